@@ -0,0 +1,248 @@
+#ifndef SZ3_COMPRESSED_ARRAY_HPP
+#define SZ3_COMPRESSED_ARRAY_HPP
+
+#include "QoZ/api/sz.hpp"
+#include "QoZ/utils/Container.hpp"
+#include <array>
+#include <list>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <stdexcept>
+
+namespace QoZ {
+
+    /**
+     * Array-like read access to a chunk-indexed container produced by SZ_compress_chunked.
+     * Tiles (chunks) are decompressed on demand and kept in a bounded LRU cache, so memory use
+     * stays at cacheBytes no matter how large the field is. When tiles are requested in a regular
+     * order (e.g. a slab-by-slab scan) the next tile is decompressed ahead of time in the background.
+     * All accessors are thread-safe. The compressed buffer is not owned and must outlive the array.
+     * Prefetching is turned off for containers compressed with SR or pybind-backed wavelets, which can
+     * not run next to another decompression. Invalid containers and corrupted tiles throw std::runtime_error.
+
+     example:
+     QoZ::CompressedArray<float, 3> arr(cmpData, cmpSize, 512 << 20);
+     float v = arr(10, 20, 30);
+     std::vector<float> plane = arr.slice(0, 10);
+     */
+    template<class T, uint N>
+    class CompressedArray {
+        static_assert(N >= 1 and N <= CONTAINER_MAX_DIM, "CompressedArray supports 1 to 4 dimensions");
+    public:
+        typedef std::shared_ptr<const std::vector<T>> Tile;
+
+        CompressedArray(const char *cmpData, size_t cmpSize, size_t cacheBytes = (size_t) 256 << 20, bool prefetch = true) :
+                cmpData(cmpData), cacheBytes(cacheBytes), prefetch(prefetch) {
+            if (!index.load((const uchar *) cmpData, cmpSize) or index.header.totalSize > cmpSize) {
+                throw std::runtime_error("CompressedArray: invalid or truncated container");
+            }
+            if (index.header.N != N or index.header.dataType != data_type_id<T>()) {
+                throw std::runtime_error("CompressedArray: container shape or data type does not match");
+            }
+            if (!SZ_chunked_parallel_safe(index, cmpData))
+                this->prefetch = false;
+            for (uint i = 0; i < N; i++) {
+                global_dims[i] = index.header.dims[i];
+                chunk_dims[i] = index.header.chunkDims[i];
+                grid_dims[i] = (global_dims[i] + chunk_dims[i] - 1) / chunk_dims[i];
+            }
+        }
+
+        ~CompressedArray() {
+            //background prefetches need the mutex to finish, so wait for them without holding it
+            std::vector<std::shared_future<Tile>> inflight;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                for (auto &p: pending)
+                    inflight.push_back(p.second);
+            }
+            for (auto &f: inflight)
+                f.wait();
+        }
+
+        const std::array<size_t, N> &dims() const {
+            return global_dims;
+        }
+
+        template<class ... Idx>
+        T operator()(Idx ... args) {
+            static_assert(sizeof...(Idx) == N, "number of indices must match the array dimension");
+            std::array<size_t, N> idx{static_cast<size_t>(args)...};
+            size_t id = tile_id(idx), offset = 0;
+            Tile tile = get_tile(id);
+            const ChunkEntry &chunk = index.chunks[id];
+            for (uint i = 0; i < N; i++)
+                offset = offset * chunk.extent[i] + idx[i] - chunk.start[i];
+            return (*tile)[offset];
+        }
+
+        /**
+         * Copies the region [lo, hi) into out, stored row-major with shape hi-lo.
+         */
+        void read_region(const std::array<size_t, N> &lo, const std::array<size_t, N> &hi, T *out) {
+            std::array<size_t, N> out_dims;
+            std::vector<size_t> vlo(N), vhi(N);
+            for (uint i = 0; i < N; i++) {
+                out_dims[i] = hi[i] - lo[i];
+                vlo[i] = lo[i];
+                vhi[i] = hi[i];
+            }
+            for (auto id: index.chunks_in_region(vlo, vhi)) {
+                Tile tile = get_tile(id);
+                const ChunkEntry &chunk = index.chunks[id];
+                //intersection of chunk and region
+                std::array<size_t, 4> ilo{0, 0, 0, 0}, ihi{1, 1, 1, 1}, cdims{1, 1, 1, 1}, odims{1, 1, 1, 1}, cst{0, 0, 0, 0}, rlo{0, 0, 0, 0};
+                for (uint i = 0; i < N; i++) {
+                    uint d = 4 - N + i;
+                    ilo[d] = std::max<size_t>(lo[i], chunk.start[i]);
+                    ihi[d] = std::min<size_t>(hi[i], chunk.start[i] + chunk.extent[i]);
+                    cdims[d] = chunk.extent[i];
+                    cst[d] = chunk.start[i];
+                    odims[d] = out_dims[i];
+                    rlo[d] = lo[i];
+                }
+                size_t row = ihi[3] - ilo[3];
+                for (size_t a = ilo[0]; a < ihi[0]; a++) {
+                    for (size_t b = ilo[1]; b < ihi[1]; b++) {
+                        for (size_t c = ilo[2]; c < ihi[2]; c++) {
+                            size_t src = (((a - cst[0]) * cdims[1] + b - cst[1]) * cdims[2] + c - cst[2]) * cdims[3] + ilo[3] - cst[3];
+                            size_t dst = (((a - rlo[0]) * odims[1] + b - rlo[1]) * odims[2] + c - rlo[2]) * odims[3] + ilo[3] - rlo[3];
+                            memcpy(out + dst, tile->data() + src, row * sizeof(T));
+                        }
+                    }
+                }
+            }
+        }
+
+        std::vector<T> read_region(const std::array<size_t, N> &lo, const std::array<size_t, N> &hi) {
+            size_t num = 1;
+            for (uint i = 0; i < N; i++)
+                num *= hi[i] - lo[i];
+            std::vector<T> out(num);
+            read_region(lo, hi, out.data());
+            return out;
+        }
+
+        //the (N-1)-dimensional slice at position idx along dimension dim
+        std::vector<T> slice(uint dim, size_t idx) {
+            std::array<size_t, N> lo{}, hi = global_dims;
+            lo[dim] = idx;
+            hi[dim] = idx + 1;
+            return read_region(lo, hi);
+        }
+
+        size_t cached_bytes() {
+            std::unique_lock<std::mutex> lock(mutex);
+            return cached_size;
+        }
+
+        const ContainerIndex &get_index() const {
+            return index;
+        }
+
+    private:
+        struct CacheEntry {
+            Tile tile;
+            std::list<size_t>::iterator lru_pos;
+        };
+
+        size_t tile_id(const std::array<size_t, N> &idx) const {
+            size_t id = 0;
+            for (uint i = 0; i < N; i++)
+                id = id * grid_dims[i] + idx[i] / chunk_dims[i];
+            return id;
+        }
+
+        Tile decompress_tile(size_t id) const {
+            auto tile = std::make_shared<std::vector<T>>(index.chunks[id].num());
+            if (!SZ_decompress_chunk<T>(index, cmpData, id, tile->data())) {
+                throw std::runtime_error("CompressedArray: failed to decompress tile " + std::to_string(id));
+            }
+            return tile;
+        }
+
+        Tile get_tile(size_t id) {
+            std::shared_future<Tile> fut;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                auto it = cache.find(id);
+                if (it != cache.end()) {
+                    lru.splice(lru.begin(), lru, it->second.lru_pos);
+                    return it->second.tile;
+                }
+                auto pit = pending.find(id);
+                if (pit != pending.end()) {
+                    fut = pit->second;
+                } else {
+                    fut = std::async(std::launch::deferred, &CompressedArray::decompress_tile, this, id).share();
+                    pending[id] = fut;
+                }
+                schedule_prefetch(id);
+            }
+            Tile tile = fut.get();
+            std::unique_lock<std::mutex> lock(mutex);
+            pending.erase(id);
+            insert(id, tile);
+            return tile;
+        }
+
+        //called with the mutex held
+        void schedule_prefetch(size_t id) {
+            if (!prefetch)
+                return;
+            size_t stride = id - last_miss;
+            last_miss = id;
+            size_t next = id + stride;
+            for (auto it = pending.begin(); it != pending.end();) {
+                //finished prefetches are already in the cache
+                if (it->first != id and it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+                    it = pending.erase(it);
+                else
+                    ++it;
+            }
+            if (stride == 0 or next >= index.chunks.size() or cache.count(next) or pending.count(next))
+                return;
+            //do not prefetch if the tile would not fit next to the current working set
+            if (2 * index.chunks[next].num() * sizeof(T) > cacheBytes)
+                return;
+            pending[next] = std::async(std::launch::async, [this, next]() {
+                Tile tile = decompress_tile(next);
+                std::unique_lock<std::mutex> lock(mutex);
+                insert(next, tile);
+                return tile;
+            }).share();
+        }
+
+        //called with the mutex held
+        void insert(size_t id, const Tile &tile) {
+            if (cache.count(id))
+                return;
+            lru.push_front(id);
+            cache[id] = CacheEntry{tile, lru.begin()};
+            cached_size += tile->size() * sizeof(T);
+            while (cached_size > cacheBytes and lru.size() > 1) {
+                size_t victim = lru.back();
+                lru.pop_back();
+                cached_size -= cache[victim].tile->size() * sizeof(T);
+                cache.erase(victim);
+            }
+        }
+
+        const char *cmpData;
+        ContainerIndex index;
+        std::array<size_t, N> global_dims, chunk_dims, grid_dims;
+        size_t cacheBytes;
+        bool prefetch;
+
+        std::mutex mutex;
+        std::list<size_t> lru;
+        std::unordered_map<size_t, CacheEntry> cache;
+        std::unordered_map<size_t, std::shared_future<Tile>> pending;
+        size_t cached_size = 0;
+        size_t last_miss = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,497 @@
+#ifndef SZ3_IMPL_SZBATCH_HPP
+#define SZ3_IMPL_SZBATCH_HPP
+
+#include "QoZ/frontend/SZGeneralFrontend.hpp"
+#include "QoZ/predictor/LorenzoPredictor.hpp"
+#include "QoZ/predictor/RegressionPredictor.hpp"
+#include "QoZ/quantizer/IntegerQuantizer.hpp"
+#include "QoZ/encoder/HuffmanEncoder.hpp"
+#include "QoZ/utils/Container.hpp"
+#include "QoZ/utils/Statistic.hpp"
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/def.hpp"
+#include "zstd.h"
+#include "QoZ/zstd/zdict.h"
+#include <vector>
+#include <array>
+#include <map>
+#include <numeric>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+/*
+ * Batched compression of many small arrays (e.g. AMR patches) into one stream.
+ *
+ * Compressing each patch with SZ_compress pays a Config tail, a Huffman tree, a zstd frame and
+ * a tuning pass per patch, which dominates the output for 16^3-64^3 patches. The batch stream shares
+ * all of that instead:
+ *   - the predictor is tuned once per refinement level on a few sample patches of that level,
+ *   - one Huffman codebook is built over the quantization bins of all patches,
+ *   - the per-patch payloads are zstd-compressed with a dictionary trained on the batch (zstd/dictBuilder).
+ * Every patch is still a separate payload listed in the batch index, so any patch can be decoded alone.
+ *
+ * Layout: [BatchHeader][PatchEntry x nPatches][zstd dictionary][Huffman tree][patch payloads ...]
+ */
+
+namespace QoZ {
+
+    constexpr uint32_t BATCH_MAGIC = 0x425a6f51; // "QoZB"
+    constexpr uint16_t BATCH_VERSION = 1;
+
+    enum BATCH_PREDICTOR {
+        BATCH_PREDICTOR_LORENZO, BATCH_PREDICTOR_LORENZO2, BATCH_PREDICTOR_REGRESSION
+    };
+    constexpr const char *BATCH_PREDICTOR_STR[] = {"BATCH_PREDICTOR_LORENZO", "BATCH_PREDICTOR_LORENZO2",
+                                                   "BATCH_PREDICTOR_REGRESSION"};
+
+    template<class T, uint N>
+    struct Patch {
+        const T *data;
+        std::array<size_t, N> dims;
+        int level = 0;//patches of the same level share the tuned predictor
+    };
+
+    struct BatchHeader {
+        uint32_t magic = BATCH_MAGIC;
+        uint16_t version = BATCH_VERSION;
+        uint8_t dataType = DATA_TYPE_OTHER;
+        uint8_t N = 0;
+        uint64_t nPatches = 0;
+        double absErrorBound = 0;
+        uint32_t blockSize = 0;
+        uint64_t dictSize = 0;//0 if no dictionary was trained
+        uint64_t treeSize = 0;
+        uint64_t totalSize = 0;
+    };
+
+    struct PatchEntry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t dims[CONTAINER_MAX_DIM] = {1, 1, 1, 1};
+        uint64_t checksum = 0;
+        int32_t level = 0;
+        uint8_t predictor = BATCH_PREDICTOR_LORENZO;
+        uint8_t reserved[3] = {0, 0, 0};
+
+        size_t num() const {
+            size_t n = 1;
+            for (uint i = 0; i < CONTAINER_MAX_DIM; i++)
+                n *= dims[i];
+            return n;
+        }
+    };
+
+    //prediction + quantization of one patch with the general frontend, data is overwritten
+    template<class T, uint N, class Predictor>
+    std::vector<int> batch_quantize(const Config &conf, Predictor predictor, T *data, std::vector<uchar> *meta) {
+        auto frontend = make_sz_general_frontend<T, N>(conf, predictor, LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2));
+        auto quant_inds = frontend.compress(data);
+        if (meta != nullptr) {
+            //unpredictable values plus the regression coefficients, which are at most a few per element
+            meta->resize(frontend.size_est() + 2 * conf.num * sizeof(T) + 4096);
+            uchar *pos = meta->data();
+            frontend.save(pos);
+            meta->resize(pos - meta->data());
+            meta->shrink_to_fit();
+        }
+        return quant_inds;
+    }
+
+    template<class T, uint N>
+    std::vector<int> batch_quantize(const Config &conf, uint8_t predictor, T *data, std::vector<uchar> *meta) {
+        if (predictor == BATCH_PREDICTOR_LORENZO2)
+            return batch_quantize<T, N>(conf, LorenzoPredictor<T, N, 2>(conf.absErrorBound), data, meta);
+        else if (predictor == BATCH_PREDICTOR_REGRESSION)
+            return batch_quantize<T, N>(conf, RegressionPredictor<T, N>(conf.blockSize, conf.absErrorBound), data, meta);
+        return batch_quantize<T, N>(conf, LorenzoPredictor<T, N, 1>(conf.absErrorBound), data, meta);
+    }
+
+    template<class T, uint N, class Predictor>
+    void batch_recover(const Config &conf, Predictor predictor, std::vector<int> &quant_inds, const uchar *&meta, size_t &remaining, T *out) {
+        auto frontend = make_sz_general_frontend<T, N>(conf, predictor, LinearQuantizer<T>());
+        frontend.load(meta, remaining);
+        frontend.decompress(quant_inds, out);
+    }
+
+    template<class T, uint N>
+    Config batch_patch_config(const Config &conf, const uint64_t *dims) {
+        Config conf_p(conf);
+        conf_p.setDims(dims, dims + N);
+        conf_p.blockSize = conf.blockSize;//setDims resets it to the default of N
+        return conf_p;
+    }
+
+    //estimated coded size of the quantization bins: zeroth order entropy of the bins plus the verbatim unpredictable values
+    inline double batch_cost(const std::vector<int> &quant_inds, size_t metaSize) {
+        std::map<int, size_t> freq;
+        for (auto q: quant_inds)
+            freq[q]++;
+        double bits = 0;
+        for (auto &f: freq) {
+            double p = (double) f.second / quant_inds.size();
+            bits -= f.second * log2(p);
+        }
+        return bits / 8 + metaSize;
+    }
+
+    /**
+     * Reader of a batch stream. Loads the index, the dictionary and the shared codebook once,
+     * then decodes any patch independently; decompress() may be called from several threads.
+     */
+    template<class T, uint N>
+    class BatchReader {
+    public:
+        BatchReader(const char *cmpData, size_t cmpSize) : cmpData((const uchar *) cmpData) {
+            valid = load(cmpSize);
+        }
+
+        ~BatchReader() {
+            if (ddict != nullptr)
+                ZSTD_freeDDict(ddict);
+        }
+
+        BatchReader(const BatchReader &) = delete;
+
+        BatchReader &operator=(const BatchReader &) = delete;
+
+        bool is_valid() const {
+            return valid;
+        }
+
+        size_t size() const {
+            return patches.size();
+        }
+
+        const PatchEntry &entry(size_t i) const {
+            return patches[i];
+        }
+
+        /**
+         * Decodes patch i into out (entry(i).num() elements).
+         * @return false if the payload checksum does not match or the payload is malformed
+         */
+        bool decompress(size_t i, T *out) const {
+            const PatchEntry &p = patches[i];
+            if (chunk_hash(cmpData + p.offset, p.size) != p.checksum) {
+                std::cerr << "Patch " << i << " is corrupted (checksum mismatch)." << std::endl;
+                return false;
+            }
+            const uchar *pos = cmpData + p.offset;
+            size_t rawLength;
+            memcpy(&rawLength, pos, sizeof(size_t));
+            //the zstd frame records its content size, do not trust the length prefix alone before allocating
+            if (ZSTD_getFrameContentSize(pos + sizeof(size_t), p.size - sizeof(size_t)) != rawLength) {
+                std::cerr << "Patch " << i << " could not be decoded." << std::endl;
+                return false;
+            }
+            std::vector<uchar> raw(rawLength);
+            ZSTD_DCtx *dctx = ZSTD_createDCtx();
+            size_t dSize = (ddict != nullptr) ?
+                           ZSTD_decompress_usingDDict(dctx, raw.data(), rawLength, pos + sizeof(size_t), p.size - sizeof(size_t), ddict) :
+                           ZSTD_decompressDCtx(dctx, raw.data(), rawLength, pos + sizeof(size_t), p.size - sizeof(size_t));
+            ZSTD_freeDCtx(dctx);
+            if (ZSTD_isError(dSize) or dSize != rawLength) {
+                std::cerr << "Patch " << i << " could not be decoded." << std::endl;
+                return false;
+            }
+
+            Config conf_p = batch_patch_config<T, N>(conf, p.dims);
+            const uchar *raw_pos = raw.data();
+            size_t remaining = rawLength;
+            size_t metaSize;
+            if (remaining < sizeof(size_t))
+                return false;
+            read(metaSize, raw_pos, remaining);
+            if (metaSize > remaining) {
+                std::cerr << "Patch " << i << " could not be decoded." << std::endl;
+                return false;
+            }
+            const uchar *meta_pos = raw_pos;
+            raw_pos += metaSize;
+            auto quant_inds = encoder.decode(raw_pos, p.num());
+            if (p.predictor == BATCH_PREDICTOR_LORENZO2)
+                batch_recover<T, N>(conf_p, LorenzoPredictor<T, N, 2>(conf.absErrorBound), quant_inds, meta_pos, metaSize, out);
+            else if (p.predictor == BATCH_PREDICTOR_REGRESSION)
+                batch_recover<T, N>(conf_p, RegressionPredictor<T, N>(conf.blockSize, conf.absErrorBound), quant_inds, meta_pos, metaSize, out);
+            else
+                batch_recover<T, N>(conf_p, LorenzoPredictor<T, N, 1>(conf.absErrorBound), quant_inds, meta_pos, metaSize, out);
+            return true;
+        }
+
+        std::vector<T> decompress(size_t i) const {
+            std::vector<T> out(patches[i].num());
+            if (!decompress(i, out.data()))
+                out.clear();
+            return out;
+        }
+
+    private:
+        bool load(size_t cmpSize) {
+            if (cmpSize < sizeof(BatchHeader))
+                return false;
+            memcpy(&header, cmpData, sizeof(BatchHeader));
+            if (header.magic != BATCH_MAGIC or header.version > BATCH_VERSION or header.N != N or
+                header.dataType != data_type_id<T>() or header.totalSize > cmpSize) {
+                return false;
+            }
+            //index, dictionary and tree must fit in the stream before anything is allocated from their sizes
+            if (header.totalSize < sizeof(BatchHeader))
+                return false;
+            size_t remaining = header.totalSize - sizeof(BatchHeader);
+            if (header.nPatches > remaining / sizeof(PatchEntry))
+                return false;
+            remaining -= header.nPatches * sizeof(PatchEntry);
+            if (header.dictSize > remaining or header.treeSize > remaining - header.dictSize)
+                return false;
+            size_t payloadStart = header.totalSize - (remaining - header.dictSize - header.treeSize);
+
+            const uchar *pos = cmpData + sizeof(BatchHeader);
+            patches.resize(header.nPatches);
+            read(patches.data(), patches.size(), pos);
+            for (auto &p: patches) {
+                if (p.offset < payloadStart or p.offset > header.totalSize or p.size > header.totalSize - p.offset or
+                    p.size < sizeof(size_t) or p.predictor > BATCH_PREDICTOR_REGRESSION)
+                    return false;
+                for (uint d = 0; d < CONTAINER_MAX_DIM; d++) {
+                    if ((d < N and p.dims[d] == 0) or (d >= N and p.dims[d] != 1))
+                        return false;
+                }
+            }
+            if (header.dictSize > 0) {
+                ddict = ZSTD_createDDict(pos, header.dictSize);
+                if (ddict == nullptr)
+                    return false;
+            }
+            pos += header.dictSize;
+            remaining = header.treeSize;
+            if (header.treeSize > 0)
+                encoder.load(pos, remaining);
+            conf.N = N;
+            conf.absErrorBound = header.absErrorBound;
+            conf.blockSize = header.blockSize;
+            return true;
+        }
+
+        const uchar *cmpData;
+        BatchHeader header;
+        std::vector<PatchEntry> patches;
+        Config conf;
+        //decode only reads the tree, so one loaded codebook serves all threads
+        mutable HuffmanEncoder<int> encoder;
+        ZSTD_DDict *ddict = nullptr;
+        bool valid = false;
+    };
+}
+
+/**
+ * API for compressing a batch of small arrays of the same dimensionality into one stream.
+ * The error bound is resolved once over the value range of the whole batch.
+ * Per level, the Lorenzo / 2nd-order Lorenzo / regression predictor with the lowest estimated cost on
+ * up to conf.batchTuningPatches sample patches is used for all patches of the level.
+ * conf.batchDictSize bounds the trained zstd dictionary (0 disables the dictionary).
+ * Patches are predicted, quantized and encoded in parallel.
+ * @return nullptr for EB_BITRATE, which is not supported for batches
+ */
+template<class T, QoZ::uint N>
+char *SZ_compress_batch(QoZ::Config &config, const std::vector<QoZ::Patch<T, N>> &patches, size_t &outSize) {
+    if (config.errorBoundMode == QoZ::EB_BITRATE) {
+        std::cerr << "EB_BITRATE is not supported for batched compression." << std::endl;
+        outSize = 0;
+        return nullptr;
+    }
+    QoZ::Config conf(config);
+    conf.N = N;
+    size_t nPatches = patches.size();
+
+    //error bound over the whole batch
+    if (conf.errorBoundMode != QoZ::EB_ABS) {
+        T mn = std::numeric_limits<T>::max(), mx = std::numeric_limits<T>::lowest();
+        size_t num = 0;
+        for (auto &p: patches) {
+            size_t n = std::accumulate(p.dims.begin(), p.dims.end(), (size_t) 1, std::multiplies<size_t>());
+            auto minmax = std::minmax_element(p.data, p.data + n);
+            mn = std::min(mn, *minmax.first);
+            mx = std::max(mx, *minmax.second);
+            num += n;
+        }
+        conf.num = num;
+        QoZ::calAbsErrorBound<T>(conf, (const T *) nullptr, std::max<T>(mx - mn, std::numeric_limits<T>::min()));
+    }
+
+    std::vector<QoZ::PatchEntry> entries(nPatches);
+    std::map<int, std::vector<size_t>> levels;
+    for (size_t i = 0; i < nPatches; i++) {
+        for (uint d = 0; d < N; d++)
+            entries[i].dims[d] = patches[i].dims[d];
+        entries[i].level = patches[i].level;
+        levels[patches[i].level].push_back(i);
+    }
+
+    //amortized tuning: one predictor per level, chosen on evenly spaced sample patches of the level
+    for (auto &level: levels) {
+        auto &ids = level.second;
+        size_t nSamples = std::min<size_t>(ids.size(), std::max(conf.batchTuningPatches, 1));
+        std::vector<uint8_t> candidates{QoZ::BATCH_PREDICTOR_LORENZO, QoZ::BATCH_PREDICTOR_LORENZO2, QoZ::BATCH_PREDICTOR_REGRESSION};
+        std::vector<double> costs(candidates.size(), 0);
+#pragma omp parallel for schedule(dynamic) collapse(2)
+        for (size_t s = 0; s < nSamples; s++) {
+            for (size_t c = 0; c < candidates.size(); c++) {
+                auto &p = patches[ids[s * ids.size() / nSamples]];
+                auto conf_p = QoZ::batch_patch_config<T, N>(conf, entries[ids[s * ids.size() / nSamples]].dims);
+                std::vector<T> copy(p.data, p.data + conf_p.num);
+                std::vector<QoZ::uchar> meta;
+                auto quant_inds = QoZ::batch_quantize<T, N>(conf_p, candidates[c], copy.data(), &meta);
+                double cost = QoZ::batch_cost(quant_inds, meta.size());
+#pragma omp atomic
+                costs[c] += cost;
+            }
+        }
+        uint8_t best = candidates[std::min_element(costs.begin(), costs.end()) - costs.begin()];
+        for (auto i: ids)
+            entries[i].predictor = best;
+    }
+
+    //prediction and quantization of all patches
+    std::vector<std::vector<int>> quant_inds(nPatches);
+    std::vector<std::vector<QoZ::uchar>> metas(nPatches);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < nPatches; i++) {
+        auto conf_p = QoZ::batch_patch_config<T, N>(conf, entries[i].dims);
+        std::vector<T> copy(patches[i].data, patches[i].data + conf_p.num);
+        quant_inds[i] = QoZ::batch_quantize<T, N>(conf_p, entries[i].predictor, copy.data(), &metas[i]);
+    }
+
+    //one Huffman codebook for the whole batch
+    QoZ::HuffmanEncoder<int> encoder;
+    std::vector<QoZ::uchar> tree;
+    {
+        std::vector<int> all;
+        for (auto &q: quant_inds)
+            all.insert(all.end(), q.begin(), q.end());
+        if (!all.empty()) {
+            encoder.preprocess_encode(all, 0);
+            tree.resize(encoder.size_est() + sizeof(int) * 4);
+            QoZ::uchar *pos = tree.data();
+            encoder.save(pos);
+            tree.resize(pos - tree.data());
+        }
+    }
+
+    //per patch raw payload: [meta size][frontend meta][huffman bits]
+    std::vector<std::vector<QoZ::uchar>> raws(nPatches);
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < nPatches; i++) {
+        auto &raw = raws[i];
+        raw.resize(sizeof(size_t) + metas[i].size() + sizeof(size_t) + 2 * quant_inds[i].size() * sizeof(int) + 64);
+        QoZ::uchar *pos = raw.data();
+        QoZ::write(metas[i].size(), pos);
+        QoZ::write(metas[i].data(), metas[i].size(), pos);
+        encoder.encode(quant_inds[i], pos);
+        raw.resize(pos - raw.data());
+        std::vector<int>().swap(quant_inds[i]);
+        std::vector<QoZ::uchar>().swap(metas[i]);
+    }
+    encoder.postprocess_encode();
+
+    //dictionary trained on the batch itself; ZDICT fails on too few or too uniform samples, then no dictionary is used
+    std::vector<QoZ::uchar> dict;
+    if (conf.batchDictSize > 0 and nPatches >= 8) {
+        std::vector<QoZ::uchar> samples;
+        std::vector<size_t> sampleSizes;
+        for (auto &raw: raws) {
+            samples.insert(samples.end(), raw.begin(), raw.end());
+            sampleSizes.push_back(raw.size());
+        }
+        dict.resize(std::min<size_t>(conf.batchDictSize, samples.size() / 10 + 256));
+        size_t dictSize = ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(), sampleSizes.data(), sampleSizes.size());
+        if (ZDICT_isError(dictSize)) {
+            dict.clear();
+        } else {
+            dict.resize(dictSize);
+        }
+    }
+
+    std::vector<std::vector<QoZ::uchar>> payloads(nPatches);
+    ZSTD_CDict *cdict = dict.empty() ? nullptr : ZSTD_createCDict(dict.data(), dict.size(), 3);
+#pragma omp parallel
+    {
+        ZSTD_CCtx *cctx = ZSTD_createCCtx();
+#pragma omp for schedule(dynamic)
+        for (size_t i = 0; i < nPatches; i++) {
+            auto &raw = raws[i];
+            auto &payload = payloads[i];
+            payload.resize(sizeof(size_t) + ZSTD_compressBound(raw.size()));
+            QoZ::uchar *pos = payload.data();
+            QoZ::write(raw.size(), pos);
+            size_t cSize = (cdict != nullptr) ?
+                           ZSTD_compress_usingCDict(cctx, pos, payload.size() - sizeof(size_t), raw.data(), raw.size(), cdict) :
+                           ZSTD_compressCCtx(cctx, pos, payload.size() - sizeof(size_t), raw.data(), raw.size(), 3);
+            payload.resize(sizeof(size_t) + cSize);
+            std::vector<QoZ::uchar>().swap(raw);
+        }
+        ZSTD_freeCCtx(cctx);
+    }
+    if (cdict != nullptr)
+        ZSTD_freeCDict(cdict);
+
+    QoZ::BatchHeader header;
+    header.dataType = QoZ::data_type_id<T>();
+    header.N = N;
+    header.nPatches = nPatches;
+    header.absErrorBound = conf.absErrorBound;
+    header.blockSize = conf.blockSize;
+    header.dictSize = dict.size();
+    header.treeSize = tree.size();
+    size_t offset = sizeof(QoZ::BatchHeader) + nPatches * sizeof(QoZ::PatchEntry) + dict.size() + tree.size();
+    for (size_t i = 0; i < nPatches; i++) {
+        entries[i].offset = offset;
+        entries[i].size = payloads[i].size();
+        entries[i].checksum = QoZ::chunk_hash(payloads[i].data(), payloads[i].size());
+        offset += payloads[i].size();
+    }
+    header.totalSize = offset;
+
+    QoZ::uchar *buffer = new QoZ::uchar[header.totalSize];
+    QoZ::uchar *buffer_pos = buffer;
+    QoZ::write(header, buffer_pos);
+    QoZ::write(entries.data(), nPatches, buffer_pos);
+    QoZ::write(dict.data(), dict.size(), buffer_pos);
+    QoZ::write(tree.data(), tree.size(), buffer_pos);
+    for (auto &payload: payloads)
+        QoZ::write(payload.data(), payload.size(), buffer_pos);
+    outSize = buffer_pos - buffer;
+    return (char *) buffer;
+}
+
+/**
+ * API for decompressing every patch of a batch stream.
+ * @param decData one vector per patch, in the order the patches were compressed
+ * @return false if the stream or any patch fails validation
+ */
+template<class T, QoZ::uint N>
+bool SZ_decompress_batch(const char *cmpData, size_t cmpSize, std::vector<std::vector<T>> &decData) {
+    QoZ::BatchReader<T, N> reader(cmpData, cmpSize);
+    if (!reader.is_valid()) {
+        std::cerr << "Invalid or truncated batch stream." << std::endl;
+        return false;
+    }
+    decData.resize(reader.size());
+    bool ok = true;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < reader.size(); i++) {
+        decData[i].resize(reader.entry(i).num());
+        if (!reader.decompress(i, decData[i].data())) {
+#pragma omp atomic write
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef SZ3_IMPL_SZCHUNKED_HPP
+#define SZ3_IMPL_SZCHUNKED_HPP
+
+#include "QoZ/utils/Container.hpp"
+#include "QoZ/utils/ChunkStats.hpp"
+#include "QoZ/utils/Statistic.hpp"
+#include "QoZ/utils/Config.hpp"
+#include <vector>
+#include <memory>
+#include <iostream>
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+/**
+ * API for chunked compression into a self-describing container (see QoZ/utils/Container.hpp)
+ * The data is split into a regular grid of chunks, each chunk is compressed independently by SZ_compress
+ * (so it carries its own config) and registered in the chunk table together with its xxhash64.
+ * The error bound is resolved once on the whole field, so all chunks share the same absolute error bound
+ * (for EB_BITRATE, the bound the rate model predicts for the whole field).
+ * @param chunkDims chunk shape, one entry per dimension. 0 or missing entries mean the whole dimension.
+ * Empty chunkDims falls back to a default chunk size depending on the dimensionality.
+ * @param stats if not null, per-chunk statistics of the original data are recorded into this sidecar index
+ */
+template<class T>
+char *SZ_compress_chunked(QoZ::Config &config, const T *data, size_t &outSize, std::vector<size_t> chunkDims = std::vector<size_t>(),
+                          QoZ::StatsIndex *stats = nullptr) {
+    QoZ::Config conf(config);
+    if (chunkDims.empty()) {
+        size_t edge = (conf.N == 1 ? (1 << 20) : (conf.N == 2 ? 1024 : (conf.N == 3 ? 256 : 64)));
+        chunkDims.assign(conf.N, edge);
+    }
+    if (conf.errorBoundMode == QoZ::EB_BITRATE) {
+        conf.absErrorBound = SZ_bitrate_error_bound<T>(conf, data);
+        conf.errorBoundMode = QoZ::EB_ABS;
+    }
+    QoZ::calAbsErrorBound<T>(conf, data);
+
+    auto chunks = QoZ::make_chunk_grid(conf.dims, chunkDims);
+    std::vector<char *> payloads(chunks.size(), nullptr);
+    std::vector<std::vector<T>> rawChunks(chunks.size());
+    //SR and pybind-backed wavelets are not safe to run from several threads
+    bool parallel = conf.wavelet <= 1 and !conf.SRNet;
+    if (stats != nullptr) {
+        auto minmax = std::minmax_element(data, data + conf.num);
+        *stats = QoZ::StatsIndex(conf.N, *minmax.first, *minmax.second, conf.absErrorBound, stats->nBins);
+        stats->resize(chunks.size());
+    }
+
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for (size_t c = 0; c < chunks.size(); c++) {
+        auto &chunk = chunks[c];
+        std::vector<T> packed(chunk.num());
+        QoZ::copy_chunk<T>(const_cast<T *>(data), conf.dims, packed.data(), chunk.start, chunk.extent, true);
+        if (stats != nullptr)
+            stats->record<T>(c, chunk, packed.data(), packed.size());
+
+        QoZ::Config conf_c(conf);
+        conf_c.setDims(chunk.extent, chunk.extent + conf.N);
+        conf_c.errorBoundMode = QoZ::EB_ABS;
+        conf_c.openmp = false;
+        size_t size_c = 0;
+        char *cmp_c = nullptr;
+        if (packed.size() > 1)
+            cmp_c = SZ_compress<T>(conf_c, packed.data(), size_c);
+        if (cmp_c == nullptr or size_c >= packed.size() * sizeof(T)) {
+            delete[] cmp_c;
+            chunk.codec = QoZ::CODEC_RAW;
+            chunk.size = packed.size() * sizeof(T);
+            rawChunks[c].swap(packed);
+        } else {
+            chunk.codec = QoZ::CODEC_QOZ;
+            chunk.size = size_c;
+            payloads[c] = cmp_c;
+        }
+    }
+
+    QoZ::ContainerWriter writer(QoZ::data_type_id<T>(), conf.dims, chunkDims);
+    for (size_t c = 0; c < chunks.size(); c++) {
+        auto payload = chunks[c].codec == QoZ::CODEC_RAW ? (QoZ::uchar *) rawChunks[c].data() : (QoZ::uchar *) payloads[c];
+        writer.add_chunk(chunks[c], payload);
+    }
+    char *cmpData = (char *) writer.save(outSize);
+    for (auto p: payloads)
+        delete[] p;
+    return cmpData;
+}
+
+/**
+ * Whether the chunks of a container can be decompressed concurrently.
+ * All chunks share the settings of the whole field, so the first compressed chunk tells whether
+ * SR or pybind-backed wavelets were used, which are not safe to run from several threads.
+ */
+inline bool SZ_chunked_parallel_safe(const QoZ::ContainerIndex &index, const char *cmpData) {
+    for (size_t c = 0; c < index.chunks.size(); c++) {
+        const QoZ::ChunkEntry &chunk = index.chunks[c];
+        if (chunk.codec == QoZ::CODEC_QOZ) {
+            if (!index.verify_chunk((const QoZ::uchar *) cmpData, index.header.totalSize, c))
+                return true;
+            QoZ::Config conf_c;
+            SZ_load_config(conf_c, cmpData + chunk.offset, chunk.size);
+            return conf_c.wavelet <= 1 and !conf_c.SRNet;
+        }
+    }
+    return true;
+}
+
+/**
+ * Decompresses one chunk of a container into a packed buffer of chunk.num() elements.
+ * The payload checksum is verified first, false is returned on mismatch.
+ */
+template<class T>
+bool SZ_decompress_chunk(const QoZ::ContainerIndex &index, const char *cmpData, size_t chunkId, T *packed) {
+    if (!index.verify_chunk((const QoZ::uchar *) cmpData, index.header.totalSize, chunkId)) {
+        std::cerr << "Chunk " << chunkId << " is corrupted (checksum mismatch)." << std::endl;
+        return false;
+    }
+    const QoZ::ChunkEntry &chunk = index.chunks[chunkId];
+    if (chunk.codec == QoZ::CODEC_RAW) {
+        if (chunk.size != chunk.num() * sizeof(T)) {
+            std::cerr << "Chunk " << chunkId << " has an invalid size." << std::endl;
+            return false;
+        }
+        memcpy(packed, cmpData + chunk.offset, chunk.size);
+    } else if (chunk.codec == QoZ::CODEC_QOZ) {
+        QoZ::Config conf_c;
+        SZ_decompress<T>(conf_c, const_cast<char *>(cmpData) + chunk.offset, chunk.size, packed);
+    } else {
+        std::cerr << "Chunk " << chunkId << " uses an unknown codec." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * API for decompressing a chunked container
+ * @param conf dims and num are set from the container header.
+ * @param decData pre-allocated memory space for decompressed data, allocated with 'new []' if nullptr
+ * @return false if the container index or any chunk fails validation
+ */
+template<class T>
+bool SZ_decompress_chunked(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *&decData) {
+    QoZ::ContainerIndex index;
+    if (!index.load((QoZ::uchar *) cmpData, cmpSize) or index.header.totalSize > cmpSize) {
+        std::cerr << "Invalid or truncated container." << std::endl;
+        return false;
+    }
+    if (index.header.dataType != QoZ::data_type_id<T>()) {
+        std::cerr << "Container data type does not match the requested type." << std::endl;
+        return false;
+    }
+    auto dims = index.dims();
+    conf.setDims(dims.begin(), dims.end());
+    if (decData == nullptr)
+        decData = new T[conf.num];
+
+    bool ok = true;
+    bool parallel = SZ_chunked_parallel_safe(index, cmpData);
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for (size_t c = 0; c < index.chunks.size(); c++) {
+        std::vector<T> packed(index.chunks[c].num());
+        if (SZ_decompress_chunk<T>(index, cmpData, c, packed.data())) {
+            QoZ::copy_chunk<T>(decData, dims, packed.data(), index.chunks[c].start, index.chunks[c].extent, false);
+        } else {
+#pragma omp atomic write
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+/**
+ * Checks the container index and every chunk checksum without decompressing anything.
+ */
+inline bool SZ_verify_chunked(const char *cmpData, size_t cmpSize) {
+    QoZ::ContainerIndex index;
+    if (!index.load((const QoZ::uchar *) cmpData, cmpSize) or index.header.totalSize > cmpSize)
+        return false;
+    for (size_t c = 0; c < index.chunks.size(); c++) {
+        if (!index.verify_chunk((const QoZ::uchar *) cmpData, index.header.totalSize, c))
+            return false;
+    }
+    return true;
+}
+
+#endif
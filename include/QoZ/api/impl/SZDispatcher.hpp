@@ -7,6 +7,7 @@
 #include "QoZ/api/impl/SZInterp.hpp"
 #include "QoZ/api/impl/SZLorenzoReg.hpp"
 #include <cmath>
+#include <stdexcept>
 
 
 template<class T, QoZ::uint N>
@@ -48,8 +49,7 @@ void SZ_decompress_dispatcher(QoZ::Config &conf, char *cmpData, size_t cmpSize,
     } else if (conf.cmprAlgo == QoZ::ALGO_INTERP) {
         SZ_decompress_Interp<T, N>(conf, cmpData, cmpSize, decData);
     } else {
-        printf("SZ_decompress_dispatcher, Method not supported\n");
-        exit(0);
+        throw std::runtime_error("SZ_decompress_dispatcher, Method not supported");
     }
 }
 
@@ -0,0 +1,284 @@
+#ifndef SZ3_IMPL_SZESTIMATE_HPP
+#define SZ3_IMPL_SZESTIMATE_HPP
+
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/utils/Statistic.hpp"
+#include "QoZ/utils/Metrics.hpp"
+#include "QoZ/utils/Timer.hpp"
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+#include <limits>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+namespace QoZ {
+
+    //a predicted quantity with its confidence interval
+    struct Interval {
+        double value = 0;
+        double low = 0;
+        double high = 0;
+    };
+
+    struct Estimate {
+        Interval ratio;
+        Interval bitrate;
+        Interval psnr;
+        Interval seconds;          //expected compression time of the whole field
+        double absErrorBound = 0;
+        double sampledFraction = 0; //fraction of the elements that were compressed for the estimate
+        double elapsed = 0;         //time spent by the estimator itself
+        double confidence = 0.95;
+        ALGO cmprAlgo = ALGO_INTERP;
+        bool exact = false;         //field too small to sample, the numbers come from a full compression
+    };
+
+    inline void print_estimate(const Estimate &e, FILE *out = stdout) {
+        fprintf(out, "estimated compression ratio = %.2f [%.2f, %.2f]\n", e.ratio.value, e.ratio.low, e.ratio.high);
+        fprintf(out, "estimated bitrate = %.4f [%.4f, %.4f]\n", e.bitrate.value, e.bitrate.low, e.bitrate.high);
+        fprintf(out, "estimated PSNR = %.3f [%.3f, %.3f]\n", e.psnr.value, e.psnr.low, e.psnr.high);
+        fprintf(out, "estimated compression time = %f [%f, %f]\n", e.seconds.value, e.seconds.low, e.seconds.high);
+        fprintf(out, "confidence = %.0f%%, predictor = %s, sampled = %.2f%%%s, estimation time = %f\n", e.confidence * 100,
+                ALGO_STR[e.cmprAlgo], e.sampledFraction * 100, e.exact ? " (exact)" : "", e.elapsed);
+    }
+
+    //two-sided 95% quantile of the t distribution
+    inline double t_quantile_95(size_t dof) {
+        static const double t[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131};
+        return dof == 0 ? 0 : (dof <= 15 ? t[dof - 1] : 1.96);
+    }
+
+    //mean of the group values +- the half width of its confidence interval
+    inline Interval group_interval(const std::vector<double> &values) {
+        Interval r;
+        size_t g = values.size();
+        for (auto v: values)
+            r.value += v;
+        r.value /= g;
+        double var = 0;
+        for (auto v: values)
+            var += (v - r.value) * (v - r.value);
+        double halfWidth = g > 1 ? t_quantile_95(g - 1) * std::sqrt(var / (g - 1) / g) : 0;
+        r.low = r.value - halfWidth;
+        r.high = r.value + halfWidth;
+        return r;
+    }
+
+    /**
+     * Block size of the sample blocks (the blocks have block_size+1 elements per dimension), shrunk to fit the
+     * shortest dimension, together with the number of blocks on the sample grid and the elements per block.
+     */
+    template<uint N>
+    size_t sample_block_size(const Config &conf, size_t &block_num, size_t &block_ele) {
+        size_t block_size = conf.sampleBlockSize > 0 ? conf.sampleBlockSize : (N == 1 ? 4096 : (N == 2 ? 64 : (N == 3 ? 32 : 16)));
+        size_t shortest = *std::min_element(conf.dims.begin(), conf.dims.end());
+        while (block_size >= 2 and block_size + 1 > shortest)
+            block_size /= 2;
+        block_num = 1;
+        block_ele = 1;
+        for (uint i = 0; i < N; i++) {
+            block_num *= (conf.dims[i] - 1) / std::max<size_t>(block_size, 1);
+            block_ele *= block_size + 1;
+        }
+        return block_size;
+    }
+
+    /**
+     * Copies the cubic blocks of edge block_size+1 at the given grid indices into packed buffers,
+     * for any dimension up to 4 (Sample.hpp only covers 2D and 3D).
+     */
+    template<class T, uint N>
+    void sample_cubic_blocks(const T *data, const std::vector<size_t> &dims, size_t block_size, const std::vector<size_t> &block_ids,
+                             std::vector<std::vector<T>> &blocks) {
+        std::array<size_t, 4> d{1, 1, 1, 1}, grid{1, 1, 1, 1}, e{1, 1, 1, 1};
+        for (uint i = 0; i < N; i++) {
+            d[4 - N + i] = dims[i];
+            grid[4 - N + i] = (dims[i] - 1) / block_size;
+            e[4 - N + i] = block_size + 1;
+        }
+        blocks.resize(block_ids.size());
+        for (size_t b = 0; b < block_ids.size(); b++) {
+            std::array<size_t, 4> s;
+            size_t id = block_ids[b];
+            for (int i = 3; i >= 0; i--) {
+                s[i] = (id % grid[i]) * block_size;
+                id /= grid[i];
+            }
+            auto &block = blocks[b];
+            block.resize(e[0] * e[1] * e[2] * e[3]);
+            size_t p = 0;
+            for (size_t i = 0; i < e[0]; i++) {
+                for (size_t j = 0; j < e[1]; j++) {
+                    for (size_t k = 0; k < e[2]; k++) {
+                        const T *row = data + (((s[0] + i) * d[1] + s[1] + j) * d[2] + s[2] + k) * d[3] + s[3];
+                        std::copy(row, row + e[3], block.begin() + p);
+                        p += e[3];
+                    }
+                }
+            }
+        }
+    }
+}
+
+template<class T, QoZ::uint N>
+QoZ::Estimate SZ_estimate_impl(const QoZ::Config &config, const T *data, double sampleRate, size_t groups) {
+    QoZ::Timer timer(true);
+    QoZ::Estimate est;
+    groups = std::max<size_t>(groups, 1);
+    QoZ::Config conf(config);
+    conf.openmp = false;
+    conf.rng = QoZ::data_range<T>(data, conf.num);
+    if (conf.errorBoundMode == QoZ::EB_BITRATE) {
+        conf.absErrorBound = SZ_bitrate_error_bound<T>(conf, data);
+        conf.errorBoundMode = QoZ::EB_ABS;
+    }
+    QoZ::calAbsErrorBound<T>(conf, data, conf.rng);
+    if (conf.rng > 0)
+        conf.relErrorBound = conf.absErrorBound / conf.rng;
+    est.absErrorBound = conf.absErrorBound;
+    double bits = sizeof(T) * 8.0;
+
+    size_t blockNum, blockEle;
+    size_t blockSize = QoZ::sample_block_size<N>(conf, blockNum, blockEle);
+    size_t sampled = std::min(blockNum, std::max<size_t>(2 * groups, (size_t) std::ceil(sampleRate * conf.num / blockEle)));
+
+    //too small to sample meaningfully, or constant (stored as one value): compress it for real
+    if (conf.rng == 0 or blockSize < 4 or sampled < 2 * groups or sampled * blockEle * 2 > conf.num) {
+        size_t outSize;
+        QoZ::Config c(config);
+        std::vector<T> work(data, data + conf.num);
+        QoZ::Timer t(true);
+        char *cmpData = SZ_compress_inplace<T>(c, work.data(), outSize);
+        double seconds = t.stop();
+        T *decData = nullptr;
+        QoZ::Config d;
+        SZ_decompress<T>(d, cmpData, outSize, decData);
+        SZ_load_config(d, cmpData, outSize);
+        double mse = 0;
+        for (size_t i = 0; i < conf.num; i++)
+            mse += ((double) decData[i] - data[i]) * ((double) decData[i] - data[i]);
+        delete[] cmpData;
+        delete[] decData;
+        est.bitrate.value = est.bitrate.low = est.bitrate.high = outSize * 8.0 / conf.num;
+        est.ratio.value = est.ratio.low = est.ratio.high = bits / est.bitrate.value;
+        est.psnr.value = est.psnr.low = est.psnr.high = mse > 0 ? QoZ::PSNR(conf.rng, mse / conf.num) : std::numeric_limits<double>::infinity();
+        est.seconds.value = est.seconds.low = est.seconds.high = seconds;
+        est.cmprAlgo = (QoZ::ALGO) d.cmprAlgo;
+        est.sampledFraction = 1;
+        est.exact = true;
+        est.elapsed = timer.stop();
+        return est;
+    }
+
+    //predictor settings are chosen the way the compressor would choose them
+    QoZ::Timer tuningTimer(true);
+    if (conf.cmprAlgo == QoZ::ALGO_INTERP_LORENZO) {
+        if (N == 2 or N == 3) {
+            std::vector<T> work(data, data + conf.num);
+            Tuning<T, N>(conf, work.data());
+        } else {
+            conf.cmprAlgo = QoZ::ALGO_INTERP;
+        }
+    }
+    double tuningTime = tuningTimer.stop();
+    est.cmprAlgo = (QoZ::ALGO) conf.cmprAlgo;
+
+    //evenly strided blocks, dealt round-robin into the groups
+    std::vector<std::vector<size_t>> groupIds(groups);
+    for (size_t b = 0; b < sampled; b++)
+        groupIds[b % groups].push_back(b * blockNum / sampled);
+    QoZ::Config testConf(conf);
+    std::vector<size_t> blockDims(N, blockSize + 1);
+    testConf.setDims(blockDims.begin(), blockDims.end());
+    testConf.sampleBlockSize = blockSize;
+    //the wavelet and sperr paths need their own preprocessed inputs, they are estimated without the transform
+    testConf.wavelet = 0;
+    testConf.sperr = -1;
+
+    std::vector<double> bitrates(groups), mses(groups), seconds(groups);
+    std::vector<std::vector<T>> allBlocks;
+    for (size_t g = 0; g < groups; g++) {
+        std::vector<std::vector<T>> blocks;
+        QoZ::sample_cubic_blocks<T, N>(data, conf.dims, blockSize, groupIds[g], blocks);
+        QoZ::Timer t(true);
+        auto res = CompressTest<T, N>(testConf, blocks, (QoZ::ALGO) conf.cmprAlgo, QoZ::TUNING_TARGET_RD, false);
+        seconds[g] = t.stop() / (blocks.size() * blockEle) * conf.num + tuningTime;
+        bitrates[g] = res.first;
+        mses[g] = conf.rng * conf.rng * std::pow(10.0, -res.second / 10);
+        std::move(blocks.begin(), blocks.end(), std::back_inserter(allBlocks));
+    }
+
+    //the entropy coder has a fixed cost (huffman tree, zstd frame) that small samples overstate, so the size is
+    //modeled as overhead + rate * elements from the group streams and one stream of all sample blocks
+    double allBitrate = CompressTest<T, N>(testConf, allBlocks, (QoZ::ALGO) conf.cmprAlgo, QoZ::TUNING_TARGET_RD, false).first;
+    double groupEle = (double) allBlocks.size() * blockEle / groups, allEle = (double) allBlocks.size() * blockEle;
+    double groupBytes = 0;
+    for (auto b: bitrates)
+        groupBytes += b * groupEle / 8 / groups;
+    double allBytes = allBitrate * allEle / 8;
+    double overhead = 0;
+    if (groups > 1 and groupBytes * groups > allBytes)
+        overhead = std::min(allBytes, (groupBytes * groups - allBytes) / (groups - 1));
+    std::vector<double> rates(groups);
+    for (size_t g = 0; g < groups; g++)
+        rates[g] = std::max(0.0, bitrates[g] - overhead * 8 / groupEle);
+    est.bitrate = QoZ::group_interval(rates);
+    double fullOverhead = overhead * 8 / conf.num;
+    est.bitrate.value += fullOverhead;
+    est.bitrate.low = std::max(est.bitrate.low, 0.0) + fullOverhead;
+    est.bitrate.high += fullOverhead;
+    est.ratio.value = bits / est.bitrate.value;
+    est.ratio.low = bits / est.bitrate.high;
+    est.ratio.high = est.bitrate.low > 0 ? bits / est.bitrate.low : std::numeric_limits<double>::infinity();
+    auto mse = QoZ::group_interval(mses);
+    est.psnr.value = QoZ::PSNR(conf.rng, mse.value);
+    est.psnr.low = QoZ::PSNR(conf.rng, mse.high);
+    est.psnr.high = mse.low > 0 ? QoZ::PSNR(conf.rng, mse.low) : std::numeric_limits<double>::infinity();
+    est.seconds = QoZ::group_interval(seconds);
+    est.seconds.low = std::max(est.seconds.low, tuningTime);
+    est.sampledFraction = (double) sampled * blockEle / conf.num;
+    est.elapsed = timer.stop();
+    return est;
+}
+
+/**
+ * API for predicting the outcome of SZ_compress without compressing the whole field.
+ * The predictor is selected as the compressor would (auto-tuning for ALGO_INTERP_LORENZO), then evenly spread
+ * sample blocks covering about sampleRate of the elements are compressed with CompressTest. The blocks are
+ * split into groups whose spread gives the 95% confidence intervals; the compression time is extrapolated
+ * from the per-element time of the sample compression plus the tuning time.
+ * The estimate is not free with ALGO_INTERP_LORENZO on 2D/3D fields: the predictor is tuned by the same Tuning pass
+ * as compression, which reads the whole field and works on a full copy of it, so the estimate costs about the
+ * tuning time and one extra copy of the input. Only the compression itself is restricted to the sample.
+ * The intervals only cover the sampling variability: sample blocks are compressed without the anchor grid of the
+ * full field, so very high ratios tend to be underestimated.
+ * Fields too small to sample, and constant fields, are compressed for real and reported as exact.
+ * With EB_BITRATE the estimate is made at the bound the rate model predicts for the target bitrate.
+ * @param sampleRate fraction of the elements to compress, e.g. 0.01
+ * @param groups number of independent sample groups used for the confidence intervals
+
+ example:
+ QoZ::Estimate e = SZ_estimate(conf, data, 0.01);
+ if (e.ratio.low > 10) ...
+ */
+template<class T>
+QoZ::Estimate SZ_estimate(const QoZ::Config &config, const T *data, double sampleRate = 0.01, size_t groups = 8) {
+    if (config.N == 1) {
+        return SZ_estimate_impl<T, 1>(config, data, sampleRate, groups);
+    } else if (config.N == 2) {
+        return SZ_estimate_impl<T, 2>(config, data, sampleRate, groups);
+    } else if (config.N == 3) {
+        return SZ_estimate_impl<T, 3>(config, data, sampleRate, groups);
+    } else if (config.N == 4) {
+        return SZ_estimate_impl<T, 4>(config, data, sampleRate, groups);
+    } else {
+        throw std::invalid_argument("Data dimension higher than 4 is not supported.");
+    }
+}
+
+#endif
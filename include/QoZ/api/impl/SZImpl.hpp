@@ -4,24 +4,135 @@
 #include "QoZ/def.hpp"
 #include "QoZ/api/impl/SZDispatcher.hpp"
 #include "QoZ/api/impl/SZImplOMP.hpp"
+#include "QoZ/utils/Statistic.hpp"
 #include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
 
+namespace QoZ {
 
+    /**
+     * Exception list of the non-finite values, as runs of equal values (e.g. a land mask):
+     * each run is stored as the gap from the end of the previous run, its length and its value.
+     */
+    template<class T>
+    std::vector<uchar> encode_nonfinite(const T *data, const std::vector<size_t> &positions) {
+        std::vector<uchar> out;
+        size_t i = 0, end = 0;
+        while (i < positions.size()) {
+            size_t p = positions[i], length = 1;
+            while (i + length < positions.size() and positions[i + length] == p + length and
+                   memcmp(&data[p + length], &data[p], sizeof(T)) == 0) {
+                length++;
+            }
+            size_t gap = p - end;
+            out.resize(out.size() + 2 * sizeof(size_t) + sizeof(T));
+            uchar *c = out.data() + out.size() - 2 * sizeof(size_t) - sizeof(T);
+            write(gap, c);
+            write(length, c);
+            write(data[p], c);
+            i += length;
+            end = p + length;
+        }
+        return out;
+    }
+
+    //replaces the non-finite values by the previous finite value in memory order, so that they do not disturb prediction
+    template<class T>
+    void fill_nonfinite(T *data, const std::vector<size_t> &positions, T first) {
+        for (auto p: positions) {
+            data[p] = p > 0 ? data[p - 1] : first;
+        }
+    }
+
+    //writes the runs of the exception list back into the num values of data, throws if the list is corrupted
+    template<class T>
+    void decode_nonfinite(T *data, size_t num, const uchar *c, size_t size) {
+        const uchar *end = c + size;
+        size_t pos = 0;
+        while (c < end) {
+            if ((size_t) (end - c) < 2 * sizeof(size_t) + sizeof(T)) {
+                throw std::runtime_error("Truncated list of non-finite values");
+            }
+            size_t gap, length;
+            T value;
+            read(gap, c);
+            read(length, c);
+            read(value, c);
+            if (gap > num - pos or length > num - pos - gap) {
+                throw std::runtime_error("List of non-finite values out of the data range");
+            }
+            pos += gap;
+            std::fill_n(data + pos, length, value);
+            pos += length;
+        }
+    }
+}
+
+/**
+ * Streams of constant fields only hold the value. A field is constant if all its finite values are equal, or if
+ * their range is within the absolute error bound, in which case the middle of the range is stored.
+ */
+template<class T>
+char *SZ_compress_constant(QoZ::Config &conf, T value, size_t &outSize) {
+    conf.constantField = true;
+    conf.wavelet = 0;
+    conf.conditioning = 0;
+    char *cmpData = new char[sizeof(T) + QoZ::Config::size_est() + conf.metadata.size()];
+    memcpy(cmpData, &value, sizeof(T));
+    outSize = sizeof(T);
+    return cmpData;
+}
+
+/**
+ * Compression of a field after a single pre-scan of the data (QoZ::scan_data): the scan gives the value range for
+ * the error bound, short-circuits constant fields, and finds the NaN/Inf values. Those are replaced by their
+ * previous finite value before compression, and stored as a run-length exception list after the compressed data
+ * (conf.nonFiniteSize bytes), to be written back by SZ_decompress_impl.
+ * data is the working buffer of the compressors and is overwritten, callers keep their own copy if they need it.
+ */
 template<class T, QoZ::uint N>
-char *SZ_compress_impl(QoZ::Config &conf, const T *data, size_t &outSize) {
+char *SZ_compress_impl(QoZ::Config &conf, T *data, size_t &outSize) {
 #ifndef _OPENMP
     conf.openmp=false;
 #endif
-    if (conf.openmp) {
-        return SZ_compress_OMP<T, N>(conf, data, outSize);
+    std::vector<size_t> nonfinite;
+    auto scan = QoZ::scan_data(data, conf.num, &nonfinite);
+    conf.rng = scan.range();//so that no compressor scans the data again for it
+    if (scan.range() > 0) {
+        QoZ::calAbsErrorBound<T>(conf, data, (T) scan.range());
+    }
+    conf.constantField = false;
+    conf.nonFiniteSize = 0;
+    //the exception list is taken before the working buffer is touched
+    auto runs = QoZ::encode_nonfinite(data, nonfinite);
+
+    char *cmpData;
+    if (scan.finite == 0 or scan.constant() or (conf.errorBoundMode == QoZ::EB_ABS and scan.range() <= conf.absErrorBound)) {
+        cmpData = SZ_compress_constant<T>(conf, (T) ((scan.min + scan.max) / 2), outSize);
+        if (nonfinite.empty()) {
+            return cmpData;
+        }
     } else {
-        std::vector<T> dataCopy(data, data + conf.num);
-        //std::cout<<"implstart"<<std::endl;
-        auto output=SZ_compress_dispatcher<T, N>(conf, dataCopy.data(), outSize);
-        //std::cout<<"implend"<<std::endl;
-       
-        return output;
+        QoZ::fill_nonfinite(data, nonfinite, (T) scan.mean);
+        if (conf.openmp) {
+            cmpData = SZ_compress_OMP<T, N>(conf, data, outSize);
+        } else {
+            cmpData = SZ_compress_dispatcher<T, N>(conf, data, outSize);
+        }
+        if (nonfinite.empty()) {
+            return cmpData;
+        }
     }
+
+    conf.nonFiniteSize = runs.size();
+    char *output = new char[outSize + conf.nonFiniteSize + QoZ::Config::size_est() + conf.metadata.size()];
+    memcpy(output, cmpData, outSize);
+    memcpy(output + outSize, runs.data(), conf.nonFiniteSize);
+    outSize += conf.nonFiniteSize;
+    delete[] cmpData;
+    return output;
 }
 
 
@@ -31,11 +142,25 @@ void SZ_decompress_impl(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *dec
     conf.openmp=false;
 #endif
     //std::cout<<"impl"<<conf.absErrorBound<<std::endl;
-    if (conf.openmp) {
+    if (conf.nonFiniteSize > cmpSize) {
+        throw std::runtime_error("List of non-finite values larger than the compressed data");
+    }
+    cmpSize -= conf.nonFiniteSize;
+    if (conf.constantField) {
+        if (cmpSize < sizeof(T)) {
+            throw std::runtime_error("Truncated constant field");
+        }
+        T value;
+        memcpy(&value, cmpData, sizeof(T));
+        std::fill_n(decData, conf.num, value);
+    } else if (conf.openmp) {
         SZ_decompress_OMP<T, N>(conf, cmpData, cmpSize, decData);
     } else {
         SZ_decompress_dispatcher<T, N>(conf, cmpData, cmpSize, decData);
     }
+    if (conf.nonFiniteSize) {
+        QoZ::decode_nonfinite(decData, conf.num, (QoZ::uchar *) cmpData + cmpSize, conf.nonFiniteSize);
+    }
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -4,6 +4,7 @@
 #include "QoZ/api/impl/SZDispatcher.hpp"
 #include <cmath>
 #include <memory>
+#include <stdexcept>
 
 
 #include "omp.h"
@@ -15,8 +16,7 @@ char *SZ_compress_OMP(QoZ::Config &conf, const T *data, size_t &outSize) {
 
     assert(N == conf.N);
     if (conf.errorBoundMode != QoZ::EB_ABS && conf.errorBoundMode != QoZ::EB_REL) {
-        printf("Error, error bound mode not supported\n");
-        exit(0);
+        throw std::runtime_error("Error, error bound mode not supported");
     }
 
     
@@ -22,13 +22,10 @@
 #include "QoZ/api/impl/SZLorenzoReg.hpp"
 
 #include "QoZ/sperr/SPERR3D_OMP_C.h"
-#include "QoZ/sperr/SPERR2D_Compressor.h"
+#include "QoZ/sperr/SPERR2D_OMP_C.h"
 #include "QoZ/sperr/SPERR3D_OMP_D.h"
-#include "QoZ/sperr/SPERR2D_Decompressor.h"
+#include "QoZ/sperr/SPERR2D_OMP_D.h"
 
-#include <pybind11/embed.h>
-#include <pybind11/numpy.h>
-#include <pybind11/stl.h>
 
 //#include <cunistd>
 #include <cmath>
@@ -36,7 +33,6 @@
 #include <limits>
 #include <cstring>
 #include <cstdlib>
-namespace py = pybind11;
 
 
 template<class T, QoZ::uint N>
@@ -46,36 +42,15 @@ bool use_sperr(const QoZ::Config & conf){
 
 template<class T, QoZ::uint N>
 auto pre_Condition(const QoZ::Config &conf,T * data){//conditioner not updated to the newest version of SPERR.
-    std::vector<double> buf(data,data+conf.num);//maybe not efficient
+    //conditions data in place: one pass for the mean and the constant test, one pass to subtract the mean
     sperr::Conditioner conditioner;
-    sperr::dims_type temp_dims={0,0,0};//temp. Fix for later introducing custom filter.
-    /*
-    if(conf.conditioning==2){
-        std::array<bool, 4> b4{true,true,false,false};
-        conditioner.toggle_all_settings(b4);
-    }
-    */
-
-    auto condi_meta = conditioner.condition(buf,temp_dims);
-    //if(rtn!=sperr::RTNType::Good)
-        //std::cout<<"bad cond"<<std::endl;
-    for(size_t i=0;i<conf.num;i++)
-        data[i]=buf[i];
-    //memcpy(data,buf.data(),conf.num*sizeof(T));//maybe not efficient
-    return condi_meta;
+    return conditioner.condition(data,conf.num);
 }
 
 template<class T, QoZ::uint N>
 auto post_Condition(T * data,const size_t &num,const sperr::vec8_type& meta){
-    std::vector<double> buf(data,data+num);
-   
-    sperr::dims_type temp_dims={0,0,0};//temp. Fix for later introducing custom filter.
     sperr::Conditioner conditioner;
-    auto rtn = conditioner.inverse_condition(buf,temp_dims,meta);
-    for(size_t i=0;i<num;i++)
-        data[i]=buf[i];
-    //memcpy(data,buf.data(),num*sizeof(T));//maybe not efficient
-    return rtn;
+    return conditioner.inverse_condition(data,num,meta);
 }
 
 template<class T, QoZ::uint N> 
@@ -109,18 +84,20 @@ char *SPERR_Compress(QoZ::Config &conf, T *data, size_t &outSize){//only support
         return outData;
     }
     else{
-        SPERR2D_Compressor compressor;
+        //the slice is compressed in tiles of conf.sperrTileSize^2, in parallel (wavelet coefficients in one tile)
+        SPERR2D_OMP_C compressor;
+        compressor.set_num_threads(0);
         compressor.set_eb_coeff(conf.wavelet_rel_coeff);
         if(conf.wavelet!=1)
             compressor.set_skip_wave(true);
         auto rtn = sperr::RTNType::Good;
-        //auto chunks = std::vector<size_t>{1024,1024,1024};//ori 256^3, to tell the truth this is not large enough for scale but I just keep it, maybe set it large later.
+        const auto tile = conf.sperrTileSize;
         if (std::is_same<T, double>::value)
             rtn = compressor.copy_data<double>(reinterpret_cast<const double*>(data), conf.num,
-                                    {conf.dims[1], conf.dims[0], 1});
+                                    {conf.dims[1], conf.dims[0], 1}, {tile, tile, 1});
         else
             rtn = compressor.copy_data<float>(reinterpret_cast<const float*>(data), conf.num,
-                                    {conf.dims[1], conf.dims[0], 1});
+                                    {conf.dims[1], conf.dims[0], 1}, {tile, tile, 1});
         if(rtn!=sperr::RTNType::Good){
             std::cerr << "Copy error."<< std::endl;
             return NULL;
@@ -131,7 +108,7 @@ char *SPERR_Compress(QoZ::Config &conf, T *data, size_t &outSize){//only support
             std::cerr << "Compression error."<< std::endl;
             return NULL;
         }
-        auto stream = compressor.view_encoded_bitstream();
+        auto stream = compressor.get_encoded_bitstream();
             
         char * outData=new char[stream.size()+conf.size_est()];
         outSize=stream.size();
@@ -174,38 +151,80 @@ void SPERR_Decompress(char *cmpData, size_t cmpSize, T *decData){//only supports
         }
     }
     else{
-        SPERR2D_Decompressor decompressor;
-      
+        //also reads the untiled streams of SPERR2D_Compressor
+        SPERR2D_OMP_D decompressor;
+        decompressor.set_num_threads(0);
         if (decompressor.use_bitstream(in_stream.data(), in_stream.size()) != sperr::RTNType::Good) {
             std::cerr << "Read compressed file error: "<< std::endl;
             return;
         }
 
-        if (decompressor.decompress() != sperr::RTNType::Good) {
+        if (decompressor.decompress(in_stream.data()) != sperr::RTNType::Good) {
             std::cerr << "Decompression failed!" << std::endl;
             return ;
         }
        
         in_stream.clear();
         in_stream.shrink_to_fit();
-        if (std::is_same<T, double>::value){
-            const auto vol = decompressor.get_data<double>();
-            memcpy(decData,vol.data(),sizeof(T)*vol.size());//maybe not efficient
-        }
-        else{
-            const auto vol = decompressor.get_data<float>();
-            memcpy(decData,vol.data(),sizeof(T)*vol.size());//maybe not efficient
-        }
+        const auto& vol = decompressor.view_data();
+        std::copy(vol.begin(), vol.end(), decData);
+    }
+}
+
+
+/**
+ * Radius of the quantization bins of the interpolation compressor: conf.quantbinCnt / 2 or, with adaptiveQuantBins,
+ * the one sampled from the errors of the configured interpolation (see QoZ::optimize_interp_quant_radius).
+ * The same radius is used in tuning (CompressTest) and in compression.
+ */
+template<class T>
+int interp_quant_radius(const QoZ::Config &conf, const T *data) {
+    int radius = conf.quantbinCnt / 2;
+    if (conf.adaptiveQuantBins) {
+        radius = QoZ::optimize_interp_quant_radius<T>(data, conf.dims, conf.absErrorBound, conf.interpMeta, radius);
     }
+    return radius;
 }
 
+template<class T>
+int interp_quant_radius(const QoZ::Config &conf, const std::vector<std::vector<T> > &blocks) {
+    int radius = conf.quantbinCnt / 2;
+    if (conf.adaptiveQuantBins) {
+        radius = QoZ::optimize_interp_quant_radius<T>(blocks, conf.dims, conf.absErrorBound, conf.interpMeta, radius);
+    }
+    return radius;
+}
+
+/**
+ * Radius of the quantization bins of the wavelet offsets compressed by the zero (offsetPredictor 0) or Lorenzo
+ * (1 and 2) predictors: conf.quantbinCnt / 2 or, with adaptiveQuantBins, the one sampled from the errors of the zero
+ * predictor, or of the 1st-order Lorenzo predictor along the fastest dimension.
+ */
+template<class T>
+int outlier_quant_radius(const QoZ::Config &conf, const T *data) {
+    int radius = conf.quantbinCnt / 2;
+    if (!conf.adaptiveQuantBins) {
+        return radius;
+    }
+    std::vector<size_t> intervals(QuantIntvSampleCapacity, 0);
+    size_t sample_count = 0;
+    size_t sample_distance = (conf.num / QuantIntvSampleCapacity) | 1;
+    if (conf.offsetPredictor == 0) {
+        QoZ::sample_quant_errors(data, conf.num, conf.dims.back(), conf.absErrorBound, 0, sample_distance,
+                                 [](const T *) { return (T) 0; }, intervals, sample_count);
+    } else {
+        QoZ::sample_quant_errors(data, conf.num, conf.dims.back(), conf.absErrorBound, 1, sample_distance,
+                                 [](const T *p) { return p[-1]; }, intervals, sample_count);
+    }
+    return QoZ::estimate_quant_radius(intervals, sample_count, radius);
+}
 
 template<class T, QoZ::uint N>
 char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
 
     char * outlier_compress_output;
     if (conf.offsetPredictor ==0){
-        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2);
+        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, outlier_quant_radius<T>(conf, data));
         auto sz = QoZ::make_sz_general_compressor<T, 1>(QoZ::make_sz_general_frontend<T, 1>(conf, QoZ::ZeroPredictor<T, 1>(), quantizer), QoZ::HuffmanEncoder<int>(),
                                                                        QoZ::Lossless_zstd());  
         outlier_compress_output =  (char *)sz->compress(conf,data,outSize);
@@ -220,7 +239,7 @@ char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
         conf.blockSize = 16;//original 5
         conf.quantbinCnt = 65536 * 2;
 
-        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2);
+        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, outlier_quant_radius<T>(conf, data));
         auto sz = make_lorenzo_regression_compressor<T, 1>(conf, quantizer, QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
         outlier_compress_output =  (char *)sz->compress(conf,data,outSize);
         delete sz;
@@ -234,7 +253,7 @@ char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
         conf.openmp = false;
         conf.blockSize = 5;
         conf.quantbinCnt = 65536 * 2;
-        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2);
+        auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, outlier_quant_radius<T>(conf, data));
         auto sz = make_lorenzo_regression_compressor<T, N>(conf, quantizer, QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
         outlier_compress_output =  (char *)sz->compress(conf,data,outSize);
         delete sz;
@@ -244,7 +263,7 @@ char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
         conf.interpMeta.interpAlgo=QoZ::INTERP_ALGO_CUBIC;
         conf.interpMeta.interpDirection=0;
         auto sz = QoZ::SZInterpolationCompressor<T, 1, QoZ::LinearQuantizer<T>, QoZ::HuffmanEncoder<int>, QoZ::Lossless_zstd>(
-        QoZ::LinearQuantizer<T>(conf.absErrorBound),
+        QoZ::LinearQuantizer<T>(conf.absErrorBound, interp_quant_radius<T>(conf, data)),
         QoZ::HuffmanEncoder<int>(),
         QoZ::Lossless_zstd());
         outlier_compress_output =  (char *)sz.compress(conf,data,outSize);
@@ -257,7 +276,7 @@ char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
         conf.interpMeta.interpAlgo=QoZ::INTERP_ALGO_CUBIC;
         conf.interpMeta.interpDirection=0;
         auto sz = QoZ::SZInterpolationCompressor<T, N, QoZ::LinearQuantizer<T>, QoZ::HuffmanEncoder<int>, QoZ::Lossless_zstd>(
-        QoZ::LinearQuantizer<T>(conf.absErrorBound),
+        QoZ::LinearQuantizer<T>(conf.absErrorBound, interp_quant_radius<T>(conf, data)),
         QoZ::HuffmanEncoder<int>(),
         QoZ::Lossless_zstd());
             
@@ -269,18 +288,23 @@ char * outlier_compress(QoZ::Config &conf,T *data,size_t &outSize){
 
 }
 
+/**
+ * Decompresses the offsets of the wavelet pipeline and adds them to decData. The offsets of offsetPredictor 0 are
+ * added as they are decoded; the other predictors read their own decoded values, so these are decoded to a buffer.
+ */
 template<class T, QoZ::uint N>
 void outlier_decompress(QoZ::Config &conf,char *cmprData,size_t outSize,T*decData){
     if (conf.offsetPredictor ==0){
         auto sz = QoZ::make_sz_general_compressor<T, 1>(QoZ::make_sz_general_frontend<T, 1>(conf, QoZ::ZeroPredictor<T, 1>(), QoZ::LinearQuantizer<T>()), QoZ::HuffmanEncoder<int>(),
                                                                        QoZ::Lossless_zstd());
 
-        sz->decompress((QoZ::uchar *)cmprData,outSize,decData);
+        sz->decompress_add((QoZ::uchar *)cmprData,outSize,decData);
        
         delete sz;
+        return;
     }
-
-    else if (conf.offsetPredictor ==1){
+    std::vector<T> offsets(conf.num);
+    if (conf.offsetPredictor ==1){
         conf.lorenzo = true;
         conf.lorenzo2 = true;
         conf.regression = false;
@@ -291,7 +315,7 @@ void outlier_decompress(QoZ::Config &conf,char *cmprData,size_t outSize,T*decDat
 
         auto sz = make_lorenzo_regression_compressor<T, 1>(conf, QoZ::LinearQuantizer<T>(), QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
                   
-        sz->decompress((QoZ::uchar *)cmprData,outSize,decData);
+        sz->decompress((QoZ::uchar *)cmprData,outSize,offsets.data());
         delete sz;
     }
     else if (conf.offsetPredictor == 2){
@@ -305,7 +329,7 @@ void outlier_decompress(QoZ::Config &conf,char *cmprData,size_t outSize,T*decDat
         conf.quantbinCnt = 65536 * 2;
 
         auto sz = make_lorenzo_regression_compressor<T, N>(conf, QoZ::LinearQuantizer<T>(), QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());       
-        sz->decompress((QoZ::uchar *)cmprData,outSize,decData);
+        sz->decompress((QoZ::uchar *)cmprData,outSize,offsets.data());
         delete sz;
     }
 
@@ -318,7 +342,7 @@ void outlier_decompress(QoZ::Config &conf,char *cmprData,size_t outSize,T*decDat
         QoZ::LinearQuantizer<T>(),
         QoZ::HuffmanEncoder<int>(),
         QoZ::Lossless_zstd());      
-        sz.decompress((QoZ::uchar *)cmprData,outSize,decData);
+        sz.decompress((QoZ::uchar *)cmprData,outSize,offsets.data());
         
     }
 
@@ -331,10 +355,12 @@ void outlier_decompress(QoZ::Config &conf,char *cmprData,size_t outSize,T*decDat
         QoZ::LinearQuantizer<T>(),
         QoZ::HuffmanEncoder<int>(),
         QoZ::Lossless_zstd());      
-        sz.decompress((QoZ::uchar *)cmprData,outSize,decData);
+        sz.decompress((QoZ::uchar *)cmprData,outSize,offsets.data());
         
     }
     
+    for(size_t i=0;i<conf.num;i++)
+        decData[i]+=offsets[i];
 }
 
 template<class T, QoZ::uint N>
@@ -351,9 +377,8 @@ char *SZ_compress_Interp(QoZ::Config &conf, T *data, size_t &outSize) {
     QoZ::calAbsErrorBound(conf, data);
 
     //conf.print();
-    
     auto sz = QoZ::SZInterpolationCompressor<T, N, QoZ::LinearQuantizer<T>, QoZ::HuffmanEncoder<int>, QoZ::Lossless_zstd>(
-            QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2),
+            QoZ::LinearQuantizer<T>(conf.absErrorBound, interp_quant_radius<T>(conf, data)),
             QoZ::HuffmanEncoder<int>(),
             QoZ::Lossless_zstd());
 
@@ -449,7 +474,7 @@ void SZ_decompress_Interp(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *d
          //QoZ::writefile<T>("waved.qoz.dec.logit", decData, conf.num);
 
         if(conf.wavelet>1){
-            T* newDecData;
+            //the inverse transform writes into decData, which holds the conf.coeffs_num >= conf.num coefficients
             if(conf.pyBind){
               
                 
@@ -457,7 +482,7 @@ void SZ_decompress_Interp(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *d
                 size_t ori_num=conf.num;
                 conf.dims=conf.coeffs_dims;
                 conf.num=conf.coeffs_num; 
-                newDecData= QoZ::pybind_wavelet_postprocessing<T,N>(conf,decData,conf.metadata,conf.wavelet, false,ori_dims);
+                QoZ::pybind_wavelet_postprocessing<T,N>(conf,decData,conf.metadata,conf.wavelet, false,ori_dims,decData);
                 conf.dims=ori_dims;
                 conf.num=ori_num;
                
@@ -465,14 +490,7 @@ void SZ_decompress_Interp(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *d
                 
             }
             else
-                newDecData= QoZ::external_wavelet_postprocessing<T,N>(decData, conf.coeffs_dims, conf.coeffs_num, conf.wavelet, conf.pid, false,conf.dims);
-
-            
-          
-            delete []decData;
-            decData = new T [conf.num];
-            memcpy(decData,newDecData,sizeof(T)*conf.num);//maybe not efficient
-            delete []newDecData;
+                QoZ::external_wavelet_postprocessing<T,N>(decData, conf.coeffs_dims, conf.coeffs_num, conf.wavelet, conf.pid, false,conf.dims,decData);
 
         
         }
@@ -492,14 +510,7 @@ void SZ_decompress_Interp(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *d
        
         
         if(second>0){
-            T *offsets =new T [conf.num];
-            outlier_decompress<T,N>(conf,(char*)(cmpDataPos+first),second,offsets);
-        
-        
-        //QoZ::writefile<T>("waved.qoz.dec.offset", offsets, conf.num); 
-            for(size_t i=0;i<conf.num;i++)
-                decData[i]+=offsets[i];//maybe not efficient
-            delete [] offsets;
+            outlier_decompress<T,N>(conf,(char*)(cmpDataPos+first),second,decData);
         }
         
     }    
@@ -826,7 +837,7 @@ std::pair<double,double> CompressTest(const QoZ::Config &conf,const std::vector<
     size_t totalOutSize=0;
     if(algo == QoZ::ALGO_LORENZO_REG){
         auto quantizer = QoZ::LinearQuantizer<T>(testConfig.absErrorBound, testConfig.quantbinCnt / 2);
-        if (useFast &&N == 3 && !testConfig.regression2) {
+        if (useFast && !testConfig.regression2) {
             sz = QoZ::make_sz_general_compressor<T, N>(QoZ::make_sz_fast_frontend<T, N>(testConfig, quantizer), QoZ::HuffmanEncoder<int>(),
                                                                    QoZ::Lossless_zstd());
         }
@@ -837,8 +848,9 @@ std::pair<double,double> CompressTest(const QoZ::Config &conf,const std::vector<
     }
     else if(algo == QoZ::ALGO_INTERP){
 
+        const auto &blocks = (testConfig.wavelet == 0 or waveleted_input.size() == 0) ? sampled_blocks : waveleted_input;
         sz =  new QoZ::SZInterpolationCompressor<T, N, QoZ::LinearQuantizer<T>, QoZ::HuffmanEncoder<int>, QoZ::Lossless_zstd>(
-                        QoZ::LinearQuantizer<T>(testConfig.absErrorBound),
+                        QoZ::LinearQuantizer<T>(testConfig.absErrorBound, interp_quant_radius<T>(testConfig, blocks)),
                         QoZ::HuffmanEncoder<int>(),
                         QoZ::Lossless_zstd());
 
@@ -1053,7 +1065,7 @@ std::pair<double,double> CompressTest(const QoZ::Config &conf,const std::vector<
     return std::pair(bitrate,metric);
 }
 
-std::pair <double,double> setABwithRelBound(double rel_bound,int configuration=0){
+inline std::pair <double,double> setABwithRelBound(double rel_bound,int configuration=0){
 
     double cur_alpha=-1,cur_beta=-1;
     if(configuration==0){              
@@ -1129,7 +1141,7 @@ std::pair <double,double> setABwithRelBound(double rel_bound,int configuration=0
     return std::pair<double,double>(cur_alpha,cur_beta);
 }
 
-void setWaveFixRates(QoZ::Config &conf,double rel_bound){
+inline void setWaveFixRates(QoZ::Config &conf,double rel_bound){
     if(1){//if(conf.sperr>=1){
        // double em1=5e-5;//old
        // double em1=5e-5;//nf1
@@ -1229,7 +1241,7 @@ void setWaveFixRates(QoZ::Config &conf,double rel_bound){
     
 
 }
-void setLorenzoFixRates(QoZ::Config &conf,double rel_bound){
+inline void setLorenzoFixRates(QoZ::Config &conf,double rel_bound){
     double e1=1e-5;
     double e2=1e-4;
     double e3=1e-3;
@@ -1747,7 +1759,7 @@ double Tuning(QoZ::Config &conf, T *data){
                 std::vector<uint8_t> cubicSplineType_list(conf.levelwisePredictionSelection,0);
                 */
                 auto sz = QoZ::SZInterpolationCompressor<T, N, QoZ::LinearQuantizer<T>, QoZ::HuffmanEncoder<int>, QoZ::Lossless_zstd>(
-                                        QoZ::LinearQuantizer<T>(conf.absErrorBound),
+                                        QoZ::LinearQuantizer<T>(conf.absErrorBound, interp_quant_radius<T>(conf, sampled_blocks)),
                                         QoZ::HuffmanEncoder<int>(),
                                         QoZ::Lossless_zstd());   
                 double best_accumulated_interp_loss_1=0;
@@ -22,6 +22,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <memory>
+#include <stdexcept>
 
 
 template<class T, QoZ::uint N, class Quantizer, class Encoder, class Lossless>
@@ -33,8 +34,7 @@ make_lorenzo_regression_compressor(const QoZ::Config &conf, Quantizer quantizer,
     int methodCnt = (conf.lorenzo + conf.lorenzo2 + conf.regression + conf.regression2);
     int use_single_predictor = (methodCnt == 1);
     if (methodCnt == 0) {
-        printf("All lorenzo and regression methods are disabled.\n");
-        exit(0);
+        throw std::runtime_error("All lorenzo and regression methods are disabled.");
     }
     if (conf.lorenzo) {
         
@@ -86,7 +86,7 @@ make_lorenzo_regression_compressor(const QoZ::Config &conf, Quantizer quantizer,
         }
     }
     return QoZ::make_sz_general_compressor<T, N>(
-            QoZ::make_sz_general_frontend<T, N>(conf, QoZ::ComposedPredictor<T, N>(predictors),
+            QoZ::make_sz_general_frontend<T, N>(conf, QoZ::ComposedPredictor<T, N>(predictors, conf.streamVersion),
                                                quantizer), encoder, lossless);
 }
 
@@ -100,8 +100,8 @@ char *SZ_compress_LorenzoReg(QoZ::Config &conf, T *data, size_t &outSize) {
 
     char *cmpData;
     auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2);
-    if (N == 3 and !conf.regression2 ) {
-        // use fast version for 3D
+    if (!conf.regression2) {
+        // use the fast version unless the second-order regression is requested
         auto sz = QoZ::make_sz_general_compressor<T, N>(QoZ::make_sz_fast_frontend<T, N>(conf, quantizer), QoZ::HuffmanEncoder<int>(),
                                                        QoZ::Lossless_zstd());
         cmpData = (char *) sz->compress(conf, data, outSize);
@@ -123,8 +123,8 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
     if(conf.wavelet==0){
 
         
-        if (N == 3 and !conf.regression2) {
-            // use fast version for 3D
+        if (!conf.regression2 and (N == 3 or conf.streamVersion >= 1)) {
+            // use the fast version unless the second-order regression is requested (3D only before stream version 1)
             auto sz = QoZ::make_sz_general_compressor<T, N>(QoZ::make_sz_fast_frontend<T, N>(conf, quantizer),
                                                            QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
             sz->decompress(cmpDataPos, cmpSize, decData);
@@ -145,8 +145,8 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
 
         size_t first =conf.firstSize;
         size_t second=cmpSize-conf.firstSize;
-        if (N == 3 and !conf.regression2 ) {
-            // use fast version for 3D
+        if (!conf.regression2 and (N == 3 or conf.streamVersion >= 1)) {
+            // use the fast version unless the second-order regression is requested (3D only before stream version 1)
             auto sz = QoZ::make_sz_general_compressor<T, N>(QoZ::make_sz_fast_frontend<T, N>(conf, quantizer),
                                                            QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
             sz->decompress(cmpDataPos, first, decData);
@@ -178,15 +178,8 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
          //QoZ::writefile<T>("waved.qoz.dec.logit", decData, conf.num);
         if(conf.wavelet>1){
 
-            T* newDecData= QoZ::external_wavelet_postprocessing<T,N>(decData, conf.coeffs_dims, conf.coeffs_num, conf.wavelet, conf.pid, false,conf.dims);
-            
-          
-            //delete []decData;
-            //decData=newDecData;
-            delete []decData;
-            decData = new T [conf.num];
-            memcpy(decData,newDecData,sizeof(T)*conf.num);
-            delete []newDecData;
+            //the inverse transform writes into decData, which holds the conf.coeffs_num >= conf.num coefficients
+            QoZ::external_wavelet_postprocessing<T,N>(decData, conf.coeffs_dims, conf.coeffs_num, conf.wavelet, conf.pid, false,conf.dims,decData);
 
             
         }
@@ -202,7 +195,9 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
         
        
        
-        T *offsets =new T [conf.num];
+        //the offsets of offsetPredictor 0 are added to decData as they are decoded, the others read their own
+        //decoded values and go through a buffer
+        std::vector<T> offsets;
         
 
         QoZ::Config newconf(conf.num);
@@ -216,10 +211,11 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
            
             
        
-             sz2->decompress(cmpDataPos+first,second,offsets);
+             sz2->decompress_add(cmpDataPos+first,second,decData);
         }
 
         else if (conf.offsetPredictor ==1){
+            offsets.resize(conf.num);
             newconf.lorenzo = true;
             newconf.lorenzo2 = true;
             newconf.regression = false;
@@ -233,9 +229,10 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
            
             
        
-              sz2->decompress(cmpDataPos+first,second,offsets);
+              sz2->decompress(cmpDataPos+first,second,offsets.data());
         }
         else if (conf.offsetPredictor == 2){
+            offsets.resize(conf.num);
             newconf.setDims(conf.dims.begin(),conf.dims.end());
             newconf.lorenzo = true;
             newconf.lorenzo2 = true;
@@ -250,10 +247,11 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
            
             
        
-            sz2->decompress(cmpDataPos+first,second,offsets);
+            sz2->decompress(cmpDataPos+first,second,offsets.data());
         }
 
         else if (conf.offsetPredictor == 3){
+            offsets.resize(conf.num);
             newconf.interpMeta.interpAlgo=QoZ::INTERP_ALGO_CUBIC;
             newconf.interpMeta.interpDirection=0;
 
@@ -264,10 +262,11 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
             QoZ::Lossless_zstd());
             
        
-            sz2.decompress(cmpDataPos+first,second,offsets);
+            sz2.decompress(cmpDataPos+first,second,offsets.data());
         }
 
         else if (conf.offsetPredictor == 4){
+            offsets.resize(conf.num);
             
             newconf.setDims(conf.dims.begin(),conf.dims.end());
             newconf.interpMeta.interpAlgo=QoZ::INTERP_ALGO_CUBIC;
@@ -279,7 +278,7 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
             QoZ::Lossless_zstd());
             
        
-            sz2.decompress(cmpDataPos+first,second,offsets);
+            sz2.decompress(cmpDataPos+first,second,offsets.data());
         }
         //QoZ::writefile<T>("waved.qoz.dec.offset", offsets, conf.num);
 
@@ -287,13 +286,12 @@ void SZ_decompress_LorenzoReg(const QoZ::Config &theconf, char *cmpData, size_t
         
        
 
-        for(size_t i=0;i<conf.num;i++)
+        for(size_t i=0;i<offsets.size();i++)
             decData[i]+=offsets[i];
       
 
         //delete [] cmpDataFirst;
         //delete [] cmpDataSecond;
-        delete [] offsets;
 
         
     }
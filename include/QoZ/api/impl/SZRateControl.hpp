@@ -0,0 +1,225 @@
+#ifndef SZ3_IMPL_SZRATECONTROL_HPP
+#define SZ3_IMPL_SZRATECONTROL_HPP
+
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/utils/Statistic.hpp"
+#include "QoZ/api/impl/SZEstimate.hpp"
+#include <vector>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace QoZ {
+
+    /**
+     * Sample-based rate model: the bitrate of a fixed set of sample blocks as a function of the absolute error bound,
+     * measured with CompressTest. Fields too small to sample are measured by compressing them entirely.
+     */
+    template<class T, uint N>
+    class RateModel {
+    public:
+        RateModel(const Config &config, const T *data, double sampleRate = 0.01) : conf(config), data(data) {
+            conf.openmp = false;
+            rng = data_range<T>(data, conf.num);
+            conf.rng = rng;
+            //constant fields are stored as one value whatever the bound, there is nothing to model
+            sampling = false;
+            if (rng <= 0)
+                return;
+            size_t blockNum, blockEle;
+            size_t blockSize = sample_block_size<N>(conf, blockNum, blockEle);
+            size_t sampled = std::min(blockNum, std::max<size_t>(16, (size_t) std::ceil(sampleRate * conf.num / blockEle)));
+            sampling = blockSize >= 4 and sampled >= 16 and sampled * blockEle * 2 <= conf.num;
+            if (!sampling)
+                return;
+            std::vector<size_t> ids;
+            for (size_t b = 0; b < sampled; b++)
+                ids.push_back(b * blockNum / sampled);
+            sample_cubic_blocks<T, N>(data, conf.dims, blockSize, ids, blocks);
+            //the model compresses with the untuned interpolation settings, tuning is left to the real compression
+            algo = conf.cmprAlgo == ALGO_LORENZO_REG ? ALGO_LORENZO_REG : ALGO_INTERP;
+            std::vector<size_t> blockDims(N, blockSize + 1);
+            conf.setDims(blockDims.begin(), blockDims.end());
+            conf.sampleBlockSize = blockSize;
+            conf.wavelet = 0;
+            conf.sperr = -1;
+        }
+
+        double bitrate(double eb) {
+            Config c(conf);
+            c.errorBoundMode = EB_ABS;
+            c.absErrorBound = eb;
+            c.relErrorBound = rng > 0 ? eb / rng : 0;
+            if (!sampling) {
+                size_t outSize;
+                char *cmpData = SZ_compress<T>(c, data, outSize);
+                delete[] cmpData;
+                return outSize * 8.0 / c.num;
+            }
+            if (c.QoZ > 0) {
+                auto ab = setABwithRelBound(c.relErrorBound, 0);
+                c.alpha = ab.first;
+                c.beta = ab.second;
+            }
+            return CompressTest<T, N>(c, blocks, algo, TUNING_TARGET_CR, false).first;
+        }
+
+        /**
+         * Absolute error bound whose modeled bitrate is within tolerance of target.
+         * The bitrate decreases monotonically with the bound, so the root is bracketed by decades
+         * and refined by regula falsi (Illinois variant) on log(bound) vs. log(bitrate).
+         * Constant fields (zero range) get a bound of 0, they are stored as one value anyway.
+         */
+        double solve(double target, double tolerance) {
+            if (rng <= 0)
+                return 0;
+            auto f = [&](double x) {
+                return std::log(bitrate(std::exp(x)) / target);
+            };
+            double lo = std::log(rng * 1e-12), hi = std::log(rng), ltol = std::log1p(tolerance / 2);
+            double xa = std::log(rng * 1e-3), fa = f(xa);
+            if (std::fabs(fa) <= ltol)
+                return std::exp(xa);
+            double step = std::log(10.0) * (fa > 0 ? 1 : -1);
+            double xb = xa, fb = fa;
+            while (fa * fb > 0) {
+                xa = xb;
+                fa = fb;
+                xb = std::min(hi, std::max(lo, xa + step));
+                //the target is out of reach, e.g. below the bitrate of an all-zero quantization
+                if (xb == xa)
+                    return std::exp(xa);
+                fb = f(xb);
+                if (std::fabs(fb) <= ltol)
+                    return std::exp(xb);
+            }
+            int side = 0;
+            for (int it = 0; it < 20; it++) {
+                double x = (xa * fb - xb * fa) / (fb - fa);
+                double fx = f(x);
+                if (std::fabs(fx) <= ltol)
+                    return std::exp(x);
+                if (fx * fb > 0) {
+                    xb = x;
+                    fb = fx;
+                    if (side == -1)
+                        fa /= 2;
+                    side = -1;
+                } else {
+                    xa = x;
+                    fa = fx;
+                    if (side == 1)
+                        fb /= 2;
+                    side = 1;
+                }
+            }
+            return std::exp(std::fabs(fa) < std::fabs(fb) ? xa : xb);
+        }
+
+        double range() const {
+            return rng;
+        }
+
+    private:
+        Config conf;
+        const T *data;
+        double rng;
+        bool sampling;
+        ALGO algo = ALGO_INTERP;
+        std::vector<std::vector<T>> blocks;
+    };
+}
+
+template<class T, QoZ::uint N>
+char *SZ_compress_bitrate_impl(QoZ::Config &config, T *data, size_t &outSize) {
+    double target = config.targetBitrate, tolerance = config.bitrateTolerance;
+    if (target <= 0) {
+        throw std::runtime_error("Error, target bitrate must be positive");
+    }
+    QoZ::RateModel<T, N> model(config, data);
+    QoZ::Config conf(config);
+    conf.errorBoundMode = QoZ::EB_ABS;
+    conf.rng = model.range();
+    conf.absErrorBound = model.solve(target, tolerance);
+    if (model.range() <= 0)
+        return SZ_compress_inplace<T>(conf, data, outSize);
+    double modeled = model.bitrate(conf.absErrorBound);
+    //the first pass works on a copy, so data is still intact for the corrective pass
+    char *cmpData = SZ_compress<T>(conf, data, outSize);
+    double achieved = outSize * 8.0 / conf.num;
+    if (conf.verbose)
+        std::cout << "Rate control: abs error bound = " << conf.absErrorBound << ", modeled bitrate = " << modeled
+                  << ", achieved bitrate = " << achieved << std::endl;
+    if (std::fabs(achieved / target - 1) <= tolerance)
+        return cmpData;
+
+    //one corrective pass: the model is assumed to be off by the same factor near the target
+    QoZ::Config conf2(config);
+    conf2.errorBoundMode = QoZ::EB_ABS;
+    conf2.rng = model.range();
+    conf2.absErrorBound = model.solve(target * modeled / achieved, tolerance);
+    size_t outSize2;
+    char *cmpData2 = SZ_compress_inplace<T>(conf2, data, outSize2);
+    double achieved2 = outSize2 * 8.0 / conf2.num;
+    if (conf.verbose)
+        std::cout << "Rate control: corrected abs error bound = " << conf2.absErrorBound << ", achieved bitrate = " << achieved2 << std::endl;
+    if (std::fabs(achieved2 / target - 1) <= std::fabs(achieved / target - 1)) {
+        delete[] cmpData;
+        outSize = outSize2;
+        return cmpData2;
+    }
+    delete[] cmpData2;
+    return cmpData;
+}
+
+template<class T, QoZ::uint N>
+double SZ_bitrate_error_bound_impl(const QoZ::Config &config, const T *data) {
+    if (config.targetBitrate <= 0) {
+        throw std::runtime_error("Error, target bitrate must be positive");
+    }
+    QoZ::RateModel<T, N> model(config, data);
+    return model.solve(config.targetBitrate, config.bitrateTolerance);
+}
+
+/**
+ * Absolute error bound that the rate model predicts for config.targetBitrate on data.
+ * Used by the entry points that resolve one bound for a whole field and then compress it in pieces
+ * (SZ_compress_chunked, SZ_compress_sweep, SZ_estimate), so there the target is met approximately, without a corrective pass.
+ */
+template<class T>
+double SZ_bitrate_error_bound(const QoZ::Config &config, const T *data) {
+    if (config.N == 1) {
+        return SZ_bitrate_error_bound_impl<T, 1>(config, data);
+    } else if (config.N == 2) {
+        return SZ_bitrate_error_bound_impl<T, 2>(config, data);
+    } else if (config.N == 3) {
+        return SZ_bitrate_error_bound_impl<T, 3>(config, data);
+    } else if (config.N == 4) {
+        return SZ_bitrate_error_bound_impl<T, 4>(config, data);
+    } else {
+        throw std::runtime_error("Data dimension higher than 4 is not supported.");
+    }
+}
+
+/**
+ * Compression to a target bitrate (EB_BITRATE, bits per value in config.targetBitrate).
+ * The absolute error bound is picked with a sample-based rate model, the field is compressed with it, and if the
+ * achieved bitrate misses the target by more than config.bitrateTolerance, the model is rescaled by the observed
+ * error and the field is compressed once more. The result closer to the target is returned.
+ */
+template<class T>
+char *SZ_compress_bitrate(QoZ::Config &config, T *data, size_t &outSize) {
+    if (config.N == 1) {
+        return SZ_compress_bitrate_impl<T, 1>(config, data, outSize);
+    } else if (config.N == 2) {
+        return SZ_compress_bitrate_impl<T, 2>(config, data, outSize);
+    } else if (config.N == 3) {
+        return SZ_compress_bitrate_impl<T, 3>(config, data, outSize);
+    } else if (config.N == 4) {
+        return SZ_compress_bitrate_impl<T, 4>(config, data, outSize);
+    } else {
+        throw std::runtime_error("Data dimension higher than 4 is not supported.");
+    }
+}
+
+#endif
@@ -0,0 +1,217 @@
+#ifndef SZ3_IMPL_SZSWEEP_HPP
+#define SZ3_IMPL_SZSWEEP_HPP
+
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/utils/Statistic.hpp"
+#include "QoZ/utils/Timer.hpp"
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+
+namespace QoZ {
+
+    //one row of the rate-distortion table produced by SZ_compress_sweep
+    struct SweepPoint {
+        double bound = 0;          //requested bound, in the unit of the config's error bound mode
+        double absErrorBound = 0;
+        size_t cmpSize = 0;
+        double ratio = 0;
+        double bitrate = 0;
+        double psnr = 0;           //psnr and maxError are only filled when the streams are evaluated
+        double maxError = 0;
+        double seconds = 0;        //compression time of this bound, tuning of the reference bound included
+        bool sharedTuning = false; //compressed with the predictor settings tuned at the reference bound
+    };
+
+    inline void print_sweep_table(const std::vector<SweepPoint> &table, FILE *out = stdout) {
+        fprintf(out, "%12s %14s %12s %10s %10s %10s %14s %10s %s\n", "bound", "abs_eb", "bytes", "ratio", "bitrate", "psnr",
+                "max_error", "time", "tuning");
+        for (auto &p: table) {
+            fprintf(out, "%12g %14g %12zu %10.3f %10.4f %10.3f %14g %10.4f %s\n", p.bound, p.absErrorBound, p.cmpSize, p.ratio,
+                    p.bitrate, p.psnr, p.maxError, p.seconds, p.sharedTuning ? "shared" : "own");
+        }
+    }
+
+    template<class T>
+    void sweep_evaluate(SweepPoint &p, const T *data, const T *recon, size_t num, double rng) {
+        double mse = 0, maxErr = 0;
+        size_t finite = 0;
+        for (size_t i = 0; i < num; i++) {
+            //NaN/Inf values are restored exactly and are left out of the error
+            if (!std::isfinite(data[i]))
+                continue;
+            double err = (double) recon[i] - (double) data[i];
+            mse += err * err;
+            maxErr = std::max(maxErr, std::fabs(err));
+            finite++;
+        }
+        mse /= std::max<size_t>(finite, 1);
+        p.maxError = maxErr;
+        //exact reconstructions, e.g. of constant fields (rng == 0), have an infinite psnr
+        p.psnr = mse > 0 ? 20 * log10(rng) - 10 * log10(mse) : std::numeric_limits<double>::infinity();
+    }
+
+    //sets the bound of the config's error bound mode, so that calAbsErrorBound can resolve it
+    inline void set_sweep_bound(Config &conf, double bound) {
+        if (conf.errorBoundMode == EB_ABS) {
+            conf.absErrorBound = bound;
+        } else if (conf.errorBoundMode == EB_REL or conf.errorBoundMode == EB_ABS_AND_REL or conf.errorBoundMode == EB_ABS_OR_REL) {
+            conf.relErrorBound = bound;
+        } else if (conf.errorBoundMode == EB_PSNR) {
+            conf.psnrErrorBound = bound;
+        } else if (conf.errorBoundMode == EB_L2NORM) {
+            conf.l2normErrorBound = bound;
+        } else if (conf.errorBoundMode == EB_BITRATE) {
+            conf.targetBitrate = bound;
+        } else {
+            throw std::invalid_argument("Error, error bound mode not supported");
+        }
+    }
+}
+
+template<class T, QoZ::uint N>
+std::vector<char *> SZ_compress_sweep_impl(QoZ::Config &config, const T *data, const std::vector<double> &bounds,
+                                           std::vector<size_t> &outSizes, std::vector<QoZ::SweepPoint> *table, bool evaluate) {
+    size_t n = bounds.size();
+    std::vector<char *> streams(n, nullptr);
+    std::vector<QoZ::SweepPoint> points(n);
+    outSizes.assign(n, 0);
+    if (n == 0)
+        return streams;
+
+    //the value range is computed once and shared by the bound resolution, the tuning and the evaluation
+    QoZ::Config conf(config);
+    conf.openmp = false;
+    double rng = QoZ::scan_data<T>(data, conf.num).range();
+    conf.rng = rng;
+    std::vector<QoZ::Config> confs(n, conf);
+    for (size_t i = 0; i < n; i++) {
+        QoZ::set_sweep_bound(confs[i], bounds[i]);
+        if (confs[i].errorBoundMode == QoZ::EB_BITRATE) {
+            confs[i].absErrorBound = SZ_bitrate_error_bound<T>(confs[i], data);
+            confs[i].errorBoundMode = QoZ::EB_ABS;
+        }
+        QoZ::calAbsErrorBound<T>(confs[i], data, rng);
+        //constant fields (rng == 0) keep their bounds, they are stored as one value anyway
+        if (confs[i].relErrorBound <= 0 and rng > 0)
+            confs[i].relErrorBound = confs[i].absErrorBound / rng;
+        points[i].bound = bounds[i];
+        points[i].absErrorBound = confs[i].absErrorBound;
+    }
+
+    //the median bound is compressed with the full auto-tuning, the tuned config is kept for the other bounds
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return confs[a].absErrorBound < confs[b].absErrorBound;
+    });
+    size_t ref = order[n / 2];
+    QoZ::Timer timer(true);
+    QoZ::Config tuned(confs[ref]);
+    std::vector<T> refWork(data, data + conf.num);
+    streams[ref] = SZ_compress_impl<T, N>(tuned, refWork.data(), outSizes[ref]);
+    std::vector<T>().swap(refWork);
+    SZ_save_config(tuned, streams[ref], outSizes[ref]);
+    points[ref].seconds = timer.stop();
+
+    //only the plain interpolation path keeps everything it tuned in the config,
+    //the lorenzo, wavelet and sperr paths are re-tuned per bound
+    //constant fields and fields with NaN/Inf values are handled by SZ_compress_impl only
+    bool share = config.cmprAlgo == QoZ::ALGO_INTERP_LORENZO and tuned.cmprAlgo == QoZ::ALGO_INTERP and tuned.wavelet == 0
+                 and !use_sperr<T, N>(tuned) and !tuned.constantField and tuned.nonFiniteSize == 0 and rng > 0;
+    //SR and pybind-backed wavelets are not safe to run from several threads
+    bool parallel = conf.wavelet <= 1 and !conf.SRNet;
+
+#pragma omp parallel for schedule(dynamic) if(parallel)
+    for (size_t k = 0; k < n; k++) {
+        if (k == ref)
+            continue;
+        QoZ::Timer t(true);
+        if (share) {
+            QoZ::Config conf_k(tuned);
+            conf_k.errorBoundMode = QoZ::EB_ABS;
+            conf_k.absErrorBound = confs[k].absErrorBound;
+            conf_k.relErrorBound = confs[k].absErrorBound / rng;
+            //alpha and beta scale the level-wise error bounds and depend on the bound itself
+            if (tuned.autoTuningRate > 0) {
+                auto ab = setABwithRelBound(conf_k.relErrorBound, 0);
+                conf_k.alpha = ab.first;
+                conf_k.beta = ab.second;
+            }
+            //the interpolation compressor overwrites its input with the reconstruction,
+            //so the stream is evaluated without decompressing it
+            std::vector<T> work(data, data + conf.num);
+            streams[k] = SZ_compress_dispatcher<T, N>(conf_k, work.data(), outSizes[k]);
+            SZ_save_config(conf_k, streams[k], outSizes[k]);
+            points[k].seconds = t.stop();
+            if (evaluate)
+                QoZ::sweep_evaluate<T>(points[k], data, work.data(), conf.num, rng);
+            points[k].sharedTuning = true;
+        } else {
+            QoZ::Config conf_k(confs[k]);
+            std::vector<T> work(data, data + conf.num);
+            streams[k] = SZ_compress_impl<T, N>(conf_k, work.data(), outSizes[k]);
+            SZ_save_config(conf_k, streams[k], outSizes[k]);
+            points[k].seconds = t.stop();
+        }
+    }
+
+    std::vector<T> decData;
+    for (size_t i = 0; i < n; i++) {
+        points[i].cmpSize = outSizes[i];
+        points[i].ratio = conf.num * sizeof(T) * 1.0 / outSizes[i];
+        points[i].bitrate = outSizes[i] * 8.0 / conf.num;
+        if (evaluate and !points[i].sharedTuning) {
+            decData.resize(conf.num);
+            QoZ::Config dconf;
+            T *decPtr = decData.data();
+            SZ_decompress<T>(dconf, streams[i], outSizes[i], decPtr);
+            QoZ::sweep_evaluate<T>(points[i], data, decData.data(), conf.num, rng);
+        }
+    }
+    if (table != nullptr)
+        table->swap(points);
+    return streams;
+}
+
+/**
+ * API for compressing one field at several error bounds, e.g. for rate-distortion studies or for serving
+ * several fidelity tiers. Each bound produces an ordinary stream (decompress it with SZ_decompress).
+ * Compared with one SZ_compress call per bound, the value range is computed once, and with
+ * ALGO_INTERP_LORENZO the auto-tuning (block profiling, sampling and predictor selection) is only run for
+ * the median bound: the other bounds reuse the tuned interpolation settings and only re-derive alpha and beta.
+ * The bounds are independent and are compressed in parallel when SR and pybind wavelets are off.
+ * @param bounds error bounds in the unit of config.errorBoundMode (ABS, REL, PSNR, NORM), or target bitrates for
+ * EB_BITRATE, which are turned into absolute bounds by the rate model (without the corrective pass of SZ_compress)
+ * @param outSizes compressed size of each stream
+ * @param table if not null, receives one rate-distortion row per bound
+ * @param evaluate decompress each stream to fill psnr and maxError in the table
+ * @return one compressed stream per bound, remember to 'delete []' each of them.
+
+ example:
+ conf.errorBoundMode = QoZ::EB_REL;
+ std::vector<QoZ::SweepPoint> table;
+ auto streams = SZ_compress_sweep(conf, data, {1e-2, 1e-3, 1e-4}, outSizes, &table);
+ QoZ::print_sweep_table(table);
+ */
+template<class T>
+std::vector<char *> SZ_compress_sweep(QoZ::Config &config, const T *data, const std::vector<double> &bounds, std::vector<size_t> &outSizes,
+                                      std::vector<QoZ::SweepPoint> *table = nullptr, bool evaluate = true) {
+    if (config.N == 1) {
+        return SZ_compress_sweep_impl<T, 1>(config, data, bounds, outSizes, table, evaluate);
+    } else if (config.N == 2) {
+        return SZ_compress_sweep_impl<T, 2>(config, data, bounds, outSizes, table, evaluate);
+    } else if (config.N == 3) {
+        return SZ_compress_sweep_impl<T, 3>(config, data, bounds, outSizes, table, evaluate);
+    } else if (config.N == 4) {
+        return SZ_compress_sweep_impl<T, 4>(config, data, bounds, outSizes, table, evaluate);
+    } else {
+        throw std::invalid_argument("Data dimension higher than 4 is not supported.");
+    }
+}
+
+#endif
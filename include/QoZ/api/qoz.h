@@ -0,0 +1,51 @@
+#ifndef QoZ_API_QOZ_H
+#define QoZ_API_QOZ_H
+
+/**
+ * C API of libqoz, the precompiled QoZ library (CMake target QoZ::qoz).
+ * Data is in C order: dims[0] is the slowest dimension, and 1 to 4 dimensions are supported.
+ * The streams are the ones of SZ_compress/SZ_decompress in sz.hpp.
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define QOZ_FLOAT 0
+#define QOZ_DOUBLE 1
+
+/**
+ * Compresses data (float or double, see dataType) of ndims dimensions.
+ * errorBoundMode is a QoZ::EB mode (0 absolute, 1 value-range relative, 2 PSNR, 3 L2 norm, 6 bitrate), and
+ * errorBound the bound of that mode. If configFile is not NULL, the settings of that file are loaded first; a
+ * negative errorBoundMode then keeps the error bound of the file, which is the way to use the ABS_AND_REL and
+ * ABS_OR_REL modes.
+ * @return the compressed stream, to be released with qoz_free, or NULL on failure
+ */
+char *qoz_compress(int dataType, const void *data, const size_t *dims, int ndims, int errorBoundMode,
+                   double errorBound, const char *configFile, size_t *outSize);
+
+/**
+ * Reads the dimensions of a compressed stream.
+ * @param dims receives the dimensions, room for 4 values
+ * @return the number of dimensions, or -1 on failure
+ */
+int qoz_get_dims(char *cmpData, size_t cmpSize, size_t *dims);
+
+/**
+ * Decompresses a stream into decData, which holds num values of dataType.
+ * @return 0, or -1 if num does not match the stream or on failure
+ */
+int qoz_decompress(int dataType, char *cmpData, size_t cmpSize, void *decData, size_t num);
+
+void qoz_free(char *cmpData);
+
+const char *qoz_version(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef QoZ_API_QOZ_HPP
+#define QoZ_API_QOZ_HPP
+
+/**
+ * C++ API of libqoz, the precompiled QoZ library (CMake target QoZ::qoz).
+ * The entry points of sz.hpp are instantiated in the library for float and double, and 1 to 4 dimensions, so this
+ * header only pulls in the config. See sz.hpp for the documentation of the functions and examples.
+ * QoZ::qoz only exports the include directory and QoZ_PRECOMPILED; a target that also links the header-only QoZ::QoZ
+ * can include sz.hpp, which then uses these instantiations too.
+ */
+
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/def.hpp"
+
+template<class T>
+char *SZ_compress(QoZ::Config &config, const T *data, size_t &outSize);
+
+template<class T>
+char *SZ_compress_inplace(QoZ::Config &config, T *data, size_t &outSize);
+
+template<class T>
+void SZ_decompress(QoZ::Config &config, char *cmpData, size_t cmpSize, T *&decData);
+
+template<class T>
+T *SZ_decompress(QoZ::Config &conf, char *cmpData, size_t cmpSize);
+
+template<class T, QoZ::uint N>
+char *SZ_compress_impl(QoZ::Config &conf, T *data, size_t &outSize);
+
+template<class T, QoZ::uint N>
+void SZ_decompress_impl(QoZ::Config &conf, char *cmpData, size_t cmpSize, T *decData);
+
+extern template char *SZ_compress<float>(QoZ::Config &, const float *, size_t &);
+extern template char *SZ_compress<double>(QoZ::Config &, const double *, size_t &);
+extern template char *SZ_compress_inplace<float>(QoZ::Config &, float *, size_t &);
+extern template char *SZ_compress_inplace<double>(QoZ::Config &, double *, size_t &);
+extern template void SZ_decompress<float>(QoZ::Config &, char *, size_t, float *&);
+extern template void SZ_decompress<double>(QoZ::Config &, char *, size_t, double *&);
+extern template float *SZ_decompress<float>(QoZ::Config &, char *, size_t);
+extern template double *SZ_decompress<double>(QoZ::Config &, char *, size_t);
+
+#define QoZ_EXTERN_IMPL(T, N) \
+    extern template char *SZ_compress_impl<T, N>(QoZ::Config &, T *, size_t &); \
+    extern template void SZ_decompress_impl<T, N>(QoZ::Config &, char *, size_t, T *);
+
+QoZ_EXTERN_IMPL(float, 1)
+QoZ_EXTERN_IMPL(float, 2)
+QoZ_EXTERN_IMPL(float, 3)
+QoZ_EXTERN_IMPL(float, 4)
+QoZ_EXTERN_IMPL(double, 1)
+QoZ_EXTERN_IMPL(double, 2)
+QoZ_EXTERN_IMPL(double, 3)
+QoZ_EXTERN_IMPL(double, 4)
+
+#undef QoZ_EXTERN_IMPL
+
+#endif
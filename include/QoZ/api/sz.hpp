@@ -4,7 +4,9 @@
 
 #include "QoZ/api/impl/SZImpl.hpp"
 #include "QoZ/version.hpp"
+#include "QoZ/utils/ArrayView.hpp"
 #include <memory>
+#include <stdexcept>
 
 /**
  * API for compression
@@ -39,6 +41,13 @@ conf.errorBoundMode = QoZ::EB_REL; // refer to def.hpp for all supported error b
 conf.relErrorBound = 1E-3; // value-rang-based error bound 1e-3
 char *compressedData = SZ_compress(conf, data, outSize);
 
+Target bitrate example:
+QoZ::Config conf(100, 200, 300); // 300 is the fastest dimension
+conf.errorBoundMode = QoZ::EB_BITRATE; // the error bound is chosen by sample-based rate control
+conf.targetBitrate = 2; // 2 bits per value, i.e. ratio 16 for float
+conf.bitrateTolerance = 0.05; // within 5% of the target before a corrective pass is made
+char *compressedData = SZ_compress(conf, data, outSize);
+
 Lorenzo/regression example :
 QoZ::Config conf(100, 200, 300); // 300 is the fastest dimension
 conf.cmprAlgo = QoZ::ALGO_LORENZO_REG;
@@ -51,22 +60,63 @@ conf.absErrorBound = 1E-3; // absolute error bound 1e-3
 char *compressedData = SZ_compress(conf, data, outSize);
  */
 
+/**
+ * Appends the config and its size to a compressed stream, so that SZ_decompress can restore it.
+ * The compressors reserve room for the config in their output buffer.
+ */
+inline void SZ_save_config(QoZ::Config &conf, char *cmpData, size_t &outSize) {
+    QoZ::uchar *cmpDataPos = (QoZ::uchar *) cmpData + outSize;
+    conf.save(cmpDataPos);
+    size_t newSize = (char *) cmpDataPos - cmpData;
+    QoZ::write(int(newSize - outSize), cmpDataPos);
+    outSize = (char *) cmpDataPos - cmpData;
+}
+
+/**
+ * Loads the config appended by SZ_save_config into conf.
+ * @return the size of the compressed data without the config
+ */
+inline size_t SZ_load_config(QoZ::Config &conf, const char *cmpData, size_t cmpSize) {
+    if (cmpSize < sizeof(int)) {
+        throw std::runtime_error("SZ_load_config: stream too short for its config size");
+    }
+    int confSize;
+    memcpy(&confSize, cmpData + (cmpSize - sizeof(int)), sizeof(int));
+    if (confSize < 0 or (size_t) confSize > cmpSize - sizeof(int)) {
+        throw std::runtime_error("SZ_load_config: config size exceeds the stream");
+    }
+    QoZ::uchar const *cmpDataPos = (QoZ::uchar *) cmpData + (cmpSize - sizeof(int) - confSize);
+    conf.load(cmpDataPos, cmpDataPos + confSize);
+    return cmpSize - sizeof(int) - confSize;
+}
+
+//EB_BITRATE entry points, see QoZ/api/impl/SZRateControl.hpp
 template<class T>
-char *SZ_compress( QoZ::Config &config, const T *data, size_t &outSize) {
+char *SZ_compress_bitrate(QoZ::Config &config, T *data, size_t &outSize);
+
+template<class T>
+double SZ_bitrate_error_bound(const QoZ::Config &config, const T *data);
+
+/**
+ * Same as SZ_compress, but compresses data in place: data is the working buffer of the compressor and is
+ * overwritten, so no copy of the input is made. Useful when the caller already owns a disposable copy of the input.
+ */
+template<class T>
+char *SZ_compress_inplace( QoZ::Config &config, T *data, size_t &outSize) {
+    if (config.errorBoundMode == QoZ::EB_BITRATE)
+        return SZ_compress_bitrate<T>(config, data, outSize);
     QoZ::Config conf(config);
-    std::vector<T> inData(data, data + conf.num);
     char *cmpData;
     if (conf.N == 1) {
-        cmpData = SZ_compress_impl<T, 1>(conf, inData.data(), outSize);
+        cmpData = SZ_compress_impl<T, 1>(conf, data, outSize);
     } else if (conf.N == 2) {
-        cmpData = SZ_compress_impl<T, 2>(conf, inData.data(), outSize);
+        cmpData = SZ_compress_impl<T, 2>(conf, data, outSize);
     } else if (conf.N == 3) {
-        cmpData = SZ_compress_impl<T, 3>(conf, inData.data(), outSize);
+        cmpData = SZ_compress_impl<T, 3>(conf, data, outSize);
     } else if (conf.N == 4) {
-        cmpData = SZ_compress_impl<T, 4>(conf, inData.data(), outSize);
+        cmpData = SZ_compress_impl<T, 4>(conf, data, outSize);
     } else {
-        printf("Data dimension higher than 4 is not supported.\n");
-        exit(0);
+        throw std::runtime_error("Data dimension higher than 4 is not supported.");
     }
     //std::cout<<"szcf"<<std::endl;
     if(conf.pybind_activated){
@@ -74,21 +124,7 @@ char *SZ_compress( QoZ::Config &config, const T *data, size_t &outSize) {
         config.pybind_activated=true;
     }
 
-    {
-        
-        //save config
-        QoZ::uchar *cmpDataPos = (QoZ::uchar *) cmpData + outSize;
-        conf.save(cmpDataPos);
-        
-        size_t newSize = (char *) cmpDataPos - cmpData;
-        QoZ::write(int(newSize - outSize), cmpDataPos);
-        
-
-        
-        
-        outSize = (char *) cmpDataPos - cmpData;
-        
-    }
+    SZ_save_config(conf, cmpData, outSize);
     
     if(conf.peTracking){
         //int status;
@@ -107,6 +143,38 @@ char *SZ_compress( QoZ::Config &config, const T *data, size_t &outSize) {
     return cmpData;
 }
 
+//copies the input once, then compresses the copy in place
+template<class T>
+char *SZ_compress( QoZ::Config &config, const T *data, size_t &outSize) {
+    std::vector<T> inData(data, data + config.num);
+    return SZ_compress_inplace<T>(config, inData.data(), outSize);
+}
+
+/**
+ * API for compressing an N-D view (base pointer + strides + layout) without a packed copy by the caller.
+ * The view is traversed in memory order, so Fortran-order data is compressed with reversed dims
+ * (view.storage_dims(), the dims of config are not used), and strided views are gathered directly into the
+ * compressor's working buffer.
+
+ example:
+ //interior of a Fortran array u(0:nx+1, 0:ny+1, 0:nz+1) with one layer of ghost cells
+ QoZ::ArrayView<float> view(u + 1 + (nx + 2) * (1 + (ny + 2)), {nx, ny, nz}, {1, nx + 2, (nx + 2) * (ny + 2)}, QoZ::LAYOUT_FORTRAN);
+ char *compressedData = SZ_compress(conf, view, outSize);
+ */
+template<class T>
+char *SZ_compress( QoZ::Config &config, const QoZ::ArrayView<T> &view, size_t &outSize) {
+    QoZ::Config conf(config);
+    auto dims = view.storage_dims();
+    conf.setDims(dims.begin(), dims.end());
+    std::vector<T> inData(conf.num);
+    view.gather(inData.data());
+    char *cmpData = SZ_compress_inplace<T>(conf, inData.data(), outSize);
+    if (conf.pybind_activated) {
+        config.pybind_activated = true;
+    }
+    return cmpData;
+}
+
 /*
 template<class T>
 char *SZ_compress(const QoZ::Config &config, T *data, size_t &outSize) {
@@ -162,15 +230,7 @@ void SZ_decompress( QoZ::Config &config, char *cmpData, size_t cmpSize, T *&decD
    
     QoZ::Config conf(config);
 
-    //{
-        //load config
-        int confSize;
-        
-        memcpy(&confSize, cmpData + (cmpSize - sizeof(int)), sizeof(int));
-        QoZ::uchar const *cmpDataPos = (QoZ::uchar *) cmpData + (cmpSize - sizeof(int) - confSize);
-        conf.load(cmpDataPos);
-        //std::cout<<"afterload"<<conf.absErrorBound<<std::endl;
-    //}
+    size_t dataSize = SZ_load_config(conf, cmpData, cmpSize);
     //timer.stop("load config");
     //timer.start();
     //std::cout<<"woshiniba"<<std::endl;
@@ -184,16 +244,15 @@ void SZ_decompress( QoZ::Config &config, char *cmpData, size_t cmpSize, T *&decD
     //timer.stop("alloc memory");
     //timer.start();
     if (conf.N == 1) {
-        SZ_decompress_impl<T, 1>(conf, cmpData, (cmpSize - sizeof(int) - confSize), decData);
+        SZ_decompress_impl<T, 1>(conf, cmpData, dataSize, decData);
     } else if (conf.N == 2) {
-        SZ_decompress_impl<T, 2>(conf, cmpData, (cmpSize - sizeof(int) - confSize), decData);
+        SZ_decompress_impl<T, 2>(conf, cmpData, dataSize, decData);
     } else if (conf.N == 3) {
-        SZ_decompress_impl<T, 3>(conf, cmpData, (cmpSize - sizeof(int) - confSize), decData);
+        SZ_decompress_impl<T, 3>(conf, cmpData, dataSize, decData);
     } else if (conf.N == 4) {
-        SZ_decompress_impl<T, 4>(conf, cmpData, (cmpSize - sizeof(int) - confSize), decData);
+        SZ_decompress_impl<T, 4>(conf, cmpData, dataSize, decData);
     } else {
-       printf("Data dimension higher than 4 is not supported.\n");
-        exit(0);
+        throw std::runtime_error("Data dimension higher than 4 is not supported.");
     }
     if(conf.pybind_activated){
       
@@ -223,4 +282,42 @@ T *SZ_decompress(QoZ::Config &conf, char *cmpData, size_t cmpSize) {
     return decData;
 }
 
+/**
+ * API for decompressing into an N-D view, e.g. directly into the interior of a ghosted simulation array.
+ * The storage order of the view must match the dims the data was compressed with.
+ * Dense views (C or Fortran) are decompressed in place, strided views are scattered from one working buffer.
+ * @return false if the view does not match the compressed shape
+ */
+template<class T>
+bool SZ_decompress( QoZ::Config &config, char *cmpData, size_t cmpSize, const QoZ::ArrayView<T> &view) {
+    QoZ::Config conf(config);
+    SZ_load_config(conf, cmpData, cmpSize);
+    if (conf.dims != view.storage_dims()) {
+        std::cerr << "View shape does not match the compressed data." << std::endl;
+        return false;
+    }
+    //wavelet modes decompress into a larger coefficient buffer, those always go through a working buffer
+    if (view.is_contiguous() and conf.wavelet <= 1) {
+        T *decData = view.data;
+        SZ_decompress<T>(config, cmpData, cmpSize, decData);
+    } else {
+        T *decData = nullptr;
+        SZ_decompress<T>(config, cmpData, cmpSize, decData);
+        view.scatter(decData);
+        delete[] decData;
+    }
+    return true;
+}
+
+#if QoZ_PRECOMPILED
+//the float/double entry points are instantiated in libqoz
+#include "QoZ/api/qoz.hpp"
+#endif
+
+#include "QoZ/api/impl/SZChunked.hpp"
+#include "QoZ/api/impl/SZBatch.hpp"
+#include "QoZ/api/impl/SZSweep.hpp"
+#include "QoZ/api/impl/SZEstimate.hpp"
+#include "QoZ/api/impl/SZRateControl.hpp"
+
 #endif
\ No newline at end of file
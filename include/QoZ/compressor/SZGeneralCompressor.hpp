@@ -47,7 +47,7 @@ namespace QoZ {
 //            timer.stop("Prediction & Quantization");
             encoder.preprocess_encode(quant_inds, 0);
             //std::cout<<"general2.1"<<std::endl;
-            size_t bufferSize = 1.5 * (frontend.size_est() + encoder.size_est() + sizeof(T) * quant_inds.size());//todo: lower the 1.5.
+            size_t bufferSize = buffer_size_est();
             uchar *buffer = new uchar[bufferSize];
             //std::cout<<"general2.2"<<std::endl;
             uchar *buffer_pos = buffer;
@@ -78,7 +78,8 @@ namespace QoZ {
             if(q_inds.size()>0)
                 quant_inds=q_inds;
           
-            size_t bufferSize = 2 * quant_inds.size()*sizeof(T);//original is 3
+            encoder.preprocess_encode(quant_inds, 0);
+            size_t bufferSize = buffer_size_est();
             uchar *buffer = new uchar[bufferSize];
             uchar *buffer_pos = buffer;
 
@@ -86,7 +87,6 @@ namespace QoZ {
             //std::cout<<"general3"<<std::endl;
 
             //timer.start();
-            encoder.preprocess_encode(quant_inds, 0);
             encoder.save(buffer_pos);
             encoder.encode(quant_inds, buffer_pos);
             encoder.postprocess_encode();
@@ -110,6 +110,24 @@ namespace QoZ {
         }
 
         T *decompress(uchar const *cmpData, const size_t &cmpSize, T *decData) {
+            auto quant_inds = load_and_decode(cmpData, cmpSize);
+
+            Timer timer(true);
+            frontend.decompress(quant_inds, decData);
+//            timer.stop("Prediction & Recover");
+            return decData;
+        }
+
+        //adds the decompressed values to decData, see SZGeneralFrontend::decompress_add
+        T *decompress_add(uchar const *cmpData, const size_t &cmpSize, T *decData) {
+            auto quant_inds = load_and_decode(cmpData, cmpSize);
+            frontend.decompress_add(quant_inds, decData);
+            return decData;
+        }
+
+
+    private:
+        std::vector<int> load_and_decode(uchar const *cmpData, const size_t &cmpSize) {
             size_t remaining_length = cmpSize;
 
             Timer timer(true);
@@ -127,15 +145,15 @@ namespace QoZ {
 //            timer.stop("Decoder");
 
             lossless.postdecompress_data(compressed_data);
-
-            timer.start();
-            frontend.decompress(quant_inds, decData);
-//            timer.stop("Prediction & Recover");
-            return decData;
+            return quant_inds;
         }
 
+        //size of the buffer of frontend.save and of the codes, after encoder.preprocess_encode. frontend.size_est()
+        //leaves out the predictors, which save at most a few values per block, bounded by sizeof(T) per element
+        size_t buffer_size_est() {
+            return frontend.size_est() + encoder.size_est() + encoder.encoded_size_est(quant_inds.size());
+        }
 
-    private:
         Frontend frontend;
         std::vector<int> quant_inds;
         Encoder encoder;
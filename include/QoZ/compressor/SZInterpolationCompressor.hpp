@@ -1206,7 +1206,18 @@ namespace QoZ {
                 }
             }*/
             encoder.preprocess_encode(quant_inds, 0);
-            size_t bufferSize = 1.2 * (quantizer.size_est() + encoder.size_est() + sizeof(T) * quant_inds.size());
+            //the fields written below, before the quantizer
+            size_t headerSize = sizeof(global_dimensions) + sizeof(blocksize) + sizeof(interp_meta) + sizeof(alpha) +
+                                sizeof(beta) + sizeof(maxStep) + sizeof(levelwise_predictor_levels) +
+                                sizeof(conf.blockwiseTuning) + sizeof(conf.fixBlockSize) + sizeof(conf.frozen_dim) +
+                                sizeof(cross_block) + sizeof(conf.regressiveInterp) + sizeof(conf.SRNet) +
+                                sizeof(size_t) + conf.ckpt_path.size();
+            if (conf.blockwiseTuning) {
+                headerSize += sizeof(size_t) + interp_metas.size() * sizeof(Interp_Meta);
+            } else if (levelwise_predictor_levels > 0) {
+                headerSize += levelwise_predictor_levels * sizeof(Interp_Meta);
+            }
+            size_t bufferSize = headerSize + quantizer.size_est() + encoder.size_est() + encoder.encoded_size_est(quant_inds.size());
             uchar *buffer = new uchar[bufferSize];
             uchar *buffer_pos = buffer;
             write(global_dimensions.data(), N, buffer_pos);
@@ -1280,14 +1291,14 @@ namespace QoZ {
 
             if(q_inds.size()>0)
                 quant_inds=q_inds;
-            size_t bufferSize = 2.5 * (quant_inds.size() * sizeof(T) + quantizer.size_est());//original is 3
+            encoder.preprocess_encode(quant_inds, 0);
+            size_t bufferSize = quantizer.size_est() + encoder.size_est() + encoder.encoded_size_est(quant_inds.size());
             uchar *buffer = new uchar[bufferSize];
             uchar *buffer_pos = buffer;
             quantizer.save(buffer_pos);
             quantizer.clear();
             quantizer.postcompress_data();
             //timer.start();
-            encoder.preprocess_encode(quant_inds, 0);
             encoder.save(buffer_pos);
             encoder.encode(quant_inds, buffer_pos);
             encoder.postprocess_encode();
@@ -1408,7 +1419,7 @@ namespace QoZ {
             }
         }
  
-        void recover_grid(T *decData,const std::array<size_t,N>& global_dimensions,size_t maxStep,size_t frozen_dim=-1){
+        void recover_grid(T *decData,const std::array<size_t,N>& global_dimensions,size_t maxStep,int frozen_dim=-1){
             assert(maxStep>0);
             if (N==2){
                 for (size_t x=0;x<global_dimensions[0];x+=maxStep){
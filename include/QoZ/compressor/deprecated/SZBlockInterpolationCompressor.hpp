@@ -147,7 +147,9 @@ namespace QoZ {
             quantizer.postcompress_data();
 //            predictor.print();
 
-            size_t bufferSize = 1.5 * (quant_inds.size() * sizeof(T) + quantizer.size_est());
+            encoder.preprocess_encode(quant_inds, 0);
+            size_t bufferSize = sizeof(global_dimensions) + sizeof(block_size) + sizeof(interpolator_id) +
+                                sizeof(direction_sequence_id) + quantizer.size_est() + encoder.size_est() + encoder.encoded_size_est(quant_inds.size());
             uchar *buffer = new uchar[bufferSize];
             uchar *buffer_pos = buffer;
 
@@ -158,7 +160,6 @@ namespace QoZ {
 
             quantizer.save(buffer_pos);
 
-            encoder.preprocess_encode(quant_inds, 0);
             encoder.save(buffer_pos);
             encoder.encode(quant_inds, buffer_pos);
             encoder.postprocess_encode();
@@ -3,6 +3,11 @@
 
 #include <cmath>
 
+//python-backed features (pybind wavelets) need pybind11::embed; without it they run through the external scripts
+#ifndef QoZ_USE_PYBIND
+#define QoZ_USE_PYBIND 1
+#endif
+
 namespace QoZ {
 
     typedef unsigned int uint;
@@ -30,6 +30,11 @@ namespace QoZ {
                 return 0;
             }
 
+            //upper bound of the bytes written by encode for num_bin bins, after preprocess_encode
+            virtual size_t encoded_size_est(size_t num_bin) {
+                return 2 * num_bin * sizeof(T) + 64;
+            }
+
             
 
         };
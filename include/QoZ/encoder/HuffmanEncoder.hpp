@@ -16,6 +16,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <stdexcept>
 
 namespace QoZ {
 
@@ -103,8 +104,7 @@ namespace QoZ {
         void preprocess_encode(const T *bins, size_t num_bin, int stateNum) {
             nodeCount = 0;
             if (num_bin == 0) {
-                printf("Huffman bins should not be empty\n");
-                exit(0);
+                throw std::runtime_error("Huffman bins should not be empty");
             }
             //std::cout<<"prepro1"<<std::endl;
             init(bins, num_bin);
@@ -141,6 +141,11 @@ namespace QoZ {
             return 1 + 2 * nodeCount * b + nodeCount * sizeof(unsigned char) + nodeCount * sizeof(T) + sizeof(int) + sizeof(int) + sizeof(T);
         }
 
+        //exact size of the codes from the frequencies of preprocess_encode, plus the length and what the 64-bit stores of encode write past the end
+        size_t encoded_size_est(size_t /*num_bin*/) {
+            return sizeof(size_t) + (encodedBits + 7) / 8 + 3 * sizeof(uint64_t);
+        }
+
         //perform encoding
         size_t encode(const std::vector<T> &bins, uchar *&bytes) {
             return encode(bins.data(), bins.size(), bytes);
@@ -301,6 +306,7 @@ namespace QoZ {
         HuffmanTree *huffmanTree = NULL;
         node treeRoot;
         unsigned int nodeCount = 0 ;
+        size_t encodedBits = 0;
         uchar sysEndianType; //0: little endian, 1: big endian
         bool loaded = false;
         T offset;
@@ -561,6 +567,10 @@ namespace QoZ {
 
             build_code(huffmanTree->qq[1], 0, 0, 0);
             treeRoot = huffmanTree->qq[1];
+            encodedBits = 0;
+            for (const auto &f: frequency) {
+                encodedBits += f.second * huffmanTree->cout[f.first - offset];
+            }
             //std::cout<<"init4"<<std::endl;
 
         }
@@ -4,7 +4,10 @@
 /**
  * This module is the implementation of the prediction and quantization methods in SZ2.
  * It has better speed than SZFrontend since multidimensional iterator is not used.
- * Currently only 3D data is supported.
+ * The kernels work on 3D blocks; 1D, 2D and 4D data are mapped onto 3D with unit dimensions
+ * (n) -> (1, 1, n), (n0, n1) -> (n0, 1, n1), (n0, n1, n2, n3) -> (n0 * n1, n2, n3).
+ * The blocks are grouped in slabs of block rows (along the first mapped dimension, or along the last one for 1D)
+ * that are predicted independently, so slabs are compressed and decompressed in parallel with OpenMP.
  */
 
 #include "Frontend.hpp"
@@ -15,6 +18,13 @@
 #include "QoZ/utils/MemoryUtil.hpp"
 #include "QoZ/utils/Config.hpp"
 #include <list>
+#include <vector>
+#include <algorithm>
+#include <limits>
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
 
 namespace QoZ {
     using namespace QoZMETA;
@@ -23,12 +33,14 @@ namespace QoZ {
     class SZFastFrontend : public concepts::FrontendInterface<T, N> {
     public:
         SZFastFrontend(const Config &conf, Quantizer quantizer) :
-                quantizer(quantizer),
                 params(false, conf.blockSize, conf.pred_dim, 0, conf.lorenzo, conf.lorenzo2,
                        conf.regression, conf.absErrorBound),
                 precision(conf.absErrorBound),
+                quantizer(quantizer),
                 conf(conf) {
-            assert(N == 3 && "SZMeta Front only support 3D data");
+            static_assert(N >= 1 && N <= 4, "SZMeta Front only supports 1D to 4D data");
+            //the Lorenzo kernels predict along the mapped dimensions that are not unit
+            params.prediction_dim = std::max(1, std::min(conf.pred_dim, (int) (N == 4 ? 3 : N)));
         }
 
         ~SZFastFrontend() {
@@ -54,6 +66,7 @@ namespace QoZ {
 //            write(intv_radius, c);
             write(mean_info, c);
             write(reg_count, c);
+            write(slab_rows, c);
 //            write(unpred_count_buffer, size.block_size * size.block_size, c);
 //            T *unpred_data_buffer_pos = unpred_data_buffer;
 //            for (int i = 0; i < size.block_size; i++) {
@@ -71,7 +84,6 @@ namespace QoZ {
             indicator_huffman.save(c);
             indicator_huffman.encode(indicator, c);
             indicator_huffman.postprocess_encode();
-            auto *c2 = c;
 
 //	convertIntArray2ByteArray_fast_1b_to_result_sz(indicator, size.num_blocks, c);
 
@@ -92,11 +104,12 @@ namespace QoZ {
 //            read(intv_radius, c, remaining_length);
             read(mean_info, c, remaining_length);
             read(reg_count, c, remaining_length);
+            slab_rows = 0;
+            if (conf.streamVersion >= 1) {
+                read(slab_rows, c, remaining_length);
+            }
 
-            size_t r1 = conf.dims[0];
-            size_t r2 = conf.dims[1];
-            size_t r3 = conf.dims[2];
-            size = QoZMETA::DSize_3d(r1, r2, r3, params.block_size);
+            size = make_size(params.block_size);
             // prepare unpred buffer for vectorization
             est_unpred_count_per_index = size.num_blocks * size.block_size * 1;
             // if(!params.block_independant) est_unpred_count_per_index /= 20;
@@ -122,8 +135,18 @@ namespace QoZ {
 
 
             if (reg_count) {
-                reg_params = decode_regression_coefficients(c, reg_count, size.block_size, precision,
-                                                            params);
+                //the coefficient prediction restarts at the first regression block of every slab
+                std::vector<size_t> chain_starts;
+                size_t regs = 0;
+                for (auto &slab: make_slabs()) {
+                    size_t slab_regs = std::count(indicator.begin() + slab.block_offset,
+                                                  indicator.begin() + slab.block_offset + slab.num_blocks, SELECTOR_REGRESSION);
+                    if (slab_regs)
+                        chain_starts.push_back(regs);
+                    regs += slab_regs;
+                }
+                reg_params = decode_regression_coefficients(c, remaining_length, reg_count, size.block_size, precision,
+                                                            params, chain_starts);
             }
             quantizer.load(c, remaining_length);
             remaining_length -= c_pos - c;
@@ -155,11 +178,11 @@ namespace QoZ {
         }
 
         size_t size_est() {
-            return quantizer.size_est() //unpred
-                  
-                   + indicator.size() * sizeof(int) + indicator_huffman.size_est()//loren or reg indicator
-                   + RegCoeffNum3d * reg_count * sizeof(int) + reg_huffman.size_est() // reg coeff quant
-                   + (reg_unpredictable_data_pos - reg_unpredictable_data) * sizeof(float); //reg coeff unpred
+            return sizeof(params) + sizeof(precision) + sizeof(mean_info) + sizeof(reg_count) + sizeof(slab_rows)
+                   + indicator_huffman.size_est() + indicator_huffman.encoded_size_est(indicator.size())//loren or reg indicator
+                   + (reg_count ? sizeof(size_t) + (reg_unpredictable_data_pos - reg_unpredictable_data) * sizeof(float) //reg coeff unpred
+                                  + reg_huffman.size_est() + reg_huffman.encoded_size_est(RegCoeffNum3d * reg_count) : 0) // reg coeff quant
+                   + quantizer.size_est(); //unpred
         }
 
         int get_radius() const {
@@ -170,54 +193,102 @@ namespace QoZ {
         size_t get_num_elements() const { return size.num_elements; };
 
     private:
-        //        unsigned char *
-//        compress_3d(const T *data, size_t r1, size_t r2, size_t r3, double precision, size_t &compressed_size,
-//                    const QoZMETA::meta_params &params, SZMETA::CompressStats &compress_info) {
-        std::vector<int> compress_3d(const T *data) {
-            clear();
+        //one group of block rows predicted independently of the others: blocks [i0, i1) x [0, num_y) x [k0, k1)
+        struct Slab {
+            size_t i0, i1, k0, k1;
+            size_t num_blocks;
+            size_t block_offset;//first block in the indicator array
+            size_t type_offset;//first element in the quantization index array
+            size_t data_offset;//first element in the data
+        };
 
-            size_t r1 = conf.dims[0];
-            size_t r2 = conf.dims[1];
-            size_t r3 = conf.dims[2];
-            size = QoZMETA::DSize_3d(r1, r2, r3, conf.blockSize);
+        //N-D dims mapped onto the 3D blocks, see the module comment
+        QoZMETA::DSize_3d make_size(int block_size) const {
+            auto &d = conf.dims;
+            if (N == 1)
+                return QoZMETA::DSize_3d(1, 1, d[0], block_size);
+            if (N == 2)
+                return QoZMETA::DSize_3d(d[0], 1, d[1], block_size);
+            if (N == 4)
+                return QoZMETA::DSize_3d(d[0] * d[1], d[2], d[3], block_size);
+            return QoZMETA::DSize_3d(d[0], d[1], d[2], block_size);
+        }
 
-//            capacity = 0; // num of quant intervals
-//            mean_info = optimize_quant_invl_3d(data, r1, r2, r3, conf.absErrorBound, capacity);
-//            if (conf.quantbinCnt > 0) {
-//                capacity = conf.quantbinCnt;
-//            }
-//            intv_radius = (capacity >> 1);
-            std::vector<int> type(size.num_elements);
-//            int *type = (int *) malloc(size.num_elements * sizeof(int));
-//            indicator = (int *) malloc(size.num_blocks * sizeof(int));
-            indicator.resize(size.num_blocks);
+        //only the 3D shape of 1D and 2D data has unit dimensions that the block selection has to skip
+        bool active_dim(int i) const {
+            return N >= 3 || (N == 2 ? i != 1 : i == 2);
+        }
 
-            reg_params_type = (int *) malloc(RegCoeffNum3d * size.num_blocks * sizeof(int));
-            reg_unpredictable_data = (float *) malloc(RegCoeffNum3d * size.num_blocks * sizeof(float));
-            reg_unpredictable_data_pos = reg_unpredictable_data;
+        //1D data is a single row of blocks, so its slabs split the row instead
+        bool slab_along_z() const {
+            return size.num_x == 1 && size.num_y == 1;
+        }
 
-            // prepare unpred buffer for vectorization
-            est_unpred_count_per_index = size.num_blocks * size.block_size * 1;
-            // if(!params.block_independant) est_unpred_count_per_index /= 20;
-//            unpred_data_buffer = (T *) malloc(
-//                    size.block_size * size.block_size * est_unpred_count_per_index * sizeof(T));
-//            unpred_count_buffer = (int *) malloc(size.block_size * size.block_size * sizeof(int));
-//            memset(unpred_count_buffer, 0, size.block_size * size.block_size * sizeof(int));
-//        T precision_t = (T) precision;
-            reg_count = 0;
-            size_t lorenzo_count = 0;
-            size_t lorenzo_2layer_count = 0;
+        //slab height in blocks: every slab restarts the Lorenzo and coefficient prediction, which costs a little
+        //compression ratio, so the field is only split with several threads and enough rows per slab
+        size_t choose_slab_rows() const {
+            size_t rows = slab_along_z() ? size.num_z : size.num_x;
+#ifdef _OPENMP
+            int threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+            if (threads > 1 && size.num_elements >= (1 << 20)) {
+                rows = std::max<size_t>((rows + 2 * threads - 1) / (2 * threads), slab_along_z() ? 256 : 4);
+            }
+#endif
+            return std::max<size_t>(rows, 1);
+        }
+
+        std::vector<Slab> make_slabs() const {
+            std::vector<Slab> slabs;
+            size_t rows = slab_along_z() ? size.num_z : size.num_x;
+            size_t step = slab_rows == 0 ? rows : slab_rows;
+            for (size_t r = 0; r < rows; r += step) {
+                Slab slab;
+                size_t r1 = std::min(rows, r + step);
+                if (slab_along_z()) {
+                    slab.i0 = 0, slab.i1 = 1, slab.k0 = r, slab.k1 = r1;
+                    slab.block_offset = r;
+                    slab.type_offset = slab.data_offset = r * size.block_size;
+                } else {
+                    slab.i0 = r, slab.i1 = r1, slab.k0 = 0, slab.k1 = size.num_z;
+                    slab.block_offset = r * size.num_y * size.num_z;
+                    slab.type_offset = slab.data_offset = r * size.block_size * size.dim0_offset;
+                }
+                slab.num_blocks = (slab.i1 - slab.i0) * size.num_y * (slab.k1 - slab.k0);
+                slabs.push_back(slab);
+            }
+            return slabs;
+        }
 
-            int *type_pos = type.data();
-            int *indicator_pos = indicator.data();
+        inline int block_extent(size_t b, size_t d) const {
+            return ((b + 1) * size.block_size < d) ? size.block_size : d - b * size.block_size;
+        }
 
-            float *reg_params = (float *) malloc(RegCoeffNum3d * (size.num_blocks + 1) * sizeof(float));
-            for (int i = 0; i < RegCoeffNum3d; i++) {
-                reg_params[i] = 0;
+        //reconstructed values of the previous block rows, with padding layers of zeros in front of the slab.
+        //Unit dimensions of 1D and 2D data are not predicted along, so they get a zero offset and no padding.
+        struct PredBuffer {
+            PredBuffer(const QoZMETA::DSize_3d &size, const Slab &slab, int pad) {
+                size_t d1 = N == 1 ? 1 : std::min<size_t>(size.block_size, size.d1) + pad;
+                size_t d2 = N <= 2 ? 1 : size.d2 + pad;
+                size_t d3 = std::min(size.d3, slab.k1 * size.block_size) - slab.k0 * size.block_size + pad;
+                dim1_offset = N <= 2 ? 0 : d3;
+                dim0_offset = N == 1 ? 0 : d2 * d3;
+                data.assign(d1 * d2 * d3, 0);
             }
-            float *reg_params_pos = reg_params + RegCoeffNum3d;
-            int *reg_params_type_pos = reg_params_type;
 
+            std::vector<T> data;
+            size_t dim0_offset, dim1_offset;
+        };
+
+        //compresses the blocks of one slab, returns the number of regression blocks
+        size_t compress_slab(const T *data, const Slab &slab, int *type, Quantizer &quantizer, int *reg_params_type_pos,
+                             float *&reg_unpredictable_data_pos) {
+            size_t reg_blocks = 0;
+            int *type_pos = type + slab.type_offset;
+            int *indicator_pos = indicator.data() + slab.block_offset;
+
+            //coefficients are predicted from the previous regression block of the slab, the first one from zero
+            std::vector<float> reg_params(RegCoeffNum3d * (slab.num_blocks + 1), 0);
+            float *reg_params_pos = reg_params.data() + RegCoeffNum3d;
 
             T reg_precisions[RegCoeffNum3d];
             T reg_recip_precisions[RegCoeffNum3d];
@@ -230,33 +301,30 @@ namespace QoZ {
 
             // maintain a buffer of (block_size+1)*(r2+1)*(r3+1)
             // 2-layer use_lorenzo
-            size_t buffer_dim0_offset =
-                    (size.d2 + params.lorenzo_padding_layer) * (size.d3 + params.lorenzo_padding_layer);
-            size_t buffer_dim1_offset = size.d3 + params.lorenzo_padding_layer;
-            T *pred_buffer = (T *) malloc(
-                    (size.block_size + params.lorenzo_padding_layer) * (size.d2 + params.lorenzo_padding_layer) *
-                    (size.d3 + params.lorenzo_padding_layer) * sizeof(T));
-            memset(pred_buffer, 0,
-                   (size.block_size + params.lorenzo_padding_layer) * (size.d2 + params.lorenzo_padding_layer) *
-                   (size.d3 + params.lorenzo_padding_layer) * sizeof(T));
+            PredBuffer buffer(size, slab, params.lorenzo_padding_layer);
+            T *pred_buffer = buffer.data.data();
+            size_t buffer_dim0_offset = buffer.dim0_offset;
+            size_t buffer_dim1_offset = buffer.dim1_offset;
             int capacity_lorenzo = mean_info.use_mean ? capacity - 2 : capacity;
             T recip_precision = (T) 1.0 / conf.absErrorBound;
 
-            const T *x_data_pos = data;
-            for (size_t i = 0; i < size.num_x; i++) {
+            const T *x_data_pos = data + slab.data_offset;
+            for (size_t i = slab.i0; i < slab.i1; i++) {
                 const T *y_data_pos = x_data_pos;
                 T *pred_buffer_pos = pred_buffer;
                 for (size_t j = 0; j < size.num_y; j++) {
                     const T *z_data_pos = y_data_pos;
-                    for (size_t k = 0; k < size.num_z; k++) {
-                        int size_x = ((i + 1) * size.block_size < size.d1) ? size.block_size : size.d1 -
-                                                                                               i * size.block_size;
-                        int size_y = ((j + 1) * size.block_size < size.d2) ? size.block_size : size.d2 -
-                                                                                               j * size.block_size;
-                        int size_z = ((k + 1) * size.block_size < size.d3) ? size.block_size : size.d3 -
-                                                                                               k * size.block_size;
-                        int min_size = MIN(size_x, size_y);
-                        min_size = MIN(min_size, size_z);
+                    for (size_t k = slab.k0; k < slab.k1; k++) {
+                        int size_x = block_extent(i, size.d1);
+                        int size_y = block_extent(j, size.d2);
+                        int size_z = block_extent(k, size.d3);
+                        int min_size = std::numeric_limits<int>::max();
+                        if (active_dim(0))
+                            min_size = MIN(min_size, size_x);
+                        if (active_dim(1))
+                            min_size = MIN(min_size, size_y);
+                        if (active_dim(2))
+                            min_size = MIN(min_size, size_z);
 
                         bool enable_regression = params.use_regression_linear && min_size >= 2;
 //                bool enable_regression = params.use_regression_linear && min_size >= 1;
@@ -288,7 +356,7 @@ namespace QoZ {
                                                               type_pos, unpred_count_buffer, unpred_data_buffer,
                                                               est_unpred_count_per_index,
                                                               params.lorenzo_padding_layer, quantizer);
-                            reg_count++;
+                            reg_blocks++;
                             reg_params_pos += RegCoeffNum3d;
                             reg_params_type_pos += RegCoeffNum3d;
                         } else {
@@ -306,27 +374,76 @@ namespace QoZ {
                                                            params.lorenzo_padding_layer,
                                                            (selection_result == SELECTOR_LORENZO_2LAYER), quantizer,
                                                            params.prediction_dim);
-//
-                            if (selection_result == SELECTOR_LORENZO_2LAYER) {
-                                lorenzo_2layer_count++;
-                            } else {
-                                lorenzo_count++;
-                            }
                         }
                         pred_buffer_pos += size.block_size;
                         indicator_pos++;
                         z_data_pos += size_z;
                     }
                     y_data_pos += size.block_size * size.dim1_offset;
-                    pred_buffer_pos += size.block_size * buffer_dim1_offset - size.block_size * size.num_z;
+                    pred_buffer_pos += size.block_size * buffer_dim1_offset - size.block_size * (slab.k1 - slab.k0);
                 }
                 // copy bottom of buffer to top of buffer
-                memcpy(pred_buffer, pred_buffer + size.block_size * buffer_dim0_offset,
-                       params.lorenzo_padding_layer * buffer_dim0_offset * sizeof(T));
+                if (i + 1 < slab.i1) {
+                    memcpy(pred_buffer, pred_buffer + size.block_size * buffer_dim0_offset,
+                           params.lorenzo_padding_layer * buffer_dim0_offset * sizeof(T));
+                }
                 x_data_pos += size.block_size * size.dim0_offset;
             }
-            free(pred_buffer);
-            free(reg_params);
+            return reg_blocks;
+        }
+
+        //        unsigned char *
+//        compress_3d(const T *data, size_t r1, size_t r2, size_t r3, double precision, size_t &compressed_size,
+//                    const QoZMETA::meta_params &params, SZMETA::CompressStats &compress_info) {
+        std::vector<int> compress_3d(const T *data) {
+            clear();
+
+            size = make_size(conf.blockSize);
+            slab_rows = choose_slab_rows();
+
+//            capacity = 0; // num of quant intervals
+//            mean_info = optimize_quant_invl_3d(data, r1, r2, r3, conf.absErrorBound, capacity);
+//            if (conf.quantbinCnt > 0) {
+//                capacity = conf.quantbinCnt;
+//            }
+//            intv_radius = (capacity >> 1);
+            std::vector<int> type(size.num_elements);
+            indicator.resize(size.num_blocks);
+
+            reg_params_type = (int *) malloc(RegCoeffNum3d * size.num_blocks * sizeof(int));
+            reg_unpredictable_data = (float *) malloc(RegCoeffNum3d * size.num_blocks * sizeof(float));
+            reg_unpredictable_data_pos = reg_unpredictable_data;
+
+            // prepare unpred buffer for vectorization
+            est_unpred_count_per_index = size.num_blocks * size.block_size * 1;
+            reg_count = 0;
+
+            auto slabs = make_slabs();
+            if (slabs.size() == 1) {
+                reg_count = compress_slab(data, slabs[0], type.data(), quantizer, reg_params_type, reg_unpredictable_data_pos);
+            } else {
+                //every slab collects its own unpredictable values and coefficients, they are concatenated in slab order
+                std::vector<Quantizer> quantizers(slabs.size(), quantizer);
+                std::vector<std::vector<int>> reg_types(slabs.size());
+                std::vector<std::vector<float>> reg_unpreds(slabs.size());
+                std::vector<size_t> reg_counts(slabs.size());
+#pragma omp parallel for schedule(dynamic)
+                for (size_t s = 0; s < slabs.size(); s++) {
+                    reg_types[s].resize(RegCoeffNum3d * slabs[s].num_blocks);
+                    reg_unpreds[s].resize(RegCoeffNum3d * slabs[s].num_blocks);
+                    float *reg_unpred_pos = reg_unpreds[s].data();
+                    reg_counts[s] = compress_slab(data, slabs[s], type.data(), quantizers[s], reg_types[s].data(), reg_unpred_pos);
+                    reg_unpreds[s].resize(reg_unpred_pos - reg_unpreds[s].data());
+                }
+                for (size_t s = 0; s < slabs.size(); s++) {
+                    memcpy(reg_params_type + RegCoeffNum3d * reg_count, reg_types[s].data(), RegCoeffNum3d * reg_counts[s] * sizeof(int));
+                    memcpy(reg_unpredictable_data_pos, reg_unpreds[s].data(), reg_unpreds[s].size() * sizeof(float));
+                    reg_unpredictable_data_pos += reg_unpreds[s].size();
+                    reg_count += reg_counts[s];
+                    quantizer.append_unpred(quantizers[s]);
+                }
+            }
+
             if (reg_count) {
                 reg_huffman = HuffmanEncoder<int>();
                 reg_huffman.preprocess_encode(reg_params_type, RegCoeffNum3d * reg_count, 0);
@@ -335,47 +452,30 @@ namespace QoZ {
             
             indicator_huffman.preprocess_encode(indicator, SELECTOR_RADIUS);
 
-//    printf("block %ld; lorenzo %ld, lorenzo_2layer %ld, regression %ld, poly regression %ld\n", size.num_blocks,
-//        lorenzo_count, lorenzo_2layer_count, reg_count);
-
             return type;
         }
 
-        //T *
-//        meta_decompress_3d(const unsigned char *compressed, size_t r1, size_t r2, size_t r3) {
-        T *decompress_3d(std::vector<int> &quant_inds, T *dec_data) {
-
-            int *type = quant_inds.data();
-//            T *dec_data = new T[size.num_elements];
-//    dec_data_sp_float = (float *) dec_data;
-            const float *reg_params_pos = (const float *) (reg_params + RegCoeffNum3d);;
-
-            const int *type_pos = type;
-            const int *indicator_pos = indicator.data();
-//        const float *reg_params_pos = reg_params;
+        //quantizer is the one of the frontend, or a LinearQuantizer::UnpredReader positioned at the slab
+        template<class SlabQuantizer>
+        void decompress_slab(const Slab &slab, const int *type, const float *reg_params_pos, SlabQuantizer &quantizer,
+                             T *dec_data) {
+            const int *type_pos = type + slab.type_offset;
+            const int *indicator_pos = indicator.data() + slab.block_offset;
             // add one more ghost layer
-            size_t buffer_dim0_offset =
-                    (size.d2 + params.lorenzo_padding_layer) * (size.d3 + params.lorenzo_padding_layer);
-            size_t buffer_dim1_offset = size.d3 + params.lorenzo_padding_layer;
-            T *pred_buffer = (T *) malloc(
-                    (size.block_size + params.lorenzo_padding_layer) * (size.d2 + params.lorenzo_padding_layer) *
-                    (size.d3 + params.lorenzo_padding_layer) * sizeof(T));
-            memset(pred_buffer, 0,
-                   (size.block_size + params.lorenzo_padding_layer) * (size.d2 + params.lorenzo_padding_layer) *
-                   (size.d3 + params.lorenzo_padding_layer) * sizeof(T));
-            T *x_data_pos = dec_data;
-            for (size_t i = 0; i < size.num_x; i++) {
+            PredBuffer buffer(size, slab, params.lorenzo_padding_layer);
+            T *pred_buffer = buffer.data.data();
+            size_t buffer_dim0_offset = buffer.dim0_offset;
+            size_t buffer_dim1_offset = buffer.dim1_offset;
+            T *x_data_pos = dec_data + slab.data_offset;
+            for (size_t i = slab.i0; i < slab.i1; i++) {
                 T *y_data_pos = x_data_pos;
                 T *pred_buffer_pos = pred_buffer;
                 for (size_t j = 0; j < size.num_y; j++) {
                     T *z_data_pos = y_data_pos;
-                    for (size_t k = 0; k < size.num_z; k++) {
-                        int size_x = ((i + 1) * size.block_size < size.d1) ? size.block_size : size.d1 -
-                                                                                               i * size.block_size;
-                        int size_y = ((j + 1) * size.block_size < size.d2) ? size.block_size : size.d2 -
-                                                                                               j * size.block_size;
-                        int size_z = ((k + 1) * size.block_size < size.d3) ? size.block_size : size.d3 -
-                                                                                               k * size.block_size;
+                    for (size_t k = slab.k0; k < slab.k1; k++) {
+                        int size_x = block_extent(i, size.d1);
+                        int size_y = block_extent(j, size.d2);
+                        int size_z = block_extent(k, size.d3);
                         if (*indicator_pos == SELECTOR_REGRESSION) {
                             // regression
                             regression_predict_recover_3d<T>(reg_params_pos, pred_buffer_pos, precision,
@@ -408,17 +508,42 @@ namespace QoZ {
                         z_data_pos += size_z;
                     }
                     y_data_pos += size.block_size * size.dim1_offset;
-                    pred_buffer_pos += size.block_size * buffer_dim1_offset - size.block_size * size.num_z;
+                    pred_buffer_pos += size.block_size * buffer_dim1_offset - size.block_size * (slab.k1 - slab.k0);
+                }
+                if (i + 1 < slab.i1) {
+                    memcpy(pred_buffer, pred_buffer + size.block_size * buffer_dim0_offset,
+                           params.lorenzo_padding_layer * buffer_dim0_offset * sizeof(T));
                 }
-                memcpy(pred_buffer, pred_buffer + size.block_size * buffer_dim0_offset,
-                       params.lorenzo_padding_layer * buffer_dim0_offset * sizeof(T));
                 x_data_pos += size.block_size * size.dim0_offset;
             }
-            free(pred_buffer);
-
+        }
 
-//            free(unpred_count_buffer);
-//            free(unpred_data_buffer);
+        //T *
+//        meta_decompress_3d(const unsigned char *compressed, size_t r1, size_t r2, size_t r3) {
+        T *decompress_3d(std::vector<int> &quant_inds, T *dec_data) {
+            const int *type = quant_inds.data();
+            const float *reg_params_pos = (const float *) (reg_params + RegCoeffNum3d);
+            auto slabs = make_slabs();
+            if (slabs.size() == 1) {
+                decompress_slab(slabs[0], type, reg_params_pos, quantizer, dec_data);
+                return dec_data;
+            }
+            //offsets of each slab into the coefficients and the unpredictable values
+            std::vector<size_t> reg_offsets(slabs.size()), unpred_offsets(slabs.size());
+            size_t regs = 0, unpreds = 0;
+            for (size_t s = 0; s < slabs.size(); s++) {
+                reg_offsets[s] = regs;
+                unpred_offsets[s] = unpreds;
+                regs += std::count(indicator.begin() + slabs[s].block_offset,
+                                   indicator.begin() + slabs[s].block_offset + slabs[s].num_blocks, SELECTOR_REGRESSION);
+                size_t type_end = s + 1 < slabs.size() ? slabs[s + 1].type_offset : size.num_elements;
+                unpreds += std::count(type + slabs[s].type_offset, type + type_end, 0);
+            }
+#pragma omp parallel for schedule(dynamic)
+            for (size_t s = 0; s < slabs.size(); s++) {
+                auto reader = quantizer.unpred_reader(unpred_offsets[s]);
+                decompress_slab(slabs[s], type, reg_params_pos + RegCoeffNum3d * reg_offsets[s], reader, dec_data);
+            }
             return dec_data;
         }
 
@@ -487,28 +612,36 @@ namespace QoZ {
             double err_lorenzo = 0;
             double err_lorenzo_2layer = 0;
             double err_reg = 0;
+            //sample coordinates along unit dimensions stay 0
+            int ax = active_dim(0), ay = active_dim(1), az = active_dim(2);
             for (int i = 2; i < min_size - 1; i++) {
                 int bmi = min_size - i;
-                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, i, i, i, dim0_offset, dim1_offset,
+                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, ax * i, ay * i, az * i, dim0_offset, dim1_offset,
                                                precision, err_lorenzo, err_lorenzo_2layer, err_reg, pred_dim,
                                                use_lorenzo,
                                                use_lorenzo_2layer, use_regression);
-                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, i, i, bmi, dim0_offset,
+                //in 1D, bmi runs over the same points as i
+                if (!ax && !ay)
+                    continue;
+                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, ax * i, ay * i, az * bmi, dim0_offset,
                                                dim1_offset, precision, err_lorenzo, err_lorenzo_2layer, err_reg,
                                                pred_dim,
                                                use_lorenzo, use_lorenzo_2layer, use_regression);
-                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, i, bmi, i, dim0_offset,
+                //with a unit second dimension, the remaining samples repeat the first two
+                if (!ay)
+                    continue;
+                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, ax * i, ay * bmi, az * i, dim0_offset,
                                                dim1_offset, precision, err_lorenzo, err_lorenzo_2layer, err_reg,
                                                pred_dim,
                                                use_lorenzo, use_lorenzo_2layer, use_regression);
-                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, i, bmi, bmi, dim0_offset,
+                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, ax * i, ay * bmi, az * bmi, dim0_offset,
                                                dim1_offset, precision, err_lorenzo, err_lorenzo_2layer, err_reg,
                                                pred_dim,
                                                use_lorenzo, use_lorenzo_2layer, use_regression);
             }
             if (min_size > 3) {
-                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, min_size - 1, min_size - 1,
-                                               min_size - 1,
+                meta_block_error_estimation_3d(data_pos, reg_params_pos, mean_info, ax * (min_size - 1), ay * (min_size - 1),
+                                               az * (min_size - 1),
                                                dim0_offset, dim1_offset,
                                                precision, err_lorenzo, err_lorenzo_2layer, err_reg, pred_dim,
                                                use_lorenzo,
@@ -530,6 +663,7 @@ namespace QoZ {
         QoZMETA::DSize_3d size;
         double precision;
         size_t reg_count = 0;
+        size_t slab_rows = 0;//block rows per independent slab, 0 for a single slab
         std::vector<int> indicator;
         int *reg_params_type = nullptr;
         float *reg_unpredictable_data = nullptr;
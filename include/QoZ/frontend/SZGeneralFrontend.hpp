@@ -8,8 +8,10 @@
 #include "QoZ/def.hpp"
 #include "QoZ/predictor/Predictor.hpp"
 #include "QoZ/predictor/LorenzoPredictor.hpp"
+#include "QoZ/predictor/ZeroPredictor.hpp"
 #include "QoZ/quantizer/Quantizer.hpp"
 #include "QoZ/utils/Iterator.hpp"
+#include "QoZ/utils/BlockCursor.hpp"
 #include "QoZ/utils/Config.hpp"
 #include "QoZ/utils/MemoryUtil.hpp"
 
@@ -42,9 +44,12 @@ namespace QoZ {
                     data, std::begin(global_dimensions), std::end(global_dimensions), 1, 0);
 
             predictor.precompress_data(block_range->begin());
+            predictor.precompress_blocks(block_range, block_size);
             quantizer.precompress_data();
-            
+
             size_t quant_count = 0;
+            BlockCursor<T, N> cursor(data, global_dimensions, block_size);
+            std::vector<T> pred(block_size);
             for (auto block = block_range->begin(); block != block_range->end(); ++block) {
 
                 element_range->update_block_range(block, block_size);
@@ -54,15 +59,15 @@ namespace QoZ {
                     predictor_withfallback = &fallback_predictor;
                 }
                 predictor_withfallback->precompress_block_commit();
-                
-                
-              
+
+                cursor.set_block(block_index(block));
+                if (compress_rows(cursor, predictor_withfallback, pred.data(), quant_inds.data(), quant_count)) {
+                    continue;
+                }
                 for (auto element = element_range->begin(); element != element_range->end(); ++element) {
                     quant_inds[quant_count++] = quantizer.quantize_and_overwrite(
                             *element, predictor_withfallback->predict(element));
                 }
-
-                
             }
            
             predictor.postcompress_data(block_range->begin());
@@ -84,6 +89,8 @@ namespace QoZ {
             predictor.predecompress_data(block_range->begin());
             quantizer.predecompress_data();
 
+            BlockCursor<T, N> cursor(dec_data, global_dimensions, block_size);
+            std::vector<T> pred(block_size);
             for (auto block = block_range->begin(); block != block_range->end(); ++block) {
 
                 element_range->update_block_range(block, block_size);
@@ -92,6 +99,10 @@ namespace QoZ {
                 if (!predictor.predecompress_block(element_range)) {
                     predictor_withfallback = &fallback_predictor;
                 }
+                cursor.set_block(block_index(block));
+                if (decompress_rows(cursor, predictor_withfallback, pred.data(), quant_inds_pos)) {
+                    continue;
+                }
                 for (auto element = element_range->begin(); element != element_range->end(); ++element) {
                     *element = quantizer.recover(predictor_withfallback->predict(element), *(quant_inds_pos++));
                 }
@@ -101,6 +112,35 @@ namespace QoZ {
             return dec_data;
         }
 
+        /**
+         * Adds the recovered values to dec_data instead of overwriting them, so that a residual field (the offsets of
+         * the wavelet pipeline) is decoded straight into the field it corrects. Only valid for predictors that never
+         * read the decompressed values, i.e. ZeroPredictor.
+         */
+        T *decompress_add(std::vector<int> &quant_inds, T *dec_data) {
+            static_assert(std::is_same<Predictor, ZeroPredictor<T, N>>::value,
+                          "the predictions must not depend on the decompressed data");
+            int const *quant_inds_pos = (int const *) quant_inds.data();
+            auto block_range = std::make_shared<QoZ::multi_dimensional_range<T, N>>(
+                    dec_data, std::begin(global_dimensions), std::end(global_dimensions), block_size, 0);
+
+            quantizer.predecompress_data();
+            BlockCursor<T, N> cursor(dec_data, global_dimensions, block_size);
+            for (auto block = block_range->begin(); block != block_range->end(); ++block) {
+                cursor.set_block(block_index(block));
+                for (; cursor.has_row(); cursor.next_row()) {
+                    T *x = cursor.row();
+                    size_t len = cursor.row_length();
+                    for (size_t i = 0; i < len; i++) {
+                        x[i] += quantizer.recover(0, quant_inds_pos[i]);
+                    }
+                    quant_inds_pos += len;
+                }
+            }
+            quantizer.postdecompress_data();
+            return dec_data;
+        }
+
         void save(uchar *&c) {
             write(global_dimensions.data(), N, c);
             write(block_size, c);
@@ -121,7 +161,7 @@ namespace QoZ {
         }
 
         size_t size_est() {
-            return quantizer.size_est();
+            return sizeof(size_t) * N + sizeof(block_size) + predictor.size_est() + quantizer.size_est();
         }
 
         void print() {
@@ -140,6 +180,90 @@ namespace QoZ {
         size_t get_num_elements() const { return num_elements; };
 
     private:
+        using block_iterator = typename multi_dimensional_range<T, N>::iterator;
+
+        static std::array<size_t, N> block_index(const block_iterator &block) {
+            std::array<size_t, N> index;
+            for (uint i = 0; i < N; i++) {
+                index[i] = block.get_local_index(i);
+            }
+            return index;
+        }
+
+        /**
+         * predicts and quantizes the block of the cursor row by row, see PredictorInterface::predict_row.
+         * Returns false if the predictor has no row-wise prediction, in which case nothing is done.
+         * The off-row terms of a Lorenzo prediction are added to the in-row neighbours one by one, in the order of the
+         * element-wise predictor, so that both give the same bits. They are not summed ahead into pred in a separate
+         * pass, since that would change the rounding of the predictions.
+         */
+        bool compress_rows(BlockCursor<T, N> &cursor, const concepts::PredictorInterface<T, N> *p, T *pred,
+                           int *quant_inds, size_t &quant_count) {
+            RowStencil<T> stencil;
+            for (; cursor.has_row(); cursor.next_row()) {
+                int order = p->predict_row(cursor, pred, stencil);
+                if (order < 0) {
+                    return false;
+                }
+                T *x = cursor.row();
+                size_t len = cursor.row_length(), col = cursor.get_global_index(N - 1);
+                int *q = quant_inds + quant_count;
+                quant_count += len;
+                if (order == 0) {
+                    for (size_t i = 0; i < len; i++) {
+                        q[i] = quantizer.quantize_and_overwrite(x[i], pred[i]);
+                    }
+                } else if (order == 1) {
+                    T x1 = col > 0 ? x[-1] : 0;
+                    for (size_t i = 0; i < len; i++) {
+                        q[i] = quantizer.quantize_and_overwrite(x[i], stencil.add_terms(x1, i));
+                        x1 = x[i];
+                    }
+                } else {
+                    T x1 = col > 0 ? x[-1] : 0, x2 = col > 1 ? x[-2] : 0;
+                    for (size_t i = 0; i < len; i++) {
+                        q[i] = quantizer.quantize_and_overwrite(x[i], stencil.add_terms(2 * x1 - x2, i));
+                        x2 = x1;
+                        x1 = x[i];
+                    }
+                }
+            }
+            return true;
+        }
+
+        bool decompress_rows(BlockCursor<T, N> &cursor, const concepts::PredictorInterface<T, N> *p, T *pred,
+                             int const *&quant_inds_pos) {
+            RowStencil<T> stencil;
+            for (; cursor.has_row(); cursor.next_row()) {
+                int order = p->predict_row(cursor, pred, stencil);
+                if (order < 0) {
+                    return false;
+                }
+                T *x = cursor.row();
+                size_t len = cursor.row_length(), col = cursor.get_global_index(N - 1);
+                if (order == 0) {
+                    for (size_t i = 0; i < len; i++) {
+                        x[i] = quantizer.recover(pred[i], quant_inds_pos[i]);
+                    }
+                } else if (order == 1) {
+                    T x1 = col > 0 ? x[-1] : 0;
+                    for (size_t i = 0; i < len; i++) {
+                        x1 = x[i] = quantizer.recover(stencil.add_terms(x1, i), quant_inds_pos[i]);
+                    }
+                } else {
+                    T x1 = col > 0 ? x[-1] : 0, x2 = col > 1 ? x[-2] : 0;
+                    for (size_t i = 0; i < len; i++) {
+                        T xi = quantizer.recover(stencil.add_terms(2 * x1 - x2, i), quant_inds_pos[i]);
+                        x[i] = xi;
+                        x2 = x1;
+                        x1 = xi;
+                    }
+                }
+                quant_inds_pos += len;
+            }
+            return true;
+        }
+
         Predictor predictor;
         LorenzoPredictor<T, N, 1> fallback_predictor;
         Quantizer quantizer;
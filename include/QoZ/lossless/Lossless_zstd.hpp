@@ -10,6 +10,11 @@
 #include "QoZ/utils/MemoryUtil.hpp"
 #include "QoZ/utils/FileUtil.hpp"
 #include "QoZ/lossless/Lossless.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 namespace QoZ {
     class Lossless_zstd : public concepts::LosslessInterface {
@@ -19,15 +24,42 @@ namespace QoZ {
 
         Lossless_zstd(int comp_level) : compression_level(comp_level) {};
 
+        /**
+         * The data is streamed through zstd into segments of at most segment_size bytes, then copied to a buffer of
+         * the compressed size (with room for the config appended by SZ_save_config), so that the memory used
+         * follows the compressed size instead of the input size.
+         */
         uchar *compress(uchar *data, size_t dataLength, size_t &outSize) {
-            size_t estimatedCompressedSize = (dataLength < 100 ? 200 : size_t(dataLength * 1.2)) + QoZ::Config::size_est();
-            uchar *compressBytes = new uchar[estimatedCompressedSize];
+            ZSTD_CCtx *cctx = ZSTD_createCCtx();
+            ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compression_level);
+            ZSTD_CCtx_setPledgedSrcSize(cctx, dataLength);
+            size_t segmentSize = std::min(ZSTD_compressBound(dataLength), segment_size);
+            std::vector<std::vector<uchar>> segments;
+            ZSTD_inBuffer input = {data, dataLength, 0};
+            ZSTD_outBuffer output = {nullptr, 0, 0};
+            size_t remaining;
+            do {
+                if (output.pos == output.size) {
+                    segments.emplace_back(segmentSize);
+                    output = {segments.back().data(), segmentSize, 0};
+                }
+                remaining = ZSTD_compressStream2(cctx, &output, &input, ZSTD_e_end);
+                if (ZSTD_isError(remaining)) {
+                    ZSTD_freeCCtx(cctx);
+                    throw std::runtime_error(std::string("zstd compression error: ") + ZSTD_getErrorName(remaining));
+                }
+            } while (remaining != 0);
+            ZSTD_freeCCtx(cctx);
+
+            outSize = sizeof(size_t) + (segments.size() - 1) * segmentSize + output.pos;
+            uchar *compressBytes = new uchar[outSize + QoZ::Config::size_est()];
             uchar *compressBytesPos = compressBytes;
             write(dataLength, compressBytesPos);
-
-            outSize = ZSTD_compress(compressBytesPos, estimatedCompressedSize, data, dataLength,
-                                    compression_level);
-            outSize += sizeof(size_t);
+            for (size_t i = 0; i < segments.size(); i++) {
+                size_t length = i + 1 < segments.size() ? segmentSize : output.pos;
+                memcpy(compressBytesPos, segments[i].data(), length);
+                compressBytesPos += length;
+            }
             return compressBytes;
         }
 
@@ -41,7 +73,11 @@ namespace QoZ {
             read(dataLength, dataPos, compressedSize);
 
             uchar *oriData = new uchar[dataLength];
-            ZSTD_decompress(oriData, dataLength, dataPos, compressedSize);
+            size_t decompressedSize = ZSTD_decompress(oriData, dataLength, dataPos, compressedSize);
+            if (ZSTD_isError(decompressedSize) or decompressedSize != dataLength) {
+                delete[] oriData;
+                throw std::runtime_error("zstd decompression error: corrupt or truncated stream");
+            }
             compressedSize = dataLength;
             return oriData;
         }
@@ -52,6 +88,7 @@ namespace QoZ {
 
     private:
         int compression_level = 3;  //default setting of level is 3
+        static constexpr size_t segment_size = 1 << 20;
     };
 }
 #endif //SZ_LOSSLESS_ZSTD_HPP
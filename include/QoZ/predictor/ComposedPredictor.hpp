@@ -5,9 +5,14 @@
 #include "QoZ/utils/Iterator.hpp"
 #include "QoZ/predictor/Predictor.hpp"
 #include "QoZ/encoder/HuffmanEncoder.hpp"
+#include "QoZ/utils/Config.hpp"
 #include <cassert>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
 
 namespace QoZ {
 
@@ -42,7 +47,79 @@ namespace QoZ {
         }
 
 
+        /**
+         * First phase of compression: fits all predictors on all blocks and selects the one with the smallest
+         * estimated error, in parallel over the blocks. The choices and the fitted coefficients are kept per block and
+         * replayed by precompress_block in the (serial) quantization pass.
+         * The selection is made on the original data instead of the reconstructed neighbors of the earlier blocks.
+         */
+        void precompress_blocks(const std::shared_ptr<Range> &block_range, uint block_size) {
+            block_sid.clear();
+            block_result.clear();
+            block_state.clear();
+            block_index = 0;
+            std::vector<iterator> blocks;
+            for (auto block = block_range->begin(); block != block_range->end(); ++block) {
+                blocks.push_back(block);
+            }
+            size_t num_blocks = blocks.size();
+            state_size = 0;
+            std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> clones;
+            for (const auto &p:predictors) {
+                clones.push_back(p->clone());
+                if (!clones.back()) {
+                    return; // selection is made block by block in precompress_block
+                }
+                state_size = std::max(state_size, p->block_state_size());
+            }
+            block_sid.resize(num_blocks);
+            block_result.resize(num_blocks);
+            block_state.resize(num_blocks * state_size);
+            selection.reserve(selection.size() + num_blocks);
+            auto global_dimensions = block_range->get_global_dimensions();
+            T *data = block_range->get_data();
+
+#pragma omp parallel if(num_blocks >= 1024)
+            {
+                //the first thread takes the clones of the check above, the others make their own
+                std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> local_predictors;
+#pragma omp critical
+                local_predictors.swap(clones);
+                if (local_predictors.empty()) {
+                    for (const auto &p:predictors) {
+                        local_predictors.push_back(p->clone());
+                    }
+                }
+                std::vector<double> local_error(predictors.size());
+                std::vector<uchar> result(predictors.size());
+                auto element_range = std::make_shared<Range>(data, std::begin(global_dimensions), std::end(global_dimensions), 1, 0);
+#pragma omp for schedule(static)
+                for (size_t b = 0; b < num_blocks; b++) {
+                    element_range->update_block_range(blocks[b], block_size);
+                    for (size_t p = 0; p < predictors.size(); p++) {
+                        result[p] = local_predictors[p]->precompress_block(element_range);
+                    }
+                    const auto &dims = element_range->get_dimensions();
+                    int min_dimension = *std::min_element(dims.begin(), dims.end());
+                    do_estimate_error(local_predictors, local_error, element_range->begin(), min_dimension);
+                    int s = std::distance(local_error.begin(), std::min_element(local_error.begin(), local_error.end()));
+                    block_sid[b] = s;
+                    block_result[b] = result[s];
+                    if (state_size) {
+                        local_predictors[s]->save_block_state(&block_state[b * state_size]);
+                    }
+                }
+            }
+        }
+
         bool precompress_block(const std::shared_ptr<Range> &range) {
+            if (block_index < block_sid.size()) {
+                sid = block_sid[block_index];
+                if (state_size) {
+                    predictors[sid]->load_block_state(&block_state[block_index * state_size]);
+                }
+                return block_result[block_index++];
+            }
             std::vector<bool> precompress_block_result;
             for (const auto &p:predictors) {
                 precompress_block_result.push_back(p->precompress_block(range));
@@ -50,7 +127,7 @@ namespace QoZ {
             const auto &dims = range->get_dimensions();
             int min_dimension = *std::min_element(dims.begin(), dims.end());
 
-            do_estimate_error(range->begin(), min_dimension);
+            do_estimate_error(predictors, predict_error, range->begin(), min_dimension);
 
             sid = std::distance(predict_error.begin(), std::min_element(predict_error.begin(), predict_error.end()));
             // std::cout << sid << std::endl;
@@ -76,14 +153,19 @@ namespace QoZ {
             // std::cout << "COMPOSED SAVE OFFSET = " << c - tmp << std::endl;
             // store selection
 
+            // the selection is stored with 2 bits per block (one byte with more than 4 predictors)
             *reinterpret_cast<size_t *>(c) = (size_t) selection.size();
             c += sizeof(size_t);
-            if (selection.size()) {
-                HuffmanEncoder<int> selection_encoder;
-                selection_encoder.preprocess_encode(selection, 0);
-                selection_encoder.save(c);
-                selection_encoder.encode(selection, c);
-                selection_encoder.postprocess_encode();
+            if (selection_bits() == 8) {
+                memcpy(c, selection.data(), selection.size());
+                c += selection.size();
+            } else {
+                size_t packed_size = (selection.size() + 3) / 4;
+                memset(c, 0, packed_size);
+                for (size_t i = 0; i < selection.size(); i++) {
+                    c[i >> 2] |= selection[i] << ((i & 3) << 1);
+                }
+                c += packed_size;
             }
 //            *reinterpret_cast<size_t *>(c) = (size_t) selection.size();
 //            c += sizeof(size_t);
@@ -101,16 +183,45 @@ namespace QoZ {
             // std::cout << "COMPOSED LOAD OFFSET = " << c - tmp << std::endl;
 
             // load selection
-            // TODO: check correctness
-            size_t selection_size = *reinterpret_cast<const size_t *>(c);
-            c += sizeof(size_t);
-            if (selection_size > 0) {
-                remaining_length -= sizeof(size_t);
-                HuffmanEncoder<int> selection_encoder;
-                selection_encoder.load(c, remaining_length);
-                this->selection = selection_encoder.decode(c, selection_size);
-                selection_encoder.postprocess_decode();
+            if (remaining_length < sizeof(size_t)) {
+                throw std::runtime_error("ComposedPredictor: truncated selection");
             }
+            size_t selection_size;
+            read(selection_size, c, remaining_length);
+            if (stream_version < 2) {
+                // Huffman coded selection of the older streams
+                selection.clear();
+                if (selection_size > 0) {
+                    HuffmanEncoder<int> selection_encoder;
+                    selection_encoder.load(c, remaining_length);
+                    auto decoded = selection_encoder.decode(c, selection_size);
+                    selection_encoder.postprocess_decode();
+                    selection.assign(decoded.begin(), decoded.end());
+                }
+            } else {
+                size_t per_byte = 8 / selection_bits();
+                if (selection_size / per_byte + (selection_size % per_byte != 0) > remaining_length) {
+                    throw std::runtime_error("ComposedPredictor: selection larger than the stream");
+                }
+                selection.resize(selection_size);
+                if (selection_bits() == 8) {
+                    memcpy(selection.data(), c, selection_size);
+                    c += selection_size;
+                    remaining_length -= selection_size;
+                } else {
+                    for (size_t i = 0; i < selection_size; i++) {
+                        selection[i] = (c[i >> 2] >> ((i & 3) << 1)) & 3;
+                    }
+                    c += (selection_size + 3) / 4;
+                    remaining_length -= (selection_size + 3) / 4;
+                }
+            }
+            for (auto sel: selection) {
+                if (sel >= predictors.size()) {
+                    throw std::runtime_error("ComposedPredictor: invalid predictor selection");
+                }
+            }
+            current_index = 0;
 //            size_t selection_size = *reinterpret_cast<const size_t *>(c);
 //            c += sizeof(size_t);
             // std::cout << "selection size = " << selection_size << std::endl;
@@ -123,6 +234,10 @@ namespace QoZ {
             return predictors[sid]->predict(iter);
         }
 
+        int predict_row(const BlockCursor<T, N> &cursor, T *pred, RowStencil<T> &stencil) const {
+            return predictors[sid]->predict_row(cursor, pred, stencil);
+        }
+
         int get_sid() const { return sid; }
 
         void set_sid(int _sid) {
@@ -133,6 +248,14 @@ namespace QoZ {
             return predictors[sid]->estimate_error(iter);
         }
 
+        size_t size_est() {
+            size_t size = sizeof(size_t) + selection.size();
+            for (const auto &p: predictors) {
+                size += p->size_est();
+            }
+            return size;
+        }
+
         void print() const {
             std::vector<size_t> cnt(predictors.size(), 0);
             size_t cnt_total = 0;
@@ -167,9 +290,10 @@ namespace QoZ {
 //            unpack(Ps...);
 //        }
 
+        // stream_version: layout of the selection to load, see STREAM_VERSION
         ComposedPredictor(std::vector<std::shared_ptr<concepts::PredictorInterface < T, N>>
 
-        > predictors) {
+        > predictors, uint8_t stream_version = STREAM_VERSION) : stream_version(stream_version) {
             this->predictors = predictors;
             predict_error.resize(predictors.size());
         }
@@ -179,38 +303,56 @@ namespace QoZ {
                 pred->clear();
             }
             selection.clear();
+            current_index = 0;
+            block_sid.clear();
+            block_result.clear();
+            block_state.clear();
+            block_index = 0;
         }
 
     private:
         std::vector<std::shared_ptr<concepts::PredictorInterface < T, N>>>
         predictors;
-        std::vector<int> selection;
+        std::vector<uchar> selection;
         int sid = 0;                            // selected index
         size_t current_index = 0;            // for decompression only
+        uint8_t stream_version;              // for decompression only
         std::vector<double> predict_error;
+        // per-block choices of precompress_blocks, replayed by precompress_block
+        std::vector<uchar> block_sid;
+        std::vector<uchar> block_result;
+        std::vector<T> block_state;
+        size_t state_size = 0;
+        size_t block_index = 0;
+
+        int selection_bits() const {
+            return predictors.size() <= 4 ? 2 : 8;
+        }
 
         template<uint NN = N>
         inline typename std::enable_if<NN == 1, void>::type
-        do_estimate_error(const iterator &iter, int min_dimension) {
-            std::fill(predict_error.begin(), predict_error.end(), 0);
+        do_estimate_error(const std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> &preds,
+                          std::vector<double> &errors, const iterator &iter, int min_dimension) const {
+            std::fill(errors.begin(), errors.end(), 0);
             auto iter1 = iter;
             iter1.move(min_dimension - 1);
-            for (int p = 0; p < predictors.size(); p++) {
-                predict_error[p] += predictors[p]->estimate_error(iter);
-                predict_error[p] += predictors[p]->estimate_error(iter1);
+            for (size_t p = 0; p < preds.size(); p++) {
+                errors[p] += preds[p]->estimate_error(iter);
+                errors[p] += preds[p]->estimate_error(iter1);
             }
         }
 
         template<uint NN = N>
         inline typename std::enable_if<NN == 2, void>::type
-        do_estimate_error(const iterator &iter, int min_dimension) {
-            std::fill(predict_error.begin(), predict_error.end(), 0);
+        do_estimate_error(const std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> &preds,
+                          std::vector<double> &errors, const iterator &iter, int min_dimension) const {
+            std::fill(errors.begin(), errors.end(), 0);
             auto iter1 = iter, iter2 = iter;
             iter2.move(0, min_dimension - 1);
             for (int i = 2; i < min_dimension; i++) {
-                for (int p = 0; p < predictors.size(); p++) {
-                    predict_error[p] += predictors[p]->estimate_error(iter1);
-                    predict_error[p] += predictors[p]->estimate_error(iter2);
+                for (size_t p = 0; p < preds.size(); p++) {
+                    errors[p] += preds[p]->estimate_error(iter1);
+                    errors[p] += preds[p]->estimate_error(iter2);
                 }
                 iter1.move(1, 1);
                 iter2.move(1, -1);
@@ -219,19 +361,20 @@ namespace QoZ {
 
         template<uint NN = N>
         inline typename std::enable_if<NN == 3, void>::type
-        do_estimate_error(const iterator &iter, int min_dimension) {
-            std::fill(predict_error.begin(), predict_error.end(), 0);
-//            std::vector<double> err(predictors.size(), 0);
+        do_estimate_error(const std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> &preds,
+                          std::vector<double> &errors, const iterator &iter, int min_dimension) const {
+            std::fill(errors.begin(), errors.end(), 0);
+//            std::vector<double> err(preds.size(), 0);
             auto iter1 = iter, iter2 = iter, iter3 = iter, iter4 = iter;
             iter2.move(0, 0, min_dimension - 1);
             iter3.move(0, min_dimension - 1, 0);
             iter4.move(0, min_dimension - 1, min_dimension - 1);
             for (int i = 2; i < min_dimension; i++) {
-                for (int p = 0; p < predictors.size(); p++) {
-                    predict_error[p] += predictors[p]->estimate_error(iter1);
-                    predict_error[p] += predictors[p]->estimate_error(iter2);
-                    predict_error[p] += predictors[p]->estimate_error(iter3);
-                    predict_error[p] += predictors[p]->estimate_error(iter4);
+                for (size_t p = 0; p < preds.size(); p++) {
+                    errors[p] += preds[p]->estimate_error(iter1);
+                    errors[p] += preds[p]->estimate_error(iter2);
+                    errors[p] += preds[p]->estimate_error(iter3);
+                    errors[p] += preds[p]->estimate_error(iter4);
                 }
                 iter1.move(1, 1, 1);
                 iter2.move(1, 1, -1);
@@ -242,9 +385,10 @@ namespace QoZ {
 
         template<uint NN = N>
         inline typename std::enable_if<NN >= 4, void>::type
-        do_estimate_error(const iterator &iter, int min_dimension) {
-            std::fill(predict_error.begin(), predict_error.end(), 0);
-//            std::vector<double> err(predictors.size(), 0);
+        do_estimate_error(const std::vector<std::shared_ptr<concepts::PredictorInterface<T, N>>> &preds,
+                          std::vector<double> &errors, const iterator &iter, int min_dimension) const {
+            std::fill(errors.begin(), errors.end(), 0);
+//            std::vector<double> err(preds.size(), 0);
             auto iter1 = iter, iter2 = iter, iter3 = iter, iter4 = iter,
                     iter5 = iter, iter6 = iter, iter7 = iter, iter8 = iter;;
             iter2.move(0, 0, 0, min_dimension - 1);
@@ -255,15 +399,15 @@ namespace QoZ {
             iter7.move(0, min_dimension - 1, min_dimension - 1, 0);
             iter8.move(0, min_dimension - 1, min_dimension - 1, min_dimension - 1);
             for (int i = 2; i < min_dimension; i++) {
-                for (int p = 0; p < predictors.size(); p++) {
-                    predict_error[p] += predictors[p]->estimate_error(iter1);
-                    predict_error[p] += predictors[p]->estimate_error(iter2);
-                    predict_error[p] += predictors[p]->estimate_error(iter3);
-                    predict_error[p] += predictors[p]->estimate_error(iter4);
-                    predict_error[p] += predictors[p]->estimate_error(iter5);
-                    predict_error[p] += predictors[p]->estimate_error(iter6);
-                    predict_error[p] += predictors[p]->estimate_error(iter7);
-                    predict_error[p] += predictors[p]->estimate_error(iter8);
+                for (size_t p = 0; p < preds.size(); p++) {
+                    errors[p] += preds[p]->estimate_error(iter1);
+                    errors[p] += preds[p]->estimate_error(iter2);
+                    errors[p] += preds[p]->estimate_error(iter3);
+                    errors[p] += preds[p]->estimate_error(iter4);
+                    errors[p] += preds[p]->estimate_error(iter5);
+                    errors[p] += preds[p]->estimate_error(iter6);
+                    errors[p] += preds[p]->estimate_error(iter7);
+                    errors[p] += preds[p]->estimate_error(iter8);
                 }
                 iter1.move(1, 1, 1, 1);
                 iter2.move(1, 1, 1, -1);
@@ -6,6 +6,9 @@
 #include "QoZ/utils/Iterator.hpp"
 #include <cassert>
 #include<cmath>
+#include <vector>
+#include <array>
+#include <algorithm>
 
 namespace QoZ {
 
@@ -95,6 +98,10 @@ namespace QoZ {
             
         }
 
+        size_t size_est() {
+            return sizeof(predictor_id);
+        }
+
         void print() const {
             std::cout << L << "-Layer " << N << "D Lorenzo predictor, noise = " << noise << "\n";
         }
@@ -107,13 +114,86 @@ namespace QoZ {
             return do_predict(iter);
         }
 
+        int predict_row(const BlockCursor<T, N> &cursor, T *, RowStencil<T> &stencil) const {
+            size_t col = cursor.get_global_index(N - 1);
+            stencil.count = 0;
+            for (const auto &term: row_terms()) {
+                const T *p = cursor.prev_row(term.back);
+                if (p == nullptr) {
+                    continue;
+                }
+                size_t back = term.back[N - 1];
+                size_t i0 = back > col ? back - col : 0;
+                stencil.rows[stencil.count] = p + i0 - back;
+                stencil.first[stencil.count] = i0;
+                stencil.coeffs[stencil.count] = term.coeff;
+                stencil.count++;
+            }
+            return RL;
+        }
+
         void clear() {}
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<LorenzoPredictor>(*this);
+        }
+
     protected:
         T noise = 0;
        
 
     private:
+        // the 4D predictor is first order for both layers, see do_predict
+        static const uint RL = N == 4 ? 1 : L;
+
+        struct RowTerm {
+            std::array<uint, N> back;
+            T coeff;
+        };
+
+        /**
+         * terms of the Lorenzo stencil that are not on the predicted row, i.e. the offsets b in {0..RL}^N with a
+         * nonzero b[0..N-2], with coefficient -prod_i (-1)^b[i] * binomial(RL, b[i]).
+         * They are listed in the order of do_predict, which sums them after the in-row terms.
+         */
+        static const std::vector<RowTerm> &row_terms() {
+            static const std::vector<RowTerm> terms = [] {
+                std::vector<RowTerm> t;
+                std::array<uint, N> back{};
+                size_t count = 1;
+                for (uint i = 0; i < N; i++) {
+                    count *= RL + 1;
+                }
+                for (size_t id = 0; id < count; id++) {
+                    size_t rest = id;
+                    bool on_row = true;
+                    int coeff = -1;
+                    for (int i = N - 1; i >= 0; i--) {
+                        back[i] = rest % (RL + 1);
+                        rest /= RL + 1;
+                        if (back[i] == 0) {
+                            continue;
+                        }
+                        if (i + 1 < (int) N) {
+                            on_row = false;
+                        }
+                        coeff *= back[i] == 1 ? -(int) RL : 1;
+                    }
+                    if (!on_row) {
+                        t.push_back(RowTerm{back, (T) coeff});
+                    }
+                }
+                // the 3D first order formula groups its terms by the number of nonzero offsets
+                if (N == 3 && RL == 1) {
+                    std::stable_sort(t.begin(), t.end(), [](const RowTerm &a, const RowTerm &b) {
+                        return std::count(a.back.begin(), a.back.end(), 1u) < std::count(b.back.begin(), b.back.end(), 1u);
+                    });
+                }
+                return t;
+            }();
+            return terms;
+        }
+
         template<uint NN = N, uint LL = L>
         inline typename std::enable_if<NN == 1 && LL == 1, T>::type do_predict(const iterator &iter) const noexcept {
             return iter.prev(1);
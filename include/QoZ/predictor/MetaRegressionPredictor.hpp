@@ -4,6 +4,7 @@
 #include "QoZ/utils/MetaDef.hpp"
 #include "QoZ/encoder/HuffmanEncoder.hpp"
 #include "QoZ/utils/MemoryUtil.hpp"
+#include <vector>
 
 namespace QoZMETA {
 
@@ -50,15 +51,19 @@ namespace QoZMETA {
         }
     }
 
+    //chain_starts: indices of the coefficient sets predicted from zero instead of the previous set
+    //(the first set of each independently compressed slab)
     template<typename T>
     float *
-    decode_regression_coefficients(const unsigned char *&compressed_pos, size_t reg_count, int block_size, T precision,
-                                   const meta_params &params) {
+    decode_regression_coefficients(const unsigned char *&compressed_pos, size_t &remaining_length, size_t reg_count,
+                                   int /*block_size*/, T /*precision*/, const meta_params &params,
+                                   const std::vector<size_t> &chain_starts = std::vector<size_t>()) {
         size_t reg_unpredictable_count = 0;
-        size_t remaining_length = RegCoeffNum3d * reg_count;//fake, has no meaning
         QoZ::read(reg_unpredictable_count, compressed_pos, remaining_length);
+        assert(reg_unpredictable_count <= remaining_length / sizeof(float));
         const float *reg_unpredictable_data_pos = (const float *) compressed_pos;
         compressed_pos += reg_unpredictable_count * sizeof(float);
+        remaining_length -= reg_unpredictable_count * sizeof(float);
 
 //        int *reg_type = Huffman_decode_tree_and_data(2 * RegCoeffCapacity, RegCoeffNum3d * reg_count, compressed_pos);
         QoZ::HuffmanEncoder<int> selector_encoder = QoZ::HuffmanEncoder<int>();
@@ -75,10 +80,16 @@ namespace QoZMETA {
             reg_precisions[i] = params.regression_param_eb_linear;
         }
         reg_precisions[RegCoeffNum3d - 1] = params.regression_param_eb_independent;
-        float *prev_reg_params = reg_params;
         float *reg_params_pos = reg_params + RegCoeffNum3d;
         const int *type_pos = (const int *) reg_type;
-        for (int i = 0; i < reg_count; i++) {
+        const float zeros[RegCoeffNum3d] = {0};
+        auto chain_start = chain_starts.begin();
+        for (size_t i = 0; i < reg_count; i++) {
+            const float *prev_reg_params = reg_params_pos - RegCoeffNum3d;
+            if (chain_start != chain_starts.end() && *chain_start == i) {
+                prev_reg_params = zeros;
+                chain_start++;
+            }
             for (int j = 0; j < RegCoeffNum3d; j++) {
                 *reg_params_pos = recover_reg_coeff(*prev_reg_params, reg_precisions[j], *(type_pos++), RegCoeffRadius,
                                                     reg_unpredictable_data_pos);
@@ -89,7 +100,7 @@ namespace QoZMETA {
         return reg_params;
     }
 
-    void
+    inline void
     encode_regression_coefficients(const int *reg_params_type, const float *reg_unpredictable_data, size_t reg_count,
                                     size_t reg_unpredictable_count, QoZ::HuffmanEncoder<int> &reg_huffman, unsigned char *&compressed_pos) {
         QoZ::write(reg_unpredictable_count, compressed_pos);
@@ -134,9 +145,10 @@ namespace QoZMETA {
             cur_data_pos += (dim0_offset - size_y * dim1_offset);
         }
         float coeff = 1.0 / (size_x * size_y * size_z);
-        reg_params_pos[0] = (2 * fx / (size_x - 1) - f) * 6 * coeff / (size_x + 1);
-        reg_params_pos[1] = (2 * fy / (size_y - 1) - f) * 6 * coeff / (size_y + 1);
-        reg_params_pos[2] = (2 * fz / (size_z - 1) - f) * 6 * coeff / (size_z + 1);
+        //unit dimensions (1D/2D data mapped onto 3D blocks) have no slope
+        reg_params_pos[0] = size_x > 1 ? (2 * fx / (size_x - 1) - f) * 6 * coeff / (size_x + 1) : 0;
+        reg_params_pos[1] = size_y > 1 ? (2 * fy / (size_y - 1) - f) * 6 * coeff / (size_y + 1) : 0;
+        reg_params_pos[2] = size_z > 1 ? (2 * fz / (size_z - 1) - f) * 6 * coeff / (size_z + 1) : 0;
         reg_params_pos[3] = f * coeff - ((size_x - 1) * reg_params_pos[0] / 2 + (size_y - 1) * reg_params_pos[1] / 2 +
                                          (size_z - 1) * reg_params_pos[2] / 2);
     }
@@ -87,24 +87,24 @@ namespace QoZ {
             std::copy(current_coeffs.begin(), current_coeffs.end(), prev_coeffs.begin());
         }
 
-        template<uint NN = N>
-        inline typename std::enable_if<NN == 1, std::array<T, M>>::type get_poly_index(const iterator &iter) const {
+        template<uint NN = N, class Index>
+        inline typename std::enable_if<NN == 1, std::array<T, M>>::type get_poly_index(const Index &iter) const {
             T i = iter.get_local_index(0);
 
             return std::array<T, M>{1, i, i * i};
         }
 
-        template<uint NN = N>
-        inline typename std::enable_if<NN == 2, std::array<T, M>>::type get_poly_index(const iterator &iter) const {
+        template<uint NN = N, class Index>
+        inline typename std::enable_if<NN == 2, std::array<T, M>>::type get_poly_index(const Index &iter) const {
             T i = iter.get_local_index(0);
             T j = iter.get_local_index(1);
 
             return std::array<T, M>{1, i, j, i * i, i * j, j * j};
         }
 
-        template<uint NN = N>
+        template<uint NN = N, class Index>
         inline typename std::enable_if<NN != 1 && NN != 2, std::array<T, M>>::type
-        get_poly_index(const iterator &iter) const {
+        get_poly_index(const Index &iter) const {
             T i = iter.get_local_index(0);
             T j = iter.get_local_index(1);
             T k = iter.get_local_index(2);
@@ -121,6 +121,19 @@ namespace QoZ {
             return pred;
         }
 
+        int predict_row(const BlockCursor<T, N> &cursor, T *pred, RowStencil<T> &) const {
+            RowIndex index{cursor, 0};
+            for (index.t = 0; index.t < cursor.row_length(); index.t++) {
+                auto poly_index = get_poly_index<N>(index);
+                T p = 0;
+                for (uint i = 0; i < M; i++) {
+                    p += poly_index[i] * current_coeffs[i];
+                }
+                pred[index.t] = p;
+            }
+            return 0;
+        }
+
         void save(uchar *&c) const {
 //            std::cout << "save 2-Layer Regression Predictor" << std::endl;
             c[0] = predictor_id;
@@ -167,6 +180,18 @@ namespace QoZ {
             regression_coeff_index = 0;
         }
 
+        size_t size_est() {
+            size_t size = sizeof(predictor_id) + quantizer_independent.size_est() + quantizer_liner.size_est() +
+                          quantizer_poly.size_est() + sizeof(size_t);
+            if (!regression_coeff_quant_inds.empty()) {
+                HuffmanEncoder<int> encoder = HuffmanEncoder<int>();
+                encoder.preprocess_encode(regression_coeff_quant_inds, 0);
+                size += encoder.size_est() + encoder.encoded_size_est(regression_coeff_quant_inds.size());
+                encoder.postprocess_encode();
+            }
+            return size;
+        }
+
         void print() const {
             std::cout << "2-Layer Regression predictor, indendent term eb = " << quantizer_independent.get_eb() << "\n";
             std::cout << "2-Layer Regression predictor, linear term eb = " << quantizer_liner.get_eb() << "\n";
@@ -183,11 +208,37 @@ namespace QoZ {
             prev_coeffs = {0};
         }
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<PolyRegressionPredictor>(*this);
+        }
+
+        size_t block_state_size() const {
+            return current_coeffs.size();
+        }
+
+        void save_block_state(T *state) const {
+            std::copy(current_coeffs.begin(), current_coeffs.end(), state);
+        }
+
+        void load_block_state(const T *state) {
+            std::copy(state, state + current_coeffs.size(), current_coeffs.begin());
+        }
+
     private:
         LinearQuantizer<T> quantizer_independent, quantizer_liner, quantizer_poly;
         std::vector<int> regression_coeff_quant_inds;
         size_t regression_coeff_index = 0;
         std::array<T, M> current_coeffs;
+
+        // local index of the t-th element of the current row of a cursor, in the form get_poly_index expects
+        struct RowIndex {
+            const BlockCursor<T, N> &cursor;
+            size_t t;
+
+            size_t get_local_index(uint i) const {
+                return i == N - 1 ? t : cursor.get_local_index(i);
+            }
+        };
         std::array<T, M> prev_coeffs;
         std::vector<std::array<T, M * M>> coef_aux_list;
         std::vector<int> COEF_AUX_MAX_BLOCK = {5000, 4096, 64, 16};
@@ -2,6 +2,7 @@
 #define _SZ_PREDICTOR_HPP
 
 #include "QoZ/utils/Iterator.hpp"
+#include "QoZ/utils/BlockCursor.hpp"
 #include "QoZ/def.hpp"
 
 namespace QoZ {
@@ -35,6 +36,9 @@ namespace QoZ {
 
             virtual void load(const uchar *&c, size_t &remaining_length) = 0;
 
+            // upper bound of the bytes written by save
+            virtual size_t size_est() = 0;
+
             virtual T predict(const iterator &iter) const noexcept = 0;
 
             virtual T estimate_error(const iterator &iter) const noexcept = 0;
@@ -42,6 +46,30 @@ namespace QoZ {
             virtual void print() const = 0;
 
             virtual void clear() = 0;
+
+            // optional pass over all blocks before the per-block calls of compression, see ComposedPredictor
+            virtual void precompress_blocks(const std::shared_ptr<Range> &, uint) {}
+
+            // copy used to fit blocks on other threads, nullptr if the predictor does not support it
+            virtual std::shared_ptr<PredictorInterface> clone() const { return nullptr; }
+
+            // number of values fitted by precompress_block (e.g. regression coefficients)
+            virtual size_t block_state_size() const { return 0; }
+
+            // saves the values fitted by the last precompress_block
+            virtual void save_block_state(T *) const {}
+
+            // restores fitted values, so that precompress_block_commit can be called without precompress_block
+            virtual void load_block_state(const T *) {}
+
+            /**
+             * row-wise prediction of the current row of the cursor, for the block-wise frontends.
+             * Returns 0 after filling pred with the prediction of the row. Lorenzo predictors return their in-row order
+             * instead and fill stencil with the terms off the row: the prediction of element i is x[i-1] (order 1) or
+             * 2x[i-1]-x[i-2] (order 2) of the reconstructed row x, followed by stencil.add_terms, which gives the same
+             * rounding as predict. Returns -1 if the predictor only supports the element-wise predict.
+             */
+            virtual int predict_row(const BlockCursor<T, N> &, T *, RowStencil<T> &) const { return -1; }
         };
 
         /**
@@ -100,6 +100,18 @@ namespace QoZ {
             return pred;
         }
 
+        int predict_row(const BlockCursor<T, N> &cursor, T *pred, RowStencil<T> &) const {
+            T base = 0;
+            for (uint i = 0; i < N - 1; i++) {
+                base += cursor.get_local_index(i) * current_coeffs[i];
+            }
+            size_t len = cursor.row_length();
+            for (size_t t = 0; t < len; t++) {
+                pred[t] = base + t * current_coeffs[N - 1] + current_coeffs[N];
+            }
+            return 0;
+        }
+
         void save(uchar *&c) const {
 //            std::cout << "save regression predictor" << std::endl;
 
@@ -152,6 +164,18 @@ namespace QoZ {
             }
         }
 
+        size_t size_est() {
+            size_t size = sizeof(uint8_t) + sizeof(size_t);
+            if (!regression_coeff_quant_inds.empty()) {
+                HuffmanEncoder<int> encoder = HuffmanEncoder<int>();
+                encoder.preprocess_encode(regression_coeff_quant_inds, 0);
+                size += quantizer_independent.size_est() + quantizer_liner.size_est() + encoder.size_est() +
+                        encoder.encoded_size_est(regression_coeff_quant_inds.size());
+                encoder.postprocess_encode();
+            }
+            return size;
+        }
+
         void print() const {
             std::cout << "Regression predictor, indendent term eb = " << quantizer_independent.get_eb() << "\n";
             std::cout << "Regression predictor, linear term eb = " << quantizer_liner.get_eb() << "\n";
@@ -177,6 +201,22 @@ namespace QoZ {
             prev_coeffs = {0};
         }
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<RegressionPredictor>(*this);
+        }
+
+        size_t block_state_size() const {
+            return current_coeffs.size();
+        }
+
+        void save_block_state(T *state) const {
+            std::copy(current_coeffs.begin(), current_coeffs.end(), state);
+        }
+
+        void load_block_state(const T *state) {
+            std::copy(state, state + current_coeffs.size(), current_coeffs.begin());
+        }
+
         std::array<T, N + 1> get_current_coeffs() {
             return current_coeffs;
         }
@@ -46,6 +46,10 @@ namespace QoZ {
            
         }
 
+        size_t size_est() {
+            return 0;
+        }
+
         void print() const {
            
         }
@@ -58,8 +62,17 @@ namespace QoZ {
             return 0;
         }
 
+        int predict_row(const BlockCursor<T, N> &cursor, T *pred, RowStencil<T> &) const {
+            std::fill(pred, pred + cursor.row_length(), 0);
+            return 0;
+        }
+
         void clear() {}
 
+        std::shared_ptr<concepts::PredictorInterface<T, N>> clone() const {
+            return std::make_shared<ZeroPredictor>(*this);
+        }
+
     protected:
        
 
@@ -8,11 +8,14 @@
 #include <gsl/gsl_wavelet.h>
 #endif
 #include "QoZ/utils/FileUtil.hpp"
+#include "QoZ/utils/Config.hpp"
+#if QoZ_USE_PYBIND
 #include <pybind11/embed.h>
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
-#include <cstdlib>
 namespace py = pybind11;
+#endif
+#include <cstdlib>
 namespace QoZ {
 
 
@@ -100,8 +103,9 @@ namespace QoZ {
         }
     }
 
+    //if not inplace, the output goes to out, which may be data itself, or to a new array if out is null
     template<class T, QoZ::uint N>
-    T * external_wavelet_postprocessing(T *data, const std::vector<size_t> &dims, size_t num, int wave_type=2, size_t pid=0, bool inplace=true,const std::vector<size_t> &output_dims=std::vector<size_t>())
+    T * external_wavelet_postprocessing(T *data, const std::vector<size_t> &/*dims*/, size_t num, int /*wave_type*/=2, size_t pid=0, bool inplace=true,const std::vector<size_t> &output_dims=std::vector<size_t>(), T *out=nullptr)
     {
         
             
@@ -132,7 +136,7 @@ namespace QoZ {
             for (size_t i = 0; i < N; i++)
                 outnum *= output_dims[i];
 
-            T *outData = new T[outnum];
+            T *outData = out ? out : new T[outnum];
             QoZ::readfile<T>(output_filename.c_str(), outnum, outData);
             system(del_command.c_str());
             
@@ -141,14 +145,28 @@ namespace QoZ {
     }
 
 
+#if QoZ_USE_PYBIND
+    /**
+     * Starts the embedded interpreter on the first use of a python-backed feature, so that processes which never use
+     * one do not pay for it. It is never finalized (numpy cannot be loaded twice), and if QoZ is itself called from
+     * python, the running interpreter is used.
+     */
+    inline void start_python(QoZ::Config &conf) {
+        if (!Py_IsInitialized()) {
+            py::initialize_interpreter();
+        }
+        conf.pybind_activated = true;
+    }
+#endif
+
     template<class T, QoZ::uint N>
-    T * pybind_wavelet_preprocessing(QoZ::Config &conf,T *data, std::string & metadata, int wave_type=2,bool inplace=true,std::vector<size_t> &coeffs_size=std::vector<size_t>())
+    T * pybind_wavelet_preprocessing(QoZ::Config &conf,T *data, [[maybe_unused]] std::string &metadata, int wave_type=2,bool inplace=true,std::vector<size_t> &coeffs_size=std::vector<size_t>())
     {
+#if !QoZ_USE_PYBIND
+        return external_wavelet_preprocessing<T,N>(data, conf.dims, conf.num, wave_type, conf.pid, inplace, coeffs_size);
+#else
         try{
-            if(!conf.pybind_activated){
-                conf.pybind_activated=true;
-                py::initialize_interpreter();
-            }
+            start_python(conf);
 
            // QoZ::Timer temptimer(true);
             std::string HOME = getenv("HOME");
@@ -214,17 +232,19 @@ namespace QoZ {
                       << e.what() << "'\n";
         }
         return NULL;
+#endif
 
     }
 
+    //same output convention as external_wavelet_postprocessing; data is copied into the python array first
     template<class T, QoZ::uint N>
-    T * pybind_wavelet_postprocessing(QoZ::Config &conf, T *data, std::string metadata, int wave_type=2, bool inplace=true,const std::vector<size_t> &output_dims=std::vector<size_t>())
-    {   
+    T * pybind_wavelet_postprocessing(QoZ::Config &conf, T *data, [[maybe_unused]] std::string metadata, int wave_type=2, bool inplace=true,const std::vector<size_t> &output_dims=std::vector<size_t>(), T *out=nullptr)
+    {
+#if !QoZ_USE_PYBIND
+        return external_wavelet_postprocessing<T,N>(data, conf.dims, conf.num, wave_type, conf.pid, inplace, output_dims, out);
+#else
         try{
-            if(!conf.pybind_activated){
-                conf.pybind_activated=true;
-                py::initialize_interpreter();
-            }
+            start_python(conf);
             //QoZ::Timer temptimer(true);
             std::string HOME = getenv("HOME");
             py::module_::import("sys").attr("path").attr("append")(HOME + "/QoZ/include/QoZ/preprocessor");
@@ -272,7 +292,7 @@ namespace QoZ {
                 for (size_t i = 0; i < N; i++)
                     outnum *= output_dims[i];
 
-                T *outData = new T[outnum];
+                T *outData = out ? out : new T[outnum];
                 for(size_t i=0;i<outnum;i++)
                     outData[i]=idwt_data.data()[i];
                 //memcpy(outData,idwt_data.data(),outnum*sizeof(T));//this may cause bug when T=double, very strange......
@@ -287,6 +307,7 @@ namespace QoZ {
                       << e.what() << "'\n";
         }
         return NULL;
+#endif
         
         
 
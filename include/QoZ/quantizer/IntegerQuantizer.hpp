@@ -3,7 +3,11 @@
 
 #include <cstring>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <type_traits>
 #include <vector>
 #include "QoZ/def.hpp"
 #include "QoZ/quantizer/Quantizer.hpp"
@@ -13,12 +17,15 @@ namespace QoZ {
     template<class T>
     class LinearQuantizer : public concepts::QuantizerInterface<T> {
     public:
-        LinearQuantizer() : error_bound(1), error_bound_reciprocal(1), radius(32768) {}
+        LinearQuantizer() : error_bound(1), error_bound_reciprocal(1), radius(32768) {
+            set_unpred_step(2);
+        }
 
         LinearQuantizer(double eb, int r = 32768) : error_bound(eb),
                                                     error_bound_reciprocal(1.0 / eb),
                                                     radius(r) {
             assert(eb != 0);
+            set_unpred_step(2 * eb);
         }
 
         int get_radius() const { return radius; }
@@ -79,6 +86,7 @@ namespace QoZ {
                 T decompressed_data = pred + quant_index * this->error_bound;
                 if (fabs(decompressed_data - data) > this->error_bound) {
                     //std::cout<<data<<std::endl;
+                    data = quantize_unpred(data);
                     if(save_unpred)
                         unpred.push_back(data);
                     return 0;
@@ -87,6 +95,7 @@ namespace QoZ {
                     return quant_index_shifted;
                 }
             } else {
+                data = quantize_unpred(data);
                 if(save_unpred)
                     unpred.push_back(data);
                 return 0;
@@ -111,26 +120,59 @@ namespace QoZ {
                 }
                 T decompressed_data = pred + quant_index * this->error_bound;
                 if (fabs(decompressed_data - ori) > this->error_bound) {
+                    dest = quantize_unpred(ori);
                     if(save_unpred)
-                        unpred.push_back(ori);
-                    dest = ori;
+                        unpred.push_back(dest);
                     return 0;
                 } else {
                     dest = decompressed_data;
                     return quant_index_shifted;
                 }
             } else {
+                dest = quantize_unpred(ori);
                 if(save_unpred)
-                    unpred.push_back(ori);
-                dest = ori;
+                    unpred.push_back(dest);
                 return 0;
             }
         }
 
+        //stores ori exactly (e.g. anchor points, which are not overwritten by the caller)
         void insert_unpred(T ori){
             unpred.push_back(ori);
         }
         
+        //appends the unpredictable values of a quantizer that compressed a later part of the data
+        void append_unpred(const LinearQuantizer &other) {
+            unpred.insert(unpred.end(), other.unpred.begin(), other.unpred.end());
+        }
+
+        /**
+         * Decoder of a part of the data, for decoding parts independently: recovers with the parameters of the
+         * quantizer, and reads its unpredictable values from the i-th one on without copying them.
+         * Only valid as long as the quantizer is not modified.
+         */
+        class UnpredReader {
+        public:
+            UnpredReader(const LinearQuantizer &quantizer, size_t i) : quantizer(quantizer),
+                                                                       pos(quantizer.unpred.data() + i) {}
+
+            T recover_pred(T pred, int quant_index) const {
+                return quantizer.recover_pred(pred, quant_index);
+            }
+
+            T recover_unpred() {
+                return *pos++;
+            }
+
+        private:
+            const LinearQuantizer &quantizer;
+            const T *pos;
+        };
+
+        UnpredReader unpred_reader(size_t i) const {
+            return UnpredReader(*this, i);
+        }
+
         void print_unpred(){
             for(auto x:unpred)
                 std::cout<<x<<std::endl;
@@ -148,7 +190,7 @@ namespace QoZ {
         }
 
 
-        T recover_pred(T pred, int quant_index) {
+        T recover_pred(T pred, int quant_index) const {
             return pred + 2 * (quant_index - this->radius) * this->error_bound;
         }
 
@@ -157,12 +199,18 @@ namespace QoZ {
         }
 
         size_t size_est() {
-            return unpred.size() * sizeof(T);
+            size_t num_blocks = (unpred.size() + unpred_block_size - 1) / unpred_block_size;
+            return sizeof(uint8_t) + sizeof(double) + sizeof(int) + sizeof(size_t) + sizeof(double) +
+                   num_blocks * sizeof(uint32_t) + unpred.size() * max_unpred_code_size;
         }
 
+        /**
+         * The unpredictable values are stored with the codec of encode_unpred_block (type 0b00000011),
+         * streams of type 0b00000010 hold them verbatim.
+         */
         void save(unsigned char *&c) const {
             // std::string serialized(sizeof(uint8_t) + sizeof(T) + sizeof(int),0);
-            c[0] = 0b00000010;
+            c[0] = 0b00000011;
             c += 1;
             // std::cout << "saving eb = " << this->error_bound << ", unpred_num = "  << unpred.size() << std::endl;
             *reinterpret_cast<double *>(c) = this->error_bound;
@@ -174,15 +222,34 @@ namespace QoZ {
             *reinterpret_cast<size_t *>(c) = unpred.size();
            
             c += sizeof(size_t);
-            memcpy(c, unpred.data(), unpred.size() * sizeof(T));
-            c += unpred.size() * sizeof(T);
+            *reinterpret_cast<double *>(c) = this->unpred_step;
+            c += sizeof(double);
+
+            //blocks are coded independently, and their sizes written first
+            size_t num_blocks = (unpred.size() + unpred_block_size - 1) / unpred_block_size;
+            std::vector<std::vector<uchar>> blocks(num_blocks);
+#pragma omp parallel for schedule(static) if(num_blocks >= 8)
+            for (size_t b = 0; b < num_blocks; b++) {
+                size_t begin = b * unpred_block_size;
+                encode_unpred_block(unpred.data() + begin, std::min(unpred_block_size, unpred.size() - begin), blocks[b]);
+            }
+            for (const auto &block: blocks) {
+                *reinterpret_cast<uint32_t *>(c) = block.size();
+                c += sizeof(uint32_t);
+            }
+            for (const auto &block: blocks) {
+                memcpy(c, block.data(), block.size());
+                c += block.size();
+            }
         };
 
         void load(const unsigned char *&c, size_t &remaining_length) {
             
-            assert(remaining_length > (sizeof(uint8_t) + sizeof(T) + sizeof(int)));
+            if (remaining_length < sizeof(uint8_t) + sizeof(double) + sizeof(int) + sizeof(size_t)) {
+                throw std::runtime_error("LinearQuantizer: truncated stream");
+            }
+            uint8_t type = c[0];
             c += sizeof(uint8_t);
-            remaining_length -= sizeof(uint8_t);
             this->error_bound = *reinterpret_cast<const double *>(c);
             //std::cout<<this->error_bound<<std::endl;
            
@@ -196,8 +263,48 @@ namespace QoZ {
             //std::cout<<unpred_size<<std::endl;
             
             c += sizeof(size_t);
-            this->unpred = std::vector<T>(reinterpret_cast<const T *>(c), reinterpret_cast<const T *>(c) + unpred_size);
-            c += unpred_size * sizeof(T);
+            remaining_length -= sizeof(uint8_t) + sizeof(double) + sizeof(int) + sizeof(size_t);
+            if (type == 0b00000010) {
+                if (unpred_size > remaining_length / sizeof(T)) {
+                    throw std::runtime_error("LinearQuantizer: unpredictable values exceed the stream");
+                }
+                this->unpred = std::vector<T>(reinterpret_cast<const T *>(c), reinterpret_cast<const T *>(c) + unpred_size);
+                c += unpred_size * sizeof(T);
+                remaining_length -= unpred_size * sizeof(T);
+            } else {
+                size_t num_blocks = unpred_size / unpred_block_size + (unpred_size % unpred_block_size != 0);
+                if (remaining_length < sizeof(double) or
+                    num_blocks > (remaining_length - sizeof(double)) / sizeof(uint32_t)) {
+                    throw std::runtime_error("LinearQuantizer: unpredictable blocks exceed the stream");
+                }
+                set_unpred_step(*reinterpret_cast<const double *>(c));
+                c += sizeof(double);
+                remaining_length -= sizeof(double) + num_blocks * sizeof(uint32_t);
+                std::vector<size_t> offsets(num_blocks + 1, 0);
+                for (size_t b = 0; b < num_blocks; b++) {
+                    offsets[b + 1] = offsets[b] + *reinterpret_cast<const uint32_t *>(c);
+                    c += sizeof(uint32_t);
+                }
+                if (offsets[num_blocks] > remaining_length) {
+                    throw std::runtime_error("LinearQuantizer: unpredictable blocks exceed the stream");
+                }
+                this->unpred.resize(unpred_size);
+                size_t corrupt = 0;
+#pragma omp parallel for schedule(static) reduction(+:corrupt) if(num_blocks >= 8)
+                for (size_t b = 0; b < num_blocks; b++) {
+                    size_t begin = b * unpred_block_size;
+                    if (!decode_unpred_block(c + offsets[b], c + offsets[b + 1],
+                                             std::min(unpred_block_size, unpred_size - begin),
+                                             this->unpred.data() + begin)) {
+                        corrupt++;
+                    }
+                }
+                if (corrupt) {
+                    throw std::runtime_error("LinearQuantizer: corrupt unpredictable block");
+                }
+                c += offsets[num_blocks];
+                remaining_length -= offsets[num_blocks];
+            }
             // std::cout << "loading: eb = " << this->error_bound << ", unpred_num = "  << unpred.size() << std::endl;
             // reset index
             index = 0;
@@ -225,8 +332,129 @@ namespace QoZ {
 
 
     private:
+        using bits_type = typename std::conditional<sizeof(T) == 4, uint32_t, uint64_t>::type;
+        static constexpr size_t unpred_block_size = 4096;
+        static constexpr size_t max_unpred_code_size = 10; // longest varint
+        static constexpr double max_unpred_index = 2305843009213693952.0; // 2^61, deltas fit in 63 bits
+
+        void set_unpred_step(double step) {
+            unpred_step = step;
+            unpred_step_reciprocal = 1.0 / step;
+        }
+
+        T unpred_value(int64_t k) const {
+            return (T) ((double) k * unpred_step);
+        }
+
+        /**
+         * secondary quantizer of the values out of the range of the quantization bins: rounds them to the grid of
+         * unpred_step, which is fixed by the constructor so that set_eb does not move it, if this is within the
+         * current error bound. Values it cannot represent (e.g. huge or non-finite) are kept as they are.
+         */
+        T quantize_unpred(T data) const {
+            double k = std::round(data * unpred_step_reciprocal);
+            if (!(fabs(k) < max_unpred_index)) {
+                return data;
+            }
+            T rec = unpred_value((int64_t) k);
+            return fabs(rec - data) > this->error_bound ? data : rec;
+        }
+
+        static void write_varint(uint64_t v, std::vector<uchar> &out) {
+            while (v >= 0x80) {
+                out.push_back((uchar) (v | 0x80));
+                v >>= 7;
+            }
+            out.push_back((uchar) v);
+        }
+
+        //false if the varint runs past end or past 64 bits
+        static bool read_varint(const uchar *&c, const uchar *end, uint64_t &v) {
+            v = 0;
+            for (int shift = 0; shift < 64 && c < end; shift += 7) {
+                uchar b = *c++;
+                v |= (uint64_t) (b & 0x7f) << shift;
+                if (!(b & 0x80)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * Each value is a varint with the lowest bit as tag. Values on the grid of quantize_unpred (tag 0) are
+         * coded as the zigzag delta of their grid index from the previous one on the grid; other values (tag 1) as
+         * the number of bytes of the XOR of their bits with the previous such value, followed by those bytes.
+         * Nearby exceptions have close magnitudes, so both codes are mostly short, and the bytes are left to the
+         * lossless stage. Decoding reproduces the values exactly.
+         */
+        void encode_unpred_block(const T *values, size_t n, std::vector<uchar> &out) const {
+            out.reserve(n * 2);
+            int64_t prev_k = 0;
+            bits_type prev_bits = 0;
+            for (size_t i = 0; i < n; i++) {
+                bits_type bits;
+                memcpy(&bits, &values[i], sizeof(T));
+                double kd = std::round(values[i] * unpred_step_reciprocal);
+                if (fabs(kd) < max_unpred_index) {
+                    int64_t k = (int64_t) kd;
+                    T rec = unpred_value(k);
+                    bits_type rec_bits;
+                    memcpy(&rec_bits, &rec, sizeof(T));
+                    if (rec_bits == bits) {
+                        int64_t delta = k - prev_k;
+                        uint64_t zigzag = ((uint64_t) delta << 1) ^ (uint64_t) (delta >> 63);
+                        write_varint(zigzag << 1, out);
+                        prev_k = k;
+                        continue;
+                    }
+                }
+                bits_type x = bits ^ prev_bits;
+                uint64_t num_bytes = 0;
+                while (num_bytes < sizeof(T) && (x >> (8 * num_bytes)) != 0) {
+                    num_bytes++;
+                }
+                write_varint(num_bytes << 1 | 1, out);
+                for (uint64_t b = 0; b < num_bytes; b++) {
+                    out.push_back((uchar) (x >> (8 * b)));
+                }
+                prev_bits = bits;
+            }
+        }
+
+        //false if the block [c, end) does not hold n values
+        bool decode_unpred_block(const uchar *c, const uchar *end, size_t n, T *values) const {
+            int64_t prev_k = 0;
+            bits_type prev_bits = 0;
+            for (size_t i = 0; i < n; i++) {
+                uint64_t code;
+                if (!read_varint(c, end, code)) {
+                    return false;
+                }
+                if (!(code & 1)) {
+                    uint64_t zigzag = code >> 1;
+                    prev_k += (int64_t) (zigzag >> 1) ^ -(int64_t) (zigzag & 1);
+                    values[i] = unpred_value(prev_k);
+                } else {
+                    uint64_t num_bytes = code >> 1;
+                    if (num_bytes > sizeof(T) or num_bytes > (size_t) (end - c)) {
+                        return false;
+                    }
+                    bits_type x = 0;
+                    for (uint64_t b = 0; b < num_bytes; b++) {
+                        x |= (bits_type) (*c++) << (8 * b);
+                    }
+                    prev_bits ^= x;
+                    memcpy(&values[i], &prev_bits, sizeof(T));
+                }
+            }
+            return true;
+        }
+
         std::vector<T> unpred;
         size_t index = 0; // used in decompression only
+        double unpred_step; // grid of the secondary quantizer of the unpredictable values
+        double unpred_step_reciprocal;
 
         double error_bound;
         double error_bound_reciprocal;
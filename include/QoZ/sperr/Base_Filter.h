@@ -32,21 +32,21 @@ class Base_Filter {
 };
 
 };  // namespace sperr
-auto sperr::Base_Filter::apply_filter(vecd_type& buf, dims_type dims) -> vec8_type
+inline auto sperr::Base_Filter::apply_filter(vecd_type& /*buf*/, dims_type /*dims*/) -> vec8_type
 {
   auto empty = vec8_type();
   return empty;
 }
 
-auto sperr::Base_Filter::inverse_filter(vecd_type& buf,
-                                        dims_type dims,
-                                        const void* header,
-                                        size_t header_len) -> bool
+inline auto sperr::Base_Filter::inverse_filter(vecd_type& /*buf*/,
+                                        dims_type /*dims*/,
+                                        const void* /*header*/,
+                                        size_t /*header_len*/) -> bool
 {
   return true;
 }
 
-auto sperr::Base_Filter::header_size(const void* header) const -> size_t
+inline auto sperr::Base_Filter::header_size(const void* /*header*/) const -> size_t
 {
   return 0;
 }
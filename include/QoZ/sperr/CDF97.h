@@ -182,7 +182,7 @@ auto sperr::CDF97::copy_data(const T* data, size_t len, dims_type dims) -> RTNTy
 template auto sperr::CDF97::copy_data(const float*, size_t, dims_type) -> RTNType;
 template auto sperr::CDF97::copy_data(const double*, size_t, dims_type) -> RTNType;
 
-auto sperr::CDF97::take_data(vecd_type&& buf, dims_type dims) -> RTNType
+inline auto sperr::CDF97::take_data(vecd_type&& buf, dims_type dims) -> RTNType
 {
   if (buf.size() != dims[0] * dims[1] * dims[2])
     return RTNType::WrongDims;
@@ -201,47 +201,47 @@ auto sperr::CDF97::take_data(vecd_type&& buf, dims_type dims) -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::CDF97::view_data() const -> const vecd_type&
+inline auto sperr::CDF97::view_data() const -> const vecd_type&
 {
   return m_data_buf;
 }
 
-auto sperr::CDF97::release_data() -> vecd_type&&
+inline auto sperr::CDF97::release_data() -> vecd_type&&
 {
   m_dims = {0, 0, 0};
   return std::move(m_data_buf);
 }
 
-auto sperr::CDF97::get_dims() const -> std::array<size_t, 3>
+inline auto sperr::CDF97::get_dims() const -> std::array<size_t, 3>
 {
   return m_dims;
 }
 
-void sperr::CDF97::dwt1d()
+inline void sperr::CDF97::dwt1d()
 {
   size_t num_xforms = sperr::num_of_xforms(m_dims[0]);
   m_dwt1d(m_data_buf.begin(), m_data_buf.size(), num_xforms);
 }
 
-void sperr::CDF97::idwt1d()
+inline void sperr::CDF97::idwt1d()
 {
   size_t num_xforms = sperr::num_of_xforms(m_dims[0]);
   m_idwt1d(m_data_buf.begin(), m_data_buf.size(), num_xforms);
 }
 
-void sperr::CDF97::dwt2d()
+inline void sperr::CDF97::dwt2d()
 {
   size_t num_xforms_xy = sperr::num_of_xforms(std::min(m_dims[0], m_dims[1]));
   m_dwt2d(m_data_buf.begin(), {m_dims[0], m_dims[1]}, num_xforms_xy);
 }
 
-void sperr::CDF97::idwt2d()
+inline void sperr::CDF97::idwt2d()
 {
   size_t num_xforms_xy = sperr::num_of_xforms(std::min(m_dims[0], m_dims[1]));
   m_idwt2d(m_data_buf.begin(), {m_dims[0], m_dims[1]}, num_xforms_xy);
 }
 
-void sperr::CDF97::dwt3d()
+inline void sperr::CDF97::dwt3d()
 {
   // Strategy to choose "dyadic" or "wavelet packet" 3D transform:
   // 1) IF all 3 axes have 5 or more levels of transforms, THEN use dyadic;
@@ -265,7 +265,7 @@ void sperr::CDF97::dwt3d()
   }
 }
 
-void sperr::CDF97::idwt3d()
+inline void sperr::CDF97::idwt3d()
 {
   // clang-format off
   const auto num_xforms = std::array<size_t, 3>{sperr::num_of_xforms(m_dims[0]),
@@ -284,7 +284,7 @@ void sperr::CDF97::idwt3d()
   }
 }
 
-void sperr::CDF97::m_dwt3d_wavelet_packet()
+inline void sperr::CDF97::m_dwt3d_wavelet_packet()
 {
   /*
    *             Z
@@ -341,7 +341,7 @@ void sperr::CDF97::m_dwt3d_wavelet_packet()
   }
 }
 
-void sperr::CDF97::m_idwt3d_wavelet_packet()
+inline void sperr::CDF97::m_idwt3d_wavelet_packet()
 {
   const size_t plane_size_xy = m_dims[0] * m_dims[1];
 
@@ -400,7 +400,7 @@ void sperr::CDF97::m_idwt3d_wavelet_packet()
   }
 }
 
-void sperr::CDF97::m_dwt3d_dyadic()
+inline void sperr::CDF97::m_dwt3d_dyadic()
 {
   // clang-format off
   const auto xforms = std::array<size_t, 3>{sperr::num_of_xforms(m_dims[0]),
@@ -417,7 +417,7 @@ void sperr::CDF97::m_dwt3d_dyadic()
   }
 }
 
-void sperr::CDF97::m_idwt3d_dyadic()
+inline void sperr::CDF97::m_idwt3d_dyadic()
 {
   // clang-format off
   const auto xforms = std::array<size_t, 3>{sperr::num_of_xforms(m_dims[0]),
@@ -438,7 +438,7 @@ void sperr::CDF97::m_idwt3d_dyadic()
 // Private Methods
 //
 
-void sperr::CDF97::m_dwt1d(itd_type array, size_t array_len, size_t num_of_lev)
+inline void sperr::CDF97::m_dwt1d(itd_type array, size_t array_len, size_t num_of_lev)
 {
   for (size_t lev = 0; lev < num_of_lev; lev++) {
     auto [apx, nnm] = sperr::calc_approx_detail_len(array_len, lev);
@@ -446,7 +446,7 @@ void sperr::CDF97::m_dwt1d(itd_type array, size_t array_len, size_t num_of_lev)
   }
 }
 
-void sperr::CDF97::m_idwt1d(itd_type array, size_t array_len, size_t num_of_lev)
+inline void sperr::CDF97::m_idwt1d(itd_type array, size_t array_len, size_t num_of_lev)
 {
   for (size_t lev = num_of_lev; lev > 0; lev--) {
     auto [apx, nnm] = sperr::calc_approx_detail_len(array_len, lev - 1);
@@ -454,7 +454,7 @@ void sperr::CDF97::m_idwt1d(itd_type array, size_t array_len, size_t num_of_lev)
   }
 }
 
-void sperr::CDF97::m_dwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t num_of_lev)
+inline void sperr::CDF97::m_dwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t num_of_lev)
 {
   for (size_t lev = 0; lev < num_of_lev; lev++) {
     auto approx_x = sperr::calc_approx_detail_len(len_xy[0], lev);
@@ -463,7 +463,7 @@ void sperr::CDF97::m_dwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t
   }
 }
 
-void sperr::CDF97::m_idwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t num_of_lev)
+inline void sperr::CDF97::m_idwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t num_of_lev)
 {
   for (size_t lev = num_of_lev; lev > 0; lev--) {
     auto approx_x = sperr::calc_approx_detail_len(len_xy[0], lev - 1);
@@ -472,7 +472,7 @@ void sperr::CDF97::m_idwt2d(itd_type plane, std::array<size_t, 2> len_xy, size_t
   }
 }
 
-void sperr::CDF97::m_dwt1d_one_level(itd_type array, size_t array_len)
+inline void sperr::CDF97::m_dwt1d_one_level(itd_type array, size_t array_len)
 {
   std::copy(array, array + array_len, m_qcc_buf.begin());
 #if __cplusplus >= 202002L
@@ -490,7 +490,7 @@ void sperr::CDF97::m_dwt1d_one_level(itd_type array, size_t array_len)
   }
 }
 
-void sperr::CDF97::m_idwt1d_one_level(itd_type array, size_t array_len)
+inline void sperr::CDF97::m_idwt1d_one_level(itd_type array, size_t array_len)
 {
 #if __cplusplus >= 202002L
   if (array_len % 2 == 0) [[likely]]  // Even length
@@ -508,7 +508,7 @@ void sperr::CDF97::m_idwt1d_one_level(itd_type array, size_t array_len)
   std::copy(m_qcc_buf.begin(), m_qcc_buf.begin() + array_len, array);
 }
 
-void sperr::CDF97::m_dwt2d_one_level(itd_type plane, std::array<size_t, 2> len_xy)
+inline void sperr::CDF97::m_dwt2d_one_level(itd_type plane, std::array<size_t, 2> len_xy)
 {
   // Note: here we call low-level functions (Qcc*()) instead of
   // m_dwt1d_one_level() because we want to have only one even/odd test outside of
@@ -577,7 +577,7 @@ void sperr::CDF97::m_dwt2d_one_level(itd_type plane, std::array<size_t, 2> len_x
   }
 }
 
-void sperr::CDF97::m_idwt2d_one_level(itd_type plane, std::array<size_t, 2> len_xy)
+inline void sperr::CDF97::m_idwt2d_one_level(itd_type plane, std::array<size_t, 2> len_xy)
 {
   const size_t max_len = std::max(len_xy[0], len_xy[1]);
   const auto beg = m_qcc_buf.begin();  // First half of the buffer
@@ -636,7 +636,7 @@ void sperr::CDF97::m_idwt2d_one_level(itd_type plane, std::array<size_t, 2> len_
   }
 }
 
-void sperr::CDF97::m_dwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xyz)
+inline void sperr::CDF97::m_dwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xyz)
 {
   // First, do one level of transform on all XY planes.
   const size_t plane_size_xy = m_dims[0] * m_dims[1];
@@ -696,7 +696,7 @@ void sperr::CDF97::m_dwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xyz
   }
 }
 
-void sperr::CDF97::m_idwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xyz)
+inline void sperr::CDF97::m_idwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xyz)
 {
   const size_t plane_size_xy = m_dims[0] * m_dims[1];
   const auto beg = m_qcc_buf.begin();  // First half of the buffer
@@ -756,7 +756,7 @@ void sperr::CDF97::m_idwt3d_one_level(itd_type vol, std::array<size_t, 3> len_xy
   }
 }
 
-void sperr::CDF97::m_gather_even(citd_type begin, citd_type end, itd_type dest) const
+inline void sperr::CDF97::m_gather_even(citd_type begin, citd_type end, itd_type dest) const
 {
   auto len = end - begin;
   assert(len % 2 == 0);  // This function specifically for even length input
@@ -771,7 +771,7 @@ void sperr::CDF97::m_gather_even(citd_type begin, citd_type end, itd_type dest)
   }
 }
 
-void sperr::CDF97::m_gather_odd(citd_type begin, citd_type end, itd_type dest) const
+inline void sperr::CDF97::m_gather_odd(citd_type begin, citd_type end, itd_type dest) const
 {
   auto len = end - begin;
   assert(len % 2 == 1);  // This function specifically for odd length input
@@ -786,7 +786,7 @@ void sperr::CDF97::m_gather_odd(citd_type begin, citd_type end, itd_type dest) c
   }
 }
 
-void sperr::CDF97::m_scatter_even(citd_type begin, citd_type end, itd_type dest) const
+inline void sperr::CDF97::m_scatter_even(citd_type begin, citd_type end, itd_type dest) const
 {
   auto len = end - begin;
   assert(len % 2 == 0);  // This function specifically for even length input
@@ -801,7 +801,7 @@ void sperr::CDF97::m_scatter_even(citd_type begin, citd_type end, itd_type dest)
   }
 }
 
-void sperr::CDF97::m_scatter_odd(citd_type begin, citd_type end, itd_type dest) const
+inline void sperr::CDF97::m_scatter_odd(citd_type begin, citd_type end, itd_type dest) const
 {
   auto len = end - begin;
   assert(len % 2 == 1);  // This function specifically for odd length input
@@ -819,7 +819,7 @@ void sperr::CDF97::m_scatter_odd(citd_type begin, citd_type end, itd_type dest)
 //
 // Methods from QccPack
 //
-void sperr::CDF97::QccWAVCDF97AnalysisSymmetricEvenEven(double* signal, size_t signal_length)
+inline void sperr::CDF97::QccWAVCDF97AnalysisSymmetricEvenEven(double* signal, size_t signal_length)
 {
   for (size_t index = 1; index < signal_length - 2; index += 2)
     signal[index] += ALPHA * (signal[index - 1] + signal[index + 1]);
@@ -841,7 +841,7 @@ void sperr::CDF97::QccWAVCDF97AnalysisSymmetricEvenEven(double* signal, size_t s
     signal[index] *= -INV_EPSILON;
 }
 
-void sperr::CDF97::QccWAVCDF97SynthesisSymmetricEvenEven(double* signal, size_t signal_length)
+inline void sperr::CDF97::QccWAVCDF97SynthesisSymmetricEvenEven(double* signal, size_t signal_length)
 {
   for (size_t index = 1; index < signal_length; index += 2)
     signal[index] *= (-EPSILON);
@@ -864,7 +864,7 @@ void sperr::CDF97::QccWAVCDF97SynthesisSymmetricEvenEven(double* signal, size_t
   signal[signal_length - 1] -= 2.0 * ALPHA * signal[signal_length - 2];
 }
 
-void sperr::CDF97::QccWAVCDF97SynthesisSymmetricOddEven(double* signal, size_t signal_length)
+inline void sperr::CDF97::QccWAVCDF97SynthesisSymmetricOddEven(double* signal, size_t signal_length)
 {
   for (size_t index = 1; index < signal_length - 1; index += 2)
     signal[index] *= (-EPSILON);
@@ -891,7 +891,7 @@ void sperr::CDF97::QccWAVCDF97SynthesisSymmetricOddEven(double* signal, size_t s
     signal[index] -= ALPHA * (signal[index - 1] + signal[index + 1]);
 }
 
-void sperr::CDF97::QccWAVCDF97AnalysisSymmetricOddEven(double* signal, size_t signal_length)
+inline void sperr::CDF97::QccWAVCDF97AnalysisSymmetricOddEven(double* signal, size_t signal_length)
 {
   for (size_t index = 1; index < signal_length - 1; index += 2)
     signal[index] += ALPHA * (signal[index - 1] + signal[index + 1]);
@@ -10,11 +10,11 @@
 
 #include "Base_Filter.h"
 #include "sperr_helper.h"
-#include <algorithm>  // std::all_of()
+#include <algorithm>  // std::fill()
 #include <cassert>
 #include <cmath>    // std::sqrt()
 #include <cstring>  // std::memcpy()
-#include <numeric>  // std::accumulate()
+#include <limits>
 #include <type_traits>
 
 namespace sperr {
@@ -24,6 +24,19 @@ class Conditioner {
   auto condition(vecd_type& buf, dims_type) -> vec8_type;
   auto inverse_condition(vecd_type& buf, dims_type, const vec8_type& header) -> RTNType;
 
+  //
+  // In-place versions on the caller's buffer of any floating-point type, so float fields
+  // do not need to be widened to double. They produce and accept the same headers as the
+  // `vecd_type` versions, except that the custom filter is not applied.
+  //
+  template <typename T>
+  auto condition(T* buf, size_t len) -> vec8_type;
+  template <typename T>
+  auto inverse_condition(T* buf, size_t len, const vec8_type& header) -> RTNType;
+
+  // Also divide the data by its RMS (around the mean) when conditioning. Off by default.
+  void toggle_rms_scaling(bool);
+
   auto is_constant(uint8_t) const -> bool;
   auto has_custom_filter(uint8_t) const -> bool;
   auto header_size(const void*) const -> size_t;
@@ -34,91 +47,97 @@ class Conditioner {
   //
   std::array<bool, 8> m_meta = {true,    // subtract mean
                                 false,   // custom filter used?
-                                false,   // unused
-                                false,   // unused
+                                false,   // [2]: skip_wave, set by the compressors
+                                false,   // divide by rms
                                 false,   // unused
                                 false,   // unused
                                 false,   // unused
                                 false};  // [7]: is this a constant field?
 
   const size_t m_constant_field_header_size = 17;
-  const size_t m_default_num_strides = 2048;
   const size_t m_constant_field_idx = 7;
   const size_t m_custom_filter_idx = 1;
+  const size_t m_rms_idx = 3;
   const size_t m_min_header_size = 9;  // when there's only a mean value saved.
 
+  bool m_rms_scaling = false;
+
   Base_Filter m_filter;
 
-  // Buffers passed in here are guaranteed to have correct lengths and conditions.
-  auto m_calc_mean(const vecd_type& buf) -> double;
+  struct Moments {
+    double min = 0.0;
+    double max = 0.0;
+    double mean = 0.0;
+    double rms = 0.0;  // around the mean
+  };
+
+  // Single pass for all the statistics, in chunks reduced in parallel and vectorized within a chunk.
+  template <typename T>
+  auto m_calc_moments(const T* buf, size_t len) const -> Moments;
+
+  // Subtract mean and divide by rms in one pass, as selected by m_meta.
+  template <typename T>
+  void m_apply(T* buf, size_t len, const Moments&) const;
+  // The inverse of m_apply, with the values saved in a (non-constant) header.
+  template <typename T>
+  void m_restore(T* buf, size_t len, const vec8_type& header) const;
+
+  auto m_constant_header(double val, uint64_t nval) const -> vec8_type;
+  auto m_assemble_header(const Moments&, const vec8_type& filter_header) const -> vec8_type;
 
-  // Calculations are carried out by strides, which
-  // should be a divisor of the input data size.
-  size_t m_num_strides = m_default_num_strides;
-  std::vector<double> m_stride_buf;
-  // Adjust the value of `m_num_strides` so it'll be a divisor of `len`.
-  void m_adjust_strides(size_t len);
   // Reset meta fields
   void m_reset_meta();
 };
 
 };  // namespace sperr
-auto sperr::Conditioner::condition(vecd_type& buf, dims_type dims) -> vec8_type
+inline auto sperr::Conditioner::condition(vecd_type& buf, dims_type dims) -> vec8_type
 {
   // The order of performing condition operations:
   // 1. Test constant. If it's a constant field, return immediately.
   // 2. Apply filter;
-  // 3. Subtract mean;
+  // 3. Subtract mean (and divide by rms);
 
-  assert(!buf.empty());
   m_reset_meta();
-  // Operation 1
+  // Operation 1 (an empty field is a constant one with no values)
   //
-   //std::cout<<"cp1"<<std::endl;
-  if (std::all_of(buf.cbegin(), buf.cend(), [v0 = buf[0]](auto v) { return v == v0; })) {
+  auto moments = m_calc_moments(buf.data(), buf.size());
+  if (moments.min == moments.max) {
     m_meta[m_constant_field_idx] = true;
-    const double val = buf[0];
-    const uint64_t nval = buf.size();
-    // Assemble a header in the following order:
-    // m_meta   nval  val
-    //
-    auto header = vec8_type(m_constant_field_header_size);
-    header[0] = sperr::pack_8_booleans(m_meta);
-    size_t pos = 1;
-    std::memcpy(header.data() + pos, &nval, sizeof(nval));
-    pos += sizeof(nval);
-    std::memcpy(header.data() + pos, &val, sizeof(val));
-    return header;
+    return m_constant_header(moments.min, buf.size());
   }
-  //std::cout<<"cp2"<<std::endl;
+
   // Operation 2
   //
   m_meta[m_custom_filter_idx] = !std::is_same<Base_Filter, decltype(m_filter)>::value;
   auto filter_header = m_filter.apply_filter(buf, dims);
+  if (m_meta[m_custom_filter_idx])
+    moments = m_calc_moments(buf.data(), buf.size());
 
   // Operation 3
   //
-  //std::cout<<"cp3"<<std::endl;
-  m_adjust_strides(buf.size());
-  const auto mean = m_calc_mean(buf);
-  std::for_each(buf.begin(), buf.end(), [mean](auto& v) { v -= mean; });
+  m_apply(buf.data(), buf.size(), moments);
 
-  // Assemble a header in the following order:
-  // m_meta   mean  filter_header
-  //
-  const auto header_size = 1 + sizeof(mean) + filter_header.size();
-  auto header = vec8_type(header_size);
-  header[0] = sperr::pack_8_booleans(m_meta);
-  size_t pos = 1;
-  std::memcpy(header.data() + pos, &mean, sizeof(mean));
-  pos += sizeof(mean);
-  if (filter_header.size() > 0)
-    std::copy(filter_header.cbegin(), filter_header.cend(), header.begin() + pos);
+  return m_assemble_header(moments, filter_header);
+}
 
-  return header;
+template <typename T>
+auto sperr::Conditioner::condition(T* buf, size_t len) -> vec8_type
+{
+  static_assert(std::is_floating_point<T>::value, "conditioning needs floating-point data");
+  m_reset_meta();
+
+  const auto moments = m_calc_moments(buf, len);
+  if (moments.min == moments.max) {
+    m_meta[m_constant_field_idx] = true;
+    return m_constant_header(moments.min, len);
+  }
+
+  m_apply(buf, len, moments);
+
+  return m_assemble_header(moments, vec8_type());
 }
 
-auto sperr::Conditioner::inverse_condition(vecd_type& buf, dims_type dims, const vec8_type& header)
+inline auto sperr::Conditioner::inverse_condition(vecd_type& buf, dims_type dims, const vec8_type& header)
     -> RTNType
 {
   if (header.size() < m_min_header_size)
@@ -126,130 +145,230 @@ auto sperr::Conditioner::inverse_condition(vecd_type& buf, dims_type dims, const
 
   // unpack header
   m_meta = sperr::unpack_8_booleans(header[0]);
-  size_t pos = 1;
 
   // Operation 1: if this is a constant field?
   //
-  //std::cout<<"dp1"<<std::endl;
   if (m_meta[m_constant_field_idx]) {
     if (header.size() != m_constant_field_header_size)
       return RTNType::BitstreamWrongLen;
-
     uint64_t nval = 0;
-    double val = 0.0;
-    std::memcpy(&nval, header.data() + pos, sizeof(nval));
-    pos += sizeof(nval);
-    std::memcpy(&val, header.data() + pos, sizeof(val));
-
+    std::memcpy(&nval, header.data() + 1, sizeof(nval));
     buf.resize(nval);
-    std::fill(buf.begin(), buf.end(), val);
-
-    return RTNType::Good;
+    return inverse_condition(buf.data(), buf.size(), header);
   }
 
   // Operation 2: add back the mean
   //
-  //std::cout<<"dp2"<<std::endl;
-  double mean = 0.0;
-  std::memcpy(&mean, header.data() + pos, sizeof(mean));
-  std::for_each(buf.begin(), buf.end(), [mean](auto& v) { v += mean; });
+  m_restore(buf.data(), buf.size(), header);
 
   // Operation 3: if there's custom filter, apply the inverse of that filter
   //
-  //std::cout<<"dp3"<<std::endl;
   if (m_meta[m_custom_filter_idx]) {
     // Sanity check: the custom filter is compiled
     if (std::is_same<Base_Filter, decltype(m_filter)>::value)
       return RTNType::CustomFilterMissing;
     // Sanity check: the filter header size is correct
-    const auto* filter = header.data() + m_min_header_size;
-    const auto filter_len = header.size() - m_min_header_size;
+    const auto filter_pos = m_min_header_size + (m_meta[m_rms_idx] ? sizeof(double) : 0);
+    const auto* filter = header.data() + filter_pos;
+    const auto filter_len = header.size() - filter_pos;
     if (m_filter.header_size(filter) != filter_len)
       return RTNType::BitstreamWrongLen;
 
     if (!m_filter.inverse_filter(buf, dims, filter, filter_len))
       return RTNType::CustomFilterError;
   }
-  //std::cout<<"dp4"<<std::endl;
   return RTNType::Good;
 }
 
-auto sperr::Conditioner::is_constant(uint8_t byte) const -> bool
+template <typename T>
+auto sperr::Conditioner::inverse_condition(T* buf, size_t len, const vec8_type& header) -> RTNType
+{
+  if (header.size() < m_min_header_size)
+    return RTNType::BitstreamWrongLen;
+
+  // unpack header
+  m_meta = sperr::unpack_8_booleans(header[0]);
+  size_t pos = 1;
+
+  if (m_meta[m_constant_field_idx]) {
+    if (header.size() != m_constant_field_header_size)
+      return RTNType::BitstreamWrongLen;
+
+    uint64_t nval = 0;
+    double val = 0.0;
+    std::memcpy(&nval, header.data() + pos, sizeof(nval));
+    pos += sizeof(nval);
+    std::memcpy(&val, header.data() + pos, sizeof(val));
+    if (nval != len)
+      return RTNType::BitstreamWrongLen;
+
+    std::fill(buf, buf + len, static_cast<T>(val));
+    return RTNType::Good;
+  }
+
+  // The in-place version has no buffer to give to the custom filter.
+  if (m_meta[m_custom_filter_idx])
+    return RTNType::CustomFilterError;
+  if (header.size() != header_size(header.data()))
+    return RTNType::BitstreamWrongLen;
+
+  m_restore(buf, len, header);
+
+  return RTNType::Good;
+}
+
+template <typename T>
+void sperr::Conditioner::m_restore(T* buf, size_t len, const vec8_type& header) const
+{
+  double mean = 0.0;
+  std::memcpy(&mean, header.data() + 1, sizeof(mean));
+
+  if (m_meta[m_rms_idx]) {
+    double rms = 1.0;
+    std::memcpy(&rms, header.data() + 1 + sizeof(mean), sizeof(rms));
+#pragma omp parallel for simd if (len >= 1 << 20)
+    for (size_t i = 0; i < len; i++)
+      buf[i] = static_cast<T>(buf[i] * rms + mean);
+  }
+  else {
+#pragma omp parallel for simd if (len >= 1 << 20)
+    for (size_t i = 0; i < len; i++)
+      buf[i] = static_cast<T>(buf[i] + mean);
+  }
+}
+
+inline void sperr::Conditioner::toggle_rms_scaling(bool rms)
+{
+  m_rms_scaling = rms;
+}
+
+inline auto sperr::Conditioner::is_constant(uint8_t byte) const -> bool
 {
   auto b8 = sperr::unpack_8_booleans(byte);
   return b8[m_constant_field_idx];
 }
 
-auto sperr::Conditioner::has_custom_filter(uint8_t byte) const -> bool
+inline auto sperr::Conditioner::has_custom_filter(uint8_t byte) const -> bool
 {
   auto b8 = sperr::unpack_8_booleans(byte);
   return b8[m_custom_filter_idx];
 }
 
-auto sperr::Conditioner::header_size(const void* header) const -> size_t
+inline auto sperr::Conditioner::header_size(const void* header) const -> size_t
 {
   const uint8_t* ptr = static_cast<const uint8_t*>(header);
   auto b8 = sperr::unpack_8_booleans(ptr[0]);
   if (b8[m_constant_field_idx])
     return m_constant_field_header_size;
 
-  if (b8[m_custom_filter_idx]) {
-    auto filter_size = m_filter.header_size(ptr + m_min_header_size);
-    return filter_size + m_min_header_size;
-  }
+  auto size = m_min_header_size + (b8[m_rms_idx] ? sizeof(double) : 0);
+  if (b8[m_custom_filter_idx])
+    size += m_filter.header_size(ptr + size);
 
-  return m_min_header_size;
+  return size;
 }
 
-auto sperr::Conditioner::m_calc_mean(const vecd_type& buf) -> double
+template <typename T>
+auto sperr::Conditioner::m_calc_moments(const T* buf, size_t len) const -> Moments
 {
-  assert(buf.size() % m_num_strides == 0);
-
-  m_stride_buf.resize(m_num_strides);
-  const size_t stride_size = buf.size() / m_num_strides;
-
-  for (size_t s = 0; s < m_num_strides; s++) {
-    auto begin = buf.begin() + stride_size * s;
-    auto end = begin + stride_size;
-    m_stride_buf[s] = std::accumulate(begin, end, double{0.0}) / static_cast<double>(stride_size);
+  if (len == 0)
+    return Moments();
+
+  const size_t chunk = 1 << 14;
+  const size_t num_chunks = (len + chunk - 1) / chunk;
+  double mn = std::numeric_limits<double>::max(), mx = std::numeric_limits<double>::lowest();
+  // sums are taken around the first value, for the rms not to cancel out on fields with a large offset
+  const double shift = buf[0];
+  double sum = 0.0, sq = 0.0;
+
+#pragma omp parallel for reduction(min : mn) reduction(max : mx) reduction(+ : sum, sq) if (num_chunks >= 64)
+  for (size_t c = 0; c < num_chunks; c++) {
+    const T* x = buf + c * chunk;
+    const size_t n = std::min(chunk, len - c * chunk);
+    T cmn = x[0], cmx = x[0];
+    double csum = 0.0, csq = 0.0;
+#pragma omp simd reduction(min : cmn) reduction(max : cmx) reduction(+ : csum, csq)
+    for (size_t i = 0; i < n; i++) {
+      const T v = x[i];
+      cmn = v < cmn ? v : cmn;
+      cmx = v > cmx ? v : cmx;
+      const double d = v - shift;
+      csum += d;
+      csq += d * d;
+    }
+    mn = std::min(mn, double(cmn));
+    mx = std::max(mx, double(cmx));
+    sum += csum;
+    sq += csq;
   }
 
-  double sum = std::accumulate(m_stride_buf.begin(), m_stride_buf.end(), double{0.0});
-
-  return (sum / static_cast<double>(m_stride_buf.size()));
+  auto moments = Moments();
+  moments.min = mn;
+  moments.max = mx;
+  const double avg = sum / double(len);
+  moments.mean = shift + avg;
+  moments.rms = std::sqrt(std::max(sq / double(len) - avg * avg, 0.0));
+  if (moments.rms == 0.0)
+    moments.rms = 1.0;
+  return moments;
 }
 
-void sperr::Conditioner::m_adjust_strides(size_t len)
+template <typename T>
+void sperr::Conditioner::m_apply(T* buf, size_t len, const Moments& moments) const
 {
-  m_num_strides = m_default_num_strides;
-  if (len % m_num_strides == 0)
-    return;
-
-  size_t num = 0;
-
-  // First, try to increase till 2^15 = 32,768
-  for (num = m_num_strides; num <= 32'768; num++) {
-    if (len % num == 0)
-      break;
+  const double mean = moments.mean;
+  if (m_meta[m_rms_idx]) {
+    const double scale = 1.0 / moments.rms;
+#pragma omp parallel for simd if (len >= 1 << 20)
+    for (size_t i = 0; i < len; i++)
+      buf[i] = static_cast<T>((buf[i] - mean) * scale);
   }
-
-  if (len % num == 0) {
-    m_num_strides = num;
-    return;
+  else {
+#pragma omp parallel for simd if (len >= 1 << 20)
+    for (size_t i = 0; i < len; i++)
+      buf[i] = static_cast<T>(buf[i] - mean);
   }
+}
+
+inline auto sperr::Conditioner::m_constant_header(double val, uint64_t nval) const -> vec8_type
+{
+  // Assemble a header in the following order:
+  // m_meta   nval  val
+  //
+  auto header = vec8_type(m_constant_field_header_size);
+  header[0] = sperr::pack_8_booleans(m_meta);
+  size_t pos = 1;
+  std::memcpy(header.data() + pos, &nval, sizeof(nval));
+  pos += sizeof(nval);
+  std::memcpy(header.data() + pos, &val, sizeof(val));
+  return header;
+}
 
-  // Second, try to decrease till 1, at which point it must work.
-  for (num = m_num_strides; num > 0; num--) {
-    if (len % num == 0)
-      break;
+inline auto sperr::Conditioner::m_assemble_header(const Moments& moments, const vec8_type& filter_header) const
+    -> vec8_type
+{
+  // Assemble a header in the following order:
+  // m_meta   mean  (rms)  filter_header
+  //
+  const size_t rms_size = m_meta[m_rms_idx] ? sizeof(moments.rms) : 0;
+  auto header = vec8_type(1 + sizeof(moments.mean) + rms_size + filter_header.size());
+  header[0] = sperr::pack_8_booleans(m_meta);
+  size_t pos = 1;
+  std::memcpy(header.data() + pos, &moments.mean, sizeof(moments.mean));
+  pos += sizeof(moments.mean);
+  if (rms_size) {
+    std::memcpy(header.data() + pos, &moments.rms, rms_size);
+    pos += rms_size;
   }
+  if (filter_header.size() > 0)
+    std::copy(filter_header.cbegin(), filter_header.cend(), header.begin() + pos);
 
-  m_num_strides = num;
+  return header;
 }
 
-void sperr::Conditioner::m_reset_meta()
+inline void sperr::Conditioner::m_reset_meta()
 {
-  m_meta = {true, false, false, false, false, false, false, false};
+  m_meta = {true, false, m_rms_scaling, false, false, false, false, false};
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -71,13 +71,13 @@ class Conditioner {
 };  // namespace sperr
 
 
-void sperr::Conditioner::toggle_all_settings(std::array<bool, 4> b4)
+inline void sperr::Conditioner::toggle_all_settings(std::array<bool, 4> b4)
 {
   m_settings[0] = b4[0];
   m_settings[1] = b4[1];
 }
 
-auto sperr::Conditioner::m_calc_mean(const vecd_type& buf) -> double
+inline auto sperr::Conditioner::m_calc_mean(const vecd_type& buf) -> double
 {
   assert(buf.size() % m_num_strides == 0);
 
@@ -95,7 +95,7 @@ auto sperr::Conditioner::m_calc_mean(const vecd_type& buf) -> double
   return (sum / static_cast<double>(m_stride_buf.size()));
 }
 
-auto sperr::Conditioner::m_calc_rms(const vecd_type& buf) -> double
+inline auto sperr::Conditioner::m_calc_rms(const vecd_type& buf) -> double
 {
   assert(buf.size() % m_num_strides == 0);
 
@@ -118,7 +118,7 @@ auto sperr::Conditioner::m_calc_rms(const vecd_type& buf) -> double
   return rms;
 }
 
-void sperr::Conditioner::m_adjust_strides(size_t len)
+inline void sperr::Conditioner::m_adjust_strides(size_t len)
 {
   // Let's say 2048 is a starting point
   m_num_strides = 2048;
@@ -147,7 +147,7 @@ void sperr::Conditioner::m_adjust_strides(size_t len)
   m_num_strides = num;
 }
 
-auto sperr::Conditioner::condition(vecd_type& buf) -> std::pair<RTNType, meta_type>
+inline auto sperr::Conditioner::condition(vecd_type& buf) -> std::pair<RTNType, meta_type>
 {
   meta_type meta;
   meta.fill(0);
@@ -195,7 +195,7 @@ auto sperr::Conditioner::condition(vecd_type& buf) -> std::pair<RTNType, meta_ty
   return {RTNType::Good, meta};
 }
 
-auto sperr::Conditioner::inverse_condition(vecd_type& buf, const meta_type& meta) -> RTNType
+inline auto sperr::Conditioner::inverse_condition(vecd_type& buf, const meta_type& meta) -> RTNType
 {
   // unpack meta
   auto b8 = sperr::unpack_8_booleans(meta[0]);
@@ -225,7 +225,7 @@ auto sperr::Conditioner::inverse_condition(vecd_type& buf, const meta_type& meta
   return RTNType::Good;
 }
 
-auto sperr::Conditioner::test_constant(const vecd_type& buf) const -> std::pair<bool, meta_type>
+inline auto sperr::Conditioner::test_constant(const vecd_type& buf) const -> std::pair<bool, meta_type>
 {
   const uint64_t nval = buf.size();
   assert(nval > 0);
@@ -256,7 +256,7 @@ auto sperr::Conditioner::test_constant(const vecd_type& buf) const -> std::pair<
   return {b8[4], meta};
 }
 
-auto sperr::Conditioner::parse_constant(const meta_type& meta) const
+inline auto sperr::Conditioner::parse_constant(const meta_type& meta) const
     -> std::tuple<bool, double, uint64_t>
 {
   auto b8 = sperr::unpack_8_booleans(meta[0]);
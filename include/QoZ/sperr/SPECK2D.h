@@ -7,6 +7,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <limits>
 using d2_type = std::array<double, 2>;
 namespace sperr {
 
@@ -25,6 +26,7 @@ class SPECKSet2D {
   uint16_t part_level = 0;  // which partition level is this set at (starting from zero).
   SigType signif = SigType::Insig;
   SetType type = SetType::TypeS;
+  uint32_t node = 0;        // encoding only. Node of this set in the max-magnitude tree.
 
  public:
   //
@@ -60,9 +62,11 @@ class SPECK2D : public SPECK_Storage {
   auto m_code_I() -> RTNType;
   void m_initialize_sets_lists();
   auto m_partition_I() -> std::array<SPECKSet2D, 3>;
+  auto m_I_subsets(uint16_t part_level) const -> std::array<SPECKSet2D, 3>;
   auto m_decide_set_S_significance(const SPECKSet2D& set) -> SigType;
   auto m_decide_set_I_significance(const SPECKSet2D& set) -> SigType;
-  void m_clean_LIS();
+  // Build the subtree of the max-magnitude tree rooted at `node`, which represents `set`.
+  auto m_build_max_tree(size_t node, const SPECKSet2D& set) -> double;
   auto m_produce_root() const -> SPECKSet2D;
   auto m_partition_S(const SPECKSet2D&) const -> std::array<SPECKSet2D, 4>;
   auto m_ready_to_encode() const -> bool;
@@ -73,8 +77,24 @@ class SPECK2D : public SPECK_Storage {
   //
   bool m_encode_mode = true;  // Encode (true) or Decode (false) mode?
 
+  // Sets are visited per partition level, and sets found significant are dropped from their
+  // list while the list is visited in the next sorting pass.
   std::vector<std::vector<SPECKSet2D>> m_LIS;
   SPECKSet2D m_I;
+  //
+  // Encoding only. Largest coefficient magnitude of every set (that is not a single pixel)
+  // the partitions can produce, so that significance tests don't look at coefficients.
+  // The subsets of a set that are not pixels are consecutive nodes, in the order given by
+  // `m_partition_S()`. Coefficients of sets in the LIS are never refined, so it is built
+  // once per encoding.
+  //
+  struct MaxNode {
+    double max = 0.0;
+    uint32_t first_child = 0;
+  };
+  std::vector<MaxNode> m_max_tree;
+  std::vector<std::array<uint32_t, 3>> m_I_nodes;  // nodes of the subsets of each level of `m_I`
+  std::vector<double> m_I_max;                     // largest magnitude of `m_I` at each level
   double eb_coeff=1.5;
 };
 
@@ -86,12 +106,12 @@ class SPECK2D : public SPECK_Storage {
 //
 // Class SPECKSet2D
 //
-auto sperr::SPECKSet2D::is_pixel() const -> bool
+inline auto sperr::SPECKSet2D::is_pixel() const -> bool
 {
   return (length_x == 1 && length_y == 1);
 }
 
-auto sperr::SPECKSet2D::is_empty() const -> bool
+inline auto sperr::SPECKSet2D::is_empty() const -> bool
 {
   return (length_x == 0 || length_y == 0);
 }
@@ -99,17 +119,17 @@ auto sperr::SPECKSet2D::is_empty() const -> bool
 //
 // Class SPECK2D
 //
-sperr::SPECK2D::SPECK2D()
+inline sperr::SPECK2D::SPECK2D()
 {
   m_I.type = SetType::TypeI;
   m_dims[2] = 1;
 }
 
-void sperr::SPECK2D::set_eb_coeff(const double & coeff){
+inline void sperr::SPECK2D::set_eb_coeff(const double & coeff){
   eb_coeff=coeff;
 }
 
-auto sperr::SPECK2D::encode() -> RTNType
+inline auto sperr::SPECK2D::encode() -> RTNType
 {
   if (!m_ready_to_encode())
     return RTNType::Error;
@@ -128,8 +148,6 @@ auto sperr::SPECK2D::encode() -> RTNType
   else
     m_data_range = sperr::max_d;
 
-  m_initialize_sets_lists();
-
   m_encoded_stream.clear();
   m_bit_buffer.clear();
 
@@ -142,6 +160,9 @@ auto sperr::SPECK2D::encode() -> RTNType
   std::transform(m_coeff_buf.cbegin(), m_coeff_buf.cend(), m_coeff_buf.begin(),
                  [](auto v) { return std::abs(v); });
 
+  // Sets are initialized on the magnitudes.
+  m_initialize_sets_lists();
+
   // Use `m_qz_coeff` to keep track of would-be quantized coefficients.
   if (m_mode_cache == CompMode::FixedPWE)
     m_qz_coeff.assign(m_coeff_buf.size(), 0.0);
@@ -149,7 +170,7 @@ auto sperr::SPECK2D::encode() -> RTNType
     m_qz_coeff.clear();
 
   // Mark every coefficient as insignificant
-  m_LSP_mask.assign(m_coeff_buf.size(), false);
+  m_clear_LSP();
 
   // Decide the starting threshold for quantization.
   // See `SPECK3D.cpp:encode()` for more discussion on the starting threshold.
@@ -187,7 +208,6 @@ auto sperr::SPECK2D::encode() -> RTNType
     assert(rtn == RTNType::Good);
 
     m_threshold *= 0.5;
-    m_clean_LIS();
   }
   /*
   // Fill the bit buffer to multiplies of eight
@@ -199,7 +219,7 @@ auto sperr::SPECK2D::encode() -> RTNType
   return rtn;
 }
 
-auto sperr::SPECK2D::decode() -> RTNType
+inline auto sperr::SPECK2D::decode() -> RTNType
 {
   if (!m_ready_to_decode())
     return RTNType::Error;
@@ -211,8 +231,7 @@ auto sperr::SPECK2D::decode() -> RTNType
   m_sign_array.assign(coeff_len, true);
 
   // Mark every coefficient as insignificant
-  m_LSP_mask.assign(m_coeff_buf.size(), false);
-  m_LSP_mask_cnt = 0;
+  m_clear_LSP();
 
   m_initialize_sets_lists();
   m_bit_idx = 0;
@@ -232,7 +251,6 @@ auto sperr::SPECK2D::decode() -> RTNType
     assert(rtn == RTNType::Good);
 
     m_threshold *= 0.5;
-    m_clean_LIS();
   }
 
   // Restore coefficient signs
@@ -243,7 +261,7 @@ auto sperr::SPECK2D::decode() -> RTNType
   return RTNType::Good;
 }
 
-void sperr::SPECK2D::m_initialize_sets_lists()
+inline void sperr::SPECK2D::m_initialize_sets_lists()
 {
   // prepare m_LIS
   const auto num_of_parts =
@@ -266,36 +284,74 @@ void sperr::SPECK2D::m_initialize_sets_lists()
   m_I.length_x = m_dims[0];
   m_I.length_y = m_dims[1];
 
+  // The max-magnitude tree has the root S and the subsets of each level of `m_I` as roots.
+  if (m_encode_mode) {
+    m_max_tree.clear();
+    m_max_tree.reserve(m_coeff_buf.size() / 2);
+    m_max_tree.resize(1);
+    m_LIS[S.part_level].back().node = 0;
+    m_build_max_tree(0, S);
+
+    m_I_nodes.resize(m_I.part_level + 1);
+    m_I_max.assign(m_I.part_level + 1, 0.0);
+    for (uint16_t lev = 1; lev <= m_I.part_level; lev++) {
+      m_I_max[lev] = m_I_max[lev - 1];
+      const auto subsets = m_I_subsets(lev);
+      for (size_t i = 0; i < subsets.size(); i++) {
+        if (subsets[i].is_empty())
+          continue;
+        m_I_nodes[lev][i] = m_max_tree.size();
+        m_max_tree.emplace_back();
+        m_I_max[lev] = std::max(m_I_max[lev], m_build_max_tree(m_I_nodes[lev][i], subsets[i]));
+      }
+    }
+  }
+
   // clear lists and reserve space.
   m_LSP_new.clear();
   m_LSP_new.reserve(m_coeff_buf.size() / 8);
-  m_LSP_mask.reserve(m_coeff_buf.size());
   m_bit_buffer.reserve(m_coeff_buf.size());
 }
 
-auto sperr::SPECK2D::m_sorting_pass_encode() -> RTNType
+inline auto sperr::SPECK2D::m_sorting_pass_encode() -> RTNType
 {
   // First, process all insignificant pixels
   //
+  // Pixels that became significant are dropped while going through the list.
   auto dummy = size_t{0};
+  size_t keep = 0;
   for (size_t idx = 0; idx < m_LIP.size(); idx++) {
+    if (m_LIP[idx] == m_u64_garbage_val)  // became significant after last pass
+      continue;
     auto rtn = m_process_P_encode(idx, dummy, true);
     if (rtn == RTNType::BitBudgetMet)
       return rtn;
     assert(rtn == RTNType::Good);
+    if (m_LIP[idx] != m_u64_garbage_val)
+      m_LIP[keep++] = m_LIP[idx];
   }
+  m_LIP.resize(keep);
 
   // Second, process all insignificant sets
   //
+  // New sets only go to lists of smaller sets, which were already visited in this pass,
+  // so each list is compacted in place.
   for (size_t tmp = 0; tmp < m_LIS.size(); tmp++) {
     // From the end to the front of m_LIS, smaller sets first.
     size_t idx1 = m_LIS.size() - 1 - tmp;
-    for (size_t idx2 = 0; idx2 < m_LIS[idx1].size(); idx2++) {
+    auto& list = m_LIS[idx1];
+    keep = 0;
+    for (size_t idx2 = 0; idx2 < list.size(); idx2++) {
+      if (list[idx2].type == SetType::Garbage)  // became significant after last pass
+        continue;
       auto rtn = m_process_S_encode(idx1, idx2, dummy, true);
       if (rtn == RTNType::BitBudgetMet)
         return rtn;
       assert(rtn == RTNType::Good);
+      if (list[idx2].type != SetType::Garbage)
+        list[keep++] = list[idx2];
     }
+    list.resize(keep);
   }
 
   auto rtn = m_process_I(true);
@@ -306,29 +362,45 @@ auto sperr::SPECK2D::m_sorting_pass_encode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_sorting_pass_decode() -> RTNType
+inline auto sperr::SPECK2D::m_sorting_pass_decode() -> RTNType
 {
   // First, process all insignificant pixels
   //
+  // Pixels that became significant are dropped while going through the list.
   size_t dummy = 0;
+  size_t keep = 0;
   for (size_t idx = 0; idx < m_LIP.size(); idx++) {
+    if (m_LIP[idx] == m_u64_garbage_val)  // became significant after last pass
+      continue;
     auto rtn = m_process_P_decode(idx, dummy, true);
     if (rtn == RTNType::BitBudgetMet)
       return rtn;
     assert(rtn == RTNType::Good);
+    if (m_LIP[idx] != m_u64_garbage_val)
+      m_LIP[keep++] = m_LIP[idx];
   }
+  m_LIP.resize(keep);
 
   // Second, process all insignificant sets
   //
+  // New sets only go to lists of smaller sets, which were already visited in this pass,
+  // so each list is compacted in place.
   for (size_t tmp = 0; tmp < m_LIS.size(); tmp++) {
     // From the end to the front of m_LIS, smaller sets first.
     size_t idx1 = m_LIS.size() - 1 - tmp;
-    for (size_t idx2 = 0; idx2 < m_LIS[idx1].size(); idx2++) {
+    auto& list = m_LIS[idx1];
+    keep = 0;
+    for (size_t idx2 = 0; idx2 < list.size(); idx2++) {
+      if (list[idx2].type == SetType::Garbage)  // became significant after last pass
+        continue;
       auto rtn = m_process_S_decode(idx1, idx2, dummy, true);
       if (rtn == RTNType::BitBudgetMet)
         return rtn;
       assert(rtn == RTNType::Good);
+      if (list[idx2].type != SetType::Garbage)
+        list[keep++] = list[idx2];
     }
+    list.resize(keep);
   }
 
   auto rtn = m_process_I(true);
@@ -339,7 +411,7 @@ auto sperr::SPECK2D::m_sorting_pass_decode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_process_P_encode(size_t loc, size_t& counter, bool need_decide_sig)
+inline auto sperr::SPECK2D::m_process_P_encode(size_t loc, size_t& counter, bool need_decide_sig)
     -> RTNType
 {
   const auto pixel_idx = m_LIP[loc];
@@ -369,7 +441,7 @@ auto sperr::SPECK2D::m_process_P_encode(size_t loc, size_t& counter, bool need_d
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_process_P_decode(size_t loc, size_t& counter, bool need_decide_sig)
+inline auto sperr::SPECK2D::m_process_P_decode(size_t loc, size_t& counter, bool need_decide_sig)
     -> RTNType
 {
   const auto pixel_idx = m_LIP[loc];
@@ -396,7 +468,7 @@ auto sperr::SPECK2D::m_process_P_decode(size_t loc, size_t& counter, bool need_d
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_process_S_encode(size_t idx1,
+inline auto sperr::SPECK2D::m_process_S_encode(size_t idx1,
                                         size_t idx2,
                                         size_t& counter,
                                         bool need_decide_sig) -> RTNType
@@ -424,7 +496,7 @@ auto sperr::SPECK2D::m_process_S_encode(size_t idx1,
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_process_S_decode(size_t idx1,
+inline auto sperr::SPECK2D::m_process_S_decode(size_t idx1,
                                         size_t idx2,
                                         size_t& counter,
                                         bool need_decide_sig) -> RTNType
@@ -452,7 +524,7 @@ auto sperr::SPECK2D::m_process_S_decode(size_t idx1,
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_code_S_encode(size_t idx1, size_t idx2) -> RTNType
+inline auto sperr::SPECK2D::m_code_S_encode(size_t idx1, size_t idx2) -> RTNType
 {
   const auto& set = m_LIS[idx1][idx2];
   auto subsets = m_partition_S(set);
@@ -461,6 +533,13 @@ auto sperr::SPECK2D::m_code_S_encode(size_t idx1, size_t idx2) -> RTNType
       std::remove_if(subsets.begin(), subsets.end(), [](const auto& s) { return s.is_empty(); });
   const auto set_end_m1 = set_end - 1;
 
+  // Locate the subsets in the max-magnitude tree.
+  auto node = m_max_tree[set.node].first_child;
+  for (auto it = subsets.begin(); it != set_end; ++it) {
+    if (!it->is_pixel())
+      it->node = node++;
+  }
+
   // We count how many subsets are significant, and if no significant set encountered until
   // the last non-empty one, then the last one must be significant.
   auto sig_counter = size_t{0};
@@ -486,7 +565,7 @@ auto sperr::SPECK2D::m_code_S_encode(size_t idx1, size_t idx2) -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
+inline auto sperr::SPECK2D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
 {
   const auto& set = m_LIS[idx1][idx2];
   auto subsets = m_partition_S(set);
@@ -520,7 +599,7 @@ auto sperr::SPECK2D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_partition_S(const SPECKSet2D& set) const -> std::array<SPECKSet2D, 4>
+inline auto sperr::SPECK2D::m_partition_S(const SPECKSet2D& set) const -> std::array<SPECKSet2D, 4>
 {
   auto subsets = std::array<SPECKSet2D, 4>();
 
@@ -563,7 +642,7 @@ auto sperr::SPECK2D::m_partition_S(const SPECKSet2D& set) const -> std::array<SP
   return subsets;
 }
 
-auto sperr::SPECK2D::m_process_I(bool need_decide_sig) -> RTNType
+inline auto sperr::SPECK2D::m_process_I(bool need_decide_sig) -> RTNType
 {
   if (m_I.part_level == 0)  // m_I is empty at this point
     return RTNType::Good;
@@ -594,7 +673,7 @@ auto sperr::SPECK2D::m_process_I(bool need_decide_sig) -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_code_I() -> RTNType
+inline auto sperr::SPECK2D::m_code_I() -> RTNType
 {
   auto subsets = m_partition_I();
 
@@ -626,11 +705,27 @@ auto sperr::SPECK2D::m_code_I() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK2D::m_partition_I() -> std::array<SPECKSet2D, 3>
+inline auto sperr::SPECK2D::m_partition_I() -> std::array<SPECKSet2D, 3>
+{
+  auto subsets = m_I_subsets(m_I.part_level);
+  if (m_encode_mode) {
+    for (size_t i = 0; i < subsets.size(); i++)
+      subsets[i].node = m_I_nodes[m_I.part_level][i];
+  }
+
+  // Also update m_I
+  m_I.part_level--;
+  m_I.start_x += subsets[0].length_x;
+  m_I.start_y += subsets[0].length_y;
+
+  return subsets;
+}
+
+inline auto sperr::SPECK2D::m_I_subsets(uint16_t part_level) const -> std::array<SPECKSet2D, 3>
 {
   auto subsets = std::array<SPECKSet2D, 3>();
-  auto len_x = sperr::calc_approx_detail_len(m_dims[0], m_I.part_level);
-  auto len_y = sperr::calc_approx_detail_len(m_dims[1], m_I.part_level);
+  auto len_x = sperr::calc_approx_detail_len(m_dims[0], part_level);
+  auto len_y = sperr::calc_approx_detail_len(m_dims[1], part_level);
   const auto approx_len_x = len_x[0];
   const auto detail_len_x = len_x[1];
   const auto approx_len_y = len_y[0];
@@ -638,73 +733,76 @@ auto sperr::SPECK2D::m_partition_I() -> std::array<SPECKSet2D, 3>
 
   // Specify the subsets following the same order in QccPack
   auto& BR = subsets[0];  // Bottom right
-  BR.part_level = m_I.part_level;
+  BR.part_level = part_level;
   BR.start_x = approx_len_x;
   BR.start_y = approx_len_y;
   BR.length_x = detail_len_x;
   BR.length_y = detail_len_y;
 
   auto& TR = subsets[1];  // Top right
-  TR.part_level = m_I.part_level;
+  TR.part_level = part_level;
   TR.start_x = approx_len_x;
   TR.start_y = 0;
   TR.length_x = detail_len_x;
   TR.length_y = approx_len_y;
 
   auto& BL = subsets[2];  // Bottom left
-  BL.part_level = m_I.part_level;
+  BL.part_level = part_level;
   BL.start_x = 0;
   BL.start_y = approx_len_y;
   BL.length_x = approx_len_x;
   BL.length_y = detail_len_y;
 
-  // Also update m_I
-  m_I.part_level--;
-  m_I.start_x += detail_len_x;
-  m_I.start_y += detail_len_y;
-
   return subsets;
 }
 
-auto sperr::SPECK2D::m_decide_set_S_significance(const SPECKSet2D& set) -> SigType
+inline auto sperr::SPECK2D::m_decide_set_S_significance(const SPECKSet2D& set) -> SigType
 {
-  // For TypeS sets, we test an obvious rectangle specified by this set.
+  // For TypeS sets, the magnitude is in the max-magnitude tree.
   assert(set.type == SetType::TypeS);
 
-  const auto gtr = [thrd = m_threshold](auto v) { return v >= thrd; };
-  for (auto y = set.start_y; y < (set.start_y + set.length_y); y++) {
-    auto first = m_coeff_buf.begin() + y * m_dims[0] + set.start_x;
-    auto last = first + set.length_x;
-    if (std::any_of(first, last, gtr))
-      return SigType::Sig;
-  }
-  return SigType::Insig;
+  return m_max_tree[set.node].max >= m_threshold ? SigType::Sig : SigType::Insig;
 }
 
-auto sperr::SPECK2D::m_decide_set_I_significance(const SPECKSet2D& set) -> SigType
+inline auto sperr::SPECK2D::m_decide_set_I_significance(const SPECKSet2D& set) -> SigType
 {
-  // For TypeI sets, we need to test two rectangles!
-  // First rectangle: directly to the right of the missing top-left corner
+  // TypeI sets are the union of the subsets of all their partition levels.
   assert(set.type == SetType::TypeI);
 
-  const auto gtr = [thrd = m_threshold](auto v) { return v >= thrd; };
-  for (size_t y = 0; y < set.start_y; y++) {
-    auto first = m_coeff_buf.begin() + y * m_dims[0] + set.start_x;
-    auto last = m_coeff_buf.begin() + (y + 1) * m_dims[0];
-    if (std::any_of(first, last, gtr))
-      return SigType::Sig;
+  return m_I_max[set.part_level] >= m_threshold ? SigType::Sig : SigType::Insig;
+}
+
+inline auto sperr::SPECK2D::m_build_max_tree(size_t node, const SPECKSet2D& set) -> double
+{
+  if (set.is_pixel()) {
+    m_max_tree[node].max = m_coeff_buf[set.start_y * m_dims[0] + set.start_x];
+    return m_max_tree[node].max;
   }
 
-  // Second rectangle: the rest area at the bottom
-  // Note: this rectangle is stored in a contiguous chunk of memory till the end of the buffer :)
-  auto first = m_coeff_buf.begin() + size_t{set.start_y} * size_t{set.length_x};
-  if (std::any_of(first, m_coeff_buf.end(), gtr))
-    return SigType::Sig;
-  else
-    return SigType::Insig;
+  const auto subsets = m_partition_S(set);
+  const auto first = m_max_tree.size();
+  const auto num_nodes = std::count_if(subsets.cbegin(), subsets.cend(),
+                                       [](const auto& s) { return !s.is_empty() && !s.is_pixel(); });
+  m_max_tree.resize(first + num_nodes);
+
+  auto max = 0.0;
+  auto child = first;
+  for (const auto& s : subsets) {
+    if (s.is_empty())
+      continue;
+    if (s.is_pixel())
+      max = std::max(max, m_coeff_buf[s.start_y * m_dims[0] + s.start_x]);
+    else
+      max = std::max(max, m_build_max_tree(child++, s));
+  }
+
+  // `m_max_tree` may have been reallocated by the recursive calls.
+  m_max_tree[node].max = max;
+  m_max_tree[node].first_child = first;
+  return max;
 }
 
-auto sperr::SPECK2D::m_produce_root() const -> SPECKSet2D
+inline auto sperr::SPECK2D::m_produce_root() const -> SPECKSet2D
 {
   auto num_of_xforms = sperr::num_of_xforms(std::min(m_dims[0], m_dims[1]));
   auto len_x = sperr::calc_approx_detail_len(m_dims[0], num_of_xforms);
@@ -720,30 +818,20 @@ auto sperr::SPECK2D::m_produce_root() const -> SPECKSet2D
   return S;
 }
 
-void sperr::SPECK2D::m_clean_LIS()
-{
-  for (auto& list : m_LIS) {
-    auto it = std::remove_if(list.begin(), list.end(),
-                             [](const auto& s) { return s.type == SetType::Garbage; });
-    list.erase(it, list.end());
-  }
-
-  // Let's also clean up m_LIP.
-  auto it = std::remove(m_LIP.begin(), m_LIP.end(), m_u64_garbage_val);
-  m_LIP.erase(it, m_LIP.end());
-}
-
-auto sperr::SPECK2D::m_ready_to_encode() const -> bool
+inline auto sperr::SPECK2D::m_ready_to_encode() const -> bool
 {
   if (m_dims[0] == 0 || m_dims[1] == 0 || m_dims[2] != 1)
     return false;
   if (m_coeff_buf.size() != m_dims[0] * m_dims[1])
     return false;
+  // Nodes of the max-magnitude tree are 32-bit, and there are fewer nodes than coefficients.
+  if (m_coeff_buf.size() > std::numeric_limits<uint32_t>::max())
+    return false;
 
   return true;
 }
 
-auto sperr::SPECK2D::m_ready_to_decode() const -> bool
+inline auto sperr::SPECK2D::m_ready_to_decode() const -> bool
 {
   if (m_dims[0] == 0 || m_dims[1] == 0 || m_dims[2] != 1)
     return false;
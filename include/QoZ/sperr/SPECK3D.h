@@ -94,12 +94,12 @@ class SPECK3D : public SPECK_Storage {
 //
 // Class SPECKSet3D
 //
-auto sperr::SPECKSet3D::is_pixel() const -> bool
+inline auto sperr::SPECKSet3D::is_pixel() const -> bool
 {
   return (length_x == 1 && length_y == 1 && length_z == 1);
 }
 
-auto sperr::SPECKSet3D::is_empty() const -> bool
+inline auto sperr::SPECKSet3D::is_empty() const -> bool
 {
   return (length_z == 0 || length_y == 0 || length_x == 0);
 }
@@ -108,11 +108,11 @@ auto sperr::SPECKSet3D::is_empty() const -> bool
 // Class SPECK3D
 //
 
-void sperr::SPECK3D::set_eb_coeff(const double & coeff){
+inline void sperr::SPECK3D::set_eb_coeff(const double & coeff){
   eb_coeff=coeff;
 }
 
-void sperr::SPECK3D::m_clean_LIS()
+inline void sperr::SPECK3D::m_clean_LIS()
 {
   for (auto& list : m_LIS) {
     auto it = std::remove_if(list.begin(), list.end(),
@@ -125,7 +125,7 @@ void sperr::SPECK3D::m_clean_LIS()
   m_LIP.erase(it, m_LIP.end());
 }
 
-auto sperr::SPECK3D::encode() -> RTNType
+inline auto sperr::SPECK3D::encode() -> RTNType
 {
   if (m_ready_to_encode() == false)
     return RTNType::Error;
@@ -164,7 +164,7 @@ auto sperr::SPECK3D::encode() -> RTNType
     m_qz_coeff.clear();
 
   // Mark every coefficient as insignificant
-  m_LSP_mask.assign(m_coeff_buf.size(), false);
+  m_clear_LSP();
 
   // Decide the starting threshold for quantization.
   size_t num_bitplanes = 128;
@@ -222,7 +222,7 @@ auto sperr::SPECK3D::encode() -> RTNType
   return rtn;
 }
 
-auto sperr::SPECK3D::decode() -> RTNType
+inline auto sperr::SPECK3D::decode() -> RTNType
 {
   if (m_ready_to_decode() == false)
     return RTNType::Error;
@@ -235,8 +235,7 @@ auto sperr::SPECK3D::decode() -> RTNType
   m_sign_array.assign(coeff_len, true);
 
   // Mark every coefficient as insignificant
-  m_LSP_mask.assign(m_coeff_buf.size(), false);
-  m_LSP_mask_cnt = 0;
+  m_clear_LSP();
   m_bit_idx = 0;
   //m_threshold = static_cast<double>(m_max_threshold_f);
   m_threshold = m_max_threshold;
@@ -268,7 +267,7 @@ auto sperr::SPECK3D::decode() -> RTNType
   return RTNType::Good;
 }
 
-void sperr::SPECK3D::m_initialize_sets_lists()
+inline void sperr::SPECK3D::m_initialize_sets_lists()
 {
   std::array<size_t, 3> num_of_parts;  // how many times each dimension could be partitioned?
   num_of_parts[0] = sperr::num_of_partitions(m_dims[0]);
@@ -342,11 +341,10 @@ void sperr::SPECK3D::m_initialize_sets_lists()
 
   m_LSP_new.clear();
   m_LSP_new.reserve(m_coeff_buf.size() / 8);
-  m_LSP_mask.reserve(m_coeff_buf.size());
   m_bit_buffer.reserve(m_coeff_buf.size());
 }
 
-auto sperr::SPECK3D::m_sorting_pass_encode() -> RTNType
+inline auto sperr::SPECK3D::m_sorting_pass_encode() -> RTNType
 {
   // Since we have a separate representation of LIP, let's process that list first!
   //
@@ -374,7 +372,7 @@ auto sperr::SPECK3D::m_sorting_pass_encode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_sorting_pass_decode() -> RTNType
+inline auto sperr::SPECK3D::m_sorting_pass_decode() -> RTNType
 {
   // Since we have a separate representation of LIP, let's process that list first
   //
@@ -402,7 +400,7 @@ auto sperr::SPECK3D::m_sorting_pass_decode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_process_P_encode(size_t loc, SigType sig, size_t& counter, bool output)
+inline auto sperr::SPECK3D::m_process_P_encode(size_t loc, SigType sig, size_t& counter, bool output)
     -> RTNType
 {
   const auto pixel_idx = m_LIP[loc];
@@ -438,7 +436,7 @@ auto sperr::SPECK3D::m_process_P_encode(size_t loc, SigType sig, size_t& counter
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_decide_significance(const SPECKSet3D& set) const
+inline auto sperr::SPECK3D::m_decide_significance(const SPECKSet3D& set) const
     -> std::pair<SigType, std::array<uint32_t, 3>>
 {
   assert(!set.is_empty());
@@ -466,7 +464,7 @@ auto sperr::SPECK3D::m_decide_significance(const SPECKSet3D& set) const
   return {SigType::Insig, {0, 0, 0}};
 }
 
-auto sperr::SPECK3D::m_process_S_encode(size_t idx1,
+inline auto sperr::SPECK3D::m_process_S_encode(size_t idx1,
                                         size_t idx2,
                                         SigType sig,
                                         size_t& counter,
@@ -533,7 +531,7 @@ auto sperr::SPECK3D::m_process_S_encode(size_t idx1,
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_process_P_decode(size_t loc, size_t& counter, bool read) -> RTNType
+inline auto sperr::SPECK3D::m_process_P_decode(size_t loc, size_t& counter, bool read) -> RTNType
 {
   bool is_sig = true;
   const auto pixel_idx = m_LIP[loc];
@@ -559,7 +557,7 @@ auto sperr::SPECK3D::m_process_P_decode(size_t loc, size_t& counter, bool read)
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_process_S_decode(size_t idx1, size_t idx2, size_t& counter, bool read)
+inline auto sperr::SPECK3D::m_process_S_decode(size_t idx1, size_t idx2, size_t& counter, bool read)
     -> RTNType
 {
   auto& set = m_LIS[idx1][idx2];
@@ -585,7 +583,7 @@ auto sperr::SPECK3D::m_process_S_decode(size_t idx1, size_t idx2, size_t& counte
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_code_S_encode(size_t idx1, size_t idx2, std::array<SigType, 8> subset_sigs)
+inline auto sperr::SPECK3D::m_code_S_encode(size_t idx1, size_t idx2, std::array<SigType, 8> subset_sigs)
     -> RTNType
 {
   auto subsets = m_partition_S_XYZ(m_LIS[idx1][idx2]);
@@ -635,7 +633,7 @@ auto sperr::SPECK3D::m_code_S_encode(size_t idx1, size_t idx2, std::array<SigTyp
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
+inline auto sperr::SPECK3D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
 {
   auto subsets = m_partition_S_XYZ(m_LIS[idx1][idx2]);
   const auto set_end =
@@ -671,7 +669,7 @@ auto sperr::SPECK3D::m_code_S_decode(size_t idx1, size_t idx2) -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPECK3D::m_ready_to_encode() const -> bool
+inline auto sperr::SPECK3D::m_ready_to_encode() const -> bool
 {
   if (std::any_of(m_dims.begin(), m_dims.end(), [](auto v) { return v == 0; }))
     return false;
@@ -681,7 +679,7 @@ auto sperr::SPECK3D::m_ready_to_encode() const -> bool
   return true;
 }
 
-auto sperr::SPECK3D::m_ready_to_decode() const -> bool
+inline auto sperr::SPECK3D::m_ready_to_decode() const -> bool
 {
   if (std::any_of(m_dims.begin(), m_dims.end(), [](auto v) { return v == 0; }))
     return false;
@@ -691,7 +689,7 @@ auto sperr::SPECK3D::m_ready_to_decode() const -> bool
   return true;
 }
 
-auto sperr::SPECK3D::m_partition_S_XYZ(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 8>
+inline auto sperr::SPECK3D::m_partition_S_XYZ(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 8>
 {
   const auto split_x = u2_type{set.length_x - set.length_x / 2, set.length_x / 2};
   const auto split_y = u2_type{set.length_y - set.length_y / 2, set.length_y / 2};
@@ -798,7 +796,7 @@ auto sperr::SPECK3D::m_partition_S_XYZ(const SPECKSet3D& set) const -> std::arra
   return subsets;
 }
 
-auto sperr::SPECK3D::m_partition_S_XY(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 4>
+inline auto sperr::SPECK3D::m_partition_S_XY(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 4>
 {
   std::array<SPECKSet3D, 4> subsets;
 
@@ -860,7 +858,7 @@ auto sperr::SPECK3D::m_partition_S_XY(const SPECKSet3D& set) const -> std::array
   return subsets;
 }
 
-auto sperr::SPECK3D::m_partition_S_Z(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 2>
+inline auto sperr::SPECK3D::m_partition_S_Z(const SPECKSet3D& set) const -> std::array<SPECKSet3D, 2>
 {
   std::array<SPECKSet3D, 2> subsets;
 
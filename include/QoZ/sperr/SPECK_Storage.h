@@ -56,7 +56,7 @@ class SPECK_Storage {
   const size_t m_header_size = 16;  // See header definition in SPECK_Storage.cpp.
   const size_t m_u64_garbage_val = std::numeric_limits<size_t>::max();
   size_t m_encode_budget = 0;
-  size_t m_LSP_mask_cnt = 0;           // Number of TRUE values in `m_LSP_mask`. Decoding only
+  size_t m_LSP_mask_cnt = 0;           // Number of set bits in `m_LSP_mask`
   size_t m_bit_idx = 0;                // Which bit we're at? Decoding only
   double m_max_threshold = 0.0;       // float representation of max threshold
   double m_data_range = sperr::max_d;  // range of data before DWT
@@ -76,7 +76,7 @@ class SPECK_Storage {
   std::vector<bool> m_bit_buffer;   // Bitstream produced by the algorithm
   std::vector<size_t> m_LIP;        // List of insignificant pixels
   std::vector<size_t> m_LSP_new;    // List of newly found significant pixels
-  std::vector<bool> m_LSP_mask;     // Significant pixels previously found
+  std::vector<uint64_t> m_LSP_mask; // Significant pixels previously found, 64 per word
   std::vector<bool> m_sign_array;   // Keep the signs of every coefficient
   vec8_type m_encoded_stream;       // Stores the SPECK bitstream
   dims_type m_dims = {0, 0, 0};     // Dimension of the 2D/3D volume
@@ -92,6 +92,10 @@ class SPECK_Storage {
   auto m_prepare_encoded_bitstream() -> RTNType;
   auto m_refinement_pass_encode() -> RTNType;
   auto m_refinement_pass_decode() -> RTNType;
+  void m_clear_LSP();
+  void m_mark_LSP_new();
+  template <typename Func>
+  void m_for_each_LSP(Func&& f) const;
 
   auto m_estimate_rmse(double q) const -> double;
   auto m_estimate_finest_q(const double &eb_coeff) const -> double;
@@ -117,7 +121,7 @@ auto sperr::SPECK_Storage::copy_data(const T* p, size_t len, dims_type dims) ->
 template auto sperr::SPECK_Storage::copy_data(const double*, size_t, dims_type) -> RTNType;
 template auto sperr::SPECK_Storage::copy_data(const float*, size_t, dims_type) -> RTNType;
 
-auto sperr::SPECK_Storage::take_data(vecd_type&& coeffs, dims_type dims) -> RTNType
+inline auto sperr::SPECK_Storage::take_data(vecd_type&& coeffs, dims_type dims) -> RTNType
 {
   if (coeffs.size() != dims[0] * dims[1] * dims[2])
     return RTNType::WrongDims;
@@ -128,18 +132,18 @@ auto sperr::SPECK_Storage::take_data(vecd_type&& coeffs, dims_type dims) -> RTNT
   return RTNType::Good;
 }
 
-auto sperr::SPECK_Storage::release_data() -> vecd_type&&
+inline auto sperr::SPECK_Storage::release_data() -> vecd_type&&
 {
   m_dims = {0, 0, 0};
   return std::move(m_coeff_buf);
 }
 
-auto sperr::SPECK_Storage::view_data() const -> const vecd_type&
+inline auto sperr::SPECK_Storage::view_data() const -> const vecd_type&
 {
   return m_coeff_buf;
 }
 
-auto sperr::SPECK_Storage::release_quantized_coeff() -> vecd_type&&
+inline auto sperr::SPECK_Storage::release_quantized_coeff() -> vecd_type&&
 {
   if (!m_qz_coeff.empty()) {
     assert(m_qz_coeff.size() == m_sign_array.size());
@@ -151,12 +155,12 @@ auto sperr::SPECK_Storage::release_quantized_coeff() -> vecd_type&&
   return std::move(m_qz_coeff);
 }
 
-void sperr::SPECK_Storage::set_data_range(double range)
+inline void sperr::SPECK_Storage::set_data_range(double range)
 {
   m_data_range = range;
 }
 
-auto sperr::SPECK_Storage::m_prepare_encoded_bitstream() -> RTNType
+inline auto sperr::SPECK_Storage::m_prepare_encoded_bitstream() -> RTNType
 {
   // Header definition: 16 bytes in total:
   // m_max_threshold,   num_useful_bits
@@ -186,7 +190,7 @@ auto sperr::SPECK_Storage::m_prepare_encoded_bitstream() -> RTNType
   return rtn;
 }
 
-auto sperr::SPECK_Storage::parse_encoded_bitstream(const void* comp_buf, size_t comp_size)
+inline auto sperr::SPECK_Storage::parse_encoded_bitstream(const void* comp_buf, size_t comp_size)
     -> RTNType
 {
   // The buffer passed in is supposed to consist a header and then a compacted
@@ -217,17 +221,17 @@ auto sperr::SPECK_Storage::parse_encoded_bitstream(const void* comp_buf, size_t
   return rtn;
 }
 
-auto sperr::SPECK_Storage::view_encoded_bitstream() const -> const vec8_type&
+inline auto sperr::SPECK_Storage::view_encoded_bitstream() const -> const vec8_type&
 {
   return m_encoded_stream;
 }
 
-auto sperr::SPECK_Storage::release_encoded_bitstream() -> vec8_type&&
+inline auto sperr::SPECK_Storage::release_encoded_bitstream() -> vec8_type&&
 {
   return std::move(m_encoded_stream);
 }
 
-auto sperr::SPECK_Storage::get_speck_stream_size(const void* buf) const -> uint64_t
+inline auto sperr::SPECK_Storage::get_speck_stream_size(const void* buf) const -> uint64_t
 {
   // Given the header definition in `prepare_encoded_bitstream()`, directly
   // go retrieve the value stored in the last 8 bytes of the header
@@ -243,12 +247,12 @@ auto sperr::SPECK_Storage::get_speck_stream_size(const void* buf) const -> uint6
   return (m_header_size + num_bytes);
 }
 
-void sperr::SPECK_Storage::set_dimensions(dims_type dims)
+inline void sperr::SPECK_Storage::set_dimensions(dims_type dims)
 {
   m_dims = dims;
 }
 
-auto sperr::SPECK_Storage::set_comp_params(size_t budget, double psnr, double pwe) -> RTNType
+inline auto sperr::SPECK_Storage::set_comp_params(size_t budget, double psnr, double pwe) -> RTNType
 {
   // First set those ones that only need a plain copy
   m_target_psnr = psnr;
@@ -272,7 +276,19 @@ auto sperr::SPECK_Storage::set_comp_params(size_t budget, double psnr, double pw
   return RTNType::Good;
 }
 
-auto sperr::SPECK_Storage::m_refinement_pass_encode() -> RTNType
+template <typename Func>
+void sperr::SPECK_Storage::m_for_each_LSP(Func&& f) const
+{
+  // Visits the significant pixels in increasing order, skipping 64 insignificant pixels at a time,
+  // so that early bit-planes, with few significant pixels, do not scan all the coefficients.
+  //
+  for (size_t w = 0; w < m_LSP_mask.size(); w++) {
+    for (auto bits = m_LSP_mask[w]; bits != 0; bits &= bits - 1)
+      f(w * 64 + static_cast<size_t>(__builtin_ctzll(bits)));
+  }
+}
+
+inline auto sperr::SPECK_Storage::m_refinement_pass_encode() -> RTNType
 {
   // First, process significant pixels previously found.
   //
@@ -282,23 +298,19 @@ auto sperr::SPECK_Storage::m_refinement_pass_encode() -> RTNType
   assert(m_encode_budget >= m_bit_buffer.size());
 
   if (m_mode_cache == CompMode::FixedPWE) {
-    for (size_t i = 0; i < m_LSP_mask.size(); i++) {
-      if (m_LSP_mask[i]) {
-        const bool o1 = m_coeff_buf[i] >= m_threshold;
-        m_bit_buffer.push_back(o1);
-        m_coeff_buf[i] += tmptr[o1];
-        m_qz_coeff[i] += tmpd[o1];
-      }
-    }
+    m_for_each_LSP([&](size_t i) {
+      const bool o1 = m_coeff_buf[i] >= m_threshold;
+      m_bit_buffer.push_back(o1);
+      m_coeff_buf[i] += tmptr[o1];
+      m_qz_coeff[i] += tmpd[o1];
+    });
   }
   else {
-    for (size_t i = 0; i < m_LSP_mask.size(); i++) {
-      if (m_LSP_mask[i]) {
-        const bool o1 = m_coeff_buf[i] >= m_threshold;
-        m_bit_buffer.push_back(o1);
-        m_coeff_buf[i] += tmptr[o1];
-      }
-    }
+    m_for_each_LSP([&](size_t i) {
+      const bool o1 = m_coeff_buf[i] >= m_threshold;
+      m_bit_buffer.push_back(o1);
+      m_coeff_buf[i] += tmptr[o1];
+    });
   }
 
   // If we generated more than necessary bits (in fixed-rate mode), then we resize!
@@ -309,14 +321,12 @@ auto sperr::SPECK_Storage::m_refinement_pass_encode() -> RTNType
 
   // Second, mark newly found significant pixels in `m_LSP_mask`.
   //
-  for (auto idx : m_LSP_new)
-    m_LSP_mask[idx] = true;
-  m_LSP_new.clear();
+  m_mark_LSP_new();
 
   return RTNType::Good;
 }
 
-auto sperr::SPECK_Storage::m_refinement_pass_decode() -> RTNType
+inline auto sperr::SPECK_Storage::m_refinement_pass_decode() -> RTNType
 {
   // First, process significant pixels previously found.
   //
@@ -324,32 +334,45 @@ auto sperr::SPECK_Storage::m_refinement_pass_decode() -> RTNType
 
   assert(m_bit_buffer.size() >= m_bit_idx);
   if (m_bit_buffer.size() - m_bit_idx > m_LSP_mask_cnt) {  // No need to check BitBudgetMet
-    for (size_t i = 0; i < m_LSP_mask.size(); i++) {
-      if (m_LSP_mask[i])
-        m_coeff_buf[i] += tmpd[m_bit_buffer[m_bit_idx++]];
-    }
+    m_for_each_LSP([&](size_t i) { m_coeff_buf[i] += tmpd[m_bit_buffer[m_bit_idx++]]; });
   }
   else {  // Need to check BitBudgetMet
-    for (size_t i = 0; i < m_LSP_mask.size(); i++) {
-      if (m_LSP_mask[i]) {
+    // Only the first bits left in the buffer are decoded: the pixels are visited in the same order.
+    const auto num_bits = m_bit_buffer.size() - m_bit_idx;
+    size_t cnt = 0;
+    for (size_t w = 0; w < m_LSP_mask.size() && cnt < num_bits; w++) {
+      for (auto bits = m_LSP_mask[w]; bits != 0 && cnt < num_bits; bits &= bits - 1, cnt++) {
+        const auto i = w * 64 + static_cast<size_t>(__builtin_ctzll(bits));
         m_coeff_buf[i] += tmpd[m_bit_buffer[m_bit_idx++]];
-        if (m_bit_idx >= m_bit_buffer.size())
-          return RTNType::BitBudgetMet;
       }
     }
+    if (m_bit_idx >= m_bit_buffer.size())
+      return RTNType::BitBudgetMet;
   }
 
-  // Second, mark newly found significant pixels in `m_LSP_mark`
+  // Second, mark newly found significant pixels in `m_LSP_mask`.
   //
+  m_mark_LSP_new();
+
+  return RTNType::Good;
+}
+
+inline void sperr::SPECK_Storage::m_clear_LSP()
+{
+  m_LSP_new.clear();
+  m_LSP_mask.assign((m_coeff_buf.size() + 63) / 64, 0);
+  m_LSP_mask_cnt = 0;
+}
+
+inline void sperr::SPECK_Storage::m_mark_LSP_new()
+{
   for (auto idx : m_LSP_new)
-    m_LSP_mask[idx] = true;
+    m_LSP_mask[idx / 64] |= uint64_t{1} << (idx % 64);
   m_LSP_mask_cnt += m_LSP_new.size();
   m_LSP_new.clear();
-
-  return RTNType::Good;
 }
 
-auto sperr::SPECK_Storage::m_estimate_rmse(double q) const -> double
+inline auto sperr::SPECK_Storage::m_estimate_rmse(double q) const -> double
 {
   const auto half_q = q * 0.5;
   const auto len = m_coeff_buf.size();
@@ -381,7 +404,7 @@ auto sperr::SPECK_Storage::m_estimate_rmse(double q) const -> double
 
 
 
-auto sperr::SPECK_Storage::m_estimate_finest_q(const double &coeff=1.5) const -> double
+inline auto sperr::SPECK_Storage::m_estimate_finest_q(const double &coeff=1.5) const -> double
 {
   if (m_mode_cache == CompMode::FixedPWE) {
     // Most recent tests show that q = 1.5 t is a pretty good estimation.
@@ -401,13 +424,8 @@ auto sperr::SPECK_Storage::m_estimate_finest_q(const double &coeff=1.5) const ->
     return 0.0;
 }
 
-size_t sperr::SPECK_Storage::count_LSP(){
-  size_t count=0;
-  for(size_t i=0;i<m_LSP_mask.size();i++){
-    if(m_LSP_mask[i])
-      count++;
-  }
-  return count;
+inline size_t sperr::SPECK_Storage::count_LSP(){
+  return m_LSP_mask_cnt;
 }
 
 #endif
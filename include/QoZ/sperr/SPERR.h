@@ -1,6 +1,10 @@
 //
 // This class implements the SPECK encoder for errors, dubbed as SPERR.
 //
+// The encoder never looks at the whole 1D array: the bit-plane at which each outlier becomes
+// significant is computed once, and the significance of a set is a difference of prefix counts
+// over the (sorted) outlier list. Bits are written to and read from the packed stream directly.
+//
 
 #ifndef SPERR_H
 #define SPERR_H
@@ -10,6 +14,7 @@
 #include <cassert>
 #include <cmath>
 #include <cstring>
+#include <limits>
 
 namespace sperr {
 
@@ -20,6 +25,8 @@ class SPECKSet1D {
  public:
   size_t start = 0;
   size_t length = 0;
+  uint32_t outlier_begin = 0;  // encoding only. Range of the outliers of the set in the sorted list.
+  uint32_t outlier_end = 0;
   uint32_t part_level = 0;
   SetType type = SetType::TypeS;  // only to indicate if it's garbage
 };
@@ -75,10 +82,20 @@ class SPERR {
   auto m_ready_to_decode() const -> bool;
 
   // If the set to be decided is significant, return a pair containing true and
-  // the index in the outlier list that makes it significant.
+  // the index in the outlier list of its first outlier (the one that makes it
+  // significant when the set is a single pixel).
   // If not, return a pair containing false and zero.
   auto m_decide_significance(const SPECKSet1D&) const -> std::pair<bool, size_t>;
 
+  // Index of the bit-plane at which each outlier becomes significant.
+  void m_calc_sig_planes();
+  // Prefix counts of the outliers that are significant at the current bit-plane.
+  void m_count_significant(size_t bitplane);
+
+  // Packed bit I/O, in the order of `pack_booleans()` (first bit in the most significant position).
+  void m_write_bit(bool);
+  auto m_read_bit() -> bool;
+
   // Encoding methods
   void m_process_S_encoding(size_t idx1, size_t idx2, size_t& counter, bool output);
   void m_refinement_pass_encoding();
@@ -103,14 +120,18 @@ class SPERR {
   size_t m_LOS_size = 0;      // decoding only. Size of `m_LOS` at the end of an iteration.
   size_t m_num_itrs = 0;      // encoding only. Number of iterations.
 
-  std::vector<bool> m_bit_buffer;
+  std::vector<uint8_t> m_bit_buffer;  // packed bits, without the bits still in `m_bit_acc`
+  size_t m_num_bits = 0;
+  uint64_t m_bit_acc = 0;  // encoding only. Bits not yet written to `m_bit_buffer`.
+
   std::vector<double> m_q;     // encoding only. This list is refined in the refinement pass.
   std::vector<Outlier> m_LOS;  // List of OutlierS. This list is not altered when encoding,
                                // but constantly updated when decoding.
 
   std::vector<size_t> m_LSP_new;        // encoding only
   std::vector<size_t> m_LSP_old;        // encoding only
-  std::vector<bool> m_sig_map;          // encoding only
+  std::vector<uint16_t> m_sig_plane;    // encoding only
+  std::vector<uint32_t> m_sig_count;    // encoding only
   std::vector<bool> m_recovered_signs;  // decoding only
 
   std::vector<std::vector<SPECKSet1D>> m_LIS;
@@ -125,48 +146,48 @@ class SPERR {
 //
 // Class Outlier
 //
-sperr::Outlier::Outlier(size_t loc, double e) : location(loc), error(e) {}
+inline sperr::Outlier::Outlier(size_t loc, double e) : location(loc), error(e) {}
 
 //
 // Class SPERR
 //
-void sperr::SPERR::add_outlier(size_t pos, double e)
+inline void sperr::SPERR::add_outlier(size_t pos, double e)
 {
   m_LOS.emplace_back(pos, e);
 }
 
-void sperr::SPERR::copy_outlier_list(const std::vector<Outlier>& list)
+inline void sperr::SPERR::copy_outlier_list(const std::vector<Outlier>& list)
 {
   // Not using the "pass by value and move" idiom because we want to
   // reuse the storage of `m_LOS` here.
   m_LOS = list;
 }
 
-void sperr::SPERR::take_outlier_list(std::vector<Outlier>&& list)
+inline void sperr::SPERR::take_outlier_list(std::vector<Outlier>&& list)
 {
   m_LOS = std::move(list);
 }
 
-void sperr::SPERR::set_length(uint64_t len)
+inline void sperr::SPERR::set_length(uint64_t len)
 {
   m_total_len = len;
 }
 
-void sperr::SPERR::set_tolerance(double t)
+inline void sperr::SPERR::set_tolerance(double t)
 {
   m_tolerance = t;
 }
 
-auto sperr::SPERR::release_outliers() -> std::vector<Outlier>&&
+inline auto sperr::SPERR::release_outliers() -> std::vector<Outlier>&&
 {
   return std::move(m_LOS);
 }
-auto sperr::SPERR::view_outliers() -> const std::vector<Outlier>&
+inline auto sperr::SPERR::view_outliers() -> const std::vector<Outlier>&
 {
   return m_LOS;
 }
 
-auto sperr::SPERR::m_part_set(const SPECKSet1D& set) const -> std::array<SPECKSet1D, 2>
+inline auto sperr::SPERR::m_part_set(const SPECKSet1D& set) const -> std::array<SPECKSet1D, 2>
 {
   std::array<SPECKSet1D, 2> subsets;
   // Prepare the 1st set
@@ -180,10 +201,21 @@ auto sperr::SPERR::m_part_set(const SPECKSet1D& set) const -> std::array<SPECKSe
   set2.length = set.length / 2;
   set2.part_level = set.part_level + 1;
 
+  if (m_encode_mode) {
+    auto begin = m_LOS.cbegin() + set.outlier_begin;
+    auto end = m_LOS.cbegin() + set.outlier_end;
+    auto split = std::lower_bound(begin, end, set2.start,
+                                  [](const auto& otl, auto idx) { return otl.location < idx; });
+    set1.outlier_begin = set.outlier_begin;
+    set1.outlier_end = static_cast<uint32_t>(std::distance(m_LOS.cbegin(), split));
+    set2.outlier_begin = set1.outlier_end;
+    set2.outlier_end = set.outlier_end;
+  }
+
   return subsets;
 }
 
-void sperr::SPERR::m_initialize_LIS()
+inline void sperr::SPERR::m_initialize_LIS()
 {
   // Note that `m_LIS` is a 2D array. In order to avoid unnecessary memory
   // allocation, we don't clear `m_LIS` itself, but clear every secondary array
@@ -198,12 +230,13 @@ void sperr::SPERR::m_initialize_LIS()
   // Put in two sets, each representing a half of the long array.
   SPECKSet1D set;
   set.length = m_total_len;  // Set represents the whole 1D array.
+  set.outlier_end = static_cast<uint32_t>(m_LOS.size());
   auto sets = m_part_set(set);
   m_LIS[sets[0].part_level].emplace_back(sets[0]);
   m_LIS[sets[1].part_level].emplace_back(sets[1]);
 }
 
-void sperr::SPERR::m_clean_LIS()
+inline void sperr::SPERR::m_clean_LIS()
 {
   for (auto& list : m_LIS) {
     auto itr = std::remove_if(list.begin(), list.end(),
@@ -212,7 +245,7 @@ void sperr::SPERR::m_clean_LIS()
   }
 }
 
-auto sperr::SPERR::m_ready_to_encode() const -> bool
+inline auto sperr::SPERR::m_ready_to_encode() const -> bool
 {
   if (m_total_len == 0)
     return false;
@@ -220,6 +253,8 @@ auto sperr::SPERR::m_ready_to_encode() const -> bool
     return false;
   if (m_LOS.empty())
     return false;
+  if (m_LOS.size() > std::numeric_limits<uint32_t>::max())
+    return false;
 
   // Make sure each outlier to process has an error greater or equal to the tolerance.
   if (!std::all_of(m_LOS.begin(), m_LOS.end(),
@@ -236,17 +271,17 @@ auto sperr::SPERR::m_ready_to_encode() const -> bool
   return (adj == m_LOS.end());
 }
 
-auto sperr::SPERR::m_ready_to_decode() const -> bool
+inline auto sperr::SPERR::m_ready_to_decode() const -> bool
 {
   if (m_total_len == 0)
     return false;
-  if (m_bit_buffer.empty())
+  if (m_num_bits == 0)
     return false;
 
   return true;
 }
 
-auto sperr::SPERR::encode() -> RTNType
+inline auto sperr::SPERR::encode() -> RTNType
 {
   // Let's sort the list of outliers so it'll be easier to locate particular individuals.
   // Actually, if the list of outliers is produced by this package (SPECK3D_Compressor),
@@ -256,6 +291,9 @@ auto sperr::SPERR::encode() -> RTNType
   if (!m_ready_to_encode())
     return RTNType::InvalidParam;
   m_bit_buffer.clear();
+  m_bit_buffer.reserve(m_LOS.size() * 4);
+  m_num_bits = 0;
+  m_bit_acc = 0;
   m_encode_mode = true;
 
   m_initialize_LIS();
@@ -278,14 +316,11 @@ auto sperr::SPERR::encode() -> RTNType
   }
   m_max_threshold = m_threshold;
 
+  m_calc_sig_planes();
+
   // Start the iterations!
   for (size_t bitplane = 0; bitplane < m_num_itrs; bitplane++) {
-    // Reset the significance map
-    m_sig_map.assign(m_total_len, false);
-    for (size_t i = 0; i < m_LOS.size(); i++) {
-      if (m_q[i] >= m_threshold)
-        m_sig_map[m_LOS[i].location] = true;
-    }
+    m_count_significant(bitplane);
 
     m_sorting_pass();
     m_refinement_pass_encoding();
@@ -297,7 +332,7 @@ auto sperr::SPERR::encode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPERR::decode() -> RTNType
+inline auto sperr::SPERR::decode() -> RTNType
 {
   if (!m_ready_to_decode())
     return RTNType::InvalidParam;
@@ -319,8 +354,8 @@ auto sperr::SPERR::decode() -> RTNType
     m_threshold *= 0.5;
     m_clean_LIS();
 
-    if (m_bit_idx >= m_bit_buffer.size()) {
-      assert(m_bit_idx == m_bit_buffer.size());
+    if (m_bit_idx >= m_num_bits) {
+      assert(m_bit_idx == m_num_bits);
       break;
     }
   }
@@ -336,40 +371,79 @@ auto sperr::SPERR::decode() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPERR::m_decide_significance(const SPECKSet1D& set) const -> std::pair<bool, size_t>
+inline auto sperr::SPERR::m_decide_significance(const SPECKSet1D& set) const -> std::pair<bool, size_t>
 {
   // This function is only used during encoding.
 
-  // Step 1: use the significance map to decide if this set is significant
-  std::pair<bool, size_t> sig{false, 0};
-  auto begin = m_sig_map.cbegin() + set.start;
-  auto end = begin + set.length;
-  auto itr1 = std::find(begin, end, true);
-
-  // Step 2: if this set is significant, then find the index of the outlier in
-  //         `m_LSO` that caused it being significant.
-  if (itr1 != end) {
-    sig.first = true;
-
-    // Note that `m_LSO` is sorted at the beginning of encoding.
-    size_t idx_to_find = std::distance(m_sig_map.cbegin(), itr1);
-    auto itr2 = std::lower_bound(m_LOS.cbegin(), m_LOS.cend(), idx_to_find,
-                                 [](const auto& otl, auto idx) { return otl.location < idx; });
-    assert(itr2 != m_LOS.cend());
-    assert((*itr2).location == idx_to_find);  // Must find exactly this index
-    sig.second = std::distance(m_LOS.cbegin(), itr2);
+  // Outliers found in previous bit-planes are not in any set of the LIS anymore,
+  // so a set is significant if it has an outlier of the current bit-plane.
+  const size_t idx1 = set.outlier_begin;
+  const size_t idx2 = set.outlier_end;
+  if (m_sig_count[idx2] > m_sig_count[idx1]) {
+    assert(set.length > 1 || m_LOS[idx1].location == set.start);
+    return {true, idx1};
   }
+  return {false, 0};
+}
 
-  return sig;
+inline void sperr::SPERR::m_calc_sig_planes()
+{
+  // Bucket the outliers by magnitude once: the threshold of bit-plane `k` is
+  // `m_max_threshold * 2^-k`, and an outlier becomes significant at the first
+  // bit-plane whose threshold it reaches.
+  const auto num = m_LOS.size();
+  const auto max_plane = static_cast<int>(m_num_itrs) - 1;
+  m_sig_plane.resize(num);
+
+#pragma omp parallel for if (num >= 65536)
+  for (size_t i = 0; i < num; i++) {
+    const auto q = m_q[i];
+    auto k = std::clamp(std::ilogb(m_max_threshold) - std::ilogb(q), 0, max_plane);
+    while (k > 0 && q >= std::ldexp(m_max_threshold, -(k - 1)))
+      k--;
+    while (k < max_plane && q < std::ldexp(m_max_threshold, -k))
+      k++;
+    m_sig_plane[i] = static_cast<uint16_t>(k);
+  }
 }
 
-void sperr::SPERR::m_process_S_encoding(size_t idx1, size_t idx2, size_t& counter, bool output)
+inline void sperr::SPERR::m_count_significant(size_t bitplane)
+{
+  const auto num = m_LOS.size();
+  m_sig_count.resize(num + 1);
+  m_sig_count[0] = 0;
+  uint32_t count = 0;
+  for (size_t i = 0; i < num; i++) {
+    count += (m_sig_plane[i] <= bitplane);
+    m_sig_count[i + 1] = count;
+  }
+}
+
+inline void sperr::SPERR::m_write_bit(bool bit)
+{
+  m_bit_acc = (m_bit_acc << 1) | uint64_t(bit);
+  if (++m_num_bits % 64 == 0) {
+    for (int shift = 56; shift >= 0; shift -= 8)
+      m_bit_buffer.push_back(uint8_t(m_bit_acc >> shift));
+    m_bit_acc = 0;
+  }
+}
+
+inline auto sperr::SPERR::m_read_bit() -> bool
+{
+  assert(m_bit_idx < m_num_bits);
+  const bool bit = (m_bit_buffer[m_bit_idx / 8] >> (7 - m_bit_idx % 8)) & 1;
+  m_bit_idx++;
+  return bit;
+}
+
+inline void sperr::SPERR::m_process_S_encoding(size_t idx1, size_t idx2, size_t& counter, bool output)
 {
   auto& set = m_LIS[idx1][idx2];
   auto [is_sig, sig_idx] = m_decide_significance(set);
 
   if (output)
-    m_bit_buffer.push_back(is_sig);
+    m_write_bit(is_sig);
 
   // Sanity check: when `output` is false, `is_sig` must be true.
   assert(output || is_sig);
@@ -377,7 +451,7 @@ void sperr::SPERR::m_process_S_encoding(size_t idx1, size_t idx2, size_t& counte
   if (is_sig) {
     counter++;
     if (set.length == 1) {                                  // Is a pixel
-      m_bit_buffer.push_back(m_LOS[sig_idx].error >= 0.0);  // Record its sign
+      m_write_bit(m_LOS[sig_idx].error >= 0.0);  // Record its sign
       m_LSP_new.push_back(sig_idx);
       m_q[sig_idx] -= m_threshold;
     }
@@ -389,7 +463,7 @@ void sperr::SPERR::m_process_S_encoding(size_t idx1, size_t idx2, size_t& counte
   }
 }
 
-void sperr::SPERR::m_code_S(size_t idx1, size_t idx2)
+inline void sperr::SPERR::m_code_S(size_t idx1, size_t idx2)
 {
   auto sets = m_part_set(m_LIS[idx1][idx2]);
   size_t counter = 0;
@@ -423,7 +497,7 @@ void sperr::SPERR::m_code_S(size_t idx1, size_t idx2)
   }
 }
 
-void sperr::SPERR::m_sorting_pass()
+inline void sperr::SPERR::m_sorting_pass()
 {
   size_t dummy = 0;
   for (size_t tmp = 1; tmp <= m_LIS.size(); tmp++) {
@@ -437,11 +511,11 @@ void sperr::SPERR::m_sorting_pass()
   }
 }
 
-void sperr::SPERR::m_refinement_pass_encoding()
+inline void sperr::SPERR::m_refinement_pass_encoding()
 {
   for (auto idx : m_LSP_old) {
     auto need_refine = m_q[idx] >= m_threshold;
-    m_bit_buffer.push_back(need_refine);
+    m_write_bit(need_refine);
     if (need_refine)
       m_q[idx] -= m_threshold;
   }
@@ -451,12 +525,11 @@ void sperr::SPERR::m_refinement_pass_encoding()
   m_LSP_new.clear();
 }
 
-void sperr::SPERR::m_process_S_decoding(size_t idx1, size_t idx2, size_t& counter, bool input)
+inline void sperr::SPERR::m_process_S_decoding(size_t idx1, size_t idx2, size_t& counter, bool input)
 {
   bool is_sig = true;
   if (input) {
-    is_sig = m_bit_buffer[m_bit_idx++];
-    assert(m_bit_idx <= m_bit_buffer.size());
+    is_sig = m_read_bit();
   }
 
   if (is_sig) {
@@ -465,9 +538,7 @@ void sperr::SPERR::m_process_S_decoding(size_t idx1, size_t idx2, size_t& counte
     if (set.length == 1) {  // This is a pixel
       // We recovered the location of another outlier!
       m_LOS.emplace_back(set.start, m_threshold * 1.5);
-      m_recovered_signs.push_back(m_bit_buffer[m_bit_idx++]);
-
-      assert(m_bit_idx <= m_bit_buffer.size());
+      m_recovered_signs.push_back(m_read_bit());
     }
     else {
       m_code_S(idx1, idx2);
@@ -477,13 +548,13 @@ void sperr::SPERR::m_process_S_decoding(size_t idx1, size_t idx2, size_t& counte
   }
 }
 
-void sperr::SPERR::m_refinement_pass_decoding()
+inline void sperr::SPERR::m_refinement_pass_decoding()
 {
   // Refine significant pixels from previous iterations only,
   //   because pixels added from this iteration are already refined.
-  assert(m_bit_idx + m_LOS_size <= m_bit_buffer.size());
+  assert(m_bit_idx + m_LOS_size <= m_num_bits);
   for (size_t idx = 0; idx < m_LOS_size; idx++) {
-    if (m_bit_buffer[m_bit_idx++])
+    if (m_read_bit())
       m_LOS[idx].error += m_threshold * 0.5;
     else
       m_LOS[idx].error -= m_threshold * 0.5;
@@ -493,18 +564,17 @@ void sperr::SPERR::m_refinement_pass_decoding()
   m_LOS_size = m_LOS.size();
 }
 
-auto sperr::SPERR::get_encoded_bitstream() -> std::vector<uint8_t>
+inline auto sperr::SPERR::get_encoded_bitstream() -> std::vector<uint8_t>
 {
   // Header definition:
   // total_len  max_threshold   num_of_bits
   // uint64_t   double          uint64_t
 
-  // Record the current (useful) number of bits before it's padded.
-  const uint64_t num_bits = m_bit_buffer.size();
-  while (m_bit_buffer.size() % 8 != 0)
-    m_bit_buffer.push_back(false);
+  // The (useful) number of bits, before they are padded to whole bytes.
+  const uint64_t num_bits = m_num_bits;
+  const size_t num_bytes = (num_bits + 7) / 8;
 
-  const size_t buf_len = m_header_size + m_bit_buffer.size() / 8;
+  const size_t buf_len = m_header_size + num_bytes;
   auto buf = std::vector<uint8_t>(buf_len);
 
   // Fill header
@@ -521,24 +591,28 @@ auto sperr::SPERR::get_encoded_bitstream() -> std::vector<uint8_t>
 
   assert(pos == m_header_size);
 
-  // Assemble the bitstream into bytes
-  auto rtn = sperr::pack_booleans(buf, m_bit_buffer, pos);
-  if (rtn != RTNType::Good)
-    buf.clear();
-
-  // Restore `m_bit_buffer` to its original size.
-  m_bit_buffer.resize(num_bits);
+  // Whole words of bits are already packed; the remaining ones are padded with zeros.
+  std::copy(m_bit_buffer.cbegin(), m_bit_buffer.cend(), buf.begin() + pos);
+  pos += m_bit_buffer.size();
+  const auto rest = num_bits % 64;
+  if (rest > 0) {
+    const auto acc = m_bit_acc << (64 - rest);
+    for (int shift = 56; pos < buf_len; shift -= 8)
+      buf[pos++] = uint8_t(acc >> shift);
+  }
 
   return buf;
 }
 
-auto sperr::SPERR::parse_encoded_bitstream(const void* buf, size_t len) -> RTNType
+inline auto sperr::SPERR::parse_encoded_bitstream(const void* buf, size_t len) -> RTNType
 {
   // The buffer passed in is supposed to consist a header and then a compacted
   // bitstream, just like what was returned by `get_encoded_bitstream()`. Note:
   // header definition is documented in get_encoded_bitstream().
 
   const uint8_t* const ptr = static_cast<const uint8_t*>(buf);
+  if (len < m_header_size)
+    return RTNType::BitstreamWrongLen;
 
   // Parse header
   uint64_t num_bits, pos = 0;
@@ -554,20 +628,16 @@ auto sperr::SPERR::parse_encoded_bitstream(const void* buf, size_t len) -> RTNTy
 
   assert(pos == m_header_size);
 
-  // Unpack bits
-  const auto num_of_bools = (len - pos) * 8;
-  m_bit_buffer.resize(num_of_bools, false);  // allocate enough space before passing it around
-  auto rtn = sperr::unpack_booleans(m_bit_buffer, buf, len, pos);
-  if (rtn != RTNType::Good)
-    return rtn;
-
-  // Restore the correct number of bits
-  m_bit_buffer.resize(num_bits);
+  // Keep the bits packed, they are read one by one while decoding.
+  if ((num_bits + 7) / 8 > len - pos)
+    return RTNType::BitstreamWrongLen;
+  m_bit_buffer.assign(ptr + pos, ptr + pos + (num_bits + 7) / 8);
+  m_num_bits = num_bits;
 
   return RTNType::Good;
 }
 
-auto sperr::SPERR::get_sperr_stream_size(const void* buf) const -> uint64_t
+inline auto sperr::SPERR::get_sperr_stream_size(const void* buf) const -> uint64_t
 {
   // Given the header definition in `get_encoded_bitstream()`, directly
   // go retrieve the value stored in byte 16-24.
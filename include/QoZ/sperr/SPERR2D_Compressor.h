@@ -86,12 +86,12 @@ class SPERR2D_Compressor {
   auto m_assemble_encoded_bitstream() -> RTNType;
 };
 
-void SPERR2D_Compressor::set_skip_wave(const bool & skip){
+inline void SPERR2D_Compressor::set_skip_wave(const bool & skip){
   skip_wave=skip;
 }
 
 
-void SPERR2D_Compressor::set_eb_coeff(const double & coeff){
+inline void SPERR2D_Compressor::set_eb_coeff(const double & coeff){
   eb_coeff=coeff;
 }
 
@@ -118,7 +118,7 @@ auto SPERR2D_Compressor::copy_data(const T* p, size_t len, sperr::dims_type dims
 template auto SPERR2D_Compressor::copy_data(const double*, size_t, sperr::dims_type) -> RTNType;
 template auto SPERR2D_Compressor::copy_data(const float*, size_t, sperr::dims_type) -> RTNType;
 
-auto SPERR2D_Compressor::take_data(std::vector<double>&& buf, sperr::dims_type dims) -> RTNType
+inline auto SPERR2D_Compressor::take_data(std::vector<double>&& buf, sperr::dims_type dims) -> RTNType
 {
   if (buf.size() != dims[0] * dims[1] || dims[2] != 1)
     return RTNType::WrongDims;
@@ -130,12 +130,12 @@ auto SPERR2D_Compressor::take_data(std::vector<double>&& buf, sperr::dims_type d
   return RTNType::Good;
 }
 
-auto SPERR2D_Compressor::get_outlier_stats() const -> std::pair<size_t, size_t>
+inline auto SPERR2D_Compressor::get_outlier_stats() const -> std::pair<size_t, size_t>
 {
   return {m_LOS.size(), m_sperr_stream.size()};
 }
 
-auto SPERR2D_Compressor::set_target_bpp(double bpp) -> RTNType
+inline auto SPERR2D_Compressor::set_target_bpp(double bpp) -> RTNType
 {
   const auto total_vals = m_dims[0] * m_dims[1];
   if (total_vals == 0)
@@ -157,31 +157,31 @@ auto SPERR2D_Compressor::set_target_bpp(double bpp) -> RTNType
   return RTNType::Good;
 }
 
-void SPERR2D_Compressor::set_target_psnr(double psnr)
+inline void SPERR2D_Compressor::set_target_psnr(double psnr)
 {
   m_target_psnr = std::max(psnr, 0.0);
   m_bit_budget = sperr::max_size;
   m_target_pwe = 0.0;
 }
 
-void SPERR2D_Compressor::set_target_pwe(double pwe)
+inline void SPERR2D_Compressor::set_target_pwe(double pwe)
 {
   m_bit_budget = sperr::max_size;
   m_target_psnr = sperr::max_d;
   m_target_pwe = std::max(pwe, 0.0);
 }
 
-auto SPERR2D_Compressor::view_encoded_bitstream() const -> const std::vector<uint8_t>&
+inline auto SPERR2D_Compressor::view_encoded_bitstream() const -> const std::vector<uint8_t>&
 {
   return m_encoded_stream;
 }
 
-auto SPERR2D_Compressor::release_encoded_bitstream() -> std::vector<uint8_t>&&
+inline auto SPERR2D_Compressor::release_encoded_bitstream() -> std::vector<uint8_t>&&
 {
   return std::move(m_encoded_stream);
 }
 
-auto SPERR2D_Compressor::compress() -> RTNType
+inline auto SPERR2D_Compressor::compress() -> RTNType
 {
   const auto total_vals = m_dims[0] * m_dims[1];
   if (m_val_buf.empty() || m_val_buf.size() != total_vals)
@@ -323,7 +323,7 @@ auto SPERR2D_Compressor::compress() -> RTNType
   return rtn;
 }
 
-auto SPERR2D_Compressor::m_assemble_encoded_bitstream() -> RTNType
+inline auto SPERR2D_Compressor::m_assemble_encoded_bitstream() -> RTNType
 {
 
   
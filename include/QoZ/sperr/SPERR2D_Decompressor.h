@@ -52,7 +52,7 @@ class SPERR2D_Decompressor {
 
 
 
-auto SPERR2D_Decompressor::use_bitstream(const void* p, size_t len) -> RTNType
+inline auto SPERR2D_Decompressor::use_bitstream(const void* p, size_t len) -> RTNType
 {
   // This method parses the metadata of a bitstream and performs the following tasks:
   // 1) Verify if the major version number is consistant.
@@ -177,23 +177,23 @@ auto SPERR2D_Decompressor::get_data() const -> std::vector<T>
 template auto SPERR2D_Decompressor::get_data() const -> std::vector<double>;
 template auto SPERR2D_Decompressor::get_data() const -> std::vector<float>;
 
-auto SPERR2D_Decompressor::view_data() const -> const std::vector<double>&
+inline auto SPERR2D_Decompressor::view_data() const -> const std::vector<double>&
 {
   return m_val_buf;
 }
 
-auto SPERR2D_Decompressor::release_data() -> std::vector<double>&&
+inline auto SPERR2D_Decompressor::release_data() -> std::vector<double>&&
 {
   m_dims = {0, 0, 0};
   return std::move(m_val_buf);
 }
 
-auto SPERR2D_Decompressor::get_dims() const -> std::array<size_t, 3>
+inline auto SPERR2D_Decompressor::get_dims() const -> std::array<size_t, 3>
 {
   return m_dims;
 }
 
-auto SPERR2D_Decompressor::decompress() -> RTNType
+inline auto SPERR2D_Decompressor::decompress() -> RTNType
 {
   // `m_condi_stream` might be indicating a constant field, so let's test and handle that case.
   if (m_conditioner.is_constant(m_condi_stream[0])) {
@@ -0,0 +1,348 @@
+//
+// This is a class that performs SPERR2D compression, and also utilizes OpenMP
+// to achieve parallelization: the input slice is divided into smaller tiles
+// and then they're processed individually, like SPERR3D_OMP_C does with chunks.
+//
+
+#ifndef SPERR2D_OMP_C_H
+#define SPERR2D_OMP_C_H
+
+#include "SPERR2D_Compressor.h"
+
+#include <algorithm>  // std::all_of()
+#include <cassert>
+#include <cstring>
+#include <numeric>  // std::accumulate()
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+using sperr::RTNType;
+
+class SPERR2D_OMP_C {
+ public:
+  // If 0 is passed in, the maximal number of threads will be used.
+  void set_num_threads(size_t);
+
+  // Upon receiving incoming data, a tiling scheme is decided, and the slice
+  // is divided and kept in separate tiles. Both dimensions have dims[2] == 1.
+  // Call set_skip_wave first: slices of wavelet coefficients are not tiled.
+  template <typename T>
+  auto copy_data(const T*, size_t len, sperr::dims_type slice_dims, sperr::dims_type tile_dims)
+      -> RTNType;
+
+  // Return 1) the number of outliers, and 2) the num of bytes to encode them.
+  auto get_outlier_stats() const -> std::pair<size_t, size_t>;
+
+  auto set_target_bpp(double) -> RTNType;
+  void set_target_psnr(double);
+  void set_target_pwe(double);
+
+  auto compress() -> RTNType;
+
+  // Provide a copy of the encoded bitstream to the caller.
+  auto get_encoded_bitstream() const -> std::vector<uint8_t>;
+
+  void set_eb_coeff(const double & coeff);
+
+  void set_skip_wave(const bool & skip);
+
+ private:
+  sperr::dims_type m_dims = {0, 0, 0};       // Dimension of the entire slice
+  sperr::dims_type m_tile_dims = {0, 0, 0};  // Preferred dimensions for a tile
+  size_t m_num_threads = 1;
+
+  std::vector<sperr::vecd_type> m_tile_buffers;
+  std::vector<sperr::vec8_type> m_encoded_streams;
+
+  // Header size would be the magic number + num_tiles * 4
+  const size_t m_header_magic = 18;
+
+  size_t m_bit_budget = 0;  // Total bit budget, including headers etc.
+  double m_target_psnr = sperr::max_d;
+  double m_target_pwe = 0.0;
+  bool m_orig_is_float = true;  // Is the original input float (true) or double (false)?
+
+  // Outlier stats include 1) the number of outliers, and 2) the num of bytes used to encode them.
+  std::vector<std::pair<size_t, size_t>> m_outlier_stats;
+  double eb_coeff=1.5;
+  bool skip_wave=false;
+
+  //
+  // Private methods
+  //
+  auto m_generate_header() const -> sperr::vec8_type;
+};
+
+inline void SPERR2D_OMP_C::set_skip_wave(const bool & skip){
+  skip_wave=skip;
+}
+
+inline void SPERR2D_OMP_C::set_eb_coeff(const double & coeff){
+  eb_coeff=coeff;
+}
+
+inline void SPERR2D_OMP_C::set_num_threads(size_t n)
+{
+#ifdef USE_OMP
+  if (n == 0)
+    m_num_threads = omp_get_max_threads();
+  else
+    m_num_threads = n;
+#else
+  m_num_threads = 1;
+#endif
+}
+
+inline auto SPERR2D_OMP_C::get_outlier_stats() const -> std::pair<size_t, size_t>
+{
+  using pair = std::pair<size_t, size_t>;
+  pair sum{0, 0};
+  auto op = [](const pair& a, const pair& b) -> pair {
+    return {a.first + b.first, a.second + b.second};
+  };
+  return std::accumulate(m_outlier_stats.begin(), m_outlier_stats.end(), sum, op);
+}
+
+inline auto SPERR2D_OMP_C::set_target_bpp(double bpp) -> RTNType
+{
+  if (bpp <= 0.0 || bpp > 64.0)
+    return RTNType::InvalidParam;
+
+  // If the slice and tile dimension hasn't been set, return error.
+  auto eq0 = [](auto v) { return v == 0; };
+  if (std::any_of(m_dims.begin(), m_dims.end(), eq0) ||
+      std::any_of(m_tile_dims.begin(), m_tile_dims.end(), eq0))
+    return RTNType::SetBPPBeforeDims;
+
+  const auto total_vals = static_cast<double>(m_dims[0] * m_dims[1]);
+  m_bit_budget = static_cast<size_t>(bpp * total_vals);
+
+  // Also set other termination criteria to be "never terminate."
+  m_target_psnr = sperr::max_d;
+  m_target_pwe = 0.0;
+
+  return RTNType::Good;
+}
+
+inline void SPERR2D_OMP_C::set_target_psnr(double psnr)
+{
+  m_target_psnr = std::max(psnr, 0.0);
+  m_bit_budget = sperr::max_size;
+  m_target_pwe = 0.0;
+}
+
+inline void SPERR2D_OMP_C::set_target_pwe(double pwe)
+{
+  m_target_pwe = std::max(pwe, 0.0);
+  m_bit_budget = sperr::max_size;
+  m_target_psnr = sperr::max_d;
+}
+
+template <typename T>
+auto SPERR2D_OMP_C::copy_data(const T* slice,
+                              size_t len,
+                              sperr::dims_type slice_dims,
+                              sperr::dims_type tile_dims) -> RTNType
+{
+  static_assert(std::is_floating_point<T>::value, "!! Only floating point values are supported !!");
+
+  if constexpr (std::is_same<T, float>::value)
+    m_orig_is_float = true;
+  else
+    m_orig_is_float = false;
+
+  if (len != slice_dims[0] * slice_dims[1] || slice_dims[2] != 1)
+    return RTNType::WrongDims;
+  else
+    m_dims = slice_dims;
+
+  // The preferred tile size has to be between 1 and m_dims.
+  // Wavelet coefficients (skip_wave) cannot be split spatially, so they are kept in one tile.
+  for (size_t i = 0; i < 2; i++)
+    m_tile_dims[i] = skip_wave ? slice_dims[i] : std::min(std::max(size_t{1}, tile_dims[i]), slice_dims[i]);
+  m_tile_dims[2] = 1;
+
+  // Block the slice into smaller tiles
+  const auto tiles = sperr::chunk_volume(m_dims, m_tile_dims);
+  const auto num_tiles = tiles.size();
+  m_tile_buffers.resize(num_tiles);
+
+#pragma omp parallel for num_threads(m_num_threads)
+  for (size_t i = 0; i < num_tiles; i++) {
+    m_tile_buffers[i] = sperr::gather_chunk<T, double>(slice, m_dims, tiles[i]);
+  }
+
+  return RTNType::Good;
+}
+template auto SPERR2D_OMP_C::copy_data(const float*, size_t, sperr::dims_type, sperr::dims_type)
+    -> RTNType;
+template auto SPERR2D_OMP_C::copy_data(const double*, size_t, sperr::dims_type, sperr::dims_type)
+    -> RTNType;
+
+inline auto SPERR2D_OMP_C::compress() -> RTNType
+{
+  // Need to make sure that the tiles are ready!
+  auto tiles = sperr::chunk_volume(m_dims, m_tile_dims);
+  const auto num_tiles = tiles.size();
+  assert(num_tiles != 0);
+  if (m_tile_buffers.size() != num_tiles)
+    return RTNType::Error;
+  if (std::any_of(m_tile_buffers.begin(), m_tile_buffers.end(),
+                  [](auto& v) { return v.empty(); }))
+    return RTNType::Error;
+
+  // Sanity check: what compression mode to use?
+  const auto mode = sperr::compression_mode(m_bit_budget, m_target_psnr, m_target_pwe);
+  assert(mode != sperr::CompMode::Unknown);
+
+  // Let's prepare some data structures for compression!
+  assert(m_num_threads > 0);
+  auto compressors = std::vector<SPERR2D_Compressor>(m_num_threads);
+  auto tile_rtn = std::vector<RTNType>(num_tiles, RTNType::Good);
+  m_encoded_streams.resize(num_tiles);
+  std::for_each(m_encoded_streams.begin(), m_encoded_streams.end(), [](auto& v) { v.clear(); });
+  m_outlier_stats.assign(num_tiles, {0, 0});
+
+  // Tiles are of different costs (e.g. smooth vs. turbulent regions), hence the dynamic schedule.
+#pragma omp parallel for num_threads(m_num_threads) schedule(dynamic)
+  for (size_t i = 0; i < num_tiles; i++) {
+#ifdef USE_OMP
+    auto& compressor = compressors[omp_get_thread_num()];
+#else
+    auto& compressor = compressors[0];
+#endif
+
+    // Prepare for compression
+    tile_rtn[i] = compressor.take_data(std::move(m_tile_buffers[i]), {tiles[i][1], tiles[i][3], 1});
+    if (tile_rtn[i] != RTNType::Good)
+      continue;
+    compressor.set_skip_wave(skip_wave);
+    compressor.set_eb_coeff(eb_coeff);
+
+    // Figure out the bit budget for this tile
+    if (m_bit_budget == sperr::max_size) {
+      if (mode == sperr::CompMode::FixedPSNR)
+        compressor.set_target_psnr(m_target_psnr);
+      else
+        compressor.set_target_pwe(m_target_pwe);
+    }
+    else {
+      const auto total_vals = m_dims[0] * m_dims[1];
+      const auto tile_vals = tiles[i][1] * tiles[i][3];
+      const auto avail_bits = m_bit_budget - (m_header_magic + num_tiles * 4) * 8;
+      const auto my_bits = (static_cast<double>(tile_vals) / total_vals) * avail_bits;
+      tile_rtn[i] = compressor.set_target_bpp(my_bits / tile_vals);
+    }
+
+    if (tile_rtn[i] == RTNType::Good)
+      tile_rtn[i] = compressor.compress();
+
+    m_encoded_streams[i] = compressor.release_encoded_bitstream();
+    m_outlier_stats[i] = compressor.get_outlier_stats();
+  }
+
+  auto fail =
+      std::find_if(tile_rtn.begin(), tile_rtn.end(), [](auto r) { return r != RTNType::Good; });
+  if (fail != tile_rtn.end())
+    return (*fail);
+
+  if (std::any_of(m_encoded_streams.begin(), m_encoded_streams.end(),
+                  [](auto& s) { return s.empty(); }))
+    return RTNType::EmptyStream;
+
+  return RTNType::Good;
+}
+
+inline auto SPERR2D_OMP_C::get_encoded_bitstream() const -> std::vector<uint8_t>
+{
+  auto buf = std::vector<uint8_t>();
+  auto header = m_generate_header();
+  if (header.empty())
+    return buf;
+
+  auto total_size =
+      std::accumulate(m_encoded_streams.begin(), m_encoded_streams.end(), header.size(),
+                      [](size_t a, const auto& b) { return a + b.size(); });
+  buf.resize(total_size, 0);
+
+  std::copy(header.begin(), header.end(), buf.begin());
+  auto itr = buf.begin() + header.size();
+  for (const auto& s : m_encoded_streams) {
+    std::copy(s.begin(), s.end(), itr);
+    itr += s.size();
+  }
+
+  return buf;
+}
+
+inline auto SPERR2D_OMP_C::m_generate_header() const -> sperr::vec8_type
+{
+  // The header would contain the following information
+  //  -- a version number                     (1 byte)
+  //  -- 8 booleans                           (1 byte)
+  //  -- slice dimensions                     (4 x 2 = 8 bytes)
+  //  -- tile dimensions                      (4 x 2 = 8 bytes)
+  //  -- length of bitstream for each tile    (4 x num_tiles), i.e., the tile index
+  //
+  // The first 10 bytes are laid out as the header of a SPERR2D_Compressor bitstream, so that
+  // sperr::parse_header() works on both, and SPERR2D_OMP_D accepts both.
+  //
+  auto tiles = sperr::chunk_volume(m_dims, m_tile_dims);
+  const auto num_tiles = tiles.size();
+  assert(num_tiles != 0);
+  if (num_tiles != m_encoded_streams.size())
+    return std::vector<uint8_t>();
+  const auto header_size = m_header_magic + num_tiles * 4;
+
+  auto header = std::vector<uint8_t>(header_size);
+
+  // Version number
+  header[0] = 0;//static_cast<uint8_t>(SPERR_VERSION_MAJOR);
+  size_t loc = 1;
+
+  // 8 booleans:
+  // bool[0]  : if ZSTD is used
+  // bool[1]  : if this bitstream is for 3D (true) or 2D (false) data.
+  // bool[2]  : if the original data is float (true) or double (false).
+  // bool[3]  : has SPERR stream; always false here, it's recorded in each tile.
+  // bool[4]  : if this bitstream is tiled (true) or a single SPERR2D bitstream (false).
+  // bool[5-7]: undefined
+  //
+  const auto b8 = std::array<bool, 8>{true,  // using ZSTD
+                                      false,  // 2D
+                                      m_orig_is_float,
+                                      false,
+                                      true,    // tiled
+                                      false,   // undefined
+                                      false,   // undefined
+                                      false};  // undefined
+
+  header[loc] = sperr::pack_8_booleans(b8);
+  loc += 1;
+
+  // Slice and tile dimensions
+  const uint32_t stdim[4] = {
+      static_cast<uint32_t>(m_dims[0]), static_cast<uint32_t>(m_dims[1]),
+      static_cast<uint32_t>(m_tile_dims[0]), static_cast<uint32_t>(m_tile_dims[1])};
+  std::memcpy(&header[loc], stdim, sizeof(stdim));
+  loc += sizeof(stdim);
+
+  // Length of bitstream for each tile
+  // Note that we use uint32_t to keep the length, and we need to make sure
+  // that no tile size is bigger than that.
+  for (const auto& stream : m_encoded_streams) {
+    assert(stream.size() <= uint64_t{std::numeric_limits<uint32_t>::max()});
+    uint32_t len = stream.size();
+    std::memcpy(&header[loc], &len, sizeof(len));
+    loc += sizeof(len);
+  }
+  assert(loc == header_size);
+
+  return header;
+}
+
+
+
+#endif
@@ -0,0 +1,258 @@
+//
+// This is a class that performs SPERR2D decompression, and also utilizes OpenMP
+// to achieve parallelization: input to this class is supposed to be smaller
+// tiles of a bigger slice, as produced by SPERR2D_OMP_C, and each tile is
+// decompressed individually before returning back the big slice.
+// The tile index in the header also allows to decompress only the tiles
+// covering a region of the slice.
+//
+
+#ifndef SPERR2D_OMP_D_H
+#define SPERR2D_OMP_D_H
+
+#include "SPERR2D_Decompressor.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+#ifdef USE_OMP
+#include <omp.h>
+#endif
+
+using sperr::RTNType;
+
+class SPERR2D_OMP_D {
+ public:
+  // Parse the header of this stream, and stores the pointer.
+  // A single (not tiled) SPERR2D bitstream is accepted too, as one tile.
+  auto use_bitstream(const void*, size_t) -> RTNType;
+
+  // If 0 is passed in here, the maximum number of threads will be used.
+  void set_num_threads(size_t);
+
+  // The pointer passed in here MUST be the same as the one passed to `use_bitstream()`.
+  auto decompress(const void*) -> RTNType;
+
+  // Only decompress the tiles that overlap with `region`, which is specified as
+  // {X start, X length, Y start, Y length}, and keep the values of `region`.
+  auto decompress_region(const void*, std::array<size_t, 4> region) -> RTNType;
+
+  auto release_data() -> std::vector<double>&&;
+  auto view_data() const -> const std::vector<double>&;
+  template <typename T>
+  auto get_data() const -> std::vector<T>;
+  // Dimension of the decompressed data, i.e., of the region if decompress_region() was used.
+  auto get_dims() const -> sperr::dims_type;
+
+ private:
+  sperr::dims_type m_dims = {0, 0, 0};       // Dimension of the entire slice
+  sperr::dims_type m_tile_dims = {0, 0, 0};  // Preferred dimensions for a tile
+  sperr::dims_type m_region_dims = {0, 0, 0};
+  size_t m_num_threads = 1;                  // number of theads to use in OpenMP sections
+
+  // Header size would be the magic number + num_tiles * 4
+  const size_t m_header_magic = 18;
+
+  std::vector<double> m_vol_buf;
+  std::vector<size_t> m_offsets;
+  const uint8_t* m_bitstream_ptr = nullptr;
+};
+
+
+inline void SPERR2D_OMP_D::set_num_threads(size_t n)
+{
+#ifdef USE_OMP
+  if (n == 0)
+    m_num_threads = omp_get_max_threads();
+  else
+    m_num_threads = n;
+#else
+  m_num_threads = 1;
+#endif
+}
+
+inline auto SPERR2D_OMP_D::use_bitstream(const void* p, size_t total_len) -> RTNType
+{
+  // This method parses the header of a bitstream and puts slice dimension and
+  // tile size information in respective member variables.
+  // It also stores the offset number to reach all tiles.
+  // It does not, however, read the actual bitstream. The actual bitstream
+  // will be provided when the decompress() method is called.
+
+  const uint8_t* const u8p = static_cast<const uint8_t*>(p);
+  if (total_len < 10)
+    return RTNType::BitstreamWrongLen;
+
+  // Parse Step 1: Major version number is not checked, as in SPERR3D_OMP_D.
+  size_t loc = 1;
+
+  // Parse Step 2: ZSTD application and 3D/2D recording need to be consistent.
+  const auto b8 = sperr::unpack_8_booleans(u8p[loc]);
+  loc++;
+
+  if (b8[0] == false)
+    return RTNType::ZSTDMismatch;
+
+  if (b8[1] == true)
+    return RTNType::SliceVolumeMismatch;
+
+  // Parse Step 3: Extract slice and tile dimensions. A single SPERR2D bitstream
+  // has the slice dimensions at the same location, and is one tile.
+  const auto tiled = b8[4];
+  if (tiled && total_len < m_header_magic)
+    return RTNType::BitstreamWrongLen;
+  uint32_t stdim[4];
+  std::memcpy(stdim, u8p + loc, tiled ? sizeof(stdim) : sizeof(uint32_t) * 2);
+  loc += tiled ? sizeof(stdim) : sizeof(uint32_t) * 2;
+  m_dims = {stdim[0], stdim[1], 1};
+  if (tiled)
+    m_tile_dims = {stdim[2], stdim[3], 1};
+  else
+    m_tile_dims = m_dims;
+  if (m_dims[0] == 0 || m_dims[1] == 0 || m_tile_dims[0] == 0 || m_tile_dims[1] == 0)
+    return RTNType::WrongDims;
+
+  if (!tiled) {
+    m_offsets = {0, total_len};
+    m_bitstream_ptr = u8p;
+    return RTNType::Good;
+  }
+
+  // Figure out how many tiles and their length
+  const auto num_tiles = sperr::chunk_volume(m_dims, m_tile_dims).size();
+  const auto header_size = m_header_magic + num_tiles * 4;
+  if (total_len < header_size)
+    return RTNType::BitstreamWrongLen;
+  auto tile_sizes = std::vector<size_t>(num_tiles, 0);
+  for (size_t i = 0; i < num_tiles; i++) {
+    uint32_t len;
+    std::memcpy(&len, u8p + loc, sizeof(len));
+    loc += sizeof(len);
+    tile_sizes[i] = len;
+  }
+
+  // Sanity check: if the buffer size matches what the header claims
+  const auto suppose_size = std::accumulate(tile_sizes.begin(), tile_sizes.end(), header_size);
+  if (suppose_size != total_len)
+    return RTNType::BitstreamWrongLen;
+
+  // We also calculate the offset value to address each bitstream tile.
+  m_offsets.assign(num_tiles + 1, 0);
+  m_offsets[0] = header_size;
+  for (size_t i = 0; i < num_tiles; i++)
+    m_offsets[i + 1] = m_offsets[i] + tile_sizes[i];
+
+  // Finally, we keep a copy of the bitstream pointer
+  m_bitstream_ptr = u8p;
+
+  return RTNType::Good;
+}
+
+inline auto SPERR2D_OMP_D::decompress(const void* p) -> RTNType
+{
+  return decompress_region(p, {0, m_dims[0], 0, m_dims[1]});
+}
+
+inline auto SPERR2D_OMP_D::decompress_region(const void* p, std::array<size_t, 4> region) -> RTNType
+{
+  if (m_dims[0] == 0 || m_dims[1] == 0 || m_tile_dims[0] == 0 || m_tile_dims[1] == 0)
+    return RTNType::Error;
+  if (p == nullptr || m_bitstream_ptr == nullptr)
+    return RTNType::Error;
+  if (static_cast<const uint8_t*>(p) != m_bitstream_ptr)
+    return RTNType::Error;
+  if (region[1] == 0 || region[3] == 0 || region[0] + region[1] > m_dims[0] ||
+      region[2] + region[3] > m_dims[1])
+    return RTNType::WrongDims;
+
+  // Let's figure out the tile information, and which tiles overlap with the region.
+  const auto tiles = sperr::chunk_volume(m_dims, m_tile_dims);
+  const auto num_tiles = tiles.size();
+  if (m_offsets.size() != num_tiles + 1)
+    return RTNType::Error;
+  auto needed = std::vector<size_t>();
+  for (size_t i = 0; i < num_tiles; i++) {
+    const auto& t = tiles[i];
+    if (t[0] < region[0] + region[1] && region[0] < t[0] + t[1] && t[2] < region[2] + region[3] &&
+        region[2] < t[2] + t[3])
+      needed.push_back(i);
+  }
+
+  // Allocate a buffer to store the region
+  m_region_dims = {region[1], region[3], 1};
+  m_vol_buf.resize(region[1] * region[3]);
+
+  // Create number of decompressor instances equal to the number of threads
+  auto decompressors = std::vector<SPERR2D_Decompressor>(m_num_threads);
+  auto tile_rtn = std::vector<RTNType>(needed.size() * 2, RTNType::Good);
+
+#pragma omp parallel for num_threads(m_num_threads) schedule(dynamic)
+  for (size_t n = 0; n < needed.size(); n++) {
+#ifdef USE_OMP
+    auto& decompressor = decompressors[omp_get_thread_num()];
+#else
+    auto& decompressor = decompressors[0];
+#endif
+    const auto i = needed[n];
+    const auto& t = tiles[i];
+
+    tile_rtn[n * 2] =
+        decompressor.use_bitstream(m_bitstream_ptr + m_offsets[i], m_offsets[i + 1] - m_offsets[i]);
+    if (tile_rtn[n * 2] != RTNType::Good)
+      continue;
+    tile_rtn[n * 2 + 1] = decompressor.decompress();
+    const auto& small_slice = decompressor.view_data();
+    if (tile_rtn[n * 2 + 1] != RTNType::Good || small_slice.size() != t[1] * t[3]) {
+      tile_rtn[n * 2 + 1] = RTNType::Error;
+      continue;
+    }
+
+    // Copy the part of the tile that is within the region.
+    const auto x0 = std::max(t[0], region[0]), x1 = std::min(t[0] + t[1], region[0] + region[1]);
+    const auto y0 = std::max(t[2], region[2]), y1 = std::min(t[2] + t[3], region[2] + region[3]);
+    for (size_t y = y0; y < y1; y++) {
+      auto src = small_slice.begin() + (y - t[2]) * t[1] + (x0 - t[0]);
+      auto dst = m_vol_buf.begin() + (y - region[2]) * region[1] + (x0 - region[0]);
+      std::copy(src, src + (x1 - x0), dst);
+    }
+  }
+
+  auto fail =
+      std::find_if(tile_rtn.begin(), tile_rtn.end(), [](auto r) { return r != RTNType::Good; });
+  if (fail != tile_rtn.end())
+    return *fail;
+  else
+    return RTNType::Good;
+}
+
+inline auto SPERR2D_OMP_D::release_data() -> sperr::vecd_type&&
+{
+  m_dims = {0, 0, 0};
+  m_region_dims = {0, 0, 0};
+  return std::move(m_vol_buf);
+}
+
+inline auto SPERR2D_OMP_D::view_data() const -> const std::vector<double>&
+{
+  return m_vol_buf;
+}
+
+inline auto SPERR2D_OMP_D::get_dims() const -> std::array<size_t, 3>
+{
+  return m_region_dims;
+}
+
+template <typename T>
+auto SPERR2D_OMP_D::get_data() const -> std::vector<T>
+{
+  auto rtn_buf = std::vector<T>(m_vol_buf.size());
+  std::copy(m_vol_buf.begin(), m_vol_buf.end(), rtn_buf.begin());
+  return rtn_buf;
+}
+template auto SPERR2D_OMP_D::get_data() const -> std::vector<float>;
+template auto SPERR2D_OMP_D::get_data() const -> std::vector<double>;
+
+
+
+#endif
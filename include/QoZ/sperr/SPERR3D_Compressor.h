@@ -81,12 +81,12 @@ class SPERR3D_Compressor {
 };  // namespace sperr
 
 
-void sperr::SPERR3D_Compressor::set_skip_wave(const bool & skip){
+inline void sperr::SPERR3D_Compressor::set_skip_wave(const bool & skip){
   skip_wave=skip;
 }
 
 
-void sperr::SPERR3D_Compressor::set_eb_coeff(const double & coeff){
+inline void sperr::SPERR3D_Compressor::set_eb_coeff(const double & coeff){
   eb_coeff=coeff;
 }
 
@@ -108,7 +108,7 @@ auto sperr::SPERR3D_Compressor::copy_data(const T* p, size_t len, sperr::dims_ty
 template auto sperr::SPERR3D_Compressor::copy_data(const double*, size_t, dims_type) -> RTNType;
 template auto sperr::SPERR3D_Compressor::copy_data(const float*, size_t, dims_type) -> RTNType;
 
-auto sperr::SPERR3D_Compressor::take_data(sperr::vecd_type&& buf, sperr::dims_type dims) -> RTNType
+inline auto sperr::SPERR3D_Compressor::take_data(sperr::vecd_type&& buf, sperr::dims_type dims) -> RTNType
 {
   if (buf.size() != dims[0] * dims[1] * dims[2])
     return RTNType::WrongDims;
@@ -119,17 +119,17 @@ auto sperr::SPERR3D_Compressor::take_data(sperr::vecd_type&& buf, sperr::dims_ty
   return RTNType::Good;
 }
 
-auto sperr::SPERR3D_Compressor::view_encoded_bitstream() const -> const std::vector<uint8_t>&
+inline auto sperr::SPERR3D_Compressor::view_encoded_bitstream() const -> const std::vector<uint8_t>&
 {
   return m_encoded_stream;
 }
 
-auto sperr::SPERR3D_Compressor::release_encoded_bitstream() -> std::vector<uint8_t>&&
+inline auto sperr::SPERR3D_Compressor::release_encoded_bitstream() -> std::vector<uint8_t>&&
 {
   return std::move(m_encoded_stream);
 }
 
-auto sperr::SPERR3D_Compressor::compress() -> RTNType
+inline auto sperr::SPERR3D_Compressor::compress() -> RTNType
 {
   const auto total_vals = m_dims[0] * m_dims[1] * m_dims[2];
   if (m_val_buf.empty() || m_val_buf.size() != total_vals)
@@ -322,7 +322,7 @@ auto sperr::SPERR3D_Compressor::compress() -> RTNType
   return rtn;
 }
 
-auto sperr::SPERR3D_Compressor::m_assemble_encoded_bitstream() -> RTNType
+inline auto sperr::SPERR3D_Compressor::m_assemble_encoded_bitstream() -> RTNType
 {
   // Copy over the condi stream.
   // `m_encoded_stream` is either empty, or is already allocated space and filled with the speck
@@ -367,12 +367,12 @@ auto sperr::SPERR3D_Compressor::m_assemble_encoded_bitstream() -> RTNType
   return RTNType::Good;
 }
 
-auto sperr::SPERR3D_Compressor::get_outlier_stats() const -> std::pair<size_t, size_t>
+inline auto sperr::SPERR3D_Compressor::get_outlier_stats() const -> std::pair<size_t, size_t>
 {
   return {m_LOS.size(), m_sperr_stream.size()};
 }
 
-auto sperr::SPERR3D_Compressor::set_comp_params(size_t budget, double psnr, double pwe) -> RTNType
+inline auto sperr::SPERR3D_Compressor::set_comp_params(size_t budget, double psnr, double pwe) -> RTNType
 {
   // First set those ones that only need a plain copy
   m_target_psnr = psnr;
@@ -392,7 +392,7 @@ auto sperr::SPERR3D_Compressor::set_comp_params(size_t budget, double psnr, doub
   }
 }
 /*
-void sperr::SPERR3D_Compressor::toggle_conditioning(sperr::Conditioner::settings_type b4)
+inline void sperr::SPERR3D_Compressor::toggle_conditioning(sperr::Conditioner::settings_type b4)
 {
   m_conditioning_settings = b4;
 }
@@ -59,7 +59,7 @@ class SPERR3D_Decompressor {
 };  // namespace sperr
 
 
-auto sperr::SPERR3D_Decompressor::use_bitstream(const void* p, size_t len) -> RTNType
+inline auto sperr::SPERR3D_Decompressor::use_bitstream(const void* p, size_t len) -> RTNType
 {
   // It'd be bad to have some buffers updated, and some others not.
   // So let's clean up everything at the very beginning of this routine
@@ -140,12 +140,12 @@ auto sperr::SPERR3D_Decompressor::use_bitstream(const void* p, size_t len) -> RT
   return RTNType::Good;
 }
 
-void sperr::SPERR3D_Decompressor::set_dims(dims_type dims)
+inline void sperr::SPERR3D_Decompressor::set_dims(dims_type dims)
 {
   m_dims = dims;
 }
 
-auto sperr::SPERR3D_Decompressor::decompress() -> RTNType
+inline auto sperr::SPERR3D_Decompressor::decompress() -> RTNType
 {
   // `m_condi_stream` might be indicating a constant field, so let's see if that's
   // the case, and if it is, we don't need to go through dwt and speck stuff anymore.
@@ -245,12 +245,12 @@ auto sperr::SPERR3D_Decompressor::get_data() const -> std::vector<T>
 template auto sperr::SPERR3D_Decompressor::get_data() const -> std::vector<double>;
 template auto sperr::SPERR3D_Decompressor::get_data() const -> std::vector<float>;
 
-auto sperr::SPERR3D_Decompressor::view_data() const -> const std::vector<double>&
+inline auto sperr::SPERR3D_Decompressor::view_data() const -> const std::vector<double>&
 {
   return m_val_buf;
 }
 
-auto sperr::SPERR3D_Decompressor::release_data() -> std::vector<double>&&
+inline auto sperr::SPERR3D_Decompressor::release_data() -> std::vector<double>&&
 {
   m_dims = {0, 0, 0};
   return std::move(m_val_buf);
@@ -81,15 +81,15 @@ class SPERR3D_OMP_C {
   auto m_generate_header() const -> sperr::vec8_type;
 };
 
-void SPERR3D_OMP_C::set_skip_wave(const bool & skip){
+inline void SPERR3D_OMP_C::set_skip_wave(const bool & skip){
   skip_wave=skip;
 }
 
-void SPERR3D_OMP_C::set_eb_coeff(const double & coeff){
+inline void SPERR3D_OMP_C::set_eb_coeff(const double & coeff){
   eb_coeff=coeff;
 }
 
-void SPERR3D_OMP_C::set_num_threads(size_t n)
+inline void SPERR3D_OMP_C::set_num_threads(size_t n)
 {
 #ifdef USE_OMP
   if (n == 0)
@@ -101,12 +101,12 @@ void SPERR3D_OMP_C::set_num_threads(size_t n)
 #endif
 }
 /*
-void SPERR3D_OMP_C::toggle_conditioning(sperr::Conditioner::settings_type b4)
+inline void SPERR3D_OMP_C::toggle_conditioning(sperr::Conditioner::settings_type b4)
 {
   m_conditioning_settings = b4;
 }
 */
-auto SPERR3D_OMP_C::get_outlier_stats() const -> std::pair<size_t, size_t>
+inline auto SPERR3D_OMP_C::get_outlier_stats() const -> std::pair<size_t, size_t>
 {
   using pair = std::pair<size_t, size_t>;
   pair sum{0, 0};
@@ -116,7 +116,7 @@ auto SPERR3D_OMP_C::get_outlier_stats() const -> std::pair<size_t, size_t>
   return std::accumulate(m_outlier_stats.begin(), m_outlier_stats.end(), sum, op);
 }
 
-auto SPERR3D_OMP_C::set_target_bpp(double bpp) -> RTNType
+inline auto SPERR3D_OMP_C::set_target_bpp(double bpp) -> RTNType
 {
   if (bpp <= 0.0 || bpp > 64.0)
     return RTNType::InvalidParam;
@@ -137,14 +137,14 @@ auto SPERR3D_OMP_C::set_target_bpp(double bpp) -> RTNType
   return RTNType::Good;
 }
 
-void SPERR3D_OMP_C::set_target_psnr(double psnr)
+inline void SPERR3D_OMP_C::set_target_psnr(double psnr)
 {
   m_target_psnr = std::max(psnr, 0.0);
   m_bit_budget = sperr::max_size;
   m_target_pwe = 0.0;
 }
 
-void SPERR3D_OMP_C::set_target_pwe(double pwe)
+inline void SPERR3D_OMP_C::set_target_pwe(double pwe)
 {
   m_target_pwe = std::max(pwe, 0.0);
   m_bit_budget = sperr::max_size;
@@ -190,7 +190,7 @@ template auto SPERR3D_OMP_C::copy_data(const float*, size_t, sperr::dims_type, s
 template auto SPERR3D_OMP_C::copy_data(const double*, size_t, sperr::dims_type, sperr::dims_type)
     -> RTNType;
 
-auto SPERR3D_OMP_C::compress() -> RTNType
+inline auto SPERR3D_OMP_C::compress() -> RTNType
 {
   // Need to make sure that the chunks are ready!
   auto chunks = sperr::chunk_volume(m_dims, m_chunk_dims);
@@ -268,7 +268,7 @@ auto SPERR3D_OMP_C::compress() -> RTNType
   return RTNType::Good;
 }
 
-auto SPERR3D_OMP_C::get_encoded_bitstream() const -> std::vector<uint8_t>
+inline auto SPERR3D_OMP_C::get_encoded_bitstream() const -> std::vector<uint8_t>
 {
   auto buf = std::vector<uint8_t>();
   auto header = m_generate_header();
@@ -290,7 +290,7 @@ auto SPERR3D_OMP_C::get_encoded_bitstream() const -> std::vector<uint8_t>
   return buf;
 }
 
-auto SPERR3D_OMP_C::m_generate_header() const -> sperr::vec8_type
+inline auto SPERR3D_OMP_C::m_generate_header() const -> sperr::vec8_type
 {
   // The header would contain the following information
   //  -- a version number                     (1 byte)
@@ -52,7 +52,7 @@ class SPERR3D_OMP_D {
 };
 
 
-void SPERR3D_OMP_D::set_num_threads(size_t n)
+inline void SPERR3D_OMP_D::set_num_threads(size_t n)
 {
 #ifdef USE_OMP
   if (n == 0)
@@ -64,7 +64,7 @@ void SPERR3D_OMP_D::set_num_threads(size_t n)
 #endif
 }
 
-auto SPERR3D_OMP_D::use_bitstream(const void* p, size_t total_len) -> RTNType
+inline auto SPERR3D_OMP_D::use_bitstream(const void* p, size_t total_len) -> RTNType
 {
   // This method parses the header of a bitstream and puts volume dimension and
   // chunk size information in respective member variables.
@@ -157,7 +157,7 @@ auto SPERR3D_OMP_D::use_bitstream(const void* p, size_t total_len) -> RTNType
   return RTNType::Good;
 }
 
-auto SPERR3D_OMP_D::decompress(const void* p) -> RTNType
+inline auto SPERR3D_OMP_D::decompress(const void* p) -> RTNType
 {
   auto eq0 = [](auto v) { return v == 0; };
   if (std::any_of(m_dims.begin(), m_dims.end(), eq0) ||
@@ -213,18 +213,18 @@ auto SPERR3D_OMP_D::decompress(const void* p) -> RTNType
     return RTNType::Good;
 }
 
-auto SPERR3D_OMP_D::release_data() -> sperr::vecd_type&&
+inline auto SPERR3D_OMP_D::release_data() -> sperr::vecd_type&&
 {
   m_dims = {0, 0, 0};
   return std::move(m_vol_buf);
 }
 
-auto SPERR3D_OMP_D::view_data() const -> const std::vector<double>&
+inline auto SPERR3D_OMP_D::view_data() const -> const std::vector<double>&
 {
   return m_vol_buf;
 }
 
-auto SPERR3D_OMP_D::get_dims() const -> std::array<size_t, 3>
+inline auto SPERR3D_OMP_D::get_dims() const -> std::array<size_t, 3>
 {
   return m_dims;
 }
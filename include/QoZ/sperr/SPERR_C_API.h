@@ -8,6 +8,8 @@
 
 #include "SPERR2D_Compressor.h"
 #include "SPERR2D_Decompressor.h"
+#include "SPERR2D_OMP_C.h"
+#include "SPERR2D_OMP_D.h"
 
 #include "SPERR3D_OMP_C.h"
 #include "SPERR3D_OMP_D.h"
@@ -54,6 +56,24 @@ int sperr_comp_2d(
     void** dst,       /* Output: buffer for the output bitstream, allocated by this function */
     size_t* dst_len); /* Output: length of `dst` in byte */
 
+/*
+ * Compress a a 2D slice in tiles, in parallel. The modes and return values are the same as
+ * `sperr_comp_2d()`. The bitstream holds an index of the tiles, and is decompressed by
+ * `sperr_decomp_2d()` and `sperr_decomp_user_mem()` as well.
+ */
+int sperr_comp_2d_omp(
+    const void* src,  /* Input: buffer that contains a 2D slice */
+    int32_t is_float, /* Input: input buffer type: 1 == float, 0 == double */
+    size_t dimx,      /* Input: X (fastest-varying) dimension */
+    size_t dimy,      /* Input: Y (slowest-varying) dimension */
+    size_t tile_x,    /* Input: preferred tile dimension in X */
+    size_t tile_y,    /* Input: preferred tile dimension in Y */
+    int32_t mode,     /* Input: compression mode to use */
+    double quality,   /* Input: target quality */
+    size_t nthreads,  /* Input: number of OMP threads to use. 0 means using all threads. */
+    void** dst,       /* Output: buffer for the output bitstream, allocated by this function */
+    size_t* dst_len); /* Output: length of `dst` in byte */
+
 /*
  * Compress a a 3D volume targetting different quality controls (modes):
  *   mode == 1 --> fixed bit-per-pixel (BPP)
@@ -122,7 +142,7 @@ int sperr_decomp_3d(
  * Decompress a 2D or 3D SPERR bitstream to a USER-ALLOCATED memory buffer. If you don't know
  * how much memory to allocate, use functions `sperr_decomp_2d()` or `sperr_decomp_3d()` instead.
  * Note 1: If not enough memory was allocated at `dst`, segment faults may occur.
- * Note 2: `nthreads` won't have any effect in 2D decompression.
+ * Note 2: `nthreads` only has an effect in 2D decompression if the slice was compressed in tiles.
  *
  * Return value meanings:
  * 0: success
@@ -160,7 +180,7 @@ void sperr_parse_header(
 
 
 
-int C_API::sperr_comp_2d(const void* src,
+inline int C_API::sperr_comp_2d(const void* src,
                          int32_t is_float,
                          size_t dimx,
                          size_t dimy,
@@ -226,7 +246,80 @@ int C_API::sperr_comp_2d(const void* src,
   return 0;
 }
 
-int C_API::sperr_comp_3d(const void* src,
+inline int C_API::sperr_comp_2d_omp(const void* src,
+                             int32_t is_float,
+                             size_t dimx,
+                             size_t dimy,
+                             size_t tile_x,
+                             size_t tile_y,
+                             int32_t mode,
+                             double quality,
+                             size_t nthreads,
+                             void** dst,
+                             size_t* dst_len)
+{
+  // Examine if `dst` is pointing to a NULL pointer
+  if (*dst != NULL)
+    return 1;
+
+  // Examine if `mode` and `quality` are valid
+  if (mode < 1 || mode > 3 || quality <= 0.0)
+    return 2;
+
+  const auto slice_dims = sperr::dims_type{dimx, dimy, 1};
+  const auto tile_dims = sperr::dims_type{tile_x, tile_y, 1};
+
+  // Setup the compressor
+  const auto total_vals = dimx * dimy;
+  auto compressor = SPERR2D_OMP_C();
+  compressor.set_num_threads(nthreads);
+  auto rtn = sperr::RTNType::Good;
+  switch (is_float) {
+    case 0:  // double
+      rtn = compressor.copy_data(static_cast<const double*>(src), total_vals, slice_dims, tile_dims);
+      break;
+    case 1:  // float
+      rtn = compressor.copy_data(static_cast<const float*>(src), total_vals, slice_dims, tile_dims);
+      break;
+    default:
+      rtn = RTNType::Error;
+  }
+  if (rtn != RTNType::Good)
+    return -1;
+
+  // Specify a particular compression mode.
+  switch (mode) {
+    case 1:
+      compressor.set_target_bpp(quality);
+      break;
+    case 2:
+      compressor.set_target_psnr(quality);
+      break;
+    case 3:
+      compressor.set_target_pwe(quality);
+      break;
+    default:
+      return 2;
+  }
+
+  // Do the actual compression work
+  rtn = compressor.compress();
+  if (rtn != RTNType::Good)
+    return -1;
+
+  // Output the compressed bitstream
+  const auto stream = compressor.get_encoded_bitstream();
+  if (stream.empty())
+    return -1;
+  *dst_len = stream.size();
+  uint8_t* buf = (uint8_t*)std::malloc(stream.size());
+  std::copy(stream.cbegin(), stream.cend(), buf);
+  *dst = buf;
+
+  return 0;
+}
+
+inline int C_API::sperr_comp_3d(const void* src,
                          int32_t is_float,
                          size_t dimx,
                          size_t dimy,
@@ -301,7 +394,7 @@ int C_API::sperr_comp_3d(const void* src,
   return 0;
 }
 
-int C_API::sperr_decomp_2d(const void* src,
+inline int C_API::sperr_decomp_2d(const void* src,
                            size_t src_len,
                            int32_t output_float,
                            size_t* dimx,
@@ -312,12 +405,12 @@ int C_API::sperr_decomp_2d(const void* src,
   if (*dst != NULL)
     return 1;
 
-  // Use a decompressor to decompress this bitstream
-  auto decompressor = SPERR2D_Decompressor();
+  // Use a decompressor to decompress this bitstream, tiled or not
+  auto decompressor = SPERR2D_OMP_D();
   auto rtn = decompressor.use_bitstream(src, src_len);
   if (rtn != RTNType::Good)
     return -1;
-  rtn = decompressor.decompress();
+  rtn = decompressor.decompress(src);
   if (rtn != RTNType::Good)
     return -1;
 
@@ -350,7 +443,7 @@ int C_API::sperr_decomp_2d(const void* src,
   return 0;
 }
 
-int C_API::sperr_decomp_3d(const void* src,
+inline int C_API::sperr_decomp_3d(const void* src,
                            size_t src_len,
                            int32_t output_float,
                            size_t nthreads,
@@ -403,7 +496,7 @@ int C_API::sperr_decomp_3d(const void* src,
   return 0;
 }
 
-int C_API::sperr_decomp_user_mem(const void* src,
+inline int C_API::sperr_decomp_user_mem(const void* src,
                                  size_t src_len,
                                  int32_t output_float,
                                  size_t nthreads,
@@ -433,12 +526,13 @@ int C_API::sperr_decomp_user_mem(const void* src,
       std::copy(vol.cbegin(), vol.cend(), ptr);
     }
   }
-  else {  // Decompress a 2D slice
-    auto decompressor = SPERR2D_Decompressor();
+  else {  // Decompress a 2D slice, tiled or not
+    auto decompressor = SPERR2D_OMP_D();
+    decompressor.set_num_threads(nthreads);
     auto rtn = decompressor.use_bitstream(src, src_len);
     if (rtn != RTNType::Good)
       return -1;
-    rtn = decompressor.decompress();
+    rtn = decompressor.decompress(src);
     if (rtn != RTNType::Good)
       return -1;
 
@@ -456,7 +550,7 @@ int C_API::sperr_decomp_user_mem(const void* src,
   return 0;
 }
 
-void C_API::sperr_parse_header(const void* ptr,
+inline void C_API::sperr_parse_header(const void* ptr,
                                int32_t* version_major,
                                int32_t* zstd_applied,
                                int32_t* is_3d,
@@ -22,6 +22,11 @@
 #include <cstring>
 #include <numeric>
 
+// QoZ links OpenMP (see CMakeLists.txt), so the OpenMP code paths of SPERR follow the compiler flag.
+#if defined(_OPENMP) && !defined(USE_OMP)
+#define USE_OMP
+#endif
+
 #ifdef USE_OMP
 #include <omp.h>
 #endif
@@ -199,7 +204,7 @@ auto compression_mode(size_t bit_budget, double psnr, double pwe) -> CompMode;
 };  // namespace sperr
 
 
-auto sperr::num_of_xforms(size_t len) -> size_t
+inline auto sperr::num_of_xforms(size_t len) -> size_t
 {
   assert(len > 0);
   // I decide 8 is the minimal length to do one level of xform.
@@ -210,7 +215,7 @@ auto sperr::num_of_xforms(size_t len) -> size_t
   return std::min(num, size_t{6});
 }
 
-auto sperr::num_of_partitions(size_t len) -> size_t
+inline auto sperr::num_of_partitions(size_t len) -> size_t
 {
   size_t num_of_parts = 0;  // Num. of partitions we can do
   while (len > 1) {
@@ -221,7 +226,7 @@ auto sperr::num_of_partitions(size_t len) -> size_t
   return num_of_parts;
 }
 
-auto sperr::calc_approx_detail_len(size_t orig_len, size_t lev) -> std::array<size_t, 2>
+inline auto sperr::calc_approx_detail_len(size_t orig_len, size_t lev) -> std::array<size_t, 2>
 {
   size_t low_len = orig_len;
   size_t high_len = 0;
@@ -235,7 +240,7 @@ auto sperr::calc_approx_detail_len(size_t orig_len, size_t lev) -> std::array<si
 
 // Good solution to deal with bools and unsigned chars
 // https://stackoverflow.com/questions/8461126/how-to-create-a-byte-out-of-8-bool-values-and-vice-versa
-auto sperr::pack_booleans(std::vector<uint8_t>& dest, const std::vector<bool>& src, size_t offset)
+inline auto sperr::pack_booleans(std::vector<uint8_t>& dest, const std::vector<bool>& src, size_t offset)
     -> RTNType
 {
   // `src` has to have a size of multiples of 8.
@@ -277,7 +282,7 @@ auto sperr::pack_booleans(std::vector<uint8_t>& dest, const std::vector<bool>& s
   return RTNType::Good;
 }
 
-auto sperr::unpack_booleans(std::vector<bool>& dest,
+inline auto sperr::unpack_booleans(std::vector<bool>& dest,
                             const void* src,
                             size_t src_len,
                             size_t src_offset) -> RTNType
@@ -348,7 +353,7 @@ auto sperr::unpack_booleans(std::vector<bool>& dest,
   return RTNType::Good;
 }
 
-auto sperr::pack_8_booleans(std::array<bool, 8> src) -> uint8_t
+inline auto sperr::pack_8_booleans(std::array<bool, 8> src) -> uint8_t
 {
   // It turns out that C++ doesn't specify bool to be one byte,
   // so to be safe we copy the content of src to array of uint8_t.
@@ -361,7 +366,7 @@ auto sperr::pack_8_booleans(std::array<bool, 8> src) -> uint8_t
   return dest;
 }
 
-auto sperr::unpack_8_booleans(uint8_t src) -> std::array<bool, 8>
+inline auto sperr::unpack_8_booleans(uint8_t src) -> std::array<bool, 8>
 {
   const uint64_t magic = 0x8040201008040201;
   const uint64_t mask = 0x8080808080808080;
@@ -375,7 +380,7 @@ auto sperr::unpack_8_booleans(uint8_t src) -> std::array<bool, 8>
   return b8;
 }
 
-auto sperr::read_n_bytes(std::string filename, size_t n_bytes) -> std::vector<uint8_t>
+inline auto sperr::read_n_bytes(std::string filename, size_t n_bytes) -> std::vector<uint8_t>
 {
   auto buf = std::vector<uint8_t>();
 
@@ -423,7 +428,7 @@ template auto sperr::read_whole_file(std::string) -> std::vector<float>;
 template auto sperr::read_whole_file(std::string) -> std::vector<double>;
 template auto sperr::read_whole_file(std::string) -> std::vector<uint8_t>;
 
-auto sperr::write_n_bytes(std::string filename, size_t n_bytes, const void* buffer) -> RTNType
+inline auto sperr::write_n_bytes(std::string filename, size_t n_bytes, const void* buffer) -> RTNType
 {
   std::unique_ptr<std::FILE, decltype(&std::fclose)> fp(std::fopen(filename.data(), "wb"),
                                                         &std::fclose);
@@ -547,7 +552,7 @@ auto sperr::kahan_summation(const T* arr, size_t len) -> T
 template auto sperr::kahan_summation(const float*, size_t) -> float;
 template auto sperr::kahan_summation(const double*, size_t) -> double;
 
-auto sperr::chunk_volume(const std::array<size_t, 3>& vol_dim,
+inline auto sperr::chunk_volume(const std::array<size_t, 3>& vol_dim,
                          const std::array<size_t, 3>& chunk_dim)
     -> std::vector<std::array<size_t, 6>>
 {
@@ -666,7 +671,7 @@ template void sperr::scatter_chunk(std::vector<double>&,
                                    const std::vector<double>&,
                                    const std::array<size_t, 6>&);
 
-auto sperr::parse_header(const void* ptr) -> HeaderInfo
+inline auto sperr::parse_header(const void* ptr) -> HeaderInfo
 {
   const uint8_t* u8p = static_cast<const uint8_t*>(ptr);
   size_t loc = 0;
@@ -770,7 +775,7 @@ auto sperr::calc_variance(const T* arr, size_t len, size_t omp_nthreads) -> T
 template auto sperr::calc_variance(const float*, size_t, size_t) -> float;
 template auto sperr::calc_variance(const double*, size_t, size_t) -> double;
 
-auto sperr::compression_mode(size_t bit_budget, double psnr, double pwe) -> CompMode
+inline auto sperr::compression_mode(size_t bit_budget, double psnr, double pwe) -> CompMode
 {
   if (bit_budget < sperr::max_size && psnr == sperr::max_d && pwe == 0.0) {
     return CompMode::FixedSize;
@@ -0,0 +1,143 @@
+#ifndef SZ_ARRAY_VIEW_HPP
+#define SZ_ARRAY_VIEW_HPP
+
+#include "QoZ/def.hpp"
+#include <vector>
+#include <array>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+
+/*
+ * Non-owning N-D view of user memory: base pointer, per-dimension strides (in elements) and layout.
+ *
+ * dims and strides are given in the index order of the caller, so a Fortran array A(nx, ny, nz)
+ * is described as dims {nx, ny, nz} with LAYOUT_FORTRAN, and a sub-array that excludes ghost cells
+ * keeps the strides of the enclosing allocation.
+ *
+ * The compressors always traverse the data with the last dimension fastest. Instead of transposing,
+ * the view reorders its axes by decreasing stride ("storage order"), so the compressor walks the data
+ * in memory order: a Fortran array is compressed as a C array with reversed dims and is decompressed
+ * straight back into its own memory.
+ */
+
+namespace QoZ {
+
+    enum LAYOUT {
+        LAYOUT_C, LAYOUT_FORTRAN
+    };
+    constexpr const char *LAYOUT_STR[] = {"LAYOUT_C", "LAYOUT_FORTRAN"};
+
+    template<class T>
+    class ArrayView {
+    public:
+        //densely packed array in the given layout
+        ArrayView(T *data, const std::vector<size_t> &dims, uint8_t layout = LAYOUT_C) :
+                data(data), dims(dims), strides(dims.size()), layout(layout) {
+            size_t s = 1;
+            if (layout == LAYOUT_FORTRAN) {
+                for (size_t i = 0; i < dims.size(); i++) {
+                    strides[i] = s;
+                    s *= dims[i];
+                }
+            } else {
+                for (int i = dims.size() - 1; i >= 0; i--) {
+                    strides[i] = s;
+                    s *= dims[i];
+                }
+            }
+        }
+
+        //strided view, e.g. the interior of a ghosted array
+        ArrayView(T *data, const std::vector<size_t> &dims, const std::vector<size_t> &strides, uint8_t layout = LAYOUT_C) :
+                data(data), dims(dims), strides(strides), layout(layout) {}
+
+        size_t num() const {
+            return std::accumulate(dims.begin(), dims.end(), (size_t) 1, std::multiplies<size_t>());
+        }
+
+        //axes sorted by decreasing stride, i.e. the order in which the compressor traverses the view
+        std::vector<uint> storage_axes() const {
+            std::vector<uint> axes(dims.size());
+            std::iota(axes.begin(), axes.end(), 0);
+            //stable, so that unit-length dimensions keep the order given by the layout
+            if (layout == LAYOUT_FORTRAN)
+                std::reverse(axes.begin(), axes.end());
+            std::stable_sort(axes.begin(), axes.end(), [this](uint a, uint b) {
+                return strides[a] > strides[b];
+            });
+            return axes;
+        }
+
+        std::vector<size_t> storage_dims() const {
+            std::vector<size_t> d;
+            for (auto a: storage_axes())
+                d.push_back(dims[a]);
+            return d;
+        }
+
+        //true if the view covers one dense block of memory, then data can be used in place
+        bool is_contiguous() const {
+            size_t s = 1;
+            auto axes = storage_axes();
+            for (int i = axes.size() - 1; i >= 0; i--) {
+                if (dims[axes[i]] > 1 && strides[axes[i]] != s)
+                    return false;
+                s *= dims[axes[i]];
+            }
+            return true;
+        }
+
+        //copies the view into a packed buffer in storage order
+        void gather(T *packed) const {
+            traverse(packed, true);
+        }
+
+        //copies a packed buffer in storage order into the view
+        void scatter(const T *packed) const {
+            traverse(const_cast<T *>(packed), false);
+        }
+
+        T *data;
+        std::vector<size_t> dims;
+        std::vector<size_t> strides;
+        uint8_t layout;
+
+    private:
+        void traverse(T *packed, bool toPacked) const {
+            //pad to 4D in storage order, the innermost dimension is copied as a row
+            std::array<size_t, 4> d{1, 1, 1, 1}, s{0, 0, 0, 0};
+            auto axes = storage_axes();
+            uint n = axes.size();
+            for (uint i = 0; i < n; i++) {
+                d[4 - n + i] = dims[axes[i]];
+                s[4 - n + i] = strides[axes[i]];
+            }
+            size_t p = 0;
+            for (size_t i = 0; i < d[0]; i++) {
+                for (size_t j = 0; j < d[1]; j++) {
+                    for (size_t k = 0; k < d[2]; k++) {
+                        T *row = data + i * s[0] + j * s[1] + k * s[2];
+                        if (s[3] == 1) {
+                            if (toPacked)
+                                memcpy(packed + p, row, d[3] * sizeof(T));
+                            else
+                                memcpy(row, packed + p, d[3] * sizeof(T));
+                        } else {
+                            for (size_t l = 0; l < d[3]; l++) {
+                                if (toPacked)
+                                    packed[p + l] = row[l * s[3]];
+                                else
+                                    row[l * s[3]] = packed[p + l];
+                            }
+                        }
+                        p += d[3];
+                    }
+                }
+            }
+        }
+    };
+}
+
+#endif //SZ_ARRAY_VIEW_HPP
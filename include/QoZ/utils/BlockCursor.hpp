@@ -0,0 +1,142 @@
+#ifndef _SZ_BLOCK_CURSOR_HPP
+#define _SZ_BLOCK_CURSOR_HPP
+
+#include "QoZ/def.hpp"
+#include <array>
+#include <cstddef>
+#include <algorithm>
+
+namespace QoZ {
+
+    /**
+     * Cursor over one block of an N-d row-major array, used on the hot loops of the block-wise frontends instead of
+     * multi_dimensional_range. It is a plain value (no shared state, no allocation), and a block is visited row by row
+     * along the last, contiguous dimension, so that predictors can work on a whole row (see predict_row).
+     * Elements outside the array (negative global indices) are treated as 0, as in multi_dimensional_iterator::prev.
+     */
+    template<class T, uint N>
+    class BlockCursor {
+    public:
+        BlockCursor(T *data, const std::array<size_t, N> &dims, size_t block_size) :
+                data(data), dims(dims), block_size(block_size) {
+            strides[N - 1] = 1;
+            for (int i = N - 2; i >= 0; i--) {
+                strides[i] = strides[i + 1] * dims[i + 1];
+            }
+        }
+
+        // moves to the block with the given block coordinates and to its first row
+        void set_block(const std::array<size_t, N> &block_index) {
+            block_offset = 0;
+            num_rows = 1;
+            for (uint i = 0; i < N; i++) {
+                start[i] = block_index[i] * block_size;
+                extent[i] = std::min(block_size, dims[i] - start[i]);
+                block_offset += start[i] * strides[i];
+                if (i + 1 < N) {
+                    num_rows *= extent[i];
+                }
+            }
+            begin_rows();
+        }
+
+        void begin_rows() {
+            local.fill(0);
+            row_ptr = data + block_offset;
+            row_id = 0;
+        }
+
+        bool has_row() const {
+            return row_id < num_rows;
+        }
+
+        void next_row() {
+            row_id++;
+            for (int i = N - 2; i >= 0; i--) {
+                row_ptr += strides[i];
+                if (++local[i] < extent[i]) {
+                    return;
+                }
+                row_ptr -= extent[i] * strides[i];
+                local[i] = 0;
+            }
+        }
+
+        // first element of the current row
+        T *row() const {
+            return row_ptr;
+        }
+
+        size_t row_length() const {
+            return extent[N - 1];
+        }
+
+        size_t get_block_dimension(uint i) const {
+            return extent[i];
+        }
+
+        // index of the current row within the block, the last dimension is always 0
+        size_t get_local_index(uint i) const {
+            return local[i];
+        }
+
+        // index of the first element of the current row within the array
+        size_t get_global_index(uint i) const {
+            return start[i] + local[i];
+        }
+
+        /**
+         * first element of the row back[0..N-2] rows before the current one (back[N-1] is not used),
+         * or nullptr if that row is outside the array
+         */
+        const T *prev_row(const std::array<uint, N> &back) const {
+            const T *p = row_ptr;
+            for (uint i = 0; i + 1 < N; i++) {
+                if (back[i] > start[i] + local[i]) {
+                    return nullptr;
+                }
+                p -= back[i] * strides[i];
+            }
+            return p;
+        }
+
+    private:
+        T *data;
+        std::array<size_t, N> dims;
+        std::array<size_t, N> strides;
+        size_t block_size;
+        std::array<size_t, N> start{};
+        std::array<size_t, N> extent{};
+        std::array<size_t, N> local{};
+        size_t block_offset = 0;
+        size_t num_rows = 0;
+        size_t row_id = 0;
+        T *row_ptr = nullptr;
+    };
+
+    /**
+     * Terms of a Lorenzo prediction that are not on the predicted row, see PredictorInterface::predict_row.
+     * Term t of element i is coeffs[t] * rows[t][i - first[t]] for i >= first[t], and 0 (outside the array) before.
+     */
+    template<class T>
+    struct RowStencil {
+        static const int MAX_TERMS = 24;// 3D second order
+        int count = 0;
+        const T *rows[MAX_TERMS];
+        size_t first[MAX_TERMS];
+        T coeffs[MAX_TERMS];
+
+        // adds the terms of element i to p one by one, in the order of the element-wise predictor
+        inline T add_terms(T p, size_t i) const {
+            for (int t = 0; t < count; t++) {
+                if (i >= first[t]) {
+                    p += coeffs[t] * rows[t][i - first[t]];
+                }
+            }
+            return p;
+        }
+    };
+
+}
+
+#endif
@@ -154,7 +154,7 @@ namespace QoZ {
         b[7] = (unsigned char) (num);
     }
 
-    std::string floatToBinary(float f) {
+    inline std::string floatToBinary(float f) {
         lfloat u;
         u.value = f;
         std::string str(32, '0');
@@ -191,7 +191,7 @@ namespace QoZ {
         }
     }
 
-    std::vector<uchar> LeadingBitsEncode(float pre, float data) {
+    inline std::vector<uchar> LeadingBitsEncode(float pre, float data) {
         lfloat lfBuf_pre;
         lfloat lfBuf_cur;
 
@@ -219,7 +219,7 @@ namespace QoZ {
         return bytes;
     }
 
-    float LeadingBitsDecode(float pre, std::vector<uchar> bytes) {
+    inline float LeadingBitsDecode(float pre, std::vector<uchar> bytes) {
         lfloat lfBuf_pre;
         lfloat lfBuf_cur;
 
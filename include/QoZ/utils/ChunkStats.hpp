@@ -0,0 +1,247 @@
+#ifndef SZ_CHUNK_STATS_HPP
+#define SZ_CHUNK_STATS_HPP
+
+#include "QoZ/def.hpp"
+#include "QoZ/utils/MemoryUtil.hpp"
+#include "QoZ/utils/Container.hpp"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+/*
+ * Per-chunk summary statistics recorded while the original data is compressed.
+ * They are kept in a sidecar buffer next to the container so that range/threshold queries and
+ * chunk pruning can be answered without reading the compressed payloads.
+ *
+ * min/max/sum/sumSquares/histogram describe the ORIGINAL values. Since every decompressed value d
+ * satisfies |d - x| <= absErrorBound, the query results are widened by the error bound whenever they
+ * are meant to describe decompressed data.
+ */
+
+namespace QoZ {
+
+    constexpr uint32_t STATS_MAGIC = 0x53746f51; // "QoSt"
+
+    struct ChunkStats {
+        uint64_t start[CONTAINER_MAX_DIM] = {0, 0, 0, 0};
+        uint64_t extent[CONTAINER_MAX_DIM] = {1, 1, 1, 1};
+        double min = std::numeric_limits<double>::max();
+        double max = std::numeric_limits<double>::lowest();
+        double sum = 0;
+        double sumSquares = 0;
+        uint64_t count = 0;
+        std::vector<uint32_t> histogram;
+    };
+
+    struct StatsSummary {
+        double min = std::numeric_limits<double>::max();//lower bound of every value in the region
+        double max = std::numeric_limits<double>::lowest();//upper bound of every value in the region
+        double sum = 0;//over the chunks fully covered by the region
+        double sumSquares = 0;
+        size_t count = 0;
+        double meanLower = 0;//bounds of the decompressed mean over the fully covered chunks
+        double meanUpper = 0;
+        std::vector<size_t> histogram;//over the fully covered chunks
+        bool exact = true;//false if the region cuts through chunks, then only min/max are guaranteed
+    };
+
+    class StatsIndex {
+    public:
+        StatsIndex() = default;
+
+        StatsIndex(uint N, double globalMin, double globalMax, double absErrorBound, uint nBins = 16) :
+                N(N), globalMin(globalMin), globalMax(globalMax), absErrorBound(absErrorBound), nBins(nBins) {}
+
+        void resize(size_t nChunks) {
+            chunks.resize(nChunks);
+        }
+
+        //fills the statistics of chunk c from its packed data
+        template<class T>
+        void record(size_t c, const ChunkEntry &entry, const T *data, size_t num) {
+            ChunkStats &s = chunks[c];
+            std::copy(entry.start, entry.start + CONTAINER_MAX_DIM, s.start);
+            std::copy(entry.extent, entry.extent + CONTAINER_MAX_DIM, s.extent);
+            s.histogram.assign(nBins, 0);
+            double binWidth = (globalMax - globalMin) / nBins;
+            double mn = std::numeric_limits<double>::max(), mx = std::numeric_limits<double>::lowest();
+            double sum = 0, sumSquares = 0;
+            for (size_t i = 0; i < num; i++) {
+                double v = data[i];
+                mn = std::min(mn, v);
+                mx = std::max(mx, v);
+                sum += v;
+                sumSquares += v * v;
+                s.histogram[bin(v, binWidth)]++;
+            }
+            s.min = mn;
+            s.max = mx;
+            s.sum = sum;
+            s.sumSquares = sumSquares;
+            s.count = num;
+        }
+
+        size_t size_est() const {
+            return header_size() + chunks.size() * chunk_size(nBins);
+        }
+
+        void save(uchar *&c) const {
+            write(STATS_MAGIC, c);
+            write(N, c);
+            write(nBins, c);
+            write(globalMin, c);
+            write(globalMax, c);
+            write(absErrorBound, c);
+            write(chunks.size(), c);
+            for (auto &s: chunks) {
+                write(s.start, CONTAINER_MAX_DIM, c);
+                write(s.extent, CONTAINER_MAX_DIM, c);
+                write(s.min, c);
+                write(s.max, c);
+                write(s.sum, c);
+                write(s.sumSquares, c);
+                write(s.count, c);
+                write(s.histogram.data(), nBins, c);
+            }
+        }
+
+        bool load(const uchar *&c, size_t remaining_length) {
+            uint32_t magic;
+            if (remaining_length < header_size())
+                return false;
+            read(magic, c);
+            if (magic != STATS_MAGIC)
+                return false;
+            read(N, c);
+            read(nBins, c);
+            read(globalMin, c);
+            read(globalMax, c);
+            read(absErrorBound, c);
+            size_t nChunks;
+            read(nChunks, c);
+            //check the counts against the buffer before anything is allocated from them
+            remaining_length -= header_size();
+            if (N == 0 || N > CONTAINER_MAX_DIM || nBins == 0 || nBins > remaining_length / sizeof(uint32_t) ||
+                nChunks > remaining_length / chunk_size(nBins))
+                return false;
+            chunks.resize(nChunks);
+            for (auto &s: chunks) {
+                read(s.start, CONTAINER_MAX_DIM, c);
+                read(s.extent, CONTAINER_MAX_DIM, c);
+                read(s.min, c);
+                read(s.max, c);
+                read(s.sum, c);
+                read(s.sumSquares, c);
+                read(s.count, c);
+                s.histogram.resize(nBins);
+                read(s.histogram.data(), nBins, c);
+            }
+            return true;
+        }
+
+        /*
+         * Summary of the region [lo, hi).
+         * decompressed=true widens the results by the error bound so they hold for the decompressed field.
+         */
+        StatsSummary query(const std::vector<size_t> &lo, const std::vector<size_t> &hi, bool decompressed = true) const {
+            StatsSummary r;
+            r.histogram.assign(nBins, 0);
+            double eb = decompressed ? absErrorBound : 0;
+            for (auto &s: chunks) {
+                int cover = coverage(s, lo, hi);
+                if (cover == 0)
+                    continue;
+                r.min = std::min(r.min, s.min - eb);
+                r.max = std::max(r.max, s.max + eb);
+                if (cover == 2) {
+                    r.sum += s.sum;
+                    r.sumSquares += s.sumSquares;
+                    r.count += s.count;
+                    for (uint b = 0; b < nBins; b++)
+                        r.histogram[b] += s.histogram[b];
+                } else {
+                    r.exact = false;
+                }
+            }
+            if (r.count > 0) {
+                double mean = r.sum / r.count;
+                r.meanLower = mean - eb;
+                r.meanUpper = mean + eb;
+            }
+            return r;
+        }
+
+        StatsSummary query() const {
+            std::vector<size_t> lo(N, 0), hi(N, std::numeric_limits<size_t>::max());
+            return query(lo, hi);
+        }
+
+        /*
+         * Chunks whose decompressed values may exceed (above=true) or fall below (above=false) threshold.
+         * All other chunks can be skipped by threshold queries.
+         */
+        std::vector<size_t> prune(double threshold, bool above = true) const {
+            std::vector<size_t> ids;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                bool hit = above ? chunks[i].max + absErrorBound > threshold : chunks[i].min - absErrorBound < threshold;
+                if (hit)
+                    ids.push_back(i);
+            }
+            return ids;
+        }
+
+        //chunks in which every decompressed value is guaranteed to exceed (above=true) or fall below threshold
+        std::vector<size_t> fully_beyond(double threshold, bool above = true) const {
+            std::vector<size_t> ids;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                bool hit = above ? chunks[i].min - absErrorBound > threshold : chunks[i].max + absErrorBound < threshold;
+                if (hit)
+                    ids.push_back(i);
+            }
+            return ids;
+        }
+
+        double bin_lower_edge(uint b) const {
+            return globalMin + (globalMax - globalMin) / nBins * b;
+        }
+
+        uint N = 0;
+        double globalMin = 0;
+        double globalMax = 0;
+        double absErrorBound = 0;
+        uint nBins = 16;
+        std::vector<ChunkStats> chunks;
+
+    private:
+        static size_t header_size() {
+            return sizeof(uint32_t) + sizeof(uint) * 2 + sizeof(double) * 3 + sizeof(size_t);
+        }
+
+        static size_t chunk_size(uint nBins) {
+            return sizeof(uint64_t) * (2 * CONTAINER_MAX_DIM + 1) + sizeof(double) * 4 + sizeof(uint32_t) * (size_t) nBins;
+        }
+
+        uint bin(double v, double binWidth) const {
+            if (binWidth <= 0)
+                return 0;
+            long b = (long) ((v - globalMin) / binWidth);
+            return (uint) std::min(std::max(b, 0L), (long) nBins - 1);
+        }
+
+        //0: disjoint, 1: partial overlap, 2: chunk fully inside the region
+        int coverage(const ChunkStats &s, const std::vector<size_t> &lo, const std::vector<size_t> &hi) const {
+            bool inside = true;
+            for (uint d = 0; d < N; d++) {
+                size_t c_lo = s.start[d], c_hi = s.start[d] + s.extent[d];
+                if (c_lo >= hi[d] || c_hi <= lo[d])
+                    return 0;
+                if (c_lo < lo[d] || c_hi > hi[d])
+                    inside = false;
+            }
+            return inside ? 2 : 1;
+        }
+    };
+}
+
+#endif //SZ_CHUNK_STATS_HPP
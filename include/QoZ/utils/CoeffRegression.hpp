@@ -7,6 +7,7 @@
 #define SZ_MATRIX_OPERATION_HPP
 #include <iostream>
 #include<cstdio>
+#include <cmath>
 namespace QoZ {
 
     inline void matrixTranspose(double *a, double *b, size_t row, size_t column)
@@ -41,7 +42,7 @@ namespace QoZ {
          }
     }
 
-    int Gauss(double *a, double *b, size_t size, double** result)
+    inline int Gauss(double *a, double *b, size_t size, double** result)
     {
     	*result = new double[size];
         double A[12][12];//the matrix A storing elements
@@ -123,7 +124,7 @@ namespace QoZ {
     	return 0;
     } 
      
-    void printMatrix(double* matrix, int m, int n)
+    inline void printMatrix(double* matrix, int m, int n)
     {
     	for(int i = 0;i<m;i++)
     	{
@@ -135,40 +136,114 @@ namespace QoZ {
     	}
     }
 
-    void printVector(double* vector, int n)
+    inline void printVector(double* vector, int n)
     {
     	for(int i = 0;i<n;i++)
     		printf("%f\t", vector[i]);
     	printf("\n");		
     }
     
-    double* Regression(double * A,size_t numPoints,size_t numFeatures,double * b,int &status)
+    /**
+     * Streaming least squares: accumulates the normal equations A^T A x = A^T b one row at a time,
+     * so the design matrix is never materialized. Only the upper triangle of A^T A is accumulated.
+     * Accumulators filled by different threads (or over different parts of the data) are combined with merge.
+     * K is the capacity, the problem may use only the leading m <= K features.
+     */
+    template<size_t K>
+    class NormalEquations {
+    public:
+        NormalEquations() {
+            clear();
+        }
+
+        void clear() {
+            for (size_t i = 0; i < K; i++) {
+                atb[i] = 0;
+                for (size_t j = 0; j < K; j++)
+                    ata[i][j] = 0;
+            }
+            rows = 0;
+        }
+
+        inline void add(const double *x, double y, size_t m = K) {
+            for (size_t i = 0; i < m; i++) {
+                double xi = x[i];
+                atb[i] += xi * y;
+                for (size_t j = i; j < m; j++)
+                    ata[i][j] += xi * x[j];
+            }
+            rows++;
+        }
+
+        void merge(const NormalEquations &other) {
+            for (size_t i = 0; i < K; i++) {
+                atb[i] += other.atb[i];
+                for (size_t j = i; j < K; j++)
+                    ata[i][j] += other.ata[i][j];
+            }
+            rows += other.rows;
+        }
+
+        size_t size() const {
+            return rows;
+        }
+
+        /**
+         * Solves for the m coefficients by Cholesky factorization.
+         * Returns 1 (and leaves coeffs untouched) if the system is rank deficient, 0 otherwise.
+         */
+        int solve(double *coeffs, size_t m = K) const {
+            if (m == 0 || m > K || rows < m)
+                return 1;
+            double L[K][K], z[K];
+            for (size_t j = 0; j < m; j++) {
+                double d = ata[j][j];
+                for (size_t k = 0; k < j; k++)
+                    d -= L[j][k] * L[j][k];
+                //relative pivot threshold, a collinear feature leaves only rounding noise on the diagonal
+                if (!(d > 1e-10 * ata[j][j]))
+                    return 1;
+                L[j][j] = std::sqrt(d);
+                for (size_t i = j + 1; i < m; i++) {
+                    double s = ata[j][i];
+                    for (size_t k = 0; k < j; k++)
+                        s -= L[i][k] * L[j][k];
+                    L[i][j] = s / L[j][j];
+                }
+            }
+            for (size_t i = 0; i < m; i++) {
+                double s = atb[i];
+                for (size_t k = 0; k < i; k++)
+                    s -= L[i][k] * z[k];
+                z[i] = s / L[i][i];
+            }
+            for (size_t i = m; i-- > 0;) {
+                double s = z[i];
+                for (size_t k = i + 1; k < m; k++)
+                    s -= L[k][i] * coeffs[k];
+                coeffs[i] = s / L[i][i];
+            }
+            return 0;
+        }
+
+    private:
+        double ata[K][K];
+        double atb[K];
+        size_t rows;
+    };
+
+    //A is numPoints x numFeatures in row-major order, at most 12 features; the result is allocated with new[]
+    inline double* Regression(double * A,size_t numPoints,size_t numFeatures,double * b,int &status)
     {
-        
-        double* AT = new double[numPoints*numFeatures]; //transpose
-
-        matrixTranspose(A, AT, numPoints, numFeatures);
-        
-        double* c = new double [numFeatures];
-        matrixVecMul(AT, b, c, numFeatures, numPoints);
-        
-        double* ATA = new double [numFeatures*numFeatures];
-        matrixMul(AT,A, ATA, numFeatures, numFeatures, numPoints);
-        //printMatrix(ATA,numFeatures,numFeatures);
-        /*
-        printMatrix(ATA, interpSize, interpSize);
-        printf("-----------------------------------\n");
-        printVector(c, interpSize);
-        */
-        double* result = NULL;
-        status=Gauss(ATA, c, numFeatures, &result);
-        
-        //delete A(extractedMatrix);
-        delete []AT;
-        delete []ATA;  
-        //free(b);
-        delete []c;
-        
+        double* result = new double[numFeatures];
+        if (numFeatures > 12) {
+            status = 1;
+            return result;
+        }
+        NormalEquations<12> ne;
+        for (size_t i = 0; i < numPoints; i++)
+            ne.add(A + i * numFeatures, b[i], numFeatures);
+        status = ne.solve(result, numFeatures);
         return result;
     }
 }
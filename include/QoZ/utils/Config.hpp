@@ -8,6 +8,7 @@
 #include <iostream>
 #include <vector>
 #include <numeric>
+#include <stdexcept>
 #include "QoZ/def.hpp"
 #include "MemoryUtil.hpp"
 #include "QoZ/utils/inih/INIReader.h"
@@ -19,15 +20,21 @@ namespace QoZ {
 
 
     enum EB {
-        EB_ABS, EB_REL, EB_PSNR, EB_L2NORM, EB_ABS_AND_REL, EB_ABS_OR_REL
+        EB_ABS, EB_REL, EB_PSNR, EB_L2NORM, EB_ABS_AND_REL, EB_ABS_OR_REL, EB_BITRATE
     };
-    constexpr const char *EB_STR[] = {"ABS", "REL", "PSNR", "NORM", "ABS_AND_REL", "ABS_OR_REL"};
-    constexpr EB EB_OPTIONS[] = {EB_ABS, EB_REL, EB_PSNR, EB_L2NORM, EB_ABS_AND_REL, EB_ABS_OR_REL};
+    constexpr const char *EB_STR[] = {"ABS", "REL", "PSNR", "NORM", "ABS_AND_REL", "ABS_OR_REL", "BITRATE"};
+    constexpr EB EB_OPTIONS[] = {EB_ABS, EB_REL, EB_PSNR, EB_L2NORM, EB_ABS_AND_REL, EB_ABS_OR_REL, EB_BITRATE};
+
+    //layout version of the compressed stream, saved as the last field of the config
+    //0: streams written before the field existed, with or without constantField and nonFiniteSize
+    //1: the fast Lorenzo/regression frontend serves 1D to 4D and stores its slab height
+    //2: the selection of the composed Lorenzo/regression predictor is packed instead of Huffman coded
+    constexpr uint8_t STREAM_VERSION = 2;
 
     enum ALGO {
         ALGO_LORENZO_REG, ALGO_INTERP_LORENZO, ALGO_INTERP,ALGO_INTERP_BLOCKED
     };
-    const char *ALGO_STR[] = {"ALGO_LORENZO_REG", "ALGO_INTERP_LORENZO", "ALGO_INTERP","ALGO_INTERP_BLOCKED"};
+    constexpr const char *ALGO_STR[] = {"ALGO_LORENZO_REG", "ALGO_INTERP_LORENZO", "ALGO_INTERP","ALGO_INTERP_BLOCKED"};
     constexpr const ALGO ALGO_OPTIONS[] = {ALGO_LORENZO_REG, ALGO_INTERP_LORENZO, ALGO_INTERP, ALGO_INTERP_BLOCKED};
 
     enum INTERP_ALGO {
@@ -55,7 +62,7 @@ namespace QoZ {
  
     };
 
-    void print_meta(Interp_Meta meta){
+    inline void print_meta(Interp_Meta meta){
         std::cout<<(int)meta.interpAlgo<<" "<<(int)meta.interpParadigm<<" "<<(int)meta.cubicSplineType<<" "<<(int)meta.interpDirection<<" "<<(int)meta.adjInterp<<std::endl;
 
     }
@@ -111,8 +118,7 @@ namespace QoZ {
             INIReader cfg(cfgpath);
 
             if (cfg.ParseError() != 0) {
-                std::cout << "Can't load cfg file  <<" << cfgpath << std::endl;
-                exit(0);
+                throw std::runtime_error("Can't load cfg file " + cfgpath);
             } else {
                 //std::cout << "Load cfg from " << cfgpath << std::endl;
             }
@@ -141,6 +147,8 @@ namespace QoZ {
                 errorBoundMode = EB_ABS_AND_REL;
             } else if (ebModeStr == EB_STR[EB_ABS_OR_REL]) {
                 errorBoundMode = EB_ABS_OR_REL;
+            } else if (ebModeStr == EB_STR[EB_BITRATE]) {
+                errorBoundMode = EB_BITRATE;
             }
             auto tuningTargetStr = cfg.Get("GlobalSettings", "tuningTarget", "");
             if (tuningTargetStr == TUNING_TARGET_STR[TUNING_TARGET_RD]) {
@@ -161,6 +169,8 @@ namespace QoZ {
             relErrorBound = cfg.GetReal("GlobalSettings", "RelErrorBound", relErrorBound);
             psnrErrorBound = cfg.GetReal("GlobalSettings", "PSNRErrorBound", psnrErrorBound);
             l2normErrorBound = cfg.GetReal("GlobalSettings", "L2NormErrorBound", l2normErrorBound);
+            targetBitrate = cfg.GetReal("GlobalSettings", "TargetBitrate", targetBitrate);
+            bitrateTolerance = cfg.GetReal("GlobalSettings", "BitrateTolerance", bitrateTolerance);
             //prewave_absErrorBound= cfg.GetReal("GlobalSettings", "prewave_absErrorBound", prewave_absErrorBound);
             alpha = cfg.GetReal("AlgoSettings", "alpha", alpha);
             beta = cfg.GetReal("AlgoSettings", "beta", beta);
@@ -221,6 +231,7 @@ namespace QoZ {
             interpBlockSize = cfg.GetInteger("AlgoSettings", "InterpBlockSize", interpBlockSize);
             blockSize = cfg.GetInteger("AlgoSettings", "BlockSize", blockSize);
             quantbinCnt = cfg.GetInteger("AlgoSettings", "QuantizationBinTotal", quantbinCnt);
+            adaptiveQuantBins = cfg.GetBoolean("AlgoSettings", "adaptiveQuantBins", adaptiveQuantBins);
             maxStep=cfg.GetInteger("AlgoSettings", "maxStep", maxStep);
             sampleBlockSize=cfg.GetInteger("AlgoSettings", "sampleBlockSize", sampleBlockSize);
             levelwisePredictionSelection=cfg.GetInteger("AlgoSettings", "levelwisePredictionSelection", levelwisePredictionSelection);
@@ -270,6 +281,9 @@ namespace QoZ {
             naturalSpline = cfg.GetInteger("AlgoSettings", "naturalSpline", naturalSpline );
             adaptiveMultiDimStride = cfg.GetInteger("AlgoSettings", "adaptiveMultiDimStride", adaptiveMultiDimStride);
             fullAdjacentInterp = cfg.GetInteger("AlgoSettings", "fullAdjacentInterp", fullAdjacentInterp);
+            batchTuningPatches = cfg.GetInteger("AlgoSettings", "batchTuningPatches", batchTuningPatches);
+            batchDictSize = cfg.GetInteger("AlgoSettings", "batchDictSize", batchDictSize);
+            sperrTileSize = cfg.GetInteger("AlgoSettings", "sperrTileSize", sperrTileSize);
            // minAnchorLevel = cfg.GetInteger("AlgoSettings", "minAnchorLevel", minAnchorLevel);
 
 
@@ -355,11 +369,17 @@ namespace QoZ {
                 write(meta.data(),meta_size,c);
                
             }
+            write(constantField, c);
+            write(nonFiniteSize, c);
+            streamVersion = STREAM_VERSION;
+            write(streamVersion, c);
 
             
         };
 
-        void load(const unsigned char *&c) {
+        //end: end of the saved config, older streams end before the fields appended since.
+        //Without it the current layout is read.
+        void load(const unsigned char *&c, const unsigned char *end = nullptr) {
             read(N, c);
             dims.resize(N);
             read(dims.data(), N, c);
@@ -442,6 +462,17 @@ namespace QoZ {
                 //std::copy(temp_meta.begin(),temp_meta.end(),meta.begin());
                 //std::cout<<"dwad3"<<std::endl;
             }
+            //appended fields, absent from the streams written before them
+            constantField = false;
+            nonFiniteSize = 0;
+            streamVersion = 0;
+            if (end == nullptr || c < end) {
+                read(constantField, c);
+                read(nonFiniteSize, c);
+            }
+            if (end == nullptr || c < end) {
+                read(streamVersion, c);
+            }
         }
 
         void print() {
@@ -458,6 +489,8 @@ namespace QoZ {
         double relErrorBound=-1.0;
         double psnrErrorBound;
         double l2normErrorBound;
+        double targetBitrate=0;//bits per value for EB_BITRATE, resolved to an absolute bound before compression
+        double bitrateTolerance=0.05;//relative deviation from targetBitrate that needs no corrective pass
         //double prewave_absErrorBound;
         double rng=-1;
         double alpha=-1;
@@ -493,6 +526,7 @@ namespace QoZ {
         size_t maxStep=0;
         int interpBlockSize = 32;
         int quantbinCnt = 65536;
+        bool adaptiveQuantBins = true;//interpolation picks the number of bins from a sample, up to quantbinCnt
         int blockSize;
         //int exhaustiveTuning=0;
         int testLorenzo=0;
@@ -578,6 +612,12 @@ namespace QoZ {
         bool fineGrainTuning=false;
         bool SRNet=true;
         std::string ckpt_path="";
+        int batchTuningPatches=4;//sample patches per level used to select the predictor of a batch
+        size_t batchDictSize=112640;//capacity of the zstd dictionary trained for a batch, 0 to disable
+        bool constantField=false;//the stream holds one value for the whole field, see SZ_compress_impl
+        size_t nonFiniteSize=0;//bytes of the NaN/Inf exception list at the end of the compressed data
+        uint8_t streamVersion=STREAM_VERSION;//layout version of the loaded stream, see STREAM_VERSION
+        size_t sperrTileSize=512;//edge of the tiles 2D SPERR compresses in parallel, recorded in the SPERR stream
         //bool profilingFix=true;//only for test
 
        // double anchorThreshold=0.0;
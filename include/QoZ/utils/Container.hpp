@@ -0,0 +1,303 @@
+#ifndef SZ_CONTAINER_HPP
+#define SZ_CONTAINER_HPP
+
+#include "QoZ/def.hpp"
+#include "QoZ/utils/MemoryUtil.hpp"
+#include <vector>
+#include <array>
+#include <numeric>
+#include <functional>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define XXH_PRIVATE_API
+#include "QoZ/zstd/xxhash.h"
+
+/*
+ * Chunk-indexed container for QoZ streams.
+ *
+ * Layout (all integers native-endian, same as the rest of the QoZ streams):
+ *   [ContainerHeader][ChunkEntry x nChunks][chunk payloads ...]
+ *
+ * The header has a fixed size and records the size and xxhash64 of the chunk table,
+ * so a reader can validate the whole index with one pread of
+ * sizeof(ContainerHeader) + nChunks * sizeof(ChunkEntry) bytes, and then seek to any chunk.
+ * Each chunk entry stores the absolute payload offset and size, the chunk origin and extent
+ * in the global array, the codec that produced the payload and the xxhash64 of the payload.
+ */
+
+namespace QoZ {
+
+    constexpr uint32_t CONTAINER_MAGIC = 0x5a6f5153; // "SQoZ"
+    constexpr uint16_t CONTAINER_VERSION = 1;
+    constexpr uint CONTAINER_MAX_DIM = 4;
+
+    enum CODEC {
+        CODEC_RAW, CODEC_QOZ
+    };
+    constexpr const char *CODEC_STR[] = {"CODEC_RAW", "CODEC_QOZ"};
+
+    enum DATA_TYPE {
+        DATA_TYPE_FLOAT, DATA_TYPE_DOUBLE, DATA_TYPE_OTHER
+    };
+
+    template<class T>
+    uint8_t data_type_id() {
+        if (std::is_same<T, float>::value)
+            return DATA_TYPE_FLOAT;
+        else if (std::is_same<T, double>::value)
+            return DATA_TYPE_DOUBLE;
+        return DATA_TYPE_OTHER;
+    }
+
+    struct ContainerHeader {
+        uint32_t magic = CONTAINER_MAGIC;
+        uint16_t version = CONTAINER_VERSION;
+        uint8_t dataType = DATA_TYPE_OTHER;
+        uint8_t N = 0;
+        uint64_t dims[CONTAINER_MAX_DIM] = {0, 0, 0, 0};
+        uint64_t chunkDims[CONTAINER_MAX_DIM] = {0, 0, 0, 0};
+        uint64_t nChunks = 0;
+        uint64_t indexSize = 0;//bytes of the chunk table following the header
+        uint64_t indexHash = 0;//xxhash64 of the chunk table
+        uint64_t totalSize = 0;//size of the whole container in bytes
+    };
+
+    struct ChunkEntry {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint64_t start[CONTAINER_MAX_DIM] = {0, 0, 0, 0};
+        uint64_t extent[CONTAINER_MAX_DIM] = {1, 1, 1, 1};
+        uint64_t checksum = 0;
+        uint8_t codec = CODEC_QOZ;
+        uint8_t reserved[7] = {0, 0, 0, 0, 0, 0, 0};
+
+        size_t num() const {
+            size_t n = 1;
+            for (uint i = 0; i < CONTAINER_MAX_DIM; i++)
+                n *= extent[i];
+            return n;
+        }
+    };
+
+    inline uint64_t chunk_hash(const void *data, size_t size) {
+        return XXH64(data, size, 0);
+    }
+
+    struct ContainerIndex {
+        ContainerHeader header;
+        std::vector<ChunkEntry> chunks;
+
+        std::vector<size_t> dims() const {
+            return std::vector<size_t>(header.dims, header.dims + header.N);
+        }
+
+        size_t num() const {
+            size_t n = 1;
+            for (uint i = 0; i < header.N; i++)
+                n *= header.dims[i];
+            return n;
+        }
+
+        size_t index_bytes() const {
+            return sizeof(ContainerHeader) + header.indexSize;
+        }
+
+        //parse and validate header and chunk table from the beginning of a container buffer
+        bool load(const uchar *data, size_t size) {
+            if (size < sizeof(ContainerHeader))
+                return false;
+            memcpy(&header, data, sizeof(ContainerHeader));
+            if (header.magic != CONTAINER_MAGIC || header.version > CONTAINER_VERSION ||
+                header.N == 0 || header.N > CONTAINER_MAX_DIM || !valid_index_size(header) ||
+                size - sizeof(ContainerHeader) < header.indexSize) {
+                return false;
+            }
+            const uchar *index_pos = data + sizeof(ContainerHeader);
+            if (chunk_hash(index_pos, header.indexSize) != header.indexHash)
+                return false;
+            chunks.resize(header.nChunks);
+            read(chunks.data(), chunks.size(), index_pos);
+            for (auto &c: chunks) {
+                if (!valid_chunk(c)) {
+                    chunks.clear();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //read header and chunk table of a container file with pread, without touching the payloads
+        bool load(int fd, off_t base = 0) {
+            ContainerHeader h;
+            if (pread(fd, &h, sizeof(h), base) != (ssize_t) sizeof(h) || h.magic != CONTAINER_MAGIC ||
+                !valid_index_size(h))
+                return false;
+            //the chunk table can not be larger than the file, check before allocating it
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_size < base ||
+                (uint64_t) (st.st_size - base) < sizeof(h) || (uint64_t) (st.st_size - base) - sizeof(h) < h.indexSize)
+                return false;
+            std::vector<uchar> buf(sizeof(h) + h.indexSize);
+            if (pread(fd, buf.data(), buf.size(), base) != (ssize_t) buf.size())
+                return false;
+            return load(buf.data(), buf.size());
+        }
+
+        //checks the payload of chunk i against its checksum, containerSize is the size of the buffer at container
+        bool verify_chunk(const uchar *container, size_t containerSize, size_t i) const {
+            const ChunkEntry &c = chunks[i];
+            if (c.offset > containerSize || c.size > containerSize - c.offset)
+                return false;
+            return chunk_hash(container + c.offset, c.size) == c.checksum;
+        }
+
+    private:
+        static bool valid_index_size(const ContainerHeader &h) {
+            return h.nChunks <= std::numeric_limits<uint64_t>::max() / sizeof(ChunkEntry) &&
+                   h.indexSize == h.nChunks * sizeof(ChunkEntry);
+        }
+
+        //the payload must lie behind the chunk table and inside the container, the box inside the array
+        bool valid_chunk(const ChunkEntry &c) const {
+            if (c.offset < index_bytes() || c.offset > header.totalSize || c.size > header.totalSize - c.offset)
+                return false;
+            for (uint d = 0; d < CONTAINER_MAX_DIM; d++) {
+                if (d < header.N) {
+                    if (c.extent[d] == 0 || c.start[d] > header.dims[d] || c.extent[d] > header.dims[d] - c.start[d])
+                        return false;
+                } else if (c.start[d] != 0 || c.extent[d] != 1) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+    public:
+        //returns the ids of the chunks overlapping the region [lo, hi)
+        std::vector<size_t> chunks_in_region(const std::vector<size_t> &lo, const std::vector<size_t> &hi) const {
+            std::vector<size_t> ids;
+            for (size_t i = 0; i < chunks.size(); i++) {
+                bool overlap = true;
+                for (uint d = 0; d < header.N && overlap; d++) {
+                    overlap = chunks[i].start[d] < hi[d] && lo[d] < chunks[i].start[d] + chunks[i].extent[d];
+                }
+                if (overlap)
+                    ids.push_back(i);
+            }
+            return ids;
+        }
+    };
+
+    //Assembles chunk payloads into a container. Payloads are appended in order of add_chunk.
+    class ContainerWriter {
+    public:
+        ContainerWriter(uint8_t dataType, const std::vector<size_t> &dims, const std::vector<size_t> &chunkDims) {
+            header.dataType = dataType;
+            header.N = dims.size();
+            for (uint i = 0; i < header.N; i++) {
+                header.dims[i] = dims[i];
+                header.chunkDims[i] = chunkDims[i];
+            }
+        }
+
+        void add_chunk(ChunkEntry entry, const uchar *payload) {
+            entry.checksum = chunk_hash(payload, entry.size);
+            chunks.push_back(entry);
+            payloads.push_back(payload);
+        }
+
+        uchar *save(size_t &outSize) {
+            header.nChunks = chunks.size();
+            header.indexSize = chunks.size() * sizeof(ChunkEntry);
+            size_t offset = sizeof(ContainerHeader) + header.indexSize;
+            for (auto &c: chunks) {
+                c.offset = offset;
+                offset += c.size;
+            }
+            header.totalSize = offset;
+            header.indexHash = chunk_hash(chunks.data(), header.indexSize);
+
+            uchar *buffer = new uchar[header.totalSize];
+            uchar *buffer_pos = buffer;
+            write(header, buffer_pos);
+            write(chunks.data(), chunks.size(), buffer_pos);
+            for (size_t i = 0; i < chunks.size(); i++) {
+                write(payloads[i], chunks[i].size, buffer_pos);
+            }
+            outSize = buffer_pos - buffer;
+            return buffer;
+        }
+
+    private:
+        ContainerHeader header;
+        std::vector<ChunkEntry> chunks;
+        std::vector<const uchar *> payloads;
+    };
+
+    inline bool is_container(const char *data, size_t size) {
+        uint32_t magic;
+        if (size < sizeof(ContainerHeader))
+            return false;
+        memcpy(&magic, data, sizeof(magic));
+        return magic == CONTAINER_MAGIC;
+    }
+
+    //splits dims into a regular grid of chunks, chunkDims[i]==0 means the whole dimension
+    inline std::vector<ChunkEntry> make_chunk_grid(const std::vector<size_t> &dims, std::vector<size_t> &chunkDims) {
+        uint N = dims.size();
+        chunkDims.resize(N, 0);
+        std::vector<size_t> counts(N);
+        for (uint i = 0; i < N; i++) {
+            if (chunkDims[i] == 0 || chunkDims[i] > dims[i])
+                chunkDims[i] = dims[i];
+            counts[i] = (dims[i] + chunkDims[i] - 1) / chunkDims[i];
+        }
+        size_t nChunks = std::accumulate(counts.begin(), counts.end(), (size_t) 1, std::multiplies<size_t>());
+        std::vector<ChunkEntry> grid(nChunks);
+        for (size_t c = 0; c < nChunks; c++) {
+            size_t rem = c;
+            for (int i = N - 1; i >= 0; i--) {
+                size_t id = rem % counts[i];
+                rem /= counts[i];
+                grid[c].start[i] = id * chunkDims[i];
+                grid[c].extent[i] = std::min(chunkDims[i], dims[i] - grid[c].start[i]);
+            }
+        }
+        return grid;
+    }
+
+    /*
+     * Copies a box between a global row-major array of shape dims and a packed buffer of shape extent.
+     * toPacked=true gathers global->packed, otherwise scatters packed->global.
+     */
+    template<class T>
+    void copy_chunk(T *global, const std::vector<size_t> &dims, T *packed,
+                    const uint64_t *start, const uint64_t *extent, bool toPacked) {
+        uint N = dims.size();
+        std::array<size_t, CONTAINER_MAX_DIM> gdims{1, 1, 1, 1}, st{0, 0, 0, 0}, ex{1, 1, 1, 1};
+        for (uint i = 0; i < N; i++) {
+            gdims[CONTAINER_MAX_DIM - N + i] = dims[i];
+            st[CONTAINER_MAX_DIM - N + i] = start[i];
+            ex[CONTAINER_MAX_DIM - N + i] = extent[i];
+        }
+        size_t row = ex[3];
+        for (size_t i = 0; i < ex[0]; i++) {
+            for (size_t j = 0; j < ex[1]; j++) {
+                for (size_t k = 0; k < ex[2]; k++) {
+                    size_t g = (((st[0] + i) * gdims[1] + st[1] + j) * gdims[2] + st[2] + k) * gdims[3] + st[3];
+                    size_t p = ((i * ex[1] + j) * ex[2] + k) * row;
+                    if (toPacked)
+                        memcpy(packed + p, global + g, row * sizeof(T));
+                    else
+                        memcpy(global + g, packed + p, row * sizeof(T));
+                }
+            }
+        }
+    }
+}
+
+#endif //SZ_CONTAINER_HPP
@@ -11,15 +11,243 @@
 #include <cassert>
 #include <random>
 #include <sstream>
+#include <stdexcept>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace QoZ {
 
+    //"-" stands for stdin / stdout in all path arguments
+    inline bool is_std_stream(const char *path) {
+        return path != nullptr && path[0] == '-' && path[1] == 0;
+    }
+
+    /**
+     * File descriptor that "-" writes to. Defaults to stdout; after reserve_stdout() the original
+     * stdout is kept for data only and fd 1 is pointed to stderr, so log output cannot corrupt a piped stream.
+     */
+    inline int &stdout_fd() {
+        static int fd = STDOUT_FILENO;
+        return fd;
+    }
+
+    inline void reserve_stdout() {
+        if (stdout_fd() != STDOUT_FILENO)
+            return;
+        fflush(stdout);
+        stdout_fd() = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+
+    /**
+     * Read-only view of a whole input file. Regular files are memory-mapped with a sequential
+     * read-ahead hint, so the data is paged in while it is consumed instead of copied up front.
+     * "-" and files that cannot be mapped (pipes) are read into an owned buffer.
+     */
+    class MappedFile {
+    public:
+        MappedFile(const char *file) {
+            int fd = is_std_stream(file) ? STDIN_FILENO : open(file, O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error(std::string("Couldn't open the file ") + file + ": " + strerror(errno));
+            }
+            struct stat st;
+            if (fd != STDIN_FILENO && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+                void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    madvise(p, st.st_size, MADV_SEQUENTIAL);
+                    madvise(p, st.st_size, MADV_WILLNEED);
+                    mapped = p;
+                    length = st.st_size;
+                }
+            }
+            if (mapped == nullptr) {
+                char buf[1 << 16];
+                ssize_t n;
+                while ((n = ::read(fd, buf, sizeof(buf))) > 0)
+                    owned.insert(owned.end(), buf, buf + n);
+                length = owned.size();
+            }
+            if (fd != STDIN_FILENO)
+                close(fd);
+        }
+
+        ~MappedFile() {
+            if (mapped != nullptr)
+                munmap(mapped, length);
+        }
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        template<class Type = char>
+        const Type *data() const {
+            return reinterpret_cast<const Type *>(mapped != nullptr ? (const char *) mapped : owned.data());
+        }
+
+        size_t size() const {
+            return length;
+        }
+
+    private:
+        void *mapped = nullptr;
+        size_t length = 0;
+        std::vector<char> owned;
+    };
+
+    /**
+     * Buffered writer whose write(2) calls run on a background thread, so formatting or compression
+     * on the calling thread overlaps with the disk / pipe. At most maxPending full buffers are queued.
+     */
+    class AsyncWriter {
+    public:
+        explicit AsyncWriter(const char *file, size_t bufferSize = 4 << 20, size_t maxPending = 4) :
+                bufferSize(bufferSize), maxPending(maxPending) {
+            fd = is_std_stream(file) ? stdout_fd() : open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throw std::runtime_error(std::string("Unable to open file for output ") + file + ": " + strerror(errno));
+            }
+            current.reserve(bufferSize);
+            worker = std::thread(&AsyncWriter::run, this);
+        }
+
+        ~AsyncWriter() {
+            close();
+        }
+
+        AsyncWriter(const AsyncWriter &) = delete;
+
+        AsyncWriter &operator=(const AsyncWriter &) = delete;
+
+        void write(const void *data, size_t size) {
+            const char *p = (const char *) data;
+            while (size > 0) {
+                size_t n = std::min(size, bufferSize - current.size());
+                current.insert(current.end(), p, p + n);
+                p += n;
+                size -= n;
+                if (current.size() == bufferSize)
+                    flush();
+            }
+        }
+
+        //hands the current buffer to the writer thread
+        void flush() {
+            if (current.empty())
+                return;
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return queue.size() < maxPending; });
+            queue.push_back(std::move(current));
+            cv.notify_all();
+            current = std::vector<char>();
+            current.reserve(bufferSize);
+        }
+
+        //flushes everything and waits for the writes to finish, returns false on a write error
+        bool close() {
+            if (!worker.joinable())
+                return ok;
+            flush();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                done = true;
+                cv.notify_all();
+            }
+            worker.join();
+            if (fd != stdout_fd())
+                ::close(fd);
+            return ok;
+        }
+
+    private:
+        void run() {
+            while (true) {
+                std::vector<char> buf;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cv.wait(lock, [this] { return done or !queue.empty(); });
+                    if (queue.empty())
+                        return;
+                    buf = std::move(queue.front());
+                    queue.pop_front();
+                    cv.notify_all();
+                }
+                size_t off = 0;
+                while (off < buf.size()) {
+                    ssize_t n = ::write(fd, buf.data() + off, buf.size() - off);
+                    if (n <= 0) {
+                        ok = false;
+                        break;
+                    }
+                    off += n;
+                }
+            }
+        }
+
+        int fd;
+        size_t bufferSize, maxPending;
+        std::vector<char> current;
+        std::deque<std::vector<char>> queue;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::thread worker;
+        bool done = false;
+        bool ok = true;
+    };
+
+    //appends the text form of v followed by a newline, same format as std::ostream << v
+    template<typename Type>
+    inline char *format_value(char *p, char *end, Type v) {
+#if defined(__cpp_lib_to_chars)
+        if constexpr (std::is_floating_point<Type>::value) {
+            p = std::to_chars(p, end, v, std::chars_format::general, 6).ptr;
+        } else if constexpr (std::is_integral<Type>::value) {
+            p = std::to_chars(p, end, v).ptr;
+        } else
+#endif
+        {
+            std::ostringstream ss;
+            ss << v;
+            auto str = ss.str();
+            memcpy(p, str.data(), std::min<size_t>(str.size(), end - p));
+            p += std::min<size_t>(str.size(), end - p);
+        }
+        *p++ = '\n';
+        return p;
+    }
+
+    //writes one value per line through an AsyncWriter, formatting in blocks instead of flushing per value
+    template<typename Type>
+    bool writeTextFile(AsyncWriter &writer, const Type *data, size_t num_elements) {
+        const size_t block = 1 << 14;
+        std::vector<char> text(block * 40);
+        for (size_t i = 0; i < num_elements; i += block) {
+            char *p = text.data();
+            size_t n = std::min(block, num_elements - i);
+            for (size_t j = 0; j < n; j++)
+                p = format_value(p, text.data() + text.size() - 1, data[i + j]);
+            writer.write(text.data(), p - text.data());
+        }
+        return writer.close();
+    }
+
     template<typename Type>
     void readfile(const char *file, const size_t num, Type *data) {
         std::ifstream fin(file, std::ios::binary);
         if (!fin) {
-            std::cout << " Error, Couldn't find the file: " << file << "\n";
-            exit(0);
+            throw std::runtime_error(std::string("Couldn't open the file ") + file + ": " + strerror(errno));
         }
         fin.seekg(0, std::ios::end);
         const size_t num_elements = fin.tellg() / sizeof(Type);
@@ -33,8 +261,7 @@ namespace QoZ {
     std::unique_ptr<Type[]> readfile(const char *file, size_t &num) {
         std::ifstream fin(file, std::ios::binary);
         if (!fin) {
-            std::cout << " Error, Couldn't find the file: " << file << std::endl;
-            exit(0);
+            throw std::runtime_error(std::string("Couldn't open the file ") + file + ": " + strerror(errno));
         }
         fin.seekg(0, std::ios::end);
         const size_t num_elements = fin.tellg() / sizeof(Type);
@@ -56,15 +283,9 @@ namespace QoZ {
 
     template<typename Type>
     void writeTextFile(const char *file, Type *data, size_t num_elements) {
-        std::ofstream fout(file);
-        if (fout.is_open()) {
-            for (size_t i = 0; i < num_elements; i++) {
-                fout << data[i] << std::endl;
-            }
-            fout.close();
-        } else {
-            std::cout << "Error, unable to open file for output: " << file << std::endl;
-            exit(0);
+        AsyncWriter writer(file);
+        if (!writeTextFile(writer, data, num_elements)) {
+            throw std::runtime_error(std::string("Unable to write output file ") + file);
         }
     }
 
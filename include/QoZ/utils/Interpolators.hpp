@@ -4,10 +4,69 @@
 
 #ifndef SZ_INTERPOLATORS_HPP
 #define SZ_INTERPOLATORS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
 namespace QoZ {
+
+    /*
+     * Interpolation stencils as compile-time types: integer weights over a common denominator, all template
+     * arguments, so every weight is an immediate in the generated code.
+     * A predictor is evaluated exactly like the original integer-coefficient formula, left to right over its
+     * neighbours and then divided by the denominator, so predictions are bit-identical to streams written before
+     * the stencils. Power-of-two denominators of floating-point predictions are applied as a multiplication by
+     * their (exact) reciprocal, integer predictions keep the integer division.
+     * The neighbours are passed in the order of the original formula.
+     */
+    template<int Den, int... W>
+    struct Stencil {
+    };
+
+    template<class T, int Den, int W0, int... W, class... A>
+    inline T stencil_apply(Stencil<Den, W0, W...>, T first, A... v) {
+        static_assert(sizeof...(W) == sizeof...(A), "stencil size mismatch");
+        T r = (T) W0 * first;
+        ((r += (T) W * (T) v), ...);
+        if constexpr (std::is_floating_point<T>::value and (Den & (Den - 1)) == 0) {
+            return r * ((T) 1 / (T) Den);
+        } else {
+            return r / (T) Den;
+        }
+    }
+
+    namespace stencil {
+        using LINEAR = Stencil<2, 1, 1>;
+        using QUAD_1 = Stencil<8, 3, 6, -1>;
+        using QUAD_2 = Stencil<8, -1, 6, 3>;
+        using QUAD_3 = Stencil<8, 3, -10, 15>;
+        using QUAD_1_ADJ = Stencil<3, 1, 3, -1>;
+        using QUAD_2_ADJ = Stencil<3, -1, 3, 1>;
+        using QUAD_3_ADJ = Stencil<1, 3, -3, 1>;//over (c, b, a)
+        using AVE_3 = Stencil<3, 1, 1, 1>;
+        using AVE_4 = Stencil<4, 1, 1, 1, 1>;
+        using AVE_6 = Stencil<6, 1, 1, 1, 1, 1, 1>;
+        //cubicSplineType 0 is not-a-knot, 1 natural
+        using CUBIC_NOKNOT = Stencil<16, -1, 9, 9, -1>;
+        using CUBIC_NAT = Stencil<40, -3, 23, 23, -3>;
+        //cubic using the already reconstructed half-stride neighbours (6 and 5 points),
+        //the not-a-knot variants only use the inner neighbours
+        using CUBIC_ADJ_NOKNOT = Stencil<6, -1, 4, 4, -1>;
+        using CUBIC_ADJ_NAT = Stencil<62, 3, -18, 46, 46, -18, 3>;
+        using CUBIC_ADJ2_NOKNOT = Stencil<20, -4, 15, 10, -1>;
+        using CUBIC_ADJ2_NAT = Stencil<224, 12, -72, 181, 118, -15>;
+        using CUBIC_FRONT = Stencil<16, 5, 15, -5, 1>;
+        using CUBIC_FRONT_ADJ = Stencil<46, 17, 44, -18, 3>;
+        using CUBIC_FRONT_2 = Stencil<4, 1, 6, -4, 1>;
+        using CUBIC_BACK_1 = Stencil<16, 1, -5, 15, 5>;
+        using CUBIC_BACK_ADJ = Stencil<46, 3, -18, 44, 17>;
+        using CUBIC_BACK_2 = Stencil<16, -5, 21, -35, 35>;
+    }
+
     template<class T>
     inline T interp_linear(T a, T b) {
-        return (a + b) / 2;
+        return stencil_apply<T>(stencil::LINEAR(), a, b);
     }
 
     template<class T>
@@ -17,106 +76,90 @@ namespace QoZ {
 
     template<class T>
     inline T interp_quad_1(T a, T b, T c) {
-        return (3 * a + 6 * b - c) / 8;
+        return stencil_apply<T>(stencil::QUAD_1(), a, b, c);
     }
     template<class T>
     inline T interp_quad_1_adj(T a, T b, T c) {
-        return ( a + 3 * b - c) / 3;
+        return stencil_apply<T>(stencil::QUAD_1_ADJ(), a, b, c);
     }
 
     template<class T>
     inline T interp_quad_2(T a, T b, T c) {
-        return (-a + 6 * b + 3 * c) / 8;
+        return stencil_apply<T>(stencil::QUAD_2(), a, b, c);
     }
 
     template<class T>
     inline T interp_quad_2_adj(T a, T b, T c) {
-        return (-a + 3 * b +  c) / 3;
+        return stencil_apply<T>(stencil::QUAD_2_ADJ(), a, b, c);
     }
 
     template<class T>
     inline T interp_quad_3(T a, T b, T c) {
-        return (3 * a - 10 * b + 15 * c) / 8;
+        return stencil_apply<T>(stencil::QUAD_3(), a, b, c);
     }
 
     template<class T>
     inline T interp_quad_3_adj(T a, T b, T c) {
-        return 3 * c - 3 * b + a;
+        return stencil_apply<T>(stencil::QUAD_3_ADJ(), c, b, a);
     }
 
     template<class T>
-    inline T interp_cubic_1(T a, T b, T c, T d) {
-        return (-a + 9 * b + 9 * c - d) / 16;//noknot
-        //return -0.06368435202786181*a+0.5731591682507563*b+0.5731591682507563*c-0.06368435202786181*d;
-        //return (-3*a+23*b+23*c-3*d)/40;
+    inline T interp_cubic_1(T a, T b, T c, T d) {//noknot
+        return stencil_apply<T>(stencil::CUBIC_NOKNOT(), a, b, c, d);
     }
 
     template<class T>
-    inline T interp_cubic_2(T a, T b, T c, T d) {
-        return (-3 * a + 23 * b + 23 * c - 3 * d) / 40;//nat
+    inline T interp_cubic_2(T a, T b, T c, T d) {//nat
+        return stencil_apply<T>(stencil::CUBIC_NAT(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic(uint8_t cst, T a, T b, T c, T d){
-        if (cst==0)
-            return (-a + 9 * b + 9 * c - d) / 16;
-        else
-            return (-3 * a + 23 * b + 23 * c - 3 * d) / 40;
+        if (cst == 0)
+            return stencil_apply<T>(stencil::CUBIC_NOKNOT(), a, b, c, d);
+        return stencil_apply<T>(stencil::CUBIC_NAT(), a, b, c, d);
     }
 
-   
-
     template<class T>
     inline T interp_cubic_adj(uint8_t cst, T a, T b, T c, T d,T e,T f) {
-        if (cst==0)
-            return (-b+4*c+4*d-e)/6;
-        else
-            return (3*a-18*b+46*c+46*d-18*e+3*f)/62;
+        if (cst == 0)
+            return stencil_apply<T>(stencil::CUBIC_ADJ_NOKNOT(), b, c, d, e);
+        return stencil_apply<T>(stencil::CUBIC_ADJ_NAT(), a, b, c, d, e, f);
     }
 
     template<class T>
     inline T interp_cubic_adj2(uint8_t cst, T a, T b, T c, T d,T f) {
-        if (cst==0)
-            return (-4*b+15*c+10*d-f)/20;
-        else
-            return (12*a-72*b+181*c+118*d-15*f)/224;
+        if (cst == 0)
+            return stencil_apply<T>(stencil::CUBIC_ADJ2_NOKNOT(), b, c, d, f);
+        return stencil_apply<T>(stencil::CUBIC_ADJ2_NAT(), a, b, c, d, f);
     }
 
-    
-
-
-
-
-
     template<class T>
     inline T interp_cubic_adj_1(T a, T b, T c, T d,T e,T f) {//adj6 nat
-        return (3*a-18*b+46*c+46*d-18*e+3*f)/62;
-        //return (-3*b+11*c+11*d-3*e)/16;
+        return stencil_apply<T>(stencil::CUBIC_ADJ_NAT(), a, b, c, d, e, f);
     }
     template<class T>
     inline T interp_cubic_adj_2(T a, T b, T c, T d,T e,T f) {//adj6 noknot
-        return (-b+4*c+4*d-e)/6;
+        return stencil_apply<T>(stencil::CUBIC_ADJ_NOKNOT(), b, c, d, e);
     }
     template<class T>
     inline T interp_cubic_adj_3(T a, T b, T c, T d,T f) {//adj5 nat
-        return (12*a-72*b+181*c+118*d-15*f)/224;
-        //return (-3*b+11*c+11*d-3*e)/16;
+        return stencil_apply<T>(stencil::CUBIC_ADJ2_NAT(), a, b, c, d, f);
     }
     template<class T>
     inline T interp_cubic_adj_4(T a, T b, T c, T d,T f) {//adj5 noknot
-        return (-4*b+15*c+10*d-f)/20;
-        //return (-3*b+11*c+11*d-3*e)/16;
+        return stencil_apply<T>(stencil::CUBIC_ADJ2_NOKNOT(), b, c, d, f);
     }
 
 
     template<class T>
     inline T interp_2d(T a, T b, T c, T d) {
-        return ( a + b + c + d) / 4;
+        return stencil_apply<T>(stencil::AVE_4(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_3d(T a, T b, T c, T d, T e,T f) {
-        return ( a + b + c + d + e + f ) / 6;
+        return stencil_apply<T>(stencil::AVE_6(), a, b, c, d, e, f);
     }
 
     template<class T>
@@ -136,37 +179,37 @@ namespace QoZ {
 
     template<class T>
     inline T interp_ave3(T a, T b, T c) {
-        return (a + b+c) / 3;
+        return stencil_apply<T>(stencil::AVE_3(), a, b, c);
     }
 
     template<class T>
     inline T interp_cubic_front(T a, T b, T c, T d) {
-        return (5 * a + 15 * b - 5 * c + d) / 16;
+        return stencil_apply<T>(stencil::CUBIC_FRONT(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic_front_adj(T a, T b, T c, T d) {
-        return (17 * a + 44 * b - 18 * c + 3*d) / 46;
+        return stencil_apply<T>(stencil::CUBIC_FRONT_ADJ(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic_front_2(T a, T b, T c, T d) {
-        return ( a + 6 * b - 4 * c + d) / 4;
+        return stencil_apply<T>(stencil::CUBIC_FRONT_2(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic_back_1(T a, T b, T c, T d) {
-        return (a - 5 * b + 15 * c + 5 * d) / 16;
+        return stencil_apply<T>(stencil::CUBIC_BACK_1(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic_back_adj(T a, T b, T c, T d) {
-        return (3*a - 18 * b + 44 * c + 17 * d) / 46;
+        return stencil_apply<T>(stencil::CUBIC_BACK_ADJ(), a, b, c, d);
     }
 
     template<class T>
     inline T interp_cubic_back_2(T a, T b, T c, T d) {
-        return (-5 * a + 21 * b - 35 * c + 35 * d) / 16;
+        return stencil_apply<T>(stencil::CUBIC_BACK_2(), a, b, c, d);
     }
 
     
@@ -1,8 +1,12 @@
 #ifndef SZ_optimize_quant_intervals_hpp
 #define SZ_optimize_quant_intervals_hpp
 
+#include <algorithm>
+#include <cmath>
 #include <vector>
 #include "QoZ/predictor/MetaLorenzoPredictor.hpp"
+#include "QoZ/utils/Config.hpp"
+#include "QoZ/utils/Interpolators.hpp"
 
 namespace QoZ {
 
@@ -10,9 +14,10 @@ namespace QoZ {
 #define QuantIntvSampleDistance 100
 #define QuantIntvSampleCapacity 32768
 #define QuantIntvAccThreshold 0.999
+#define QuantIntvMinRadius 256
 
 // copied from conf.c
-    unsigned int
+    inline unsigned int
     round_up_power_of_2(unsigned int base) {
         base -= 1;
         base = base | (base >> 1);
@@ -145,6 +150,100 @@ namespace QoZ {
         float mean_freq = estimate_mean_freq_and_position(freq_intervals, precision, sample_count, mean_guess);
         return estimate_quantization_intervals(intervals, sample_count);
     }
+
+    /**
+     * Adds to intervals the histogram of the errors of predict(p), which predicts *p from its neighbours at most reach
+     * values away along the fastest dimension (of size r), for points of data (len values) sampled every sample_distance.
+     */
+    template<typename T, class Predict>
+    void sample_quant_errors(const T *data, size_t len, size_t r, double precision, size_t reach, size_t sample_distance,
+                             Predict &&predict, std::vector<size_t> &intervals, size_t &sample_count) {
+        for (size_t idx = 0; idx < len; idx += sample_distance) {
+            size_t i = idx % r;
+            if (i < reach || i + reach >= r) {
+                continue;
+            }
+            double pred_err = fabs((double) predict(data + idx) - data[idx]);
+            double pred_index = (pred_err / precision + 1) / 2;
+            intervals[pred_index < intervals.size() ? (size_t) pred_index : intervals.size() - 1]++;
+            sample_count++;
+        }
+    }
+
+    /**
+     * Radius of the quantization bins from a histogram of sampled errors. As in optimize_quant_invl_3d, the bins cover
+     * QuantIntvAccThreshold of the samples, with a power-of-2 margin, and at least QuantIntvMinRadius so that the
+     * coarser interpolation levels (larger errors, smaller error bounds) stay mostly predictable.
+     * The radius is at most max_radius, which is also returned if nothing could be sampled.
+     */
+    inline int estimate_quant_radius(const std::vector<size_t> &intervals, size_t sample_count, int max_radius) {
+        if (sample_count == 0) {
+            return max_radius;
+        }
+        int radius = estimate_quantization_intervals(intervals, sample_count) / 2;
+        return std::min(std::max(radius, QuantIntvMinRadius), max_radius);
+    }
+
+    /**
+     * Errors of the interpolation meta.interpAlgo (linear, cubic of meta.cubicSplineType, or quadratic) of sampled
+     * points along the fastest dimension (of size r) with strides 1 and 2, i.e. of the two finest levels, which hold
+     * most of the points.
+     */
+    template<typename T>
+    void sample_interp_errors(const T *data, size_t len, size_t r, double precision, const Interp_Meta &meta,
+                              size_t sample_distance, std::vector<size_t> &intervals, size_t &sample_count) {
+        for (ptrdiff_t s = 1; s <= 2; s++) {
+            if (meta.interpAlgo == INTERP_ALGO_LINEAR) {
+                sample_quant_errors(data, len, r, precision, s, sample_distance, [s](const T *p) {
+                    return interp_linear(p[-s], p[s]);
+                }, intervals, sample_count);
+            } else if (meta.interpAlgo == INTERP_ALGO_QUAD) {
+                sample_quant_errors(data, len, r, precision, 3 * s, sample_distance, [s](const T *p) {
+                    return interp_quad_1(p[-s], p[s], p[3 * s]);
+                }, intervals, sample_count);
+            } else {
+                uint8_t cst = meta.cubicSplineType;
+                sample_quant_errors(data, len, r, precision, 3 * s, sample_distance, [s, cst](const T *p) {
+                    return interp_cubic(cst, p[-3 * s], p[-s], p[s], p[3 * s]);
+                }, intervals, sample_count);
+            }
+        }
+    }
+
+    /**
+     * Radius of the quantization bins of the interpolation compressor, from the errors of the configured interpolation
+     * (see sample_interp_errors and estimate_quant_radius).
+     */
+    template<typename T>
+    int optimize_interp_quant_radius(const T *data, const std::vector<size_t> &dims, double precision,
+                                     const Interp_Meta &meta, int max_radius) {
+        size_t len = 1;
+        for (auto d: dims) {
+            len *= d;
+        }
+        std::vector<size_t> intervals(QuantIntvSampleCapacity, 0);
+        size_t sample_count = 0;
+        sample_interp_errors(data, len, dims.back(), precision, meta, (len / QuantIntvSampleCapacity) | 1, intervals,
+                             sample_count);
+        return estimate_quant_radius(intervals, sample_count, max_radius);
+    }
+
+    //same over blocks of the same dims, e.g. the sampled blocks of the tuning
+    template<typename T>
+    int optimize_interp_quant_radius(const std::vector<std::vector<T> > &blocks, const std::vector<size_t> &dims,
+                                     double precision, const Interp_Meta &meta, int max_radius) {
+        size_t len = 0;
+        for (auto &block: blocks) {
+            len += block.size();
+        }
+        std::vector<size_t> intervals(QuantIntvSampleCapacity, 0);
+        size_t sample_count = 0;
+        for (auto &block: blocks) {
+            sample_interp_errors(block.data(), block.size(), dims.back(), precision, meta,
+                                 (len / QuantIntvSampleCapacity) | 1, intervals, sample_count);
+        }
+        return estimate_quant_radius(intervals, sample_count, max_radius);
+    }
 }
 
 #endif
\ No newline at end of file
@@ -5,6 +5,9 @@
 
 #include "QoZ/utils/Interpolators.hpp"
 #include "QoZ/utils/CoeffRegression.hpp"
+#ifdef _OPENMP
+#include "omp.h"
+#endif
 namespace QoZ {
 
     
@@ -148,69 +151,96 @@ namespace QoZ {
 
 
 
-template<class T, uint N>
+    /**
+     * Fits the 4 cubic interpolation weights (neighbours at -3,-1,+1,+3 times the stride) by least squares over the
+     * points interpolated at the given stride. Every such point contributes one row per dimension. The normal
+     * equations are accumulated directly from the data, per thread on large inputs, and solved by Cholesky. The
+     * per-thread sums are merged in thread order, so that the coefficients do not depend on the scheduling.
+     */
+    template<class T, uint N>
     inline int
     calculate_interp_coeffs(T *data, std::vector<size_t> &dims,std::vector<double> &coeffs, size_t stride=2){
-
-        //size_t count=0;
-        std::vector<double>xs,ys; 
+        std::vector<NormalEquations<4>> partial(1);
         size_t stride2x=2*stride;
         if(N==3){
             size_t dimx=dims[0],dimy=dims[1],dimz=dims[2],dimyz=dimy*dimz;
-            //std::cout<<dimx<<" "<<dimy<<" "<<dimz<<std::endl;
-            for (size_t i = 3; i < dimx-3; i+=stride) {
-                for (size_t j = 3; j < dimy-3; j+=stride) {
-                    for (size_t k = 3; k < dimz-3; k+=stride) {
-                        if(i%stride2x==0 and j%stride2x==0 and k%stride2x==0)
-                            continue;
-                        //std::cout<<i<<" "<<j<<" "<<k<<std::endl;
-                        //count+=1;
-                        size_t idx=i*dimyz+j*dimz+k;
-                        T *d= data+idx;
-                        T cur_value=*d;
-                        //std::cout<<cur_value<<std::endl;
-                        std::vector<double>temp_xs={*(d - 3*dimyz),*(d - dimyz),*(d + dimyz), *(d + 3*dimyz),*(d - 3*dimz),*(d - dimz),*(d + dimz),*(d + 3*dimz),*(d - 3), *(d - 1), *(d + 1), *(d + 3)};
-                        //std::cout<<"dwa"<<std::endl;
-                        std::vector<double>temp_ys={cur_value,cur_value,cur_value};
-                       // std::cout<<"dwa2"<<std::endl;
-                        xs.insert(xs.end(),temp_xs.begin(),temp_xs.end());
-                        //std::cout<<"dwa3"<<std::endl;
-                        ys.insert(ys.end(),temp_ys.begin(),temp_ys.end());
-                        //std::cout<<"dwa4"<<std::endl;
-                       
-
+            if(dimx<7 or dimy<7 or dimz<7)
+                return 1;
+            bool parallel=dimx*dimyz>=(1<<22);
+#pragma omp parallel if(parallel)
+            {
+                int tid=0;
+#ifdef _OPENMP
+                tid=omp_get_thread_num();
+#pragma omp single
+                partial.resize(omp_get_num_threads());
+#endif
+                NormalEquations<4> local;
+                double x[4];
+#pragma omp for schedule(static)
+                for (size_t i = 3; i < dimx-3; i+=stride) {
+                    for (size_t j = 3; j < dimy-3; j+=stride) {
+                        for (size_t k = 3; k < dimz-3; k+=stride) {
+                            if(i%stride2x==0 and j%stride2x==0 and k%stride2x==0)
+                                continue;
+                            T *d= data+i*dimyz+j*dimz+k;
+                            double cur_value=*d;
+                            for (size_t off: {dimyz, dimz, (size_t) 1}) {
+                                x[0]=*(d - 3*off);
+                                x[1]=*(d - off);
+                                x[2]=*(d + off);
+                                x[3]=*(d + 3*off);
+                                local.add(x,cur_value);
+                            }
+                        }
                     }
                 }
+                partial[tid]=local;
             }
         }
 
         else if(N==2){
             size_t  dimx=dims[0],dimy=dims[1];
-            for (size_t i = 3; i < dimx-3; i+=stride) {
-                for (size_t j = 3; j < dimy-3; j+=stride) {
-                    if(i%stride2x==0 and j%stride2x==0)
-                        continue;
-                 
-                    //count+=1;
-                    size_t idx=i*dimy+j;
-                    T *d= data+idx;
-                    T cur_value=*d;
-
-                    std::vector<double>temp_xs={*(d - 3*dimy),*(d - dimy),*(d + dimy),*(d + 3*dimy),*(d - 3), *(d - 1), *(d + 1), *(d + 3)};
-                    std::vector<double>temp_ys={cur_value,cur_value,cur_value};
-                    xs.insert(xs.end(),temp_xs.begin(),temp_xs.end());
-                    ys.insert(xs.end(),temp_ys.begin(),temp_ys.end());
+            if(dimx<7 or dimy<7)
+                return 1;
+            bool parallel=dimx*dimy>=(1<<22);
+#pragma omp parallel if(parallel)
+            {
+                int tid=0;
+#ifdef _OPENMP
+                tid=omp_get_thread_num();
+#pragma omp single
+                partial.resize(omp_get_num_threads());
+#endif
+                NormalEquations<4> local;
+                double x[4];
+#pragma omp for schedule(static)
+                for (size_t i = 3; i < dimx-3; i+=stride) {
+                    for (size_t j = 3; j < dimy-3; j+=stride) {
+                        if(i%stride2x==0 and j%stride2x==0)
+                            continue;
+                        T *d= data+i*dimy+j;
+                        double cur_value=*d;
+                        for (size_t off: {dimy, (size_t) 1}) {
+                            x[0]=*(d - 3*off);
+                            x[1]=*(d - off);
+                            x[2]=*(d + off);
+                            x[3]=*(d + 3*off);
+                            local.add(x,cur_value);
+                        }
+                    }
                 }
+                partial[tid]=local;
             }
 
         }
-        int status;
-        auto reg_res=QoZ::Regression(xs.data(),ys.size(),4,ys.data(),status);
-        if(status==0){
-            coeffs.resize(4);
-            for(size_t i=0;i<4;i++)
-                coeffs[i]=reg_res[i];
-        }
+        NormalEquations<4> ne;
+        for (auto &p: partial)
+            ne.merge(p);
+        double res[4];
+        int status=ne.solve(res);
+        if(status==0)
+            coeffs.assign(res,res+4);
         return status;
     }
     
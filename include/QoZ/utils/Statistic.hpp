@@ -6,6 +6,11 @@
 #define SZ_STATISTIC_HPP
 
 #include "Config.hpp"
+#include <vector>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
 
 namespace QoZ {
     template<class T>
@@ -20,11 +25,107 @@ namespace QoZ {
         return max - min;
     }
 
-    uint8_t factorial(int n) {
+    //summary of the finite values of a field, see scan_data
+    struct DataScan {
+        double min = 0;
+        double max = 0;
+        double mean = 0;
+        double rms = 0;
+        size_t finite = 0;
+
+        double range() const {
+            return max - min;
+        }
+
+        bool constant() const {
+            return min == max;
+        }
+    };
+
+    /**
+     * One pass over the data for min/max/mean/rms of the finite values. If nonfinite is not null, it receives the
+     * positions of the NaN/Inf values in increasing order.
+     * The data is scanned in chunks, in parallel, with reductions the compiler can vectorize; only the chunks that
+     * contain non-finite values are scanned a second time, element by element.
+     */
+    template<class T>
+    DataScan scan_data(const T *data, size_t num, std::vector<size_t> *nonfinite = nullptr) {
+        const size_t chunk = 1 << 14;
+        size_t num_chunks = (num + chunk - 1) / chunk;
+        std::vector<T> cmin(num_chunks), cmax(num_chunks);
+        std::vector<double> csum(num_chunks), csq(num_chunks);
+        std::vector<size_t> cfinite(num_chunks);
+        std::vector<std::vector<size_t>> cpos(num_chunks);
+#pragma omp parallel for schedule(static) if(num_chunks >= 64)
+        for (size_t c = 0; c < num_chunks; c++) {
+            const T *x = data + c * chunk;
+            size_t n = std::min(chunk, num - c * chunk);
+            T mn = std::numeric_limits<T>::max(), mx = std::numeric_limits<T>::lowest();
+            double sum = 0, sq = 0;
+            size_t bad = 0;
+#pragma omp simd reduction(min:mn) reduction(max:mx) reduction(+:sum, sq, bad)
+            for (size_t i = 0; i < n; i++) {
+                T v = x[i];
+                mn = v < mn ? v : mn;
+                mx = v > mx ? v : mx;
+                sum += v;
+                sq += (double) v * v;
+                bad += !(v - v == 0);
+            }
+            if (bad) {
+                mn = std::numeric_limits<T>::max();
+                mx = std::numeric_limits<T>::lowest();
+                sum = sq = 0;
+                for (size_t i = 0; i < n; i++) {
+                    T v = x[i];
+                    if (!std::isfinite(v)) {
+                        if (nonfinite) {
+                            cpos[c].push_back(c * chunk + i);
+                        }
+                        continue;
+                    }
+                    mn = std::min(mn, v);
+                    mx = std::max(mx, v);
+                    sum += v;
+                    sq += (double) v * v;
+                }
+            }
+            cmin[c] = mn;
+            cmax[c] = mx;
+            csum[c] = sum;
+            csq[c] = sq;
+            cfinite[c] = n - bad;
+        }
+
+        DataScan scan;
+        T mn = std::numeric_limits<T>::max(), mx = std::numeric_limits<T>::lowest();
+        double sum = 0, sq = 0;
+        for (size_t c = 0; c < num_chunks; c++) {
+            if (cfinite[c]) {
+                mn = std::min(mn, cmin[c]);
+                mx = std::max(mx, cmax[c]);
+            }
+            sum += csum[c];
+            sq += csq[c];
+            scan.finite += cfinite[c];
+            if (nonfinite) {
+                nonfinite->insert(nonfinite->end(), cpos[c].begin(), cpos[c].end());
+            }
+        }
+        if (scan.finite) {
+            scan.min = mn;
+            scan.max = mx;
+            scan.mean = sum / scan.finite;
+            scan.rms = std::sqrt(sq / scan.finite);
+        }
+        return scan;
+    }
+
+    inline uint8_t factorial(int n) {
         return (n == 0) || (n == 1) ? 1 : n * factorial(n - 1);
     }
 
-    double computeABSErrBoundFromPSNR(double psnr, double threshold, double value_range) {
+    inline double computeABSErrBoundFromPSNR(double psnr, double threshold, double value_range) {
         double v1 = psnr + 10 * log10(1 - 2.0 / 3.0 * threshold);
         double v2 = v1 / (-20);
         double v3 = pow(10, v2);
@@ -59,8 +160,8 @@ namespace QoZ {
                 conf.rng=rng;
                 conf.absErrorBound = std::max(conf.absErrorBound, conf.relErrorBound *rng);
             } else {
-                printf("Error, error bound mode not supported\n");
-                exit(0);
+                //EB_BITRATE is resolved by the callers, see SZ_bitrate_error_bound
+                throw std::runtime_error("Error, error bound mode not supported");
             }
         }
     }
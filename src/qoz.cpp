@@ -0,0 +1,140 @@
+/**
+ * libqoz: the float/double x 1-4D instantiations of the QoZ API, and its C API.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include "QoZ/api/qoz.hpp"
+#include "QoZ/api/qoz.h"
+
+template char *SZ_compress<float>(QoZ::Config &, const float *, size_t &);
+template char *SZ_compress<double>(QoZ::Config &, const double *, size_t &);
+template char *SZ_compress_inplace<float>(QoZ::Config &, float *, size_t &);
+template char *SZ_compress_inplace<double>(QoZ::Config &, double *, size_t &);
+template void SZ_decompress<float>(QoZ::Config &, char *, size_t, float *&);
+template void SZ_decompress<double>(QoZ::Config &, char *, size_t, double *&);
+template float *SZ_decompress<float>(QoZ::Config &, char *, size_t);
+template double *SZ_decompress<double>(QoZ::Config &, char *, size_t);
+
+#define QoZ_INSTANTIATE_IMPL(T, N) \
+    template char *SZ_compress_impl<T, N>(QoZ::Config &, T *, size_t &); \
+    template void SZ_decompress_impl<T, N>(QoZ::Config &, char *, size_t, T *);
+
+QoZ_INSTANTIATE_IMPL(float, 1)
+QoZ_INSTANTIATE_IMPL(float, 2)
+QoZ_INSTANTIATE_IMPL(float, 3)
+QoZ_INSTANTIATE_IMPL(float, 4)
+QoZ_INSTANTIATE_IMPL(double, 1)
+QoZ_INSTANTIATE_IMPL(double, 2)
+QoZ_INSTANTIATE_IMPL(double, 3)
+QoZ_INSTANTIATE_IMPL(double, 4)
+
+#undef QoZ_INSTANTIATE_IMPL
+
+namespace {
+
+    template<class T>
+    char *compress(const void *data, QoZ::Config &conf, size_t *outSize) {
+        return SZ_compress<T>(conf, static_cast<const T *>(data), *outSize);
+    }
+
+    template<class T>
+    int decompress(char *cmpData, size_t cmpSize, void *decData, size_t num) {
+        QoZ::Config conf;
+        SZ_load_config(conf, cmpData, cmpSize);
+        if (conf.num != num) {
+            return -1;
+        }
+        QoZ::ArrayView<T> view(static_cast<T *>(decData), conf.dims);
+        return SZ_decompress<T>(conf, cmpData, cmpSize, view) ? 0 : -1;
+    }
+
+}
+
+//failures of the library (invalid configurations, corrupt streams, bad_alloc) are reported by exceptions, which
+//give NULL/-1 here, none crosses the C boundary
+
+char *qoz_compress(int dataType, const void *data, const size_t *dims, int ndims, int errorBoundMode,
+                   double errorBound, const char *configFile, size_t *outSize) {
+    if (data == nullptr or dims == nullptr or outSize == nullptr or ndims < 1 or ndims > 4) {
+        return nullptr;
+    }
+    try {
+        QoZ::Config conf;
+        conf.setDims(dims, dims + ndims);
+        if (configFile != nullptr) {
+            conf.loadcfg(configFile);
+        }
+        if (errorBoundMode >= 0) {
+            conf.errorBoundMode = errorBoundMode;
+            switch (errorBoundMode) {
+                case QoZ::EB_ABS:
+                    conf.absErrorBound = errorBound;
+                    break;
+                case QoZ::EB_REL:
+                    conf.relErrorBound = errorBound;
+                    break;
+                case QoZ::EB_PSNR:
+                    conf.psnrErrorBound = errorBound;
+                    break;
+                case QoZ::EB_L2NORM:
+                    conf.l2normErrorBound = errorBound;
+                    break;
+                case QoZ::EB_BITRATE:
+                    conf.targetBitrate = errorBound;
+                    break;
+                default:
+                    return nullptr;
+            }
+        }
+        if (dataType == QOZ_FLOAT) {
+            return compress<float>(data, conf, outSize);
+        } else if (dataType == QOZ_DOUBLE) {
+            return compress<double>(data, conf, outSize);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "qoz_compress: " << e.what() << std::endl;
+    }
+    return nullptr;
+}
+
+int qoz_get_dims(char *cmpData, size_t cmpSize, size_t *dims) {
+    if (cmpData == nullptr or dims == nullptr or cmpSize < sizeof(int)) {
+        return -1;
+    }
+    try {
+        QoZ::Config conf;
+        SZ_load_config(conf, cmpData, cmpSize);
+        if (conf.N < 1 or conf.N > 4 or conf.dims.size() != (size_t) conf.N) {
+            return -1;
+        }
+        std::copy(conf.dims.begin(), conf.dims.end(), dims);
+        return conf.N;
+    } catch (const std::exception &e) {
+        std::cerr << "qoz_get_dims: " << e.what() << std::endl;
+    }
+    return -1;
+}
+
+int qoz_decompress(int dataType, char *cmpData, size_t cmpSize, void *decData, size_t num) {
+    if (cmpData == nullptr or decData == nullptr or cmpSize < sizeof(int)) {
+        return -1;
+    }
+    try {
+        if (dataType == QOZ_FLOAT) {
+            return decompress<float>(cmpData, cmpSize, decData, num);
+        } else if (dataType == QOZ_DOUBLE) {
+            return decompress<double>(cmpData, cmpSize, decData, num);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "qoz_decompress: " << e.what() << std::endl;
+    }
+    return -1;
+}
+
+void qoz_free(char *cmpData) {
+    delete[] cmpData;
+}
+
+const char *qoz_version(void) {
+    return QoZ_VER;
+}
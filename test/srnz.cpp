@@ -2,10 +2,6 @@
 #include <cstdlib>
 #include <cmath>
 #include "QoZ/api/sz.hpp"
-#include <pybind11/embed.h>
-#include <pybind11/numpy.h>
-#include <pybind11/stl.h>
-namespace py = pybind11;
 
 #define SZ_FLOAT 0
 #define SZ_DOUBLE 1
@@ -33,6 +29,7 @@ void usage() {
     printf("	-o <path> : compressed output file, default in binary format\n");
     printf("	-z <path> : compressed output (w -i) or input (w/o -i) file\n");
     printf("	-t : store compressed output file in text format\n");
+    printf("	use - as <path> to read from stdin or write to stdout\n");
 //    printf("	-p: print meta data (configuration info)\n");
     printf("* data type:\n");
     printf("	-f: single precision (float type)\n");
@@ -49,6 +46,8 @@ void usage() {
     printf("		NORM (norm2 error : sqrt(sum(xi-xi')^2)\n");
     printf("		ABS_AND_REL (using min{ABS, REL})\n");
     printf("		ABS_OR_REL (using max{ABS, REL})\n");
+    printf("		BITRATE (target bits per value, the error bound is chosen by sample-based rate control)\n");
+    printf("		RATIO (target compression ratio, converted to BITRATE)\n");
     printf("	error bound can be set directly after the error control mode, or separately with the following options:\n");
     printf("		-A <absolute error bound>: specifying absolute error bound\n");
     printf("		-R <value_range based relative error bound>: specifying relative error bound\n");
@@ -70,6 +69,10 @@ void usage() {
     printf("        AC (autocorrelation)\n");
     printf("    -C <anchor stride> : stride of anchor points.\n");
     printf("    -B <sampling block size> : block size of sampled data block for auto-tuning.\n");
+    printf("    -K <chunk size> : compress into a chunk-indexed container with chunks of <chunk size> along every dimension.\n");
+    printf("    --estimate [fraction] : only predict compression ratio, PSNR and compression time from a sample of [fraction] (default 0.01) of the data.\n");
+    printf("                            With ALGO_INTERP_LORENZO on 2D/3D data the predictor is tuned as in compression, on a copy of the whole input.\n");
+    printf("    -W <bound,bound,...> : sweep, compress once per error bound (in the unit of -M) into <compressed file>.<bound> and print a rate-distortion table.\n");
     printf("* dimensions: \n");
     printf("	-1 <nx> : dimension for 1D data such as data[nx]\n");
     printf("	-2 <nx> <ny> : dimensions for 2D data such as data[ny][nx]\n");
@@ -142,13 +145,53 @@ void usage_sz2() {
 }
 
 template<class T>
-void compress(char *inPath, char *cmpPath, QoZ::Config &conf) {//conf changed to reference
-    T *data = new T[conf.num];
-    QoZ::readfile<T>(inPath, conf.num, data);
+void compress_sweep(char *inPath, char *cmpPath, QoZ::Config &conf, const std::vector<double> &bounds, const T *data) {
+    std::vector<size_t> outSizes;
+    std::vector<QoZ::SweepPoint> table;
+    QoZ::Timer timer(true);
+    auto streams = SZ_compress_sweep<T>(conf, data, bounds, outSizes, &table);
+    double compress_time = timer.stop();
+
+    for (size_t i = 0; i < streams.size(); i++) {
+        char outputFilePath[1024];
+        snprintf(outputFilePath, sizeof(outputFilePath), "%s.%g", cmpPath == nullptr ? inPath : cmpPath, bounds[i]);
+        QoZ::AsyncWriter writer(outputFilePath);
+        writer.write(streams[i], outSizes[i]);
+        if (!writer.close()) {
+            printf("Error: failed to write %s\n", outputFilePath);
+            exit(0);
+        }
+        delete[] streams[i];
+    }
+    QoZ::print_sweep_table(table);
+    printf("sweep time = %f\n", compress_time);
+}
+
+template<class T>
+void compress(char *inPath, char *cmpPath, QoZ::Config &conf, size_t chunkSize = 0, const std::vector<double> &sweep = std::vector<double>(),
+              double estimateRate = 0) {//conf changed to reference
+    QoZ::MappedFile input(inPath);
+    if (input.size() != conf.num * sizeof(T)) {
+        printf("Error: file size of %s does not match the input setting\n", inPath);
+        exit(0);
+    }
+    const T *data = input.data<T>();
+    if (estimateRate > 0) {
+        QoZ::print_estimate(SZ_estimate<T>(conf, data, estimateRate));
+        return;
+    }
+    if (!sweep.empty()) {
+        compress_sweep<T>(inPath, cmpPath, conf, sweep, data);
+        return;
+    }
 
     size_t outSize;
     QoZ::Timer timer(true);
-    char *bytes = SZ_compress<T>(conf, data, outSize);
+    char *bytes;
+    if (chunkSize > 0)
+        bytes = SZ_compress_chunked<T>(conf, data, outSize, std::vector<size_t>(conf.N, chunkSize));
+    else
+        bytes = SZ_compress<T>(conf, data, outSize);
     double compress_time = timer.stop();
    
 
@@ -159,7 +202,12 @@ void compress(char *inPath, char *cmpPath, QoZ::Config &conf) {//conf changed to
         strcpy(outputFilePath, cmpPath);
     }
    
-    QoZ::writefile(outputFilePath, bytes, outSize);
+    QoZ::AsyncWriter writer(outputFilePath);
+    writer.write(bytes, outSize);
+    if (!writer.close()) {
+        printf("Error: failed to write %s\n", outputFilePath);
+        exit(0);
+    }
 
 
     
@@ -169,7 +217,6 @@ void compress(char *inPath, char *cmpPath, QoZ::Config &conf) {//conf changed to
     printf("compression time = %f\n", compress_time);
     printf("compressed data file = %s\n", outputFilePath);
 
-    delete[]data;
     delete[]bytes;
   
 
@@ -181,14 +228,22 @@ void decompress(char *inPath, char *cmpPath, char *decPath,
                 QoZ::Config &conf,
                 int binaryOutput, int printCmpResults) {//conf changed to reference
 
-    size_t cmpSize;
-   
-    auto cmpData = QoZ::readfile<char>(cmpPath, cmpSize);
-    //std::cout<<"woshinidie"<<std::endl;
+    QoZ::MappedFile input(cmpPath);
+    size_t cmpSize = input.size();
+    //the decompressors take a mutable pointer but never write to the compressed data
+    char *cmpData = const_cast<char *>(input.data());
     
 
     QoZ::Timer timer(true);
-    T *decData = SZ_decompress<T>(conf, cmpData.get(), cmpSize);
+    T *decData = nullptr;
+    if (QoZ::is_container(cmpData, cmpSize)) {
+        if (!SZ_decompress_chunked<T>(conf, cmpData, cmpSize, decData)) {
+            printf("Error: failed to decompress the container %s\n", cmpPath);
+            exit(0);
+        }
+    } else {
+        decData = SZ_decompress<T>(conf, cmpData, cmpSize);
+    }
     double compress_time = timer.stop();
 
     char outputFilePath[1024];
@@ -197,17 +252,27 @@ void decompress(char *inPath, char *cmpPath, char *decPath,
     } else {
         strcpy(outputFilePath, decPath);
     }
+    QoZ::AsyncWriter writer(outputFilePath);
+    bool written;
     if (binaryOutput == 1) {
-        QoZ::writefile<T>(outputFilePath, decData, conf.num);
+        writer.write(decData, conf.num * sizeof(T));
+        written = writer.close();
     } else {
-        QoZ::writeTextFile<T>(outputFilePath, decData, conf.num);
+        written = QoZ::writeTextFile<T>(writer, decData, conf.num);
+    }
+    if (!written) {
+        printf("Error: failed to write %s\n", outputFilePath);
+        exit(0);
     }
     if (printCmpResults) {
         //compute the distortion / compression errors...
-        size_t totalNbEle;
-        auto ori_data = QoZ::readfile<T>(inPath, totalNbEle);
-        assert(totalNbEle == conf.num);
-        QoZ::verify<T>(ori_data.get(), decData, conf.num);
+        if (QoZ::is_std_stream(inPath)) {
+            printf("Error: cannot compare with the original data read from stdin\n");
+        } else {
+            QoZ::MappedFile ori_data(inPath);
+            assert(ori_data.size() == conf.num * sizeof(T));
+            QoZ::verify<T>(const_cast<T *>(ori_data.data<T>()), decData, conf.num);
+        }
     }
     delete[]decData;
 
@@ -239,6 +304,9 @@ int main(int argc, char *argv[]) {
     char *ckptPath = nullptr;
     int maxStep=0;
     int sampleBlockSize=0;
+    size_t chunkSize=0;
+    std::vector<double> sweep;
+    double estimateRate = 0;
 
     bool sz2mode = false;
     int qoz=1;
@@ -256,6 +324,13 @@ int main(int argc, char *argv[]) {
     int width = -1;
 
     for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--estimate") == 0) {
+            compression = true;
+            estimateRate = 0.01;
+            if (i + 1 < (size_t) argc && argv[i + 1][0] != '-' && sscanf(argv[i + 1], "%lf", &estimateRate) == 1)
+                i++;
+            continue;
+        }
         if (argv[i][0] != '-' || argv[i][2]) {
             if (argv[i][1] == 'h' && argv[i][2] == '2') {
                 usage_sz2();
@@ -283,7 +358,7 @@ int main(int argc, char *argv[]) {
                 compression = true;
                 if (i + 1 < argc) {
                     cmpPath = argv[i + 1];
-                    if (cmpPath[0] != '-')
+                    if (cmpPath[0] != '-' || QoZ::is_std_stream(cmpPath))
                         i++;
                     else
                         cmpPath = nullptr;
@@ -294,7 +369,7 @@ int main(int argc, char *argv[]) {
                 decompression = true;
                 if (i + 1 < argc) {
                     decPath = argv[i + 1];
-                    if (decPath[0] != '-')
+                    if (decPath[0] != '-' || QoZ::is_std_stream(decPath))
                         i++;
                     else
                         decPath = nullptr;
@@ -416,6 +491,18 @@ int main(int argc, char *argv[]) {
                 if (++i == argc || sscanf(argv[i], "%d", &sampleBlockSize) != 1)
                         usage();
                 break;
+            case 'K':
+                if (++i == (size_t) argc || sscanf(argv[i], "%zu", &chunkSize) != 1)
+                        usage();
+                break;
+            case 'W':
+                if (++i == (size_t) argc)
+                    usage();
+                for (char *tok = strtok(argv[i], ","); tok != nullptr; tok = strtok(nullptr, ","))
+                    sweep.push_back(atof(tok));
+                if (sweep.empty())
+                    usage();
+                break;
             case 'k':
                 if (++i == argc)
                     usage();
@@ -438,6 +525,10 @@ int main(int argc, char *argv[]) {
     if (cmpPath != nullptr && decPath != nullptr) {
         decompression = true;
     }
+    //data goes to stdout, so all messages are sent to stderr
+    if (QoZ::is_std_stream(decPath) || (compression && !decompression && QoZ::is_std_stream(cmpPath))) {
+        QoZ::reserve_stdout();
+    }
     char cmpPathTmp[1024];
     if (inPath != nullptr && cmpPath == nullptr && decPath != nullptr) {
         compression = true;
@@ -449,6 +540,11 @@ int main(int argc, char *argv[]) {
     if (inPath == nullptr||errBoundMode == nullptr) {
         compression = false;
     }
+    //an estimate writes nothing, so there is nothing to decompress afterwards
+    if (estimateRate > 0) {
+        decompression = false;
+        delCmpPath = false;
+    }
     if (!compression && !decompression) {
         usage();
         exit(0);
@@ -519,6 +615,16 @@ int main(int argc, char *argv[]) {
             conf.errorBoundMode = QoZ::EB_ABS_AND_REL;
         } else if (strcmp(errBoundMode, QoZ::EB_STR[QoZ::EB_ABS_OR_REL]) == 0) {
             conf.errorBoundMode = QoZ::EB_ABS_OR_REL;
+        } else if (strcmp(errBoundMode, QoZ::EB_STR[QoZ::EB_BITRATE]) == 0) {
+            conf.errorBoundMode = QoZ::EB_BITRATE;
+            if (errBound != nullptr) {
+                conf.targetBitrate = atof(errBound);
+            }
+        } else if (strcmp(errBoundMode, "RATIO") == 0) {
+            conf.errorBoundMode = QoZ::EB_BITRATE;
+            if (errBound != nullptr) {
+                conf.targetBitrate = (dataType == SZ_DOUBLE || dataType == SZ_INT64 ? 64.0 : 32.0) / atof(errBound);
+            }
         } else {
             printf("Error: wrong error bound mode setting by using the option '-M'\n");
             usage();
@@ -559,7 +665,7 @@ int main(int argc, char *argv[]) {
     if (compression) {
 
         if (dataType == SZ_FLOAT) {
-            compress<float>(inPath, cmpPath, conf);
+            compress<float>(inPath, cmpPath, conf, chunkSize, sweep, estimateRate);
         } 
         /*else if (dataType == SZ_DOUBLE) {
             compress<double>(inPath, cmpPath, conf);
@@ -0,0 +1,467 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <condition_variable>
+#include <glob.h>
+#include "QoZ/api/sz.hpp"
+
+/*
+ * Batch driver: compresses many single precision fields in one process with a bounded
+ * three-stage pipeline (read-ahead -> compression workers -> background writers).
+ * The stages overlap, so while one field is compressed the next ones are being read and the previous
+ * ones written. A field that fails (e.g. unreadable input, invalid settings, a failed write) is reported
+ * in the JSON report and does not stop the others.
+ */
+
+void usage() {
+    printf("Usage: srnz_batch <options>\n");
+    printf("Options:\n");
+    printf("* inputs (one of):\n");
+    printf("	-m <manifest> : text file, one field per line: <path> <error bound mode> <error bound> <nx> [ny] [nz] [np]\n");
+    printf("	                lines starting with # are ignored\n");
+    printf("	-g <pattern> : glob of input files, all sharing the dims and error bound given by -1/-2/-3/-4 and -M\n");
+    printf("* outputs:\n");
+    printf("	-O <dir> : directory of the compressed files, default next to the inputs (<input>.srnz)\n");
+    printf("	-j <path> : write the JSON report to <path> instead of stdout\n");
+    printf("* settings:\n");
+    printf("	-c <configuration file> : configuration file qoz.config\n");
+    printf("	-M <error control mode> <error bound> : ABS, REL, PSNR or NORM, used with -g\n");
+    printf("	-1 <nx> | -2 <nx> <ny> | -3 <nx> <ny> <nz> | -4 <nx> <ny> <nz> <np> : dimensions, used with -g\n");
+    printf("	-w <workers> : number of compression workers, default the number of cores\n");
+    printf("	               SR (on by default, SRNet = 0 in the configuration turns it off) runs an external python\n");
+    printf("	               model through shared temporary files, and the pybind wavelets share one interpreter,\n");
+    printf("	               so with either of them the fields are compressed by a single worker\n");
+    printf("	-W <writers> : number of background writers, default min(workers, 4)\n");
+    printf("	-Q <depth> : maximum number of fields read ahead or waiting to be written, default 2 x max(workers, writers)\n");
+    printf("* examples: \n");
+    printf("	srnz_batch -m fields.txt -c qoz.config -O cmp -j report.json\n");
+    printf("	srnz_batch -g 'run1/*.dat' -3 512 512 512 -M REL 1e-3 -c qoz.config\n");
+    exit(0);
+}
+
+struct Job {
+    size_t id;
+    std::string input, output;
+    QoZ::Config conf;
+    std::vector<float> data;
+    char *cmpData = nullptr;
+    size_t cmpSize = 0;
+    double readTime = 0, compressTime = 0, writeTime = 0;
+    bool ok = true;
+    std::string error;
+};
+
+//bounded FIFO between two pipeline stages, close() wakes up consumers once the producer is done
+template<class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return queue.size() < capacity; });
+        queue.push_back(std::move(item));
+        cv.notify_all();
+    }
+
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return closed or !queue.empty(); });
+        if (queue.empty())
+            return false;
+        item = std::move(queue.front());
+        queue.pop_front();
+        cv.notify_all();
+        return true;
+    }
+
+    void close() {
+        std::unique_lock<std::mutex> lock(mutex);
+        closed = true;
+        cv.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool closed = false;
+};
+
+bool set_error_bound(QoZ::Config &conf, const char *mode, double bound) {
+    if (strcmp(mode, QoZ::EB_STR[QoZ::EB_ABS]) == 0) {
+        conf.errorBoundMode = QoZ::EB_ABS;
+        conf.absErrorBound = bound;
+    } else if (strcmp(mode, QoZ::EB_STR[QoZ::EB_REL]) == 0 || strcmp(mode, "VR_REL") == 0) {
+        conf.errorBoundMode = QoZ::EB_REL;
+        conf.relErrorBound = bound;
+    } else if (strcmp(mode, QoZ::EB_STR[QoZ::EB_PSNR]) == 0) {
+        conf.errorBoundMode = QoZ::EB_PSNR;
+        conf.psnrErrorBound = bound;
+    } else if (strcmp(mode, QoZ::EB_STR[QoZ::EB_L2NORM]) == 0) {
+        conf.errorBoundMode = QoZ::EB_L2NORM;
+        conf.l2normErrorBound = bound;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+//dims are given fastest first as in srnz, the Config wants them slowest first
+void set_dims(QoZ::Config &conf, std::vector<size_t> dims) {
+    std::reverse(dims.begin(), dims.end());
+    conf.setDims(dims.begin(), dims.end());
+}
+
+std::string output_path(const std::string &input, const char *outDir) {
+    if (outDir == nullptr)
+        return input + ".srnz";
+    size_t slash = input.find_last_of('/');
+    std::string name = (slash == std::string::npos) ? input : input.substr(slash + 1);
+    return std::string(outDir) + "/" + name + ".srnz";
+}
+
+std::string json_escape(const std::string &s) {
+    std::string r;
+    for (char c: s) {
+        if (c == '"' || c == '\\') {
+            r += '\\';
+            r += c;
+        } else if ((unsigned char) c < 0x20) {
+            char hex[8];
+            snprintf(hex, sizeof(hex), "\\u%04x", (unsigned char) c);
+            r += hex;
+        } else {
+            r += c;
+        }
+    }
+    return r;
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+int main(int argc, char *argv[]) {
+    char *manifestPath = nullptr;
+    char *pattern = nullptr;
+    char *outDir = nullptr;
+    char *jsonPath = nullptr;
+    char *conPath = nullptr;
+    char *errBoundMode = nullptr;
+    double errBound = 0;
+    std::vector<size_t> dims;
+    size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t writers = 0;
+    size_t depth = 0;
+
+    if (argc == 1)
+        usage();
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][2])
+            usage();
+        switch (argv[i][1]) {
+            case 'm':
+                if (++i == argc)
+                    usage();
+                manifestPath = argv[i];
+                break;
+            case 'g':
+                if (++i == argc)
+                    usage();
+                pattern = argv[i];
+                break;
+            case 'O':
+                if (++i == argc)
+                    usage();
+                outDir = argv[i];
+                break;
+            case 'j':
+                if (++i == argc)
+                    usage();
+                jsonPath = argv[i];
+                break;
+            case 'c':
+                if (++i == argc)
+                    usage();
+                conPath = argv[i];
+                break;
+            case 'M':
+                if (i + 2 >= argc)
+                    usage();
+                errBoundMode = argv[++i];
+                errBound = atof(argv[++i]);
+                break;
+            case '1':
+            case '2':
+            case '3':
+            case '4': {
+                int n = argv[i][1] - '0';
+                dims.clear();
+                for (int d = 0; d < n; d++) {
+                    size_t v;
+                    if (++i == argc || sscanf(argv[i], "%zu", &v) != 1)
+                        usage();
+                    dims.push_back(v);
+                }
+                break;
+            }
+            case 'w':
+                if (++i == argc || sscanf(argv[i], "%zu", &workers) != 1 || workers == 0)
+                    usage();
+                break;
+            case 'W':
+                if (++i == argc || sscanf(argv[i], "%zu", &writers) != 1 || writers == 0)
+                    usage();
+                break;
+            case 'Q':
+                if (++i == argc || sscanf(argv[i], "%zu", &depth) != 1 || depth == 0)
+                    usage();
+                break;
+            default:
+                usage();
+                break;
+        }
+    }
+    if ((manifestPath == nullptr) == (pattern == nullptr)) {
+        printf("Error: specify either a manifest (-m) or a glob pattern (-g)\n");
+        usage();
+    }
+
+    //the report goes to stdout, progress messages of the compressors to stderr
+    if (jsonPath == nullptr)
+        QoZ::reserve_stdout();
+
+    QoZ::Config base;
+    if (conPath != nullptr) {
+        try {
+            base.loadcfg(conPath);
+        } catch (const std::exception &e) {
+            printf("Error: %s\n", e.what());
+            return 1;
+        }
+    }
+
+    std::vector<Job> jobs;
+    if (manifestPath != nullptr) {
+        std::ifstream manifest(manifestPath);
+        if (!manifest) {
+            printf("Error: cannot open the manifest %s\n", manifestPath);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(manifest, line)) {
+            std::istringstream ss(line);
+            Job job;
+            std::string mode;
+            double bound;
+            if (!(ss >> job.input) || job.input[0] == '#')
+                continue;
+            std::vector<size_t> d;
+            size_t v;
+            ss >> mode >> bound;
+            while (ss >> v)
+                d.push_back(v);
+            job.conf = base;
+            if (d.empty() || d.size() > 4 || !set_error_bound(job.conf, mode.c_str(), bound)) {
+                printf("Error: malformed manifest line: %s\n", line.c_str());
+                return 1;
+            }
+            set_dims(job.conf, d);
+            jobs.push_back(std::move(job));
+        }
+    } else {
+        if (dims.empty() || errBoundMode == nullptr) {
+            printf("Error: -g needs the dimensions and the error bound (-M)\n");
+            usage();
+        }
+        glob_t g;
+        int status = glob(pattern, 0, nullptr, &g);
+        if (status != 0) {
+            printf("Error: %s %s\n", status == GLOB_NOMATCH ? "no input file matches" : "cannot expand", pattern);
+            globfree(&g);
+            return 1;
+        }
+        for (size_t i = 0; i < g.gl_pathc; i++) {
+            Job job;
+            job.input = g.gl_pathv[i];
+            job.conf = base;
+            if (!set_error_bound(job.conf, errBoundMode, errBound)) {
+                printf("Error: wrong error bound mode setting by using the option '-M'\n");
+                usage();
+            }
+            set_dims(job.conf, dims);
+            jobs.push_back(std::move(job));
+        }
+        globfree(&g);
+    }
+    if (jobs.empty()) {
+        printf("Error: no input files\n");
+        return 1;
+    }
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobs[i].id = i;
+        jobs[i].output = output_path(jobs[i].input, outDir);
+    }
+
+    //SR inference runs an external python on fixed temporary files and the pybind wavelets share one interpreter,
+    //those configurations are compressed one at a time.
+    //decided from the loaded job configs, SRNet is on unless the configuration file turns it off
+    bool serial = std::any_of(jobs.begin(), jobs.end(), [](const Job &job) {
+        return job.conf.SRNet || job.conf.wavelet > 1;
+    });
+    if (serial && workers > 1) {
+        fprintf(stderr, "srnz_batch: SR or pybind wavelets are enabled, compressing with one worker\n");
+        workers = 1;
+    }
+    if (writers == 0)
+        writers = std::min<size_t>(workers, 4);
+    if (depth == 0)
+        depth = 2 * std::max(workers, writers);
+
+    BoundedQueue<Job *> toCompress(depth), toWrite(depth);
+    auto start = std::chrono::steady_clock::now();
+
+    std::thread reader([&]() {
+        for (auto &job: jobs) {
+            auto t = std::chrono::steady_clock::now();
+            if (access(job.input.c_str(), R_OK) != 0) {
+                job.ok = false;
+                job.error = "cannot open the input file";
+            } else {
+                try {
+                    QoZ::MappedFile input(job.input.c_str());
+                    if (input.size() != job.conf.num * sizeof(float)) {
+                        job.ok = false;
+                        job.error = "file size does not match the dimensions";
+                    } else {
+                        //the owned copy is also the compressor's scratch buffer, so the worker does not copy again
+                        job.data.assign(input.data<float>(), input.data<float>() + job.conf.num);
+                    }
+                } catch (const std::exception &e) {
+                    job.ok = false;
+                    job.error = e.what();
+                }
+            }
+            job.readTime = seconds_since(t);
+            toCompress.push(&job);
+        }
+        toCompress.close();
+    });
+
+    std::atomic<size_t> activeWorkers(workers);
+    std::vector<std::thread> compressors;
+    for (size_t w = 0; w < workers; w++) {
+        compressors.emplace_back([&]() {
+            Job *job;
+            while (toCompress.pop(job)) {
+                if (job->ok) {
+                    auto t = std::chrono::steady_clock::now();
+                    job->conf.openmp = false;
+                    try {
+                        job->cmpData = SZ_compress_inplace<float>(job->conf, job->data.data(), job->cmpSize);
+                    } catch (const std::exception &e) {
+                        job->ok = false;
+                        job->error = e.what();
+                    }
+                    job->compressTime = seconds_since(t);
+                    std::vector<float>().swap(job->data);
+                }
+                toWrite.push(job);
+            }
+            if (--activeWorkers == 0)
+                toWrite.close();
+        });
+    }
+
+    std::vector<std::thread> writerThreads;
+    for (size_t w = 0; w < writers; w++) {
+        writerThreads.emplace_back([&]() {
+            Job *job;
+            while (toWrite.pop(job)) {
+                if (!job->ok)
+                    continue;
+                auto t = std::chrono::steady_clock::now();
+                try {
+                    QoZ::AsyncWriter out(job->output.c_str());
+                    out.write(job->cmpData, job->cmpSize);
+                    if (!out.close()) {
+                        job->ok = false;
+                        job->error = "failed to write the output";
+                    }
+                } catch (const std::exception &e) {
+                    job->ok = false;
+                    job->error = e.what();
+                }
+                job->writeTime = seconds_since(t);
+                delete[] job->cmpData;
+                job->cmpData = nullptr;
+            }
+        });
+    }
+
+    reader.join();
+    for (auto &c: compressors)
+        c.join();
+    for (auto &w: writerThreads)
+        w.join();
+    double wall = seconds_since(start);
+
+    size_t bytesIn = 0, bytesOut = 0, failed = 0;
+    std::ostringstream json;
+    json << "{\n  \"files\": [\n";
+    for (size_t i = 0; i < jobs.size(); i++) {
+        auto &job = jobs[i];
+        size_t in = job.conf.num * sizeof(float);
+        json << "    {\"input\": \"" << json_escape(job.input) << "\", \"output\": \"" << json_escape(job.output)
+             << "\", \"ok\": " << (job.ok ? "true" : "false");
+        if (job.ok) {
+            bytesIn += in;
+            bytesOut += job.cmpSize;
+            json << ", \"bytes_in\": " << in << ", \"bytes_out\": " << job.cmpSize
+                 << ", \"ratio\": " << (double) in / job.cmpSize
+                 << ", \"read_s\": " << job.readTime << ", \"compress_s\": " << job.compressTime
+                 << ", \"write_s\": " << job.writeTime;
+        } else {
+            failed++;
+            json << ", \"error\": \"" << json_escape(job.error) << "\"";
+        }
+        json << "}" << (i + 1 < jobs.size() ? "," : "") << "\n";
+    }
+    json << "  ],\n  \"aggregate\": {\"files\": " << jobs.size() << ", \"failed\": " << failed
+         << ", \"workers\": " << workers << ", \"writers\": " << writers << ", \"bytes_in\": " << bytesIn << ", \"bytes_out\": " << bytesOut
+         << ", \"ratio\": " << (bytesOut > 0 ? (double) bytesIn / bytesOut : 0)
+         << ", \"wall_s\": " << wall << ", \"throughput_MBps\": " << bytesIn / 1e6 / wall << "}\n}\n";
+
+    bool written;
+    if (jsonPath != nullptr) {
+        std::ofstream report(jsonPath);
+        report << json.str();
+        report.close();
+        written = !report.fail();
+    } else {
+        try {
+            QoZ::AsyncWriter out("-");
+            out.write(json.str().data(), json.str().size());
+            written = out.close();
+        } catch (const std::exception &) {
+            written = false;
+        }
+    }
+    if (!written) {
+        fprintf(stderr, "srnz_batch: failed to write the report to %s\n", jsonPath != nullptr ? jsonPath : "stdout");
+        return 1;
+    }
+    return failed > 0;
+}
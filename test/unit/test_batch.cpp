@@ -0,0 +1,88 @@
+/**
+ * Round trip of batched patches, and rejection of corrupted batch indexes.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include <cstdio>
+#include <cmath>
+
+template<class T, QoZ::uint N>
+int test_batch(const std::vector<std::array<size_t, N>> &shapes) {
+    std::vector<std::vector<T>> fields;
+    std::vector<QoZ::Patch<T, N>> patches;
+    for (size_t p = 0; p < shapes.size(); p++) {
+        size_t num = 1;
+        for (auto d: shapes[p])
+            num *= d;
+        std::vector<T> field(num);
+        for (size_t i = 0; i < num; i++)
+            field[i] = std::sin(0.01 * i + p) + 0.1 * std::cos(0.3 * i);
+        fields.push_back(field);
+    }
+    for (size_t p = 0; p < shapes.size(); p++)
+        patches.push_back(QoZ::Patch<T, N>{fields[p].data(), shapes[p], int(p % 2)});
+
+    QoZ::Config conf;
+    conf.errorBoundMode = QoZ::EB_ABS;
+    conf.absErrorBound = 1e-3;
+    size_t cmpSize = 0;
+    char *cmpData = SZ_compress_batch<T, N>(conf, patches, cmpSize);
+
+    int failures = 0;
+    std::vector<std::vector<T>> decData;
+    if (!SZ_decompress_batch<T, N>(cmpData, cmpSize, decData) or decData.size() != fields.size()) {
+        printf("%uD batch: decompression failed\n", N);
+        failures++;
+    } else {
+        double maxErr = 0;
+        for (size_t p = 0; p < fields.size(); p++)
+            for (size_t i = 0; i < fields[p].size(); i++)
+                maxErr = std::max(maxErr, (double) std::fabs(fields[p][i] - decData[p][i]));
+        if (maxErr > conf.absErrorBound * (1 + 1e-6)) {
+            printf("%uD batch: max error %g exceeds %g\n", N, maxErr, conf.absErrorBound);
+            failures++;
+        }
+    }
+
+    //truncated stream, and an index claiming more patches than the stream holds
+    std::vector<char> bad(cmpData, cmpData + cmpSize);
+    if (QoZ::BatchReader<T, N>(bad.data(), cmpSize / 2).is_valid()) {
+        printf("%uD batch: truncated stream accepted\n", N);
+        failures++;
+    }
+    QoZ::BatchHeader header;
+    memcpy(&header, bad.data(), sizeof(header));
+    header.nPatches = (uint64_t) 1 << 60;
+    memcpy(bad.data(), &header, sizeof(header));
+    if (QoZ::BatchReader<T, N>(bad.data(), cmpSize).is_valid()) {
+        printf("%uD batch: oversized patch count accepted\n", N);
+        failures++;
+    }
+    //a patch pointing past the end of the stream
+    memcpy(bad.data(), cmpData, cmpSize);
+    QoZ::PatchEntry entry;
+    memcpy(&entry, bad.data() + sizeof(header), sizeof(entry));
+    entry.size = cmpSize;
+    memcpy(bad.data() + sizeof(header), &entry, sizeof(entry));
+    if (QoZ::BatchReader<T, N>(bad.data(), cmpSize).is_valid()) {
+        printf("%uD batch: out of range patch accepted\n", N);
+        failures++;
+    }
+    delete[] cmpData;
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    std::vector<std::array<size_t, 2>> shapes2;
+    std::vector<std::array<size_t, 3>> shapes3;
+    for (size_t p = 0; p < 12; p++) {
+        shapes2.push_back({16 + p, 32});
+        shapes3.push_back({16, 16 + p % 3, 24});
+    }
+    failures += test_batch<float, 2>(shapes2);
+    failures += test_batch<float, 3>(shapes3);
+    failures += test_batch<double, 3>(shapes3);
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+/**
+ * Round trip of the fast Lorenzo/regression frontend in 1D to 4D, with one slab and with several slabs,
+ * and decompression of 2D streams written before stream version 1 by the generic frontend.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include <cstdio>
+#include <cmath>
+
+#ifdef _OPENMP
+#include "omp.h"
+#endif
+
+template<class T>
+std::vector<T> make_field(size_t num) {
+    std::vector<T> field(num);
+    for (size_t i = 0; i < num; i++)
+        field[i] = std::sin(0.001 * i) + 0.1 * std::cos(0.03 * i) + 0.01 * std::sin(1.7 * i);
+    return field;
+}
+
+template<class T>
+QoZ::Config make_config(const std::vector<size_t> &dims) {
+    QoZ::Config conf;
+    conf.setDims(dims.begin(), dims.end());
+    conf.cmprAlgo = QoZ::ALGO_LORENZO_REG;
+    conf.errorBoundMode = QoZ::EB_ABS;
+    conf.absErrorBound = 1e-3;
+    conf.openmp = false;
+    conf.SRNet = false;
+    return conf;
+}
+
+template<class T>
+int check_round_trip(const char *name, const std::vector<T> &field, char *cmpData, size_t cmpSize, double eb) {
+    QoZ::Config conf;
+    SZ_load_config(conf, cmpData, cmpSize);
+    T *decData = SZ_decompress<T>(conf, cmpData, cmpSize);
+    double maxErr = 0;
+    for (size_t i = 0; i < field.size(); i++)
+        maxErr = std::max(maxErr, (double) std::fabs(field[i] - decData[i]));
+    delete[] decData;
+    if (conf.num != field.size() or maxErr > eb * (1 + 1e-6)) {
+        printf("%s: max error %g exceeds %g\n", name, maxErr, eb);
+        return 1;
+    }
+    return 0;
+}
+
+template<class T>
+int test_fast_frontend(const char *name, const std::vector<size_t> &dims, int threads) {
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#endif
+    auto conf = make_config<T>(dims);
+    auto field = make_field<T>(conf.num);
+    size_t cmpSize = 0;
+    char *cmpData = SZ_compress<T>(conf, field.data(), cmpSize);
+    int failures = check_round_trip<T>(name, field, cmpData, cmpSize, conf.absErrorBound);
+#ifdef _OPENMP
+    if (threads > 1) {
+        //several slabs restart the prediction, so the stream has to differ from the single-slab one,
+        //and it has to decompress with any number of threads
+        omp_set_num_threads(1);
+        size_t singleSize = 0;
+        char *single = SZ_compress<T>(conf, field.data(), singleSize);
+        if (singleSize == cmpSize and memcmp(single, cmpData, cmpSize) == 0) {
+            printf("%s: %d threads gave a single slab\n", name, threads);
+            failures++;
+        }
+        failures += check_round_trip<T>(name, field, cmpData, cmpSize, conf.absErrorBound);
+        delete[] single;
+    }
+#endif
+    delete[] cmpData;
+    return failures;
+}
+
+//stream of the generic frontend with the last strip bytes of its config cut, i.e. a config that ends before the
+//streamVersion field (or before constantField), with a single predictor, whose stream layout did not change since
+template<class T>
+int test_version0(const char *name, const std::vector<size_t> &dims, int strip) {
+    auto conf = make_config<T>(dims);
+    conf.lorenzo = true;
+    conf.lorenzo2 = conf.regression = conf.regression2 = false;
+    auto field = make_field<T>(conf.num);
+    auto quantizer = QoZ::LinearQuantizer<T>(conf.absErrorBound, conf.quantbinCnt / 2);
+    auto sz = make_lorenzo_regression_compressor<T, 2>(conf, quantizer, QoZ::HuffmanEncoder<int>(), QoZ::Lossless_zstd());
+    size_t cmpSize = 0;
+    auto work = field;
+    QoZ::uchar *payload = sz->compress(conf, work.data(), cmpSize);
+    std::vector<char> cmpData(cmpSize + QoZ::Config::size_est());
+    memcpy(cmpData.data(), payload, cmpSize);
+    delete[] payload;
+    SZ_save_config(conf, cmpData.data(), cmpSize);
+    int confSize;
+    memcpy(&confSize, cmpData.data() + cmpSize - sizeof(int), sizeof(int));
+    confSize -= strip;
+    cmpSize -= strip;
+    memcpy(cmpData.data() + cmpSize - sizeof(int), &confSize, sizeof(int));
+    return check_round_trip<T>(name, field, cmpData.data(), cmpSize, conf.absErrorBound);
+}
+
+int main() {
+    int failures = 0;
+    failures += test_fast_frontend<float>("1D", {100000}, 1);
+    failures += test_fast_frontend<float>("2D", {300, 400}, 1);
+    failures += test_fast_frontend<double>("3D", {40, 50, 60}, 1);
+    failures += test_fast_frontend<float>("4D", {5, 6, 70, 80}, 1);
+    failures += test_fast_frontend<float>("1D slabs", {1 << 20}, 4);
+    failures += test_fast_frontend<float>("3D slabs", {128, 128, 64}, 4);
+    failures += test_fast_frontend<double>("4D slabs", {4, 32, 64, 128}, 4);
+    failures += test_version0<float>("2D version 0", {300, 400}, sizeof(uint8_t));
+    failures += test_version0<float>("2D version 0 without constantField", {300, 400},
+                                     sizeof(uint8_t) + sizeof(bool) + sizeof(size_t));
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,64 @@
+/**
+ * Round trip of the interpolation compressors with the adaptive quantization radius (adaptiveQuantBins, on by
+ * default), with each interpolation, with the tuning of ALGO_INTERP_LORENZO, and on a field with spikes that fall
+ * outside the sampled radius.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include <cstdio>
+#include <cmath>
+
+template<class T>
+std::vector<T> make_field(size_t num, bool spikes) {
+    std::vector<T> field(num);
+    for (size_t i = 0; i < num; i++)
+        field[i] = std::sin(0.001 * i) + 0.1 * std::cos(0.03 * i) + 0.01 * std::sin(1.7 * i);
+    if (spikes) {
+        for (size_t i = 0; i < num; i += 997)
+            field[i] += 50;
+    }
+    return field;
+}
+
+template<class T>
+int test_round_trip(const char *name, QoZ::ALGO algo, uint8_t interpAlgo, bool spikes, double eb) {
+    QoZ::Config conf(48, 56, 64);
+    conf.cmprAlgo = algo;
+    conf.interpMeta.interpAlgo = interpAlgo;
+    conf.errorBoundMode = QoZ::EB_ABS;
+    conf.absErrorBound = eb;
+    conf.openmp = false;
+    conf.SRNet = false;
+    auto field = make_field<T>(conf.num, spikes);
+    size_t cmpSize = 0;
+    char *cmpData = SZ_compress<T>(conf, field.data(), cmpSize);
+    QoZ::Config dconf;
+    SZ_load_config(dconf, cmpData, cmpSize);
+    T *decData = SZ_decompress<T>(dconf, cmpData, cmpSize);
+    double maxErr = 0;
+    for (size_t i = 0; i < field.size(); i++)
+        maxErr = std::max(maxErr, (double) std::fabs(field[i] - decData[i]));
+    delete[] decData;
+    delete[] cmpData;
+    if (maxErr > eb * (1 + 1e-6)) {
+        printf("%s: max error %g exceeds %g\n", name, maxErr, eb);
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    int failures = 0;
+    if (!QoZ::Config().adaptiveQuantBins) {
+        printf("adaptiveQuantBins is off by default\n");
+        failures++;
+    }
+    failures += test_round_trip<float>("linear", QoZ::ALGO_INTERP, QoZ::INTERP_ALGO_LINEAR, false, 1e-3);
+    failures += test_round_trip<float>("cubic", QoZ::ALGO_INTERP, QoZ::INTERP_ALGO_CUBIC, false, 1e-3);
+    failures += test_round_trip<double>("quad", QoZ::ALGO_INTERP, QoZ::INTERP_ALGO_QUAD, false, 1e-4);
+    failures += test_round_trip<float>("cubic with spikes", QoZ::ALGO_INTERP, QoZ::INTERP_ALGO_CUBIC, true, 1e-4);
+    failures += test_round_trip<float>("tuned", QoZ::ALGO_INTERP_LORENZO, QoZ::INTERP_ALGO_CUBIC, false, 1e-3);
+    failures += test_round_trip<double>("tuned with spikes", QoZ::ALGO_INTERP_LORENZO, QoZ::INTERP_ALGO_CUBIC, true, 1e-5);
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,130 @@
+/**
+ * Round trip of fields with NaN/Inf values (all non-finite, runs at the start and at the end of the data) and of
+ * constant fields, and rejection of corrupted lists of non-finite values.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include <cstdio>
+#include <cmath>
+#include <limits>
+
+template<class T>
+std::vector<T> make_field(size_t num) {
+    std::vector<T> field(num);
+    for (size_t i = 0; i < num; i++)
+        field[i] = std::sin(0.001 * i) + 0.1 * std::cos(0.03 * i);
+    return field;
+}
+
+template<class T>
+QoZ::Config make_config(const std::vector<size_t> &dims) {
+    QoZ::Config conf;
+    conf.setDims(dims.begin(), dims.end());
+    conf.cmprAlgo = QoZ::ALGO_LORENZO_REG;
+    conf.errorBoundMode = QoZ::EB_ABS;
+    conf.absErrorBound = 1e-3;
+    conf.openmp = false;
+    conf.SRNet = false;
+    return conf;
+}
+
+//non-finite values have to come back bit-exact, finite ones within the error bound
+template<class T>
+int test_round_trip(const char *name, const std::vector<size_t> &dims, const std::vector<T> &field) {
+    auto conf = make_config<T>(dims);
+    size_t cmpSize = 0;
+    char *cmpData = SZ_compress<T>(conf, field.data(), cmpSize);
+    QoZ::Config dconf;
+    SZ_load_config(dconf, cmpData, cmpSize);
+    T *decData = SZ_decompress<T>(dconf, cmpData, cmpSize);
+    int failures = 0;
+    for (size_t i = 0; i < field.size() and failures == 0; i++) {
+        bool ok = std::isfinite(field[i]) ? std::fabs(field[i] - decData[i]) <= conf.absErrorBound * (1 + 1e-6)
+                                          : memcmp(&field[i], &decData[i], sizeof(T)) == 0;
+        if (!ok) {
+            printf("%s: value %zu is %g instead of %g\n", name, i, (double) decData[i], (double) field[i]);
+            failures++;
+        }
+    }
+    delete[] decData;
+    delete[] cmpData;
+    return failures;
+}
+
+template<class T>
+int test_all_nonfinite(const char *name) {
+    std::vector<T> field(300 * 400, std::numeric_limits<T>::quiet_NaN());
+    for (size_t i = 0; i < 1000; i++)
+        field[i] = std::numeric_limits<T>::infinity();
+    return test_round_trip<T>(name, {300, 400}, field);
+}
+
+template<class T>
+int test_leading_trailing(const char *name) {
+    auto field = make_field<T>(300 * 400);
+    for (size_t i = 0; i < 500; i++) {
+        field[i] = std::numeric_limits<T>::quiet_NaN();
+        field[field.size() - 1 - i] = -std::numeric_limits<T>::infinity();
+    }
+    return test_round_trip<T>(name, {300, 400}, field);
+}
+
+//range within the error bound, with and without non-finite values
+template<class T>
+int test_constant(const char *name, bool nonfinite) {
+    std::vector<T> field(300 * 400);
+    for (size_t i = 0; i < field.size(); i++)
+        field[i] = 1 + 4e-4 * std::sin(0.01 * i);
+    if (nonfinite) {
+        field[0] = field[12345] = std::numeric_limits<T>::quiet_NaN();
+    }
+    int failures = test_round_trip<T>(name, {300, 400}, field);
+    auto conf = make_config<T>({300, 400});
+    size_t cmpSize = 0;
+    char *cmpData = SZ_compress<T>(conf, field.data(), cmpSize);
+    QoZ::Config dconf;
+    SZ_load_config(dconf, cmpData, cmpSize);
+    if (!dconf.constantField) {
+        printf("%s: not stored as a constant field\n", name);
+        failures++;
+    }
+    delete[] cmpData;
+    return failures;
+}
+
+template<class T>
+int expect_throw(const char *name, std::vector<T> &data, const std::vector<QoZ::uchar> &runs, size_t size) {
+    try {
+        QoZ::decode_nonfinite(data.data(), data.size(), runs.data(), size);
+    } catch (std::runtime_error &) {
+        return 0;
+    }
+    printf("%s: corrupted list accepted\n", name);
+    return 1;
+}
+
+template<class T>
+int test_corrupted(const char *name) {
+    std::vector<T> data(1000, 0);
+    data[10] = data[11] = data[999] = std::numeric_limits<T>::quiet_NaN();
+    auto runs = QoZ::encode_nonfinite(data.data(), std::vector<size_t>{10, 11, 999});
+    int failures = 0;
+    std::vector<T> shorter(999);
+    failures += expect_throw<T>(name, shorter, runs, runs.size());
+    failures += expect_throw<T>(name, data, runs, runs.size() - 1);
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    failures += test_all_nonfinite<float>("all non-finite float");
+    failures += test_all_nonfinite<double>("all non-finite double");
+    failures += test_leading_trailing<float>("leading and trailing float");
+    failures += test_leading_trailing<double>("leading and trailing double");
+    failures += test_constant<float>("constant", false);
+    failures += test_constant<float>("constant with NaN", true);
+    failures += test_corrupted<float>("corrupted float");
+    failures += test_corrupted<double>("corrupted double");
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
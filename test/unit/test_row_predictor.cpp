@@ -0,0 +1,78 @@
+/**
+ * The row-wise predictions of the block-wise frontend (PredictorInterface::predict_row) have to be bit-identical to
+ * the element-wise predict, which existing streams were written with.
+ */
+
+#include "QoZ/api/sz.hpp"
+#include <cstdio>
+#include <cmath>
+#include <cstring>
+#include <random>
+
+template<class T, QoZ::uint N, class Predictor>
+int test_row_predictor(const char *name, Predictor predictor, const std::array<size_t, N> &dims, size_t block_size) {
+    size_t num = 1;
+    for (auto d: dims)
+        num *= d;
+    std::vector<T> data(num);
+    std::mt19937 gen(N);
+    std::uniform_real_distribution<double> noise(-1, 1);
+    for (size_t i = 0; i < num; i++)
+        data[i] = std::sin(0.01 * i) * 1000 + noise(gen);
+
+    auto block_range = std::make_shared<QoZ::multi_dimensional_range<T, N>>(
+            data.data(), std::begin(dims), std::end(dims), block_size, 0);
+    auto element_range = std::make_shared<QoZ::multi_dimensional_range<T, N>>(
+            data.data(), std::begin(dims), std::end(dims), 1, 0);
+    QoZ::BlockCursor<T, N> cursor(data.data(), dims, block_size);
+    QoZ::RowStencil<T> stencil;
+    std::vector<T> pred(block_size);
+    size_t mismatches = 0, checked = 0;
+    for (auto block = block_range->begin(); block != block_range->end(); ++block) {
+        element_range->update_block_range(block, block_size);
+        if (!predictor.precompress_block(element_range)) {
+            continue;
+        }
+        std::array<size_t, N> index;
+        for (QoZ::uint i = 0; i < N; i++)
+            index[i] = block.get_local_index(i);
+        cursor.set_block(index);
+        auto element = element_range->begin();
+        for (; cursor.has_row(); cursor.next_row()) {
+            int order = predictor.predict_row(cursor, pred.data(), stencil);
+            const T *x = cursor.row();
+            size_t col = cursor.get_global_index(N - 1);
+            for (size_t i = 0; i < cursor.row_length(); i++, ++element) {
+                T x1 = i + col > 0 ? x[(long) i - 1] : 0, x2 = i + col > 1 ? x[(long) i - 2] : 0;
+                T row = order == 0 ? pred[i] : stencil.add_terms(order == 1 ? x1 : 2 * x1 - x2, i);
+                T point = predictor.predict(element);
+                if (memcmp(&row, &point, sizeof(T)) != 0 and !(row == 0 and point == 0)) {
+                    mismatches++;
+                }
+                checked++;
+            }
+        }
+    }
+    if (mismatches or checked == 0) {
+        printf("%s: %zu of %zu row predictions differ from predict (%zu elements)\n", name, mismatches, checked, num);
+        return 1;
+    }
+    return 0;
+}
+
+int main() {
+    int failures = 0;
+    const double eb = 1e-3;
+    failures += test_row_predictor<float, 1>("1D Lorenzo", QoZ::LorenzoPredictor<float, 1, 1>(eb), {1000}, 128);
+    failures += test_row_predictor<float, 1>("1D Lorenzo2", QoZ::LorenzoPredictor<float, 1, 2>(eb), {1000}, 128);
+    failures += test_row_predictor<float, 2>("2D Lorenzo", QoZ::LorenzoPredictor<float, 2, 1>(eb), {50, 70}, 16);
+    failures += test_row_predictor<float, 2>("2D Lorenzo2", QoZ::LorenzoPredictor<float, 2, 2>(eb), {50, 70}, 16);
+    failures += test_row_predictor<float, 3>("3D Lorenzo", QoZ::LorenzoPredictor<float, 3, 1>(eb), {20, 21, 22}, 6);
+    failures += test_row_predictor<double, 3>("3D Lorenzo2", QoZ::LorenzoPredictor<double, 3, 2>(eb), {20, 21, 22}, 6);
+    failures += test_row_predictor<float, 4>("4D Lorenzo", QoZ::LorenzoPredictor<float, 4, 1>(eb), {7, 8, 9, 10}, 6);
+    failures += test_row_predictor<float, 2>("2D regression", QoZ::RegressionPredictor<float, 2>(16, eb), {50, 70}, 16);
+    failures += test_row_predictor<double, 3>("3D regression", QoZ::RegressionPredictor<double, 3>(6, eb), {20, 21, 22}, 6);
+    failures += test_row_predictor<float, 3>("3D poly regression", QoZ::PolyRegressionPredictor<float, 3>(6, eb), {20, 21, 22}, 6);
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
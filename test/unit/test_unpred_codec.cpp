@@ -0,0 +1,165 @@
+/**
+ * Round trip of the unpredictable values of LinearQuantizer (codec of type 0b00000011): values on and off the grid
+ * of the secondary quantizer, non-finite values, several blocks; loading of the verbatim type 0b00000010, and
+ * rejection of truncated or corrupted blocks.
+ */
+
+#include "QoZ/quantizer/IntegerQuantizer.hpp"
+#include <cstdio>
+#include <cmath>
+#include <limits>
+#include <random>
+
+template<class T>
+using Quantizer = QoZ::LinearQuantizer<T>;
+
+//fills q with n unpredictable values, and returns them as they are to be decoded
+template<class T>
+std::vector<T> make_unpred(Quantizer<T> &q, size_t n) {
+    std::mt19937 gen(42);
+    std::uniform_real_distribution<double> dist(-1000, 1000);
+    std::vector<T> values;
+    for (size_t i = 0; i < n; i++) {
+        T v = dist(gen);
+        switch (i % 8) {
+            case 0:
+            case 1:
+            case 2:
+                //rounded to the grid of 2 eb by the quantizer
+                q.quantize_and_overwrite(v, 0);
+                values.push_back(v);
+                continue;
+            case 3:
+                v = (T) (1e30 / (i + 1));
+                break;
+            case 4:
+                v = i % 16 == 4 ? std::numeric_limits<T>::quiet_NaN() : -std::numeric_limits<T>::infinity();
+                break;
+            case 5:
+                v = std::numeric_limits<T>::denorm_min() * (T) (i % 7);
+                break;
+            case 6:
+                v = i % 16 == 6 ? (T) -0.0 : std::nextafter(v, (T) 0);
+                break;
+            default:
+                //off the grid of 2 eb, kept verbatim
+                break;
+        }
+        q.insert_unpred(v);
+        values.push_back(v);
+    }
+    return values;
+}
+
+template<class T>
+int check_values(const char *name, Quantizer<T> &q, const std::vector<T> &values) {
+    for (size_t i = 0; i < values.size(); i++) {
+        T v = q.recover_unpred();
+        if (memcmp(&v, &values[i], sizeof(T)) != 0) {
+            printf("%s: value %zu is %g instead of %g\n", name, i, (double) v, (double) values[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+template<class T>
+std::vector<QoZ::uchar> save(Quantizer<T> &q) {
+    std::vector<QoZ::uchar> buf(q.size_est());
+    QoZ::uchar *c = buf.data();
+    q.save(c);
+    buf.resize(c - buf.data());
+    return buf;
+}
+
+template<class T>
+int test_round_trip(const char *name, size_t n) {
+    Quantizer<T> q(1e-3, 4);
+    auto values = make_unpred(q, n);
+    auto buf = save(q);
+    Quantizer<T> r;
+    const QoZ::uchar *c = buf.data();
+    size_t remaining = buf.size();
+    r.load(c, remaining);
+    if (remaining != 0 or c != buf.data() + buf.size()) {
+        printf("%s: %zu bytes left after loading\n", name, remaining);
+        return 1;
+    }
+    return check_values(name, r, values);
+}
+
+//type 0b00000010: header, then the values verbatim
+template<class T>
+int test_legacy(const char *name) {
+    std::vector<T> values = {1.5, -2.25, std::numeric_limits<T>::infinity(), (T) 1e-3, 12345.678};
+    std::vector<QoZ::uchar> buf(1 + sizeof(double) + sizeof(int) + sizeof(size_t) + values.size() * sizeof(T));
+    QoZ::uchar *c = buf.data();
+    double eb = 1e-3;
+    int radius = 32768;
+    size_t n = values.size();
+    *c++ = 0b00000010;
+    memcpy(c, &eb, sizeof(double));
+    c += sizeof(double);
+    memcpy(c, &radius, sizeof(int));
+    c += sizeof(int);
+    memcpy(c, &n, sizeof(size_t));
+    c += sizeof(size_t);
+    memcpy(c, values.data(), n * sizeof(T));
+    Quantizer<T> r;
+    const QoZ::uchar *p = buf.data();
+    size_t remaining = buf.size();
+    r.load(p, remaining);
+    if (remaining != 0 or r.get_eb() != eb or r.get_radius() != radius) {
+        printf("%s: wrong header\n", name);
+        return 1;
+    }
+    return check_values(name, r, values);
+}
+
+template<class T>
+int expect_throw(const char *name, const std::vector<QoZ::uchar> &buf, size_t size) {
+    try {
+        Quantizer<T> r;
+        const QoZ::uchar *c = buf.data();
+        size_t remaining = size;
+        r.load(c, remaining);
+    } catch (std::runtime_error &) {
+        return 0;
+    }
+    printf("%s: corrupted stream accepted\n", name);
+    return 1;
+}
+
+template<class T>
+int test_truncated(const char *name) {
+    Quantizer<T> q(1e-3, 4);
+    make_unpred(q, 10000);
+    auto buf = save(q);
+    int failures = 0;
+    failures += expect_throw<T>(name, buf, buf.size() - 1);
+    failures += expect_throw<T>(name, buf, 20);
+    //first block one byte shorter than written, so that it ends in the middle of a value
+    const size_t header = 1 + sizeof(double) + sizeof(int) + sizeof(size_t) + sizeof(double);
+    auto cut = buf;
+    uint32_t block_size;
+    memcpy(&block_size, cut.data() + header, sizeof(uint32_t));
+    block_size--;
+    memcpy(cut.data() + header, &block_size, sizeof(uint32_t));
+    failures += expect_throw<T>(name, cut, cut.size());
+    return failures;
+}
+
+int main() {
+    int failures = 0;
+    failures += test_round_trip<float>("float", 1000);
+    failures += test_round_trip<double>("double", 1000);
+    failures += test_round_trip<float>("float blocks", 50000);
+    failures += test_round_trip<double>("double blocks", 4097);
+    failures += test_round_trip<float>("empty", 0);
+    failures += test_legacy<float>("legacy float");
+    failures += test_legacy<double>("legacy double");
+    failures += test_truncated<float>("truncated float");
+    failures += test_truncated<double>("truncated double");
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}